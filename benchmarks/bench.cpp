@@ -0,0 +1,920 @@
+/*
+ * docpp - C++ library for generating HTML, CSS and SGML-like documents.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ * Copyright (c) 2024 speedie <speedie@speedie.site>
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <src/docpp.cpp>
+
+namespace {
+    std::atomic<std::size_t> allocations{0};
+}
+
+// the replacements are kept out of line, so the compiler never pairs an inlined malloc() or free() with operator new or delete
+#if defined(__GNUC__)
+#define DOCPP_BENCH_NOINLINE __attribute__((noinline))
+#else
+#define DOCPP_BENCH_NOINLINE
+#endif
+
+DOCPP_BENCH_NOINLINE void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+DOCPP_BENCH_NOINLINE void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+DOCPP_BENCH_NOINLINE void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+    /**
+     * @brief The measurements of a single benchmark.
+     */
+    struct Result {
+        std::string name{};
+        std::size_t iterations{0};
+        double ns_per_op{0};
+        double allocs_per_op{0};
+        double bytes_per_second{0};
+    };
+
+    std::vector<Result> results{};
+    std::string filter{};
+    bool json{false};
+
+    /**
+     * @brief Prevent the compiler from optimizing away a value.
+     */
+    template <typename T> void keep(const T& value) {
+#if defined(__GNUC__)
+        asm volatile("" : : "r"(&value) : "memory");
+#else
+        static volatile const void* sink{nullptr};
+        sink = &value;
+#endif
+    }
+
+    /**
+     * @brief Run a function until enough time has passed to get a stable measurement, and record the results.
+     * @param name The name of the benchmark
+     * @param function The function to run once per iteration
+     * @param bytes The number of bytes produced per iteration, used to report throughput. 0 if not applicable.
+     */
+    template <typename F> void run(const std::string& name, F function, const std::size_t bytes = 0) {
+        using clock = std::chrono::steady_clock;
+
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+
+        std::size_t iterations{1};
+
+        for (;;) {
+            const std::size_t allocations_before{allocations.load()};
+            const clock::time_point start{clock::now()};
+
+            for (std::size_t i{0}; i < iterations; i++) {
+                function();
+            }
+
+            const double elapsed{std::chrono::duration<double, std::nano>(clock::now() - start).count()};
+
+            if (elapsed > 2e8 || iterations >= (std::size_t{1} << 30)) {
+                Result result{};
+
+                result.name = name;
+                result.iterations = iterations;
+                result.ns_per_op = elapsed / static_cast<double>(iterations);
+                result.allocs_per_op = static_cast<double>(allocations.load() - allocations_before) / static_cast<double>(iterations);
+                result.bytes_per_second = bytes ? static_cast<double>(bytes) * 1e9 / result.ns_per_op : 0;
+
+                if (!json) {
+                    std::printf("%-40s %12zu iterations %12.2f ns/op %10.2f allocs/op",
+                        name.c_str(), result.iterations, result.ns_per_op, result.allocs_per_op);
+
+                    if (bytes) {
+                        std::printf(" %10.2f MB/s", result.bytes_per_second / 1e6);
+                    }
+
+                    std::printf("\n");
+                }
+
+                results.push_back(result);
+                return;
+            }
+
+            iterations *= 2;
+        }
+    }
+
+    /**
+     * @brief Escape a string for use in a JSON string literal.
+     */
+    std::string escape_json(const std::string& str) {
+        std::string ret{};
+
+        for (const char c : str) {
+            if (c == '"' || c == '\\') {
+                ret += '\\';
+            }
+
+            ret += c;
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief Print the recorded results as a JSON document, for comparison between builds.
+     */
+    void print_json() {
+        std::printf("{\n    \"version\": \"%s\",\n    \"benchmarks\": [\n", DOCPP_VERSION);
+
+        for (std::size_t i{0}; i < results.size(); i++) {
+            const Result& it = results.at(i);
+
+            std::printf("        {\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.2f, \"bytes_per_second\": %.0f}%s\n",
+                escape_json(it.name).c_str(), it.iterations, it.ns_per_op, it.allocs_per_op, it.bytes_per_second, i + 1 < results.size() ? "," : "");
+        }
+
+        std::printf("    ]\n}\n");
+    }
+
+    /**
+     * @brief The way resolve_tag() used to look up names: build the whole map, then scan it.
+     */
+    docpp::HTML::Tag resolve_tag_by_map(const std::string& tag) {
+        for (const auto& it : docpp::HTML::get_tag_map()) {
+            if (it.second.first == tag) {
+                return it.first;
+            }
+        }
+
+        throw docpp::invalid_argument{"Invalid tag"};
+    }
+
+    void bench_resolve_tag() {
+        const std::vector<std::string> names{"a", "h1", "div", "abbr", "table", "blockquote", "figcaption", "xmp"};
+
+        run("resolve_tag(Tag::Div)", []() {
+            keep(docpp::HTML::resolve_tag(docpp::HTML::Tag::Div));
+        });
+        run("resolve_tag(Tag::Xmp)", []() {
+            keep(docpp::HTML::resolve_tag(docpp::HTML::Tag::Xmp));
+        });
+
+        for (const std::string& name : names) {
+            run("resolve_tag(\"" + name + "\")", [&name]() {
+                keep(docpp::HTML::resolve_tag(name));
+            });
+        }
+
+        run("resolve_tag(\"not-a-tag\")", []() {
+            static const std::string name{"not-a-tag"};
+
+            try {
+                keep(docpp::HTML::resolve_tag(name));
+            } catch (const docpp::invalid_argument&) {
+            }
+        });
+
+        for (const std::string& name : {std::string{"a"}, std::string{"xmp"}}) {
+            run("get_tag_map() scan \"" + name + "\"", [&name]() {
+                keep(resolve_tag_by_map(name));
+            });
+        }
+    }
+
+    /**
+     * @brief Build a product listing page into section, the way a request handler would.
+     * @param section The section to build into. Products, their data and their property values are built in the same arena as the section.
+     * @param products The number of products on the page
+     */
+    void build_page(docpp::HTML::Section& section, const std::size_t products) {
+        using namespace docpp::HTML;
+
+        docpp::Arena* arena{section.get_arena()};
+
+        // text is built where it is stored, so adding it to the section moves it rather than copying it
+        const auto text = [arena](const char* prefix, const std::string& id, const char* suffix) {
+            docpp::String ret{prefix, docpp::ArenaAllocator<char>{arena}};
+
+            ret.append(id.data(), id.size()).append(suffix);
+
+            return ret;
+        };
+        const auto properties = [arena]() {
+            return arena ? Properties{*arena} : Properties{};
+        };
+
+        for (std::size_t i{0}; i < products; i++) {
+            const std::string id{std::to_string(i)};
+            Section product{arena ? Section{*arena} : Section{}};
+            Properties product_properties{properties()};
+
+            product_properties.reserve(2);
+            product_properties.emplace_back("class", "product");
+            product_properties.emplace_back("id", text("product-", id, ""));
+            product.set_tag(Tag::Div);
+            product.set_properties(std::move(product_properties));
+
+            Properties title{properties()};
+            title.emplace_back("class", "product-title");
+            product.emplace_back(Tag::H2, std::move(title), text("Product number ", id, ""));
+
+            Properties image{properties()};
+            image.reserve(2);
+            image.emplace_back("src", text("/images/product-", id, ".png"));
+            image.emplace_back("alt", text("A picture of product ", id, ""));
+            product.emplace_back(Tag::Img, std::move(image));
+
+            Properties description{properties()};
+            description.emplace_back("class", "product-description");
+            product.emplace_back(Tag::P, std::move(description), text("This is the description of product number ", id, "."));
+
+            Properties price{properties()};
+            price.emplace_back("class", "price");
+            product.emplace_back(Tag::Span, std::move(price), text("$", id, ".99"));
+
+            section.push_back(std::move(product));
+        }
+    }
+
+    void bench_arena() {
+        const std::size_t products{200};
+
+        run("build page (heap)", [products]() {
+            docpp::HTML::Document document{};
+            build_page(document.get_section(), products);
+            keep(document);
+        });
+        run("build page (arena)", [products]() {
+            docpp::Arena arena{};
+            docpp::HTML::Document document{arena};
+            build_page(document.get_section(), products);
+            keep(document);
+        });
+        run("build and get page (heap)", [products]() {
+            docpp::HTML::Document document{};
+            build_page(document.get_section(), products);
+            keep(document.get());
+        });
+        run("build and get page (arena)", [products]() {
+            docpp::Arena arena{};
+            docpp::HTML::Document document{arena};
+            build_page(document.get_section(), products);
+            keep(document.get());
+        });
+    }
+
+    /**
+     * @brief Count the properties on a page by walking it with the read-only accessors.
+     * @param section The section to walk
+     * @return std::size_t The number of properties
+     */
+    std::size_t count_properties(const docpp::HTML::Section& section) {
+        std::size_t ret{section.get_properties().size()};
+
+        for (const docpp::HTML::Element& it : section.get_elements()) {
+            ret += it.get_properties().size();
+        }
+
+        for (const docpp::HTML::Section& it : section.get_sections()) {
+            ret += count_properties(it);
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief Count the properties on a page by walking its children in document order.
+     * @param section The section to walk
+     * @return std::size_t The number of properties
+     */
+    std::size_t count_properties_children(const docpp::HTML::Section& section) {
+        std::size_t ret{section.get_properties().size()};
+
+        for (const docpp::HTML::Section::Node& it : section.children()) {
+            if (it.is_element()) {
+                ret += it.get_element().get_properties().size();
+            } else {
+                ret += count_properties_children(it.get_section());
+            }
+        }
+
+        return ret;
+    }
+
+    void bench_traverse() {
+        docpp::HTML::Document document{};
+        build_page(document.get_section(), 200);
+
+        run("traverse page", [&document]() {
+            keep(count_properties(document.get_section()));
+        });
+        run("traverse page (children)", [&document]() {
+            keep(count_properties_children(document.get_section()));
+        });
+    }
+
+    void bench_index() {
+        using namespace docpp::HTML;
+
+        Document document{};
+        build_page(document.get_section(), 200);
+
+        Section& section{document.get_section()};
+        Section* product{nullptr};
+
+        for (Section::Node& it : section.children()) {
+            product = &it.get_section();
+        }
+
+        run("Section::find by id (200 products)", [&section]() {
+            keep(section.find("product-150"));
+        });
+        run("Section::get_by_id (200 products, no index)", [&section]() {
+            keep(section.get_by_id("product-150"));
+        });
+
+        section.set_indexing(true);
+
+        run("Section::get_by_id (200 products)", [&section]() {
+            keep(section.get_by_id("product-150"));
+        });
+        run("Section::get_by_class (200 products)", [&section]() {
+            keep(section.get_by_class("price").size());
+        });
+        run("Section::insert and erase, then get_by_tag (200 products)", [product, &section]() {
+            product->insert(4, Element{Tag::Span, Properties{Property{"class", "sale"}}, "On sale"});
+            product->erase(4);
+            keep(section.get_by_tag(Tag::Span).size());
+        });
+    }
+
+    /**
+     * @brief Build a section with many children side by side.
+     * @param children The number of children
+     * @return docpp::HTML::Section The section
+     */
+    docpp::HTML::Section make_wide(const std::size_t children) {
+        using namespace docpp::HTML;
+
+        Section section{Tag::Div, Properties{Property{"class", "wide"}}};
+
+        for (std::size_t i{0}; i < children; i++) {
+            section.push_back(Element{Tag::P, Properties{Property{"id", "p-" + std::to_string(i)}}, "Paragraph number " + std::to_string(i)});
+        }
+
+        return section;
+    }
+
+    /**
+     * @brief Build a chain of nested sections, each with one element next to the next section.
+     * @param depth The number of nested sections
+     * @return docpp::HTML::Section The outermost section
+     */
+    docpp::HTML::Section make_deep(const std::size_t depth) {
+        using namespace docpp::HTML;
+
+        Section section{Tag::Div, {}};
+
+        for (std::size_t i{0}; i < depth; i++) {
+            Section parent{Tag::Div, Properties{Property{"class", "level-" + std::to_string(i)}}};
+
+            parent.push_back(Element{Tag::Span, {}, "Level " + std::to_string(i)});
+            parent.push_back(std::move(section));
+
+            section = std::move(parent);
+        }
+
+        return section;
+    }
+
+    void bench_render() {
+        using namespace docpp::HTML;
+
+        const Element element{Tag::A, Properties{std::vector<Property>{Property{"href", "https://example.com/"}, Property{"class", "link"}}}, "An example link"};
+
+        run("Element::get", [&element]() {
+            keep(element.get());
+        }, element.get().size());
+
+        const Section wide{make_wide(1000)};
+
+        run("Section::get (wide)", [&wide]() {
+            keep(wide.get());
+        }, wide.get().size());
+
+        const Section deep{make_deep(100)};
+
+        run("Section::get (deep)", [&deep]() {
+            keep(deep.get());
+        }, deep.get().size());
+
+        const Section deepest{make_deep(100000)};
+
+        run("Section::get (100000 levels)", [&deepest]() {
+            keep(deepest.get());
+        }, deepest.get().size());
+
+        Document document{};
+        build_page(document.get_section(), 200);
+
+        const std::vector<std::pair<std::string, Formatting>> formattings{
+            {"None", Formatting::None},
+            {"Pretty", Formatting::Pretty},
+            {"Newline", Formatting::Newline},
+            {"Minified", Formatting::Minified},
+        };
+
+        for (const auto& it : formattings) {
+            const Formatting formatting{it.second};
+
+            run("Document::get (" + it.first + ")", [&document, formatting]() {
+                keep(document.get(formatting));
+            }, document.get(formatting).size());
+        }
+    }
+
+    /**
+     * @brief Enable caching on a section and all of its descendants.
+     * @param section The section
+     */
+    void enable_caching(docpp::HTML::Section& section) {
+        section.set_caching(true);
+
+        for (docpp::HTML::Section::Node& it : section.children()) {
+            if (it.is_section()) {
+                enable_caching(it.get_section());
+            }
+        }
+    }
+
+    /**
+     * @brief Get the innermost section of a chain of nested sections.
+     * @param section The outermost section
+     * @return docpp::HTML::Section& The innermost section
+     */
+    docpp::HTML::Section& innermost(docpp::HTML::Section& section) {
+        for (docpp::HTML::Section::Node& it : section.children()) {
+            if (it.is_section()) {
+                return innermost(it.get_section());
+            }
+        }
+
+        return section;
+    }
+
+    void bench_cache() {
+        using namespace docpp::HTML;
+
+        Section deep{make_deep(100)};
+        Section& leaf{innermost(deep)};
+
+        enable_caching(deep);
+
+        run("Section::get (deep, cached, unchanged)", [&deep]() {
+            keep(deep.get());
+        }, deep.get().size());
+        run("Section::get (deep, cached, leaf changed)", [&deep, &leaf]() {
+            leaf.set_tag("div");
+            keep(deep.get());
+        }, deep.get().size());
+
+        Document document{};
+        build_page(document.get_section(), 200);
+        enable_caching(document.get_section());
+
+        Section* product{nullptr};
+        std::size_t index{0};
+
+        for (Section::Node& it : document.get_section().children()) {
+            if (it.is_section() && index++ == 100) {
+                product = &it.get_section();
+            }
+        }
+
+        run("Document::get (cached, one product changed)", [&document, product]() {
+            product->set_tag(Tag::Div);
+            keep(document.get());
+        }, document.get().size());
+    }
+
+    void bench_hash() {
+        using namespace docpp::HTML;
+
+        Document document{};
+        build_page(document.get_section(), 200);
+
+        const std::string page{document.get()};
+
+        run("Hash (200 products)", [&page]() {
+            keep(docpp::Hash{page}.get_64());
+        }, page.size());
+        run("Sha256 (200 products)", [&page]() {
+            docpp::Sha256 digest{};
+            digest.update(page.data(), page.size());
+            keep(digest.get());
+        }, page.size());
+        run("Document::get, then Hash (200 products)", [&document]() {
+            const std::string out{document.get()};
+            keep(docpp::Hash{out}.get_64());
+        }, page.size());
+        run("Document::get with Hash (200 products)", [&document]() {
+            docpp::Hash hash{};
+            keep(document.get(hash));
+            keep(hash.get_64());
+        }, page.size());
+
+        enable_caching(document.get_section());
+
+        run("Document::get_hash (cached, 200 products)", [&document]() {
+            keep(document.get_hash().get_64());
+        }, page.size());
+    }
+
+    void bench_diff() {
+        using namespace docpp::HTML;
+
+        Document before{};
+        build_page(before.get_section(), 200);
+
+        Document after{before};
+        Section* product{nullptr};
+
+        for (Section::Node& it : after.get_section().children()) {
+            if (it.is_section()) {
+                product = &it.get_section();
+            }
+        }
+
+        product->push_back(Element{Tag::P, {}, "Sold out"});
+
+        const std::size_t size{before.get().size()};
+
+        run("diff (200 products, one changed)", [&before, &after]() {
+            keep(diff(before, after).size());
+        }, size);
+        run("Document::get, then compare (200 products, one changed)", [&before, &after]() {
+            keep(before.get() == after.get());
+        }, size);
+        run("diff and apply (200 products, one changed)", [&before, &after]() {
+            Document document{before};
+            document.get_section().apply(diff(before, after));
+            keep(document.get_section().size());
+        }, size);
+    }
+
+    void bench_atoms() {
+        using namespace docpp::HTML;
+
+        run("build table (100000 cells)", []() {
+            Section table{Tag::Table, {}};
+
+            for (std::size_t i{0}; i < 100000; i++) {
+                table.push_back(Element{Tag::Td, Properties{Property{"class", "cell"}}, "x"});
+            }
+
+            keep(table.size());
+        });
+
+        Section table{Tag::Table, {}};
+
+        for (std::size_t i{0}; i < 100000; i++) {
+            table.push_back(Element{"td", Properties{Property{"class", "cell"}}, std::to_string(i % 100)});
+        }
+
+        run("Section::operator[] by tag (100000 cells)", [&table]() {
+            keep(table["td"].size());
+        });
+        std::vector<Properties> rows{};
+
+        for (const Element& it : table.get_elements()) {
+            rows.push_back(it.get_properties());
+        }
+
+        run("Properties::find by key (100000 cells)", [&rows]() {
+            const Property key{"class", "other"};
+            std::size_t count{0};
+
+            for (Properties& it : rows) {
+                count += it.find(key) != Properties::npos;
+            }
+
+            keep(count);
+        });
+    }
+
+    void bench_elements() {
+        using namespace docpp::HTML;
+
+        run("construct Element from Tag", []() {
+            keep(Element{Tag::Blockquote, {}, "x"}.get_type());
+        });
+
+        const Element first{Tag::Td, Properties{Property{"class", "cell"}}, "x"};
+        const Element second{"td", Properties{Property{"class", "cell"}}, "x"};
+        const Element custom{"my-cell", Properties{Property{"class", "cell"}}, "x"};
+
+        run("Element::operator== (equal)", [&first, &second]() {
+            keep(first == second);
+        });
+        run("Element::operator== (custom tag)", [&first, &custom]() {
+            keep(first == custom);
+        });
+    }
+
+    void bench_query() {
+        using namespace docpp::HTML;
+
+        // five nodes per product
+        Section section{Tag::Body, {}};
+        build_page(section, 20000);
+
+        const std::string id{"product-19999"};
+
+        run("Section::find by id (20000 products)", [&section, &id]() {
+            keep(section.find(id));
+        });
+        run("get_sections and get_elements loop (20000 products)", [&section]() {
+            std::size_t count{0};
+
+            for (const Section& it : section.get_sections()) {
+                if (it.get_properties().at(0).get_value() != "product") {
+                    continue;
+                }
+
+                for (const Element& element : it.get_elements()) {
+                    count += element.get_tag() == "span" && element.get_properties().at(0).get_value() == "price";
+                }
+            }
+
+            keep(count);
+        });
+        run("query_selector_all (20000 products, no index)", [&section]() {
+            keep(section.query_selector_all("div.product > span.price").size());
+        });
+
+        section.set_indexing(true);
+        keep(section.query_selector("#" + id));
+
+        const Selector price{"div.product > span.price"};
+        const Selector product{"#" + id};
+
+        run("query_selector_all (20000 products)", [&section, &price]() {
+            keep(section.query_selector_all(price).size());
+        });
+        run("query_selector by id (20000 products)", [&section, &product]() {
+            keep(section.query_selector(product));
+        });
+    }
+
+    /**
+     * @brief Escape a string one character at a time, the way callers had to before docpp could escape.
+     */
+    std::string escape_bytewise(const std::string& str) {
+        std::string ret{};
+
+        for (const char c : str) {
+            switch (c) {
+                case '&': ret += "&amp;"; break;
+                case '<': ret += "&lt;"; break;
+                case '>': ret += "&gt;"; break;
+                default: ret += c; break;
+            }
+        }
+
+        return ret;
+    }
+
+    void bench_escape() {
+        std::string clean{};
+        std::string dirty{};
+        std::string utf8{};
+
+        while (clean.size() < 16384) {
+            clean += "The quick brown fox jumps over the lazy dog. ";
+            dirty += "if (a < b && c > d) { return a & b; } ";
+            utf8 += "Blåbærsyltetøy på brødskiva, naïve café. ";
+        }
+
+        const std::vector<std::pair<std::string, const std::string*>> inputs{
+            {"clean ASCII", &clean},
+            {"dirty ASCII", &dirty},
+            {"UTF-8", &utf8},
+        };
+
+        for (const auto& it : inputs) {
+            const std::string& input{*it.second};
+
+            run("escape (" + it.first + ")", [&input]() {
+                keep(docpp::HTML::escape(input));
+            }, input.size());
+            run("escape bytewise (" + it.first + ")", [&input]() {
+                keep(escape_bytewise(input));
+            }, input.size());
+        }
+
+        docpp::HTML::Element element{docpp::HTML::Tag::P, {}, clean};
+        element.set_escape(docpp::HTML::Escape::Always);
+
+        run("Element::get (escaped, clean ASCII)", [&element]() {
+            keep(element.get());
+        }, clean.size());
+    }
+
+    void bench_parse() {
+        docpp::HTML::Document document{};
+        build_page(document.get_section(), 2000);
+
+        const std::string page{document.get()};
+        const std::string pretty{document.get(docpp::HTML::Formatting::Pretty)};
+
+        run("parse_document (page)", [&page]() {
+            keep(docpp::HTML::parse_document(page));
+        }, page.size());
+        run("parse_document (page, Pretty)", [&pretty]() {
+            keep(docpp::HTML::parse_document(pretty));
+        }, pretty.size());
+        run("parse (page, arena)", [&page]() {
+            docpp::Arena arena{};
+            keep(docpp::HTML::parse(page, arena));
+        }, page.size());
+    }
+
+    void bench_threads() {
+        using namespace docpp::HTML;
+
+        Section section{};
+        build_page(section, 5000);
+
+        const std::size_t bytes{section.serialized_size()};
+        const unsigned int hardware{std::max(std::thread::hardware_concurrency(), 1u)};
+
+        for (const unsigned int threads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+            if (threads > 1 && threads > hardware * 2) {
+                break;
+            }
+
+            section.set_threads(threads);
+
+            run("Section::get (5000 products, " + std::to_string(threads) + " threads)", [&section]() {
+                keep(section.get());
+            }, bytes);
+        }
+    }
+
+    void bench_template() {
+        using namespace docpp::HTML;
+
+        const auto make_page = [](const std::string& user, const std::string& cart) {
+            Document document{};
+            document.get_section().push_back(Element{Tag::H1, {}, "Welcome back, " + user});
+            document.get_section().push_back(Element{Tag::A, Properties{Property{"href", "/cart/" + cart}}, "Your cart"});
+            build_page(document.get_section(), 200);
+            return document;
+        };
+
+        const Document source{make_page(placeholder("user"), placeholder("cart"))};
+        const Document page{make_page("Jane", "42")};
+        const std::vector<std::string> values{"Jane", "42"};
+
+        for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Newline}) {
+            const std::string suffix{formatting == Formatting::None ? "" : formatting == Formatting::Pretty ? " (Pretty)" : " (Newline)"};
+            const Template templ{source, formatting};
+            const std::size_t bytes{templ.serialized_size(values)};
+
+            run("Document::get (200 products)" + suffix, [&page, formatting]() {
+                keep(page.get(formatting));
+            }, bytes);
+            run("Template::get (200 products)" + suffix, [&templ, &values]() {
+                keep(templ.get(values));
+            }, bytes);
+        }
+    }
+
+    void bench_mutate() {
+        using namespace docpp::HTML;
+
+        Section section{make_wide(1000)};
+        const Element last{section.back()};
+
+        run("Section::find (element)", [&section, &last]() {
+            keep(section.find(last));
+        });
+        run("Section::find (string)", [&section]() {
+            keep(section.find("Paragraph number 999"));
+        });
+        run("Section::erase and insert", [&section]() {
+            section.erase(500);
+            section.insert(500, Element{Tag::P, {}, "Replacement"});
+        });
+    }
+
+    void bench_stylesheet() {
+        using namespace docpp::CSS;
+
+        Stylesheet stylesheet{};
+
+        for (std::size_t i{0}; i < 200; i++) {
+            stylesheet.push_back(Element{".class-" + std::to_string(i), std::vector<Property>{
+                Property{"color", "#" + std::to_string(100000 + i)},
+                Property{"margin", std::to_string(i) + "px"},
+                Property{"display", "block"},
+            }});
+        }
+
+        run("Stylesheet::get", [&stylesheet]() {
+            keep(stylesheet.get());
+        }, stylesheet.get().size());
+        run("Stylesheet::get (Pretty)", [&stylesheet]() {
+            keep(stylesheet.get(Formatting::Pretty));
+        }, stylesheet.get(Formatting::Pretty).size());
+        run("Stylesheet::get (Minified)", [&stylesheet]() {
+            keep(stylesheet.get(Formatting::Minified));
+        }, stylesheet.get(Formatting::Minified).size());
+
+        const std::string css{stylesheet.get()};
+        const std::string pretty{stylesheet.get(Formatting::Pretty)};
+
+        run("CSS::parse", [&css]() {
+            keep(parse(css));
+        }, css.size());
+        run("CSS::parse (Pretty)", [&pretty]() {
+            keep(parse(pretty));
+        }, pretty.size());
+
+        // every selector is used by two rules in a row, so half of the rules are merged into the other half
+        Stylesheet large{};
+
+        for (std::size_t i{0}; i < 20000; i++) {
+            large.push_back(Element{".class-" + std::to_string(i / 2), std::vector<Property>{
+                Property{"color", "#aabbcc"},
+                Property{i % 2 ? "margin" : "padding", "0px"},
+                Property{"display", "block"},
+            }});
+        }
+
+        run("Stylesheet::optimize (20000 rules)", [&large]() {
+            Stylesheet copy{large};
+            copy.optimize();
+            keep(copy.size());
+        });
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    for (int i{1}; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--help") == 0) {
+            std::printf("usage: %s [--json] [filter]\n", argv[0]);
+            return 0;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    bench_resolve_tag();
+    bench_render();
+    bench_cache();
+    bench_hash();
+    bench_diff();
+    bench_escape();
+    bench_parse();
+    bench_template();
+    bench_threads();
+    bench_mutate();
+    bench_stylesheet();
+    bench_arena();
+    bench_traverse();
+    bench_index();
+    bench_query();
+    bench_atoms();
+    bench_elements();
+
+    if (json) {
+        print_json();
+    }
+
+    return 0;
+}
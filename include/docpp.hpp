@@ -14,6 +14,14 @@
 #include <utility>
 #include <type_traits>
 #include <tuple>
+#include <cstdio>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <cstddef>
+#include <cstdint>
 
 /**
  * @brief A namespace to represent HTML elements and documents
@@ -47,6 +55,603 @@ namespace docpp {
             explicit invalid_argument(const char* message) : message(message) {};
     };
 
+    /**
+     * @brief A class to represent an exception when writing to a sink fails
+     */
+    class io_error : public std::exception {
+        private:
+            const char* message{"I/O error"};
+        public:
+            const char* what() const noexcept override {
+                return message;
+            }
+            io_error() = default;
+            explicit io_error(const char* message) : message(message) {};
+    };
+
+    /**
+     * @brief A class to represent a fast, non-cryptographic 128-bit hash of serialized output.
+     * The hash of two pieces of output written one after the other can be computed from the hashes of the pieces, without reading the bytes again.
+     */
+    class Hash {
+        private:
+            std::uint64_t hash[2]{0, 0};
+            std::uint64_t power[2]{1, 1};
+            std::uint64_t length{0};
+        public:
+            using size_type = std::size_t;
+
+            /**
+             * @brief Construct a new Hash object, the hash of no output
+             */
+            Hash() = default;
+            /**
+             * @brief Construct a new Hash object
+             * @param data The data to hash
+             * @param size The number of bytes to hash
+             */
+            Hash(const char* data, const size_type size) {
+                this->update(data, size);
+            };
+            /**
+             * @brief Construct a new Hash object
+             * @param str The string to hash
+             */
+            explicit Hash(const std::string& str) : Hash(str.data(), str.size()) {};
+
+            /**
+             * @brief Add data to the end of the hashed output
+             * @param data The data to add
+             * @param size The number of bytes to add
+             */
+            void update(const char* data, const size_type size);
+            /**
+             * @brief Add output that has already been hashed to the end of the hashed output
+             * @param hash The hash of the output to add
+             */
+            void append(const Hash& hash);
+            /**
+             * @brief Get the number of bytes that have been hashed
+             * @return size_type The number of bytes
+             */
+            size_type size() const;
+            /**
+             * @brief Get a 64-bit hash of the output
+             * @return std::uint64_t The hash
+             */
+            std::uint64_t get_64() const;
+            /**
+             * @brief Get the 128-bit hash of the output, most significant half first
+             * @return std::pair<std::uint64_t, std::uint64_t> The hash
+             */
+            std::pair<std::uint64_t, std::uint64_t> get_128() const;
+            /**
+             * @brief Get the 128-bit hash of the output as 32 hexadecimal digits
+             * @return std::string The hash
+             */
+            std::string get_string() const;
+            /**
+             * @brief Get the 128-bit hash of the output as a strong HTTP entity tag, including the quotes
+             * @return std::string The entity tag
+             */
+            std::string get_etag() const;
+
+            bool operator==(const Hash& hash) const;
+            bool operator!=(const Hash& hash) const;
+    };
+
+    /**
+     * @brief A class to compute the SHA-256 digest of output, a piece at a time
+     */
+    class Sha256 {
+        private:
+            std::uint32_t state[8]{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            unsigned char block[64]{};
+            std::uint64_t length{0};
+
+            /**
+             * @brief Process one full block of 64 bytes
+             */
+            void transform(const unsigned char* data);
+        public:
+            using size_type = std::size_t;
+
+            /**
+             * @brief Add data to the end of the digested output
+             * @param data The data to add
+             * @param size The number of bytes to add
+             */
+            void update(const char* data, const size_type size);
+            /**
+             * @brief Get the digest of the output added so far as 64 hexadecimal digits. More data can still be added afterwards.
+             * @return std::string The digest
+             */
+            std::string get() const;
+    };
+
+    /**
+     * @brief A class to represent a destination for serialized output. Inherit from this class to write output anywhere.
+     */
+    class Sink {
+        public:
+            using size_type = std::size_t;
+
+            /**
+             * @brief Write data to the sink
+             * @param data The data to write
+             * @param size The number of bytes to write
+             */
+            virtual void write(const char* data, const size_type size) = 0;
+            /**
+             * @brief Write a string to the sink
+             * @param str The string to write
+             */
+            void write(const std::string& str) {
+                this->write(str.data(), str.size());
+            }
+            /**
+             * @brief Write data whose hash is already known to the sink. Sinks that hash their output may use the hash instead of reading the data.
+             * @param data The data to write
+             * @param size The number of bytes to write
+             * @param hash The hash of the data
+             */
+            virtual void write(const char* data, const size_type size, const Hash&) {
+                this->write(data, size);
+            }
+            /**
+             * @brief Check if the sink makes use of the hash passed to write(), so that it is only computed when needed
+             * @return bool True if the hash is used, false otherwise
+             */
+            virtual bool uses_hash() const {
+                return false;
+            }
+            /**
+             * @brief Let the sink know that at least size more bytes are about to be written, so that it can make room for all of them at once
+             * @param size The number of bytes
+             */
+            virtual void reserve(const size_type) {}
+            /**
+             * @brief Write any buffered data to the underlying destination
+             */
+            virtual void flush() {}
+            /**
+             * @brief Destroy the Sink object
+             */
+            virtual ~Sink() = default;
+    };
+
+    /**
+     * @brief A sink that appends all output to a string
+     */
+    class StringSink : public Sink {
+        private:
+            std::string& str;
+        public:
+            using Sink::write;
+
+            /**
+             * @brief Construct a new StringSink object
+             * @param str The string to append to
+             */
+            explicit StringSink(std::string& str) : str(str) {};
+
+            void write(const char* data, const size_type size) override;
+            void reserve(const size_type size) override;
+    };
+
+    /**
+     * @brief A sink that writes all output to an std::ostream
+     */
+    class StreamSink : public Sink {
+        private:
+            std::ostream& stream;
+        public:
+            using Sink::write;
+
+            /**
+             * @brief Construct a new StreamSink object
+             * @param stream The stream to write to
+             */
+            explicit StreamSink(std::ostream& stream) : stream(stream) {};
+
+            void write(const char* data, const size_type size) override;
+            void flush() override;
+    };
+
+    /**
+     * @brief A sink that writes all output to a C FILE stream
+     */
+    class FileSink : public Sink {
+        private:
+            std::FILE* file{nullptr};
+        public:
+            using Sink::write;
+
+            /**
+             * @brief Construct a new FileSink object. The file is not closed when the sink is destroyed.
+             * @param file The file to write to
+             */
+            explicit FileSink(std::FILE* file) : file(file) {};
+
+            void write(const char* data, const size_type size) override;
+            void flush() override;
+    };
+
+    /**
+     * @brief A sink that collects output in a fixed size buffer, and hands it off whenever the buffer is full.
+     */
+    class BufferedSink : public Sink {
+        private:
+            std::string buffer{};
+            size_type capacity{8192};
+        protected:
+            /**
+             * @brief Write data to the underlying destination, bypassing the buffer
+             * @param data The data to write
+             * @param size The number of bytes to write
+             */
+            virtual void write_out(const char* data, const size_type size) = 0;
+        public:
+            using Sink::write;
+
+            /**
+             * @brief Construct a new BufferedSink object
+             * @param capacity The size of the buffer in bytes
+             */
+            explicit BufferedSink(const size_type capacity = 8192) : capacity(capacity) {
+                this->buffer.reserve(capacity);
+            };
+
+            void write(const char* data, const size_type size) override;
+            void flush() override;
+    };
+
+    /**
+     * @brief A sink that writes all output to a raw file descriptor
+     */
+    class DescriptorSink : public BufferedSink {
+        private:
+            int fd{-1};
+        protected:
+            void write_out(const char* data, const size_type size) override;
+        public:
+            /**
+             * @brief Construct a new DescriptorSink object. The file descriptor is not closed when the sink is destroyed.
+             * @param fd The file descriptor to write to
+             * @param capacity The size of the buffer in bytes
+             */
+            explicit DescriptorSink(const int fd, const size_type capacity = 8192) : BufferedSink(capacity), fd(fd) {};
+            /**
+             * @brief Destroy the DescriptorSink object, flushing any buffered data
+             */
+            ~DescriptorSink() override;
+    };
+
+    /**
+     * @brief A sink that hands all output to a callback function
+     */
+    class CallbackSink : public BufferedSink {
+        private:
+            std::function<void(const char*, size_type)> callback{};
+        protected:
+            void write_out(const char* data, const size_type size) override;
+        public:
+            /**
+             * @brief Construct a new CallbackSink object
+             * @param callback The function to call with each chunk of output
+             * @param capacity The size of the buffer in bytes
+             */
+            explicit CallbackSink(const std::function<void(const char*, size_type)>& callback, const size_type capacity = 8192) : BufferedSink(capacity), callback(callback) {};
+            /**
+             * @brief Destroy the CallbackSink object, flushing any buffered data
+             */
+            ~CallbackSink() override;
+    };
+
+    /**
+     * @brief A sink that hashes all output on its way to another sink, or on its own. Cached sections hand it the hashes of their cached output, so that output is not hashed again.
+     * Output is passed on in larger pieces, call flush() or destroy the sink to pass on the rest.
+     */
+    class HashingSink : public Sink {
+        private:
+            Sink* sink{nullptr};
+            Hash hash{};
+            char buffer[1024];
+            size_type buffered{0};
+            bool sha256{false};
+            Sha256 digest{};
+
+            /**
+             * @brief Hash the buffered output and pass it on
+             */
+            void write_buffer();
+        public:
+            using Sink::write;
+
+            /**
+             * @brief Construct a new HashingSink object that only hashes the output
+             * @param sha256 True to also compute the SHA-256 digest of the output, which cannot reuse the hashes of cached output
+             */
+            explicit HashingSink(const bool sha256 = false) : sha256(sha256) {};
+            /**
+             * @brief Construct a new HashingSink object
+             * @param sink The sink to pass the output on to
+             * @param sha256 True to also compute the SHA-256 digest of the output, which cannot reuse the hashes of cached output
+             */
+            explicit HashingSink(Sink& sink, const bool sha256 = false) : sink(&sink), sha256(sha256) {};
+
+            void write(const char* data, const size_type size) override;
+            void write(const char* data, const size_type size, const Hash& hash) override;
+            bool uses_hash() const override;
+            void reserve(const size_type size) override;
+            void flush() override;
+            /**
+             * @brief Destroy the HashingSink object, passing on any buffered output
+             */
+            ~HashingSink() override;
+            /**
+             * @brief Get the hash of the output written so far
+             * @return Hash The hash
+             */
+            Hash get_hash() const;
+            /**
+             * @brief Get the SHA-256 digest of the output written so far
+             * @return std::string The digest as 64 hexadecimal digits, or an empty string if the sink was not asked to compute it
+             */
+            std::string get_sha256() const;
+    };
+
+    namespace HTML {
+        class Atom;
+    } // namespace HTML
+
+    /**
+     * @brief A class to represent a monotonic memory arena. Memory is handed out from large blocks and only given back when the arena is released or destroyed.
+     * @note Objects built in an arena, and anything moved from them, must not outlive the arena.
+     */
+    class Arena {
+        private:
+            struct Block {
+                Block* next{nullptr};
+                std::size_t size{};
+            };
+
+            /**
+             * @brief The strings of the atoms made for the arena once the atom table is full, freed with the arena
+             */
+            struct Atoms;
+
+            Block* blocks{nullptr};
+            char* cursor{nullptr};
+            char* last{nullptr};
+            std::size_t block_size{};
+            std::size_t used{};
+            std::size_t reserved{};
+            Atoms* atoms{nullptr};
+
+            friend class HTML::Atom;
+        public:
+            using size_type = std::size_t;
+
+            /**
+             * @brief Construct a new Arena object
+             * @param block_size The size of each block in bytes. Larger allocations get a block of their own.
+             */
+            explicit Arena(const size_type block_size = 65536) : block_size(block_size) {};
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+            /**
+             * @brief Destroy the Arena object, releasing all memory
+             */
+            ~Arena();
+
+            /**
+             * @brief Allocate memory from the arena
+             * @param size The number of bytes to allocate
+             * @param alignment The alignment of the memory, which must be a power of two
+             * @return void* The allocated memory
+             */
+            void* allocate(const size_type size, const size_type alignment = alignof(std::max_align_t));
+            /**
+             * @brief Release all memory held by the arena. Everything allocated from it is invalidated.
+             */
+            void release();
+            /**
+             * @brief Get the number of bytes handed out by the arena
+             * @return size_type The number of bytes
+             */
+            size_type size() const;
+            /**
+             * @brief Get the number of bytes the arena has reserved from the system
+             * @return size_type The number of bytes
+             */
+            size_type capacity() const;
+    };
+
+    /**
+     * @brief An allocator that allocates from an Arena, or from the heap if it has no arena.
+     * @note Copies of a container made with the copy constructor use the heap, like std::pmr.
+     */
+    template <typename T>
+    class ArenaAllocator {
+        private:
+            Arena* memory{nullptr};
+        public:
+            using value_type = T;
+            using propagate_on_container_copy_assignment = std::false_type;
+            using propagate_on_container_move_assignment = std::true_type;
+            using propagate_on_container_swap = std::true_type;
+
+            /**
+             * @brief Construct a new ArenaAllocator object which allocates from the heap
+             */
+            ArenaAllocator() = default;
+            /**
+             * @brief Construct a new ArenaAllocator object
+             * @param arena The arena to allocate from, or nullptr for the heap
+             */
+            ArenaAllocator(Arena* arena) : memory(arena) {};
+            template <typename U>
+            ArenaAllocator(const ArenaAllocator<U>& allocator) : memory(allocator.arena()) {}
+
+            /**
+             * @brief Get the arena the allocator allocates from
+             * @return Arena* The arena, or nullptr if the allocator uses the heap
+             */
+            Arena* arena() const { return memory; }
+
+            T* allocate(const std::size_t count) {
+                if (this->memory) {
+                    return static_cast<T*>(this->memory->allocate(count * sizeof(T), alignof(T)));
+                }
+
+                return static_cast<T*>(::operator new(count * sizeof(T)));
+            }
+            void deallocate(T* pointer, const std::size_t) {
+                if (!this->memory) {
+                    ::operator delete(pointer);
+                }
+            }
+            /**
+             * @brief Construct an object in memory from the allocator. Objects that take an allocator, like Property, are given this one, so
+             * that what they own is allocated from the same arena as the container they are in, like std::pmr.
+             * @param pointer The memory to construct the object in
+             * @param args The arguments to construct the object with
+             */
+            template <typename U, typename... Args>
+            void construct(U* pointer, Args&&... args) {
+                this->construct_with(std::integral_constant<bool, std::uses_allocator<U, ArenaAllocator>::value>{}, pointer, std::forward<Args>(args)...);
+            }
+            ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator{}; }
+
+            template <typename U>
+            bool operator==(const ArenaAllocator<U>& allocator) const { return this->memory == allocator.arena(); }
+            template <typename U>
+            bool operator!=(const ArenaAllocator<U>& allocator) const { return this->memory != allocator.arena(); }
+        private:
+            template <typename U, typename... Args>
+            void construct_with(std::true_type, U* pointer, Args&&... args) {
+                ::new (static_cast<void*>(pointer)) U(std::allocator_arg, *this, std::forward<Args>(args)...);
+            }
+            template <typename U, typename... Args>
+            void construct_with(std::false_type, U* pointer, Args&&... args) {
+                ::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...);
+            }
+    };
+
+    /**
+     * @brief A string that allocates from an Arena, or from the heap if it has no arena. It converts to, and compares with, std::string.
+     * @note Unlike a std::string, a String keeps its arena when it is assigned to; contents from anywhere else are copied into it.
+     * A String made from a std::string always copies it, since the two can not share memory.
+     */
+    class String : public std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> {
+        public:
+            using base_type = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+            using base_type::basic_string;
+
+            /**
+             * @brief Construct a new String object
+             */
+            String() = default;
+            /**
+             * @brief Construct a new String object, on the heap
+             * @param str The string to copy
+             */
+            String(const String& str) = default;
+            /**
+             * @brief Construct a new String object, in the arena of the string to move from
+             * @param str The string to move from
+             */
+            String(String&& str) noexcept = default;
+            /**
+             * @brief Construct a new String object
+             * @param str The string to copy
+             * @param allocator The allocator to allocate with
+             */
+            String(const std::string& str, const ArenaAllocator<char>& allocator = {}) : base_type(str.data(), str.size(), allocator) {};
+            /**
+             * @brief Construct a new String object
+             * @param str The string to copy
+             */
+            String(const base_type& str) : base_type(str) {};
+            /**
+             * @brief Construct a new String object
+             * @param str The string to move from
+             */
+            String(base_type&& str) noexcept : base_type(std::move(str)) {};
+            /**
+             * @brief Destroy the String object
+             */
+            ~String() = default;
+
+            /**
+             * @brief Get the arena the string allocates from
+             * @return Arena* The arena, or nullptr if the string uses the heap
+             */
+            Arena* get_arena() const { return this->get_allocator().arena(); }
+
+            using base_type::compare;
+            using base_type::find;
+
+            /**
+             * @brief Compare the string with a std::string
+             * @param str The string to compare with
+             * @return int Less than, equal to or greater than zero, like std::string::compare()
+             */
+            int compare(const std::string& str) const { return this->compare(0, this->size(), str.data(), str.size()); }
+            /**
+             * @brief Compare part of the string with a std::string
+             * @param pos The position of the first character to compare
+             * @param count The number of characters to compare
+             * @param str The string to compare with
+             * @return int Less than, equal to or greater than zero, like std::string::compare()
+             */
+            int compare(const size_type pos, const size_type count, const std::string& str) const { return this->compare(pos, count, str.data(), str.size()); }
+            /**
+             * @brief Find a std::string in the string
+             * @param str The string to find
+             * @param pos The position to start at
+             * @return size_type The position of the string, or npos if it does not occur
+             */
+            size_type find(const std::string& str, const size_type pos = 0) const { return this->find(str.data(), pos, str.size()); }
+
+            String& operator=(const String& str) = default;
+            String& operator=(String&& str) {
+                if (this->get_allocator() == str.get_allocator()) {
+                    base_type::operator=(std::move(str));
+                } else {
+                    this->assign(str.data(), str.size());
+                }
+
+                return *this;
+            }
+            String& operator=(const std::string& str) {
+                this->assign(str.data(), str.size());
+                return *this;
+            }
+            String& operator=(const char* str) {
+                this->assign(str);
+                return *this;
+            }
+            operator std::string() const { return std::string{this->data(), this->size()}; }
+    };
+
+    inline bool operator==(const String& lhs, const String& rhs) { return lhs.size() == rhs.size() && lhs.compare(rhs) == 0; }
+    inline bool operator==(const String& lhs, const std::string& rhs) { return lhs.size() == rhs.size() && lhs.compare(0, lhs.size(), rhs.data(), rhs.size()) == 0; }
+    inline bool operator==(const std::string& lhs, const String& rhs) { return rhs == lhs; }
+    inline bool operator==(const String& lhs, const char* rhs) { return lhs.compare(rhs) == 0; }
+    inline bool operator==(const char* lhs, const String& rhs) { return rhs.compare(lhs) == 0; }
+    inline bool operator!=(const String& lhs, const String& rhs) { return !(lhs == rhs); }
+    inline bool operator!=(const String& lhs, const std::string& rhs) { return !(lhs == rhs); }
+    inline bool operator!=(const std::string& lhs, const String& rhs) { return !(lhs == rhs); }
+    inline bool operator!=(const String& lhs, const char* rhs) { return !(lhs == rhs); }
+    inline bool operator!=(const char* lhs, const String& rhs) { return !(lhs == rhs); }
+    inline std::string operator+(const String& lhs, const String& rhs) { return std::string{lhs}.append(rhs.data(), rhs.size()); }
+    inline std::string operator+(const String& lhs, const std::string& rhs) { return std::string{lhs} + rhs; }
+    inline std::string operator+(const std::string& lhs, const String& rhs) { return std::string{lhs}.append(rhs.data(), rhs.size()); }
+    inline std::string operator+(const String& lhs, const char* rhs) { return std::string{lhs} + rhs; }
+    inline std::string operator+(const char* lhs, const String& rhs) { return std::string{lhs}.append(rhs.data(), rhs.size()); }
+
     /**
      * @brief A namespace to represent HTML elements and documents
      */
@@ -221,10 +826,46 @@ namespace docpp {
             None, /* No formatting. Output is in the form of one long string of text, and a single newline character. */
             Pretty, /* Pretty formatting. Output is formatted with newlines and tabs as deemed appropriate. */
             Newline, /* Newline formatting. Each element has a newline appended. */
+            Minified, /* Minified formatting. Like None, but runs of whitespace in text are collapsed, optional closing tags and attribute quotes are left out. Content of pre, textarea, script and style is kept as written. */
+        };
+
+        /**
+         * @brief Enum for escaping options. The content of script and style is raw text and is never escaped, only their property values are.
+         */
+        enum class Escape {
+            Default, /* Follow the global setting, see set_escape(). */
+            Always, /* Escape the data and property values of the element. */
+            Never, /* Output the data and property values of the element verbatim. */
         };
 
         /**
-         * @brief Get a map of tags to strings and types.
+         * @brief Set whether data and property values are escaped when the element does not say otherwise. Disabled by default. The content of script and style is never escaped.
+         * @param escape True to escape, false to output verbatim
+         */
+        void set_escape(const bool escape);
+        /**
+         * @brief Check whether data and property values are escaped when the element does not say otherwise.
+         * @return bool True if escaped, false otherwise
+         */
+        bool get_escape();
+        /**
+         * @brief Escape a string for use as HTML text (& < >) or as a quoted attribute value (& " ').
+         * @param str The string to escape
+         * @param attribute True to escape for an attribute value, false to escape for text
+         * @return std::string The escaped string
+         */
+        std::string escape(const std::string& str, const bool attribute = false);
+        /**
+         * @brief Make a placeholder for a Template slot, to put anywhere in the data or property values of an element. The placeholder is
+         * the name between two '\x1A' (SUB) control characters, which are written verbatim and never escaped. Only placeholders become slots,
+         * so text such as {{name}} is kept as written. Outside a Template, the control characters are part of the output.
+         * @param name The name of the slot, made of letters, digits, '_', '-' and '.'
+         * @return std::string The placeholder
+         */
+        std::string placeholder(const std::string& name);
+
+        /**
+         * @brief Get a map of tags to strings and types. Note that this builds a new map on every call; use resolve_tag() for lookups.
          * @return std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> The map of tags to strings and types.
          */
         std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> get_tag_map();
@@ -235,21 +876,133 @@ namespace docpp {
          */
         std::pair<std::string, Type> resolve_tag(const Tag tag);
         /**
-         * @brief Resolve a string tag to a Tag enum.
+         * @brief Resolve a string tag to a Tag enum. If several tags share a name (e.g. Tag::Abbreviation and Tag::Abbr), the first one declared is returned.
          * @param tag The tag to resolve
          * @return Tag The resolved tag
          */
         Tag resolve_tag(const std::string& tag);
 
+        /**
+         * @brief A class to represent an interned string, used for tags and property keys. Equal strings intern to the same shared, immutable string, so atoms compare by pointer instead of by content.
+         * Interned strings are never freed, so the table holds at most get_limit() strings besides the tag names and common property keys. Past the limit, an atom stores
+         * its own copy of the string instead, which is freed with the last atom that holds it, or with the arena the atom was made for. Such atoms compare by content.
+         */
+        class Atom {
+            public:
+                using size_type = std::size_t;
+            private:
+                /**
+                 * @brief A string that did not fit in the atom table. Strings stored for an arena belong to the arena, other strings are reference counted.
+                 */
+                struct Stored;
+
+                const std::string* str{nullptr};
+                Stored* stored{nullptr};
+
+                void assign(const std::string& str, Arena* arena);
+                void retain();
+                void release();
+
+                friend class docpp::Arena;
+            protected:
+            public:
+                /**
+                 * @brief Construct a new Atom object for the empty string
+                 */
+                Atom() = default;
+                /**
+                 * @brief Construct a new Atom object
+                 * @param str The string to intern
+                 */
+                explicit Atom(const std::string& str) { this->assign(str, nullptr); };
+                /**
+                 * @brief Construct a new Atom object
+                 * @param str The string to intern
+                 */
+                explicit Atom(const char* str) { this->assign(str, nullptr); };
+                /**
+                 * @brief Construct a new Atom object
+                 * @param str The string to intern
+                 * @param arena The arena to store the string in if the atom table is full, or nullptr for the heap
+                 */
+                Atom(const std::string& str, Arena* arena) { this->assign(str, arena); };
+                /**
+                 * @brief Construct a new Atom object for the name of a tag, without locking
+                 * @param tag The tag
+                 */
+                explicit Atom(const Tag tag);
+                /**
+                 * @brief Construct a new Atom object
+                 * @param atom The atom to copy. A copy of an atom stored for an arena refers to the same string, so it must not outlive the arena.
+                 */
+                Atom(const Atom& atom) : str(atom.str), stored(atom.stored) { if (this->stored) this->retain(); };
+                /**
+                 * @brief Construct a new Atom object
+                 * @param atom The atom to move from
+                 */
+                Atom(Atom&& atom) noexcept : str(atom.str), stored(atom.stored) { atom.str = nullptr; atom.stored = nullptr; };
+                /**
+                 * @brief Construct a new Atom object
+                 * @param atom The atom to copy
+                 * @param arena The arena to store the string in if the atom does not use the atom table, or nullptr for the heap
+                 */
+                Atom(const Atom& atom, Arena* arena);
+                /**
+                 * @brief Destroy the Atom object
+                 */
+                ~Atom() { if (this->stored) this->release(); };
+
+                /**
+                 * @brief Look up a string without interning it
+                 * @param str The string to look up
+                 * @param atom The atom to set if the string is interned. Once the atom table is full, any string may be stored by an atom, so it is always set.
+                 * @return bool True if an atom may be equal to the string, false otherwise
+                 */
+                static bool find(const std::string& str, Atom& atom);
+                /**
+                 * @brief Set the maximum number of strings interned at run time. Lowering it below the number already interned stops the table from growing.
+                 * @param limit The maximum number of strings
+                 */
+                static void set_limit(const size_type limit);
+                /**
+                 * @brief Get the maximum number of strings interned at run time
+                 * @return size_type The maximum number of strings
+                 */
+                static size_type get_limit();
+
+                /**
+                 * @brief Get the string
+                 * @return const std::string& The string, which lives for the rest of the program if it is interned
+                 */
+                const std::string& get() const;
+                /**
+                 * @brief Get the arena the string is stored in
+                 * @return Arena* The arena, or nullptr if the string is interned or on the heap
+                 */
+                Arena* get_arena() const;
+                /**
+                 * @brief Check if the atom is the empty string
+                 * @return bool True if the atom is empty, false otherwise
+                 */
+                bool empty() const { return this->str == nullptr; }
+
+                Atom& operator=(const Atom& atom) { Atom copy{atom}; std::swap(this->str, copy.str); std::swap(this->stored, copy.stored); return *this; }
+                Atom& operator=(Atom&& atom) noexcept { std::swap(this->str, atom.str); std::swap(this->stored, atom.stored); return *this; }
+                bool operator==(const Atom& atom) const { return this->str == atom.str || ((this->stored || atom.stored) && this->get() == atom.get()); }
+                bool operator!=(const Atom& atom) const { return !(*this == atom); }
+        };
+
         /**
          * @brief A class to represent an HTML property
          */
         class Property {
             private:
-                std::pair<std::string, std::string> property{};
+                Atom key{};
+                String value{};
             protected:
             public:
                 using size_type = std::size_t;
+                using allocator_type = ArenaAllocator<char>;
 
                 /**
                  * @brief The npos value
@@ -261,12 +1014,43 @@ namespace docpp {
                  * @param key The key of the property
                  * @param value The value of the property
                  */
-                Property(const std::string& key, const std::string& value) : property(std::make_pair(key, value)) {};
+                Property(const std::string& key, const String& value) : key(key), value(value) {};
+                /**
+                 * @brief Construct a new Property object
+                 * @param key The key of the property
+                 * @param value The value of the property
+                 */
+                Property(std::string&& key, String&& value) : key(key), value(std::move(value)) {};
                 /**
                  * @brief Construct a new Property object
                  * @param property The property to set
                  */
-                Property(const Property& property) : property(property.property) {};
+                Property(const Property& property) : key(property.key, nullptr), value(property.value) {};
+                /**
+                 * @brief Construct a new Property object
+                 * @param property The property to move from
+                 */
+                Property(Property&& property) noexcept = default;
+                /**
+                 * @brief Construct a new Property object, allocating its value with an allocator
+                 * @param allocator The allocator to allocate with
+                 * @param key The key of the property
+                 * @param value The value of the property
+                 */
+                template <typename K, typename V>
+                Property(std::allocator_arg_t, const allocator_type& allocator, K&& key, V&& value) : key(std::forward<K>(key), allocator.arena()), value(std::forward<V>(value), allocator) {}
+                /**
+                 * @brief Construct a new Property object, allocating its value with an allocator
+                 * @param allocator The allocator to allocate with
+                 * @param property The property to set
+                 */
+                Property(std::allocator_arg_t, const allocator_type& allocator, const Property& property) : key(property.key, allocator.arena()), value(property.value, allocator) {};
+                /**
+                 * @brief Construct a new Property object, allocating its value with an allocator
+                 * @param allocator The allocator to allocate with
+                 * @param property The property to move from
+                 */
+                Property(std::allocator_arg_t, const allocator_type& allocator, Property&& property) : key(property.key, allocator.arena()), value(std::move(property.value), allocator) {};
                 /**
                  * @brief Construct a new Property object
                  */
@@ -278,38 +1062,44 @@ namespace docpp {
 
                 /**
                  * @brief Get the key of the property
-                 * @return std::string The key of the property
+                 * @return const std::string& The key of the property
                  */
-                std::string get_key() const;
+                const std::string& get_key() const;
                 /**
                  * @brief Get the key of the property in a specific type
                  * @return T The key of the property
                  */
                 template <typename T> T get_key() const {
                     if (std::is_same<T, std::string>::value) {
-                        return this->property.first;
+                        return this->key.get();
                     }
 
-                    return T(this->property.first);
-                };
+                    return T(this->key.get());
+                }
+                /**
+                 * @brief Get the interned key of the property, which compares without comparing strings
+                 * @return const Atom& The key of the property
+                 */
+                const Atom& get_key_atom() const;
                 /**
                  * @brief Get the value of the property
-                 * @return std::string The value of the property
+                 * @return const String& The value of the property, which converts to std::string
+                 * @note Before arena support, this returned a const std::string&. Code that binds the result to a const std::string& now gets a copy.
                  */
-                std::string get_value() const;
+                const String& get_value() const;
                 /**
                  * @brief Get the value of the property in a specific type
                  * @return T The value of the property
                  */
                 template <typename T> T get_value() const {
                     if (std::is_same<T, std::string>::value) {
-                        return this->property.second;
+                        return this->value;
                     }
-                    return T(this->property.second);
+                    return T(this->value);
                 }
                 /**
                  * @brief Get the property.
-                 * @return std::pair<std::string, std::string> The value of the property
+                 * @return std::pair<std::string, std::string> The key and value of the property
                  */
                 std::pair<std::string, std::string> get() const;
                 /**
@@ -317,11 +1107,7 @@ namespace docpp {
                  * @return std::pair<T, T> The value of the property
                  */
                 template <typename T> std::pair<T, T> get() const {
-                    if (std::is_same<T, std::string>::value) {
-                        return this->property;
-                    }
-
-                    return T(this->property);
+                    return std::pair<T, T>(T(this->key.get()), T(this->value));
                 }
                 /**
                  * @brief Set the key of the property.
@@ -349,6 +1135,7 @@ namespace docpp {
                 bool empty() const;
 
                 Property& operator=(const Property& property);
+                Property& operator=(Property&& property);
                 bool operator==(const Property& property) const;
                 bool operator!=(const Property& property) const;
 
@@ -359,14 +1146,14 @@ namespace docpp {
          */
         class Properties {
             private:
-                std::vector<Property> properties{};
+                std::vector<Property, ArenaAllocator<Property>> properties{};
             protected:
             public:
                 using size_type = std::size_t;
-                using iterator = std::vector<Property>::iterator;
-                using const_iterator = std::vector<Property>::const_iterator;
-                using reverse_iterator = std::vector<Property>::reverse_iterator;
-                using const_reverse_iterator = std::vector<Property>::const_reverse_iterator;
+                using iterator = std::vector<Property, ArenaAllocator<Property>>::iterator;
+                using const_iterator = std::vector<Property, ArenaAllocator<Property>>::const_iterator;
+                using reverse_iterator = std::vector<Property, ArenaAllocator<Property>>::reverse_iterator;
+                using const_reverse_iterator = std::vector<Property, ArenaAllocator<Property>>::const_reverse_iterator;
 
                 /**
                  * @brief Return an iterator to the beginning.
@@ -415,27 +1202,64 @@ namespace docpp {
                 static const size_type npos = -1;
 
                 /**
-                 * @brief Get the properties of the element
-                 * @return std::vector<Property> The properties of the element
+                 * @brief Get the properties of the element. This returns the underlying vector, whose allocator type is not that of std::vector<Property>,
+                 * so code that copied the result into a std::vector<Property> should use get_properties<std::vector<Property>>() instead.
+                 * @return const std::vector<Property, ArenaAllocator<Property>>& The properties of the element
                  */
-                std::vector<Property> get_properties() const;
+                const std::vector<Property, ArenaAllocator<Property>>& get_properties() const;
+                /**
+                 * @brief Get a copy of the properties in a specific container type, such as std::vector<Property>, which get_properties() returned before it returned a reference.
+                 * @return T The properties
+                 */
+                template <typename T> T get_properties() const {
+                    return T(this->properties.begin(), this->properties.end());
+                }
+                /**
+                 * @brief Get the arena the properties are allocated from
+                 * @return Arena* The arena, or nullptr if the properties use the heap
+                 */
+                Arena* get_arena() const;
                 /**
                  * @brief Set the properties of the element
                  * @param properties The properties to set
                  */
                 void set(const std::vector<Property>& properties);
+                /**
+                 * @brief Set the properties of the element
+                 * @param properties The properties to move from
+                 */
+                void set(std::vector<Property>&& properties);
                 /**
                  * @brief Get the property at an index
                  * @param index The index of the property
-                 * @return Property The property at the index
+                 * @return const Property& The property at the index
                  */
-                Property at(const size_type index) const;
+                const Property& at(const size_type index) const;
                 /**
                  * @brief Insert a property into the element
                  * @param index The index to insert the property
                  * @param property The property to insert
                  */
                 void insert(const size_type index, const Property& property);
+                /**
+                 * @brief Insert a property into the element
+                 * @param index The index to insert the property
+                 * @param property The property to move from
+                 */
+                void insert(const size_type index, Property&& property);
+                /**
+                 * @brief Construct a property in place in the element
+                 * @param index The index to insert the property
+                 * @param args The arguments to construct the property with
+                 */
+                template <typename... Args>
+                void emplace(const size_type index, Args&&... args) {
+                    if (index >= this->properties.size()) {
+                        throw docpp::out_of_range("Index out of range");
+                    }
+
+                    this->properties.emplace(this->properties.begin() + index, std::forward<Args>(args)...);
+                }
                 /**
                  * @brief Erase a property from the element
                  * @param index The index of the property to erase
@@ -467,19 +1291,24 @@ namespace docpp {
                 void swap(const Property& property1, const Property& property2);
                 /**
                  * @brief Get the first property of the element
-                 * @return Property The first property of the element
+                 * @return const Property& The first property of the element
                  */
-                Property front() const;
+                const Property& front() const;
                 /**
                  * @brief Get the last property of the element
-                 * @return Property The last property of the element
+                 * @return const Property& The last property of the element
                  */
-                Property back() const;
+                const Property& back() const;
                 /**
                  * @brief Get the size of the element
                  * @return size_type The size of the element
                  */
                 size_type size() const;
+                /**
+                 * @brief Make room for a number of properties, so that adding them does not reallocate
+                 * @param size The number of properties
+                 */
+                void reserve(const size_type size);
                 /**
                  * @brief Clear the properties
                  */
@@ -494,26 +1323,84 @@ namespace docpp {
                  * @param property The property to add
                  */
                 void push_front(const Property& property);
+                /**
+                 * @brief Prepend a property to the element
+                 * @param property The property to move from
+                 */
+                void push_front(Property&& property);
                 /**
                  * @brief Append a property to the element
                  * @param property The property to add
                  */
                 void push_back(const Property& property);
+                /**
+                 * @brief Append a property to the element
+                 * @param property The property to move from
+                 */
+                void push_back(Property&& property);
+                /**
+                 * @brief Construct a property in place at the end of the element
+                 * @param args The arguments to construct the property with
+                 */
+                template <typename... Args>
+                void emplace_back(Args&&... args) {
+                    this->properties.emplace_back(std::forward<Args>(args)...);
+                }
                 /**
                  * @brief Construct a new Properties object
                  * @param properties The properties to set
                  */
-                Properties(const std::vector<Property>& properties) : properties(properties) {};
+                Properties(const std::vector<Property>& properties) : properties(properties.begin(), properties.end()) {};
+                /**
+                 * @brief Construct a new Properties object
+                 * @param properties The properties to move from
+                 */
+                Properties(std::vector<Property>&& properties) : properties(std::make_move_iterator(properties.begin()), std::make_move_iterator(properties.end())) {};
+                /**
+                 * @brief Construct a new Properties object
+                 * @param properties The properties to set, such as the ones returned by get_properties()
+                 */
+                template <typename Allocator>
+                Properties(const std::vector<Property, Allocator>& properties) : properties(properties.begin(), properties.end()) {}
                 /**
                  * @brief Construct a new Properties object
                  * @param property The property to add
                  */
                 Properties(const Property& property) : properties({property}) {};
+                /**
+                 * @brief Construct a new Properties object
+                 * @param property The property to move from
+                 */
+                Properties(Property&& property) {
+                    this->properties.push_back(std::move(property));
+                };
                 /**
                  * @brief Construct a new Properties object
                  * @param properties The properties to set
                  */
-                Properties(const Properties& properties) : properties(properties.properties) {};
+                Properties(const Properties& properties) : properties(properties.properties) {};
+                /**
+                 * @brief Construct a new Properties object
+                 * @param properties The properties to move from
+                 */
+                Properties(Properties&& properties) noexcept = default;
+                /**
+                 * @brief Construct a new Properties object, allocating from an arena
+                 * @param arena The arena to allocate from
+                 */
+                explicit Properties(Arena& arena) : properties(ArenaAllocator<Property>{&arena}) {};
+                /**
+                 * @brief Construct a new Properties object, allocating from an arena
+                 * @param properties The properties to set
+                 * @param arena The arena to allocate from
+                 */
+                Properties(const Properties& properties, Arena& arena) : properties(properties.properties.begin(), properties.properties.end(), ArenaAllocator<Property>{&arena}) {};
+                /**
+                 * @brief Construct a new Properties object, allocating from an arena
+                 * @param properties The properties to move from
+                 * @param arena The arena to allocate from
+                 */
+                Properties(Properties&& properties, Arena& arena) : properties(std::move(properties.properties), ArenaAllocator<Property>{&arena}) {};
                 /**
                  * @brief Construct a new Properties object
                  */
@@ -524,14 +1411,18 @@ namespace docpp {
                 ~Properties() = default;
 
                 Properties& operator=(const Properties& properties);
+                Properties& operator=(Properties&& properties) noexcept = default;
                 Properties& operator=(const std::vector<Property>& properties);
                 Properties& operator=(const Property& property);
+                Properties& operator=(std::vector<Property>&& properties);
+                Properties& operator=(Property&& property);
                 bool operator==(const Properties& properties) const;
                 bool operator==(const Property& property) const;
                 bool operator!=(const Properties& properties) const;
                 bool operator!=(const Property& property) const;
-                Property operator[](const size_type& index) const;
+                const Property& operator[](const size_type& index) const;
                 Properties& operator+=(const Property& property);
+                Properties& operator+=(Property&& property);
                 Properties& operator+=(const Properties& properties);
         };
 
@@ -540,10 +1431,11 @@ namespace docpp {
          */
         class Element {
             private:
-                std::string tag{};
-                std::string data{};
-                Type type{Type::Non_Self_Closing};
+                Atom tag{};
                 Properties properties{};
+                String data{};
+                Type type{Type::Non_Self_Closing};
+                Escape escape{Escape::Default};
             protected:
             public:
                 using size_type = std::size_t;
@@ -559,19 +1451,59 @@ namespace docpp {
                  * @param data The data of the element
                  * @param type The close tag type.
                  */
-                Element(const std::string& tag, const Properties& properties = {}, const std::string& data = {}, const Type type = Type::Non_Self_Closing) : tag(tag), properties(properties), data(data), type(type) {};
+                Element(const std::string& tag, const Properties& properties = {}, const String& data = {}, const Type type = Type::Non_Self_Closing) : tag(tag), properties(properties), data(data), type(type) {};
+                /**
+                 * @brief Construct a new Element object
+                 * @param tag The tag of the element
+                 * @param properties The properties of the element to move from
+                 * @param data The data of the element to move from
+                 * @param type The close tag type.
+                 */
+                Element(const std::string& tag, Properties&& properties, String&& data = {}, const Type type = Type::Non_Self_Closing) : tag(tag), properties(std::move(properties)), data(std::move(data)), type(type) {};
+                /**
+                 * @brief Construct a new Element object from a tag that is already interned
+                 * @param tag The tag of the element
+                 * @param properties The properties of the element to move from
+                 * @param data The data of the element to move from
+                 * @param type The close tag type.
+                 */
+                Element(const Atom tag, Properties&& properties, String&& data = {}, const Type type = Type::Non_Self_Closing) : tag(tag), properties(std::move(properties)), data(std::move(data)), type(type) {};
                 /**
                  * @brief Construct a new Element object
                  * @param tag The tag of the element
                  * @param properties The properties of the element
                  * @param data The data of the element
                  */
-                Element(const Tag tag, const Properties& properties = {}, const std::string& data = {}) : tag(resolve_tag(tag).first), properties(properties), data(data), type(resolve_tag(tag).second) {};
+                Element(const Tag tag, const Properties& properties = {}, const String& data = {});
+                /**
+                 * @brief Construct a new Element object
+                 * @param tag The tag of the element
+                 * @param properties The properties of the element to move from
+                 * @param data The data of the element to move from
+                 */
+                Element(const Tag tag, Properties&& properties, String&& data = {});
                 /**
                  * @brief Construct a new Element object
                  * @param element The element to set
                  */
-                Element(const Element& element) : tag(element.tag), properties(element.properties), data(element.data), type(element.type) {};
+                Element(const Element& element) : tag(element.tag, nullptr), properties(element.properties), data(element.data), type(element.type), escape(element.escape) {};
+                /**
+                 * @brief Construct a new Element object
+                 * @param element The element to move from
+                 */
+                Element(Element&& element) noexcept = default;
+                /**
+                 * @brief Construct a new Element object, allocating its properties and data from an arena
+                 * @param element The element to set
+                 * @param arena The arena to allocate from
+                 */
+                Element(const Element& element, Arena& arena) : tag(element.tag, &arena), properties(element.properties, arena), data(element.data, ArenaAllocator<char>{&arena}), type(element.type), escape(element.escape) {};
+                /**
+                 * @brief Construct a new Element object, allocating its properties and data from an arena
+                 * @param element The element to move from
+                 * @param arena The arena to allocate from
+                 */
+                Element(Element&& element, Arena& arena) : tag(element.tag, &arena), properties(std::move(element.properties), arena), data(std::move(element.data), ArenaAllocator<char>{&arena}), type(element.type), escape(element.escape) {};
                 /**
                  * @brief Construct a new Element object
                  */
@@ -587,14 +1519,14 @@ namespace docpp {
                  * @param data The data of the element
                  * @param type The close tag type.
                  */
-                void set(const std::string& tag, const Properties& properties = {}, const std::string& data = {}, const Type type = Type::Non_Self_Closing);
+                void set(const std::string& tag, const Properties& properties = {}, const String& data = {}, const Type type = Type::Non_Self_Closing);
                 /**
                  * @brief Set the tag, properties, and data of the element
                  * @param tag The tag of the element
                  * @param properties The properties of the element
                  * @param data The data of the element
                  */
-                void set(const Tag tag, const Properties& properties = {}, const std::string& data = {});
+                void set(const Tag tag, const Properties& properties = {}, const String& data = {});
                 /**
                  * @brief Set the tag of the element
                  * @param tag The tag of the element
@@ -609,23 +1541,53 @@ namespace docpp {
                  * @brief Set the data of the element
                  * @param data The data of the element
                  */
-                void set_data(const std::string& data);
+                void set_data(const String& data);
+                /**
+                 * @brief Set the data of the element
+                 * @param data The data to move from
+                 */
+                void set_data(String&& data);
                 /**
                  * @brief Set the properties of the element
                  * @param properties The properties of the element
                  */
                 void set_properties(const Properties& properties);
+                /**
+                 * @brief Set the properties of the element
+                 * @param properties The properties to move from
+                 */
+                void set_properties(Properties&& properties);
                 /**
                  * @brief Set the type of the element
                  * @param type The type of the element
                  */
                 void set_type(const Type type);
+                /**
+                 * @brief Set whether the data and property values of the element are escaped
+                 * @param escape The escaping option
+                 */
+                void set_escape(const Escape escape);
 
                 /**
                  * @brief Get the element in the form of an HTML tag.
                  * @return std::string The tag of the element
                  */
                 std::string get(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the exact number of bytes get() would return for the element in the form of an HTML tag, without rendering it.
+                 * @return size_type The size of the serialized output
+                 */
+                size_type serialized_size(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Append the element in the form of an HTML tag to a string, without building intermediate strings.
+                 * @param out The string to append to
+                 */
+                void get_into(std::string& out, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Write the element in the form of an HTML tag to a sink, without building intermediate strings.
+                 * @param sink The sink to write to
+                 */
+                void write_to(Sink& sink, const Formatting formatting = Formatting::None, const int tabc = 0) const;
                 /**
                  * @brief Get the element in the form of a specific type.
                  * @return T The element in the form of a specific type
@@ -639,25 +1601,31 @@ namespace docpp {
 
                 /**
                  * @brief Get the tag of the element
-                 * @return std::string The data of the element
+                 * @return const std::string& The data of the element
                  */
-                std::string get_tag() const;
+                const std::string& get_tag() const;
                 /**
                  * @brief Get the tag of the element in a specific type
                  * @return T The tag of the element
                  */
                 template <typename T> T get_tag() const {
                     if (std::is_same<T, std::string>::value) {
-                        return this->tag;
+                        return this->tag.get();
                     }
-                    return T(this->tag);
+                    return T(this->tag.get());
                 }
+                /**
+                 * @brief Get the interned tag of the element, which compares without comparing strings
+                 * @return const Atom& The tag of the element
+                 */
+                const Atom& get_tag_atom() const;
 
                 /**
                  * @brief Get the data of the element
-                 * @return std::string The data of the element
+                 * @return const String& The data of the element, which converts to std::string
+                 * @note Before arena support, this returned a const std::string&. Code that binds the result to a const std::string& now gets a copy.
                  */
-                std::string get_data() const;
+                const String& get_data() const;
                 /**
                  * @brief Get the data of the element in a specific type
                  * @return T The data of the element
@@ -670,14 +1638,19 @@ namespace docpp {
                 }
                 /**
                  * @brief Get the properties of the element
-                 * @return Properties The properties of the element
+                 * @return const Properties& The properties of the element
                  */
-                Properties get_properties() const;
+                const Properties& get_properties() const;
                 /**
                  * @brief Get the type of the element
                  * @return Type The type of the element
                  */
                 Type get_type() const;
+                /**
+                 * @brief Get whether the data and property values of the element are escaped
+                 * @return Escape The escaping option
+                 */
+                Escape get_escape() const;
                 /**
                  * @brief Clear the element
                  */
@@ -689,79 +1662,366 @@ namespace docpp {
                 bool empty() const;
 
                 Element& operator=(const Element& element);
+                Element& operator=(Element&& element);
                 Element& operator+=(const std::string& data);
                 bool operator==(const Element& element) const;
                 bool operator!=(const Element& element) const;
         };
 
+        class Patch;
+        class Selector;
+
         /**
          * @brief A class to represent an HTML section (head, body, etc.)
          */
         class Section {
+            public:
+                /**
+                 * @brief A class to represent a child of a section. A node holds either an element, a section, or nothing if the child was erased.
+                 */
+                class Node {
+                    private:
+                        enum class Kind {
+                            None,
+                            Element,
+                            Section,
+                        };
+
+                        /**
+                         * @brief Destroys a child section, leaving the memory alone if it belongs to an arena
+                         */
+                        struct Deleter {
+                            bool arena;
+
+                            Deleter() : arena(false) {};
+                            explicit Deleter(const bool arena) : arena(arena) {};
+                            void operator()(Section* section) const;
+                        };
+
+                        Kind kind{Kind::None};
+                        Element element{};
+                        std::unique_ptr<Section, Deleter> section{};
+
+                        /**
+                         * @brief Copy a section into a new child section, allocated from arena if it is not nullptr
+                         */
+                        static std::unique_ptr<Section, Deleter> copy_section(const Section& section, Arena* arena);
+                        /**
+                         * @brief Move a section into a new child section, allocated from arena if it is not nullptr
+                         */
+                        static std::unique_ptr<Section, Deleter> move_section(Section&& section, Arena* arena);
+
+                        friend class Section;
+                    public:
+                        Node() = default;
+                        Node(const Element& element, Arena* arena);
+                        Node(const Section& section, Arena* arena);
+                        Node(Element&& element, Arena* arena);
+                        Node(Section&& section, Arena* arena);
+                        Node(const Node& node, Arena* arena = nullptr);
+                        Node(Node&& node) noexcept;
+                        ~Node();
+
+                        /**
+                         * @brief Check if the node holds an element
+                         * @return bool True if the node holds an element, false otherwise
+                         */
+                        bool is_element() const { return this->kind == Kind::Element; }
+                        /**
+                         * @brief Check if the node holds a section
+                         * @return bool True if the node holds a section, false otherwise
+                         */
+                        bool is_section() const { return this->kind == Kind::Section; }
+                        /**
+                         * @brief Get the element held by the node. The element can not be modified through the node, since the section that holds it
+                         * would not know about it; use Section::replace() instead.
+                         * @return const Element& The element
+                         */
+                        const Element& get_element() const;
+                        /**
+                         * @brief Get the section held by the node. The section can be modified through the node, it discards the cached output and indexes of its ancestors itself.
+                         * @return Section& The section
+                         */
+                        Section& get_section();
+                        /**
+                         * @brief Get the section held by the node
+                         * @return const Section& The section
+                         */
+                        const Section& get_section() const;
+
+                        Node& operator=(const Node& node) = delete;
+                        Node& operator=(Node&& node) noexcept;
+                        bool operator==(const Node& node) const;
+                        bool operator!=(const Node& node) const;
+
+                        bool holds(const Element*) const { return this->kind == Kind::Element; }
+                        bool holds(const Section*) const { return this->kind == Kind::Section; }
+                        const Element& value(const Element*) const { return this->element; }
+                        const Section& value(const Section*) const { return *this->section; }
+                };
+
+                /**
+                 * @brief A class to represent an iterator over the children of a section, in document order. Erased children are skipped.
+                 */
+                template <typename T, typename N>
+                class node_iterator {
+                    private:
+                        T current{};
+                        T last{};
+
+                        void skip() {
+                            while (current != last && !current->is_element() && !current->is_section()) {
+                                ++current;
+                            }
+                        }
+                    public:
+                        using iterator_category = std::forward_iterator_tag;
+                        using value_type = Node;
+                        using difference_type = std::ptrdiff_t;
+                        using pointer = N*;
+                        using reference = N&;
+
+                        node_iterator() = default;
+                        node_iterator(const T& current, const T& last) : current(current), last(last) { skip(); }
+                        node_iterator& operator++() { ++current; skip(); return *this; }
+                        node_iterator operator++(int) { node_iterator ret{*this}; ++*this; return ret; }
+                        N& operator*() const { return *current; }
+                        N* operator->() const { return &*current; }
+                        bool operator==(const node_iterator& other) const { return current == other.current; }
+                        bool operator!=(const node_iterator& other) const { return current != other.current; }
+                };
+
+                /**
+                 * @brief A class to represent a range of children, for use in range-based for loops
+                 */
+                template <typename T>
+                class node_range {
+                    private:
+                        T first{};
+                        T last{};
+                    public:
+                        node_range(const T& first, const T& last) : first(first), last(last) {};
+                        T begin() const { return first; }
+                        T end() const { return last; }
+                };
+
+                using child_iterator = node_iterator<std::vector<Node, ArenaAllocator<Node>>::iterator, Node>;
+                using const_child_iterator = node_iterator<std::vector<Node, ArenaAllocator<Node>>::const_iterator, const Node>;
+
+                /**
+                 * @brief Get the children of the section, both elements and sections, in document order. Child sections can be modified through the range,
+                 * child elements are read-only and are replaced with replace(). Nodes must not be assigned to.
+                 * @return node_range<child_iterator> The children of the section
+                 */
+                node_range<child_iterator> children() { return node_range<child_iterator>(child_iterator(nodes.begin(), nodes.end()), child_iterator(nodes.end(), nodes.end())); }
+                /**
+                 * @brief Get the children of the section, both elements and sections, in document order
+                 * @return node_range<const_child_iterator> The children of the section
+                 */
+                node_range<const_child_iterator> children() const { return node_range<const_child_iterator>(const_child_iterator(nodes.cbegin(), nodes.cend()), const_child_iterator(nodes.cend(), nodes.cend())); }
             protected:
             public:
                 using size_type = std::size_t;
 
                 /**
-                 * @brief A class to represent an iterator for the Section class
+                 * @brief A class to represent an iterator for the Section class. It visits the elements of the section, skipping sections.
                  */
                 template <typename T>
                 class sect_iterator {
                     private:
                         T element{};
+                        T last{};
+
+                        void skip() {
+                            while (element != last && !element->is_element()) {
+                                ++element;
+                            }
+                        }
                     public:
-                        sect_iterator(const T& element) : element(element) {}
-                        sect_iterator operator++() { return ++element; }
-                        Element operator*() { return element->second; }
-                        bool operator==(const sect_iterator& other) { return element == other.element; }
-                        bool operator!=(const sect_iterator& other) { return element != other.element; }
+                        sect_iterator(const T& element, const T& last) : element(element), last(last) { skip(); }
+                        sect_iterator operator++() { ++element; skip(); return *this; }
+                        const Element& operator*() const { return element->value(static_cast<const Element*>(nullptr)); }
+                        const Element* operator->() const { return &element->value(static_cast<const Element*>(nullptr)); }
+                        bool operator==(const sect_iterator& other) const { return element == other.element; }
+                        bool operator!=(const sect_iterator& other) const { return element != other.element; }
                 };
 
-                using iterator = sect_iterator<std::map<int, Element>::iterator>;
-                using const_iterator = sect_iterator<std::map<int, Element>::const_iterator>;
-                using reverse_iterator = sect_iterator<std::map<int, Element>::reverse_iterator>;
-                using const_reverse_iterator = sect_iterator<std::map<int, Element>::const_reverse_iterator>;
+                using iterator = sect_iterator<std::vector<Node, ArenaAllocator<Node>>::iterator>;
+                using const_iterator = sect_iterator<std::vector<Node, ArenaAllocator<Node>>::const_iterator>;
+                using reverse_iterator = sect_iterator<std::vector<Node, ArenaAllocator<Node>>::reverse_iterator>;
+                using const_reverse_iterator = sect_iterator<std::vector<Node, ArenaAllocator<Node>>::const_reverse_iterator>;
 
                 /**
                  * @brief Return an iterator to the beginning.
                  * @return iterator The iterator to the beginning.
                  */
-                iterator begin() { return iterator(elements.begin()); }
+                iterator begin() { return iterator(nodes.begin(), nodes.end()); }
                 /**
                  * @brief Return an iterator to the end.
                  * @return iterator The iterator to the end.
                  */
-                iterator end() { return iterator(elements.end()); }
+                iterator end() { return iterator(nodes.end(), nodes.end()); }
                 /**
                  * @brief Return a const iterator to the beginning.
                  * @return const_iterator The const iterator to the beginning.
                  */
-                const_iterator cbegin() const { return const_iterator(elements.cbegin()); }
+                const_iterator cbegin() const { return const_iterator(nodes.cbegin(), nodes.cend()); }
                 /**
                  * @brief Return a const iterator to the end.
                  * @return const_iterator The const iterator to the end.
                  */
-                const_iterator cend() const { return const_iterator(elements.cend()); }
+                const_iterator cend() const { return const_iterator(nodes.cend(), nodes.cend()); }
                 /**
                  * @brief Return a reverse iterator to the beginning.
                  * @return reverse_iterator The reverse iterator to the beginning.
                  */
-                reverse_iterator rbegin() { return reverse_iterator(elements.rbegin()); }
+                reverse_iterator rbegin() { return reverse_iterator(nodes.rbegin(), nodes.rend()); }
                 /**
                  * @brief Return a reverse iterator to the end.
                  * @return reverse_iterator The reverse iterator to the end.
                  */
-                reverse_iterator rend() { return reverse_iterator(elements.rend()); }
+                reverse_iterator rend() { return reverse_iterator(nodes.rend(), nodes.rend()); }
                 /**
                  * @brief Return a const reverse iterator to the beginning.
                  * @return const_reverse_iterator The const reverse iterator to the beginning.
                  */
-                const_reverse_iterator crbegin() { return const_reverse_iterator(elements.crbegin()); }
+                const_reverse_iterator crbegin() { return const_reverse_iterator(nodes.crbegin(), nodes.crend()); }
                 /**
                  * @brief Return a const reverse iterator to the end.
                  * @return const_reverse_iterator The const reverse iterator to the end.
                  */
-                const_reverse_iterator crend() { return const_reverse_iterator(elements.crend()); }
+                const_reverse_iterator crend() { return const_reverse_iterator(nodes.crend(), nodes.crend()); }
+
+                /**
+                 * @brief A class to represent a read-only view of the elements or the sections of a section. Nothing is copied, so the section must outlive the view.
+                 * @note The view remembers its size and its position for at(), so like an iterator it is invalidated by any modification of the section.
+                 * Keep one view for a loop over indexes: each call to get_elements() or get_sections() returns a new view, which walks the section again.
+                 */
+                template <typename T>
+                class child_view {
+                    private:
+                        const std::vector<Node, ArenaAllocator<Node>>* nodes{nullptr};
+                    public:
+                        /**
+                         * @brief A class to represent an iterator for the child_view class
+                         */
+                        class const_iterator {
+                            private:
+                                std::vector<Node, ArenaAllocator<Node>>::const_iterator current{};
+                                std::vector<Node, ArenaAllocator<Node>>::const_iterator last{};
+
+                                void skip() {
+                                    while (current != last && !current->holds(static_cast<const T*>(nullptr))) {
+                                        ++current;
+                                    }
+                                }
+                            public:
+                                using iterator_category = std::forward_iterator_tag;
+                                using value_type = T;
+                                using difference_type = std::ptrdiff_t;
+                                using pointer = const T*;
+                                using reference = const T&;
+
+                                const_iterator() = default;
+                                const_iterator(const std::vector<Node, ArenaAllocator<Node>>::const_iterator& current, const std::vector<Node, ArenaAllocator<Node>>::const_iterator& last) : current(current), last(last) { skip(); }
+                                const_iterator& operator++() { ++current; skip(); return *this; }
+                                const_iterator operator++(int) { const_iterator ret{*this}; ++*this; return ret; }
+                                const T& operator*() const { return current->value(static_cast<const T*>(nullptr)); }
+                                const T* operator->() const { return &current->value(static_cast<const T*>(nullptr)); }
+                                bool operator==(const const_iterator& other) const { return current == other.current; }
+                                bool operator!=(const const_iterator& other) const { return current != other.current; }
+                        };
+
+                        using iterator = const_iterator;
+                        using size_type = std::size_t;
+
+                        explicit child_view(const std::vector<Node, ArenaAllocator<Node>>& nodes) : nodes(&nodes) {};
+
+                    private:
+                        static const size_type unknown = static_cast<size_type>(-1);
+
+                        mutable size_type count{unknown};
+                        mutable const_iterator cursor{};
+                        mutable size_type position{unknown}; // the index of the child at cursor, unknown before the first call to at()
+                    public:
+                        /**
+                         * @brief Return an iterator to the beginning.
+                         * @return const_iterator The iterator to the beginning.
+                         */
+                        const_iterator begin() const { return const_iterator(nodes->cbegin(), nodes->cend()); }
+                        /**
+                         * @brief Return an iterator to the end.
+                         * @return const_iterator The iterator to the end.
+                         */
+                        const_iterator end() const { return const_iterator(nodes->cend(), nodes->cend()); }
+                        /**
+                         * @brief Get the number of children in the view. The first call walks the section, later calls return the remembered size.
+                         * @return size_type The number of children
+                         */
+                        size_type size() const {
+                            if (count == unknown) {
+                                count = 0;
+                                for (const_iterator it{begin()}; it != end(); ++it) ++count;
+                            }
+                            return count;
+                        }
+                        /**
+                         * @brief Check if the view is empty
+                         * @return bool True if the view is empty, false otherwise
+                         */
+                        bool empty() const { return begin() == end(); }
+                        /**
+                         * @brief Get the child at an index in the view. This walks the section from the child returned by the previous call, or from the start if the index is lower,
+                         * so a loop over increasing indexes walks the section once.
+                         * @param index The index of the child, counting only children in the view
+                         * @return const T& The child at the index
+                         */
+                        const T& at(const size_type index) const {
+                            if (count != unknown && index >= count) {
+                                throw docpp::out_of_range("Index out of range");
+                            }
+                            if (position == unknown || index < position) {
+                                cursor = begin();
+                                position = 0;
+                            }
+                            const const_iterator last{end()};
+                            for (; cursor != last && position < index; ++cursor, ++position);
+                            if (cursor == last) {
+                                position = unknown;
+                                throw docpp::out_of_range("Index out of range");
+                            }
+                            return *cursor;
+                        }
+                        /**
+                         * @brief Get the first child in the view
+                         * @return const T& The first child
+                         */
+                        const T& front() const { return at(0); }
+                        /**
+                         * @brief Get the last child in the view
+                         * @return const T& The last child
+                         */
+                        const T& back() const {
+                            if (count != unknown) {
+                                if (count == 0) throw docpp::out_of_range("Index out of range");
+                                return at(count - 1);
+                            }
+                            const T* ret{nullptr};
+                            for (const_iterator it{begin()}; it != end(); ++it) ret = &*it;
+                            if (!ret) throw docpp::out_of_range("Index out of range");
+                            return *ret;
+                        }
+                        /**
+                         * @brief Copy the children in the view into a vector
+                         * @return std::vector<T> The children
+                         */
+                        operator std::vector<T>() const { return std::vector<T>(begin(), end()); }
+
+                        const T& operator[](const size_type index) const { return at(index); }
+                };
+
+                using element_view = child_view<Element>;
+                using section_view = child_view<Section>;
 
                 /**
                  * @brief The npos value
@@ -773,35 +2033,63 @@ namespace docpp {
                  * @param element The element to add
                  */
                 void push_front(const Element& element);
+                /**
+                 * @brief Prepend an element to the section
+                 * @param element The element to move from
+                 */
+                void push_front(Element&& element);
                 /**
                  * @brief Prepend a section to the section
                  * @param section The section to add
                  */
                 void push_front(const Section& section);
+                /**
+                 * @brief Prepend a section to the section
+                 * @param section The section to move from
+                 */
+                void push_front(Section&& section);
                 /**
                  * @brief Append an element to the section
                  * @param element The element to add
                  */
                 void push_back(const Element& element);
+                /**
+                 * @brief Append an element to the section
+                 * @param element The element to move from
+                 */
+                void push_back(Element&& element);
+                /**
+                 * @brief Construct an element in place at the end of the section
+                 * @param args The arguments to construct the element with
+                 */
+                template <typename... Args>
+                void emplace_back(Args&&... args) {
+                    this->push_back(Element(std::forward<Args>(args)...));
+                }
                 /**
                  * @brief Append a section to the section
                  * @param section The section to add
                  */
                 void push_back(const Section& section);
+                /**
+                 * @brief Append a section to the section
+                 * @param section The section to move from
+                 */
+                void push_back(Section&& section);
                 /**
                  * @brief Get the element at an index. To get a section, use at_section()
                  * @param index The index of the element
-                 * @return Element The element at the index
+                 * @return const Element& The element at the index
                  */
-                Element at(const size_type index) const;
+                const Element& at(const size_type index) const;
                 /**
                  * @brief Get the section at an index. To get an element, use at()
                  * @param index The index of the section
-                 * @return Section The section at the index
+                 * @return const Section& The section at the index
                  */
-                Section at_section(const size_type index) const;
+                const Section& at_section(const size_type index) const;
                 /**
-                 * @brief Erase an element from the section. Note that this will NOT change the size/index.
+                 * @brief Erase an element or section from the section. Note that this will NOT change the size/index.
                  * @param index The index of the element to erase
                  */
                 void erase(const size_type index);
@@ -839,37 +2127,75 @@ namespace docpp {
                  * @param element The element to insert
                  */
                 void insert(const size_type index, const Element& element);
+                /**
+                 * @brief Insert an element into the section
+                 * @param index The index to insert the element
+                 * @param element The element to move from
+                 */
+                void insert(const size_type index, Element&& element);
+                /**
+                 * @brief Construct an element in place at an index in the section
+                 * @param index The index to insert the element
+                 * @param args The arguments to construct the element with
+                 */
+                template <typename... Args>
+                void emplace(const size_type index, Args&&... args) {
+                    this->insert(index, Element(std::forward<Args>(args)...));
+                }
                 /**
                  * @brief Insert a section into the section
                  * @param index The index to insert the section
                  * @param section The section to insert
                  */
                 void insert(const size_type index, const Section& section);
+                /**
+                 * @brief Insert a section into the section
+                 * @param index The index to insert the section
+                 * @param section The section to move from
+                 */
+                void insert(const size_type index, Section&& section);
+                /**
+                 * @brief Replace the element held by a child of the section
+                 * @param node The child, as found through children()
+                 * @param element The element to hold instead
+                 */
+                void replace(const Node& node, const Element& element);
+                /**
+                 * @brief Replace the element held by a child of the section
+                 * @param node The child, as found through children()
+                 * @param element The element to move from
+                 */
+                void replace(const Node& node, Element&& element);
                 /**
                  * @brief Get the first element of the section
-                 * @return Element The first element of the section
+                 * @return const Element& The first element of the section
                  */
-                Element front() const;
+                const Element& front() const;
                 /**
                  * @brief Get the last element of the section
-                 * @return Element The last element of the section
+                 * @return const Element& The last element of the section
                  */
-                Element back() const;
+                const Element& back() const;
                 /**
                  * @brief Get the first section of the section
-                 * @return Section The first section of the section
+                 * @return const Section& The first section of the section
                  */
-                Section front_section() const;
+                const Section& front_section() const;
                 /**
                  * @brief Get the last section of the section
-                 * @return Section The last section of the section
+                 * @return const Section& The last section of the section
                  */
-                Section back_section() const;
+                const Section& back_section() const;
                 /**
                  * @brief Get the size of the section
                  * @return size_type The size of the section
                  */
                 size_type size() const;
+                /**
+                 * @brief Make room for a number of children, so that adding up to that many does not allocate again
+                 * @param size The number of children
+                 */
+                void reserve(const size_type size);
                 /**
                  * @brief Clear the section
                  */
@@ -879,6 +2205,11 @@ namespace docpp {
                  * @return bool True if the section is empty, false otherwise
                  */
                 bool empty() const;
+                /**
+                 * @brief Get the arena the section allocates its children from
+                 * @return Arena* The arena, or nullptr if the section uses the heap
+                 */
+                Arena* get_arena() const;
 
                 /**
                  * @brief Construct a new Section object
@@ -891,7 +2222,7 @@ namespace docpp {
                  * @param tag The tag of the section
                  * @param properties The properties of the section
                  */
-                Section(const Tag tag, const Properties& properties = {}) : tag(resolve_tag(tag).first), properties(properties) {};
+                Section(const Tag tag, const Properties& properties = {}) : tag(tag), properties(properties) {};
                 /**
                  * @brief Construct a new Section object
                  * @param tag The tag of the section
@@ -907,7 +2238,7 @@ namespace docpp {
                  * @param properties The properties of the section
                  * @param elements The elements of the section
                  */
-                Section(const Tag tag, const Properties& properties, const std::vector<Element>& elements) : tag(resolve_tag(tag).first), properties(properties) {
+                Section(const Tag tag, const Properties& properties, const std::vector<Element>& elements) : tag(tag), properties(properties) {
                     for (const auto& element : elements) this->push_back(element);
                 };
                 /**
@@ -925,28 +2256,64 @@ namespace docpp {
                  * @param properties The properties of the section
                  * @param sections The sections of the section
                  */
-                Section(const Tag tag, const Properties& properties, const std::vector<Section>& sections) : tag(resolve_tag(tag).first), properties(properties) {
+                Section(const Tag tag, const Properties& properties, const std::vector<Section>& sections) : tag(tag), properties(properties) {
                     for (const auto& section : sections) this->push_back(section);
                 };
                 /**
                  * @brief Construct a new Section object
                  * @param section The section to set
                  */
-                Section(const Section& section) {
-                    this->tag = section.tag;
-                    this->properties = section.properties;
-                    this->elements = section.elements;
-                    this->sections = section.sections;
-                    this->index = section.index;
-                }
+                Section(const Section& section) : tag(section.tag, nullptr), properties(section.properties), nodes(section.nodes), caching(section.caching), indexing(section.indexing), threads(section.threads) {
+                    this->adopt();
+                };
+                /**
+                 * @brief Construct a new Section object
+                 * @param section The section to move from
+                 */
+                Section(Section&& section) noexcept : tag(std::move(section.tag)), properties(std::move(section.properties)), nodes(std::move(section.nodes)), caching(section.caching), indexing(section.indexing), threads(section.threads), cache(std::move(section.cache)) {
+                    section.index.reset();
+                    this->adopt();
+                };
+                /**
+                 * @brief Construct a new Section object, allocating its children from an arena
+                 * @param arena The arena to allocate from
+                 */
+                explicit Section(Arena& arena) : properties(arena), nodes(ArenaAllocator<Node>{&arena}) {};
+                /**
+                 * @brief Construct a new Section object, allocating its children from an arena
+                 * @param tag The tag of the section
+                 * @param properties The properties of the section
+                 * @param arena The arena to allocate from
+                 */
+                Section(const std::string& tag, const Properties& properties, Arena& arena) : tag(tag, &arena), properties(properties, arena), nodes(ArenaAllocator<Node>{&arena}) {};
+                /**
+                 * @brief Construct a new Section object, allocating its children from an arena
+                 * @param tag The tag of the section
+                 * @param properties The properties of the section
+                 * @param arena The arena to allocate from
+                 */
+                Section(const Tag tag, const Properties& properties, Arena& arena) : tag(tag), properties(properties, arena), nodes(ArenaAllocator<Node>{&arena}) {};
+                /**
+                 * @brief Construct a new Section object, copying section and all of its children into an arena
+                 * @param section The section to copy
+                 * @param arena The arena to allocate from
+                 */
+                Section(const Section& section, Arena& arena);
+                /**
+                 * @brief Construct a new Section object, moving section into an arena
+                 * @param section The section to move from
+                 * @param arena The arena to allocate from
+                 */
+                Section(Section&& section, Arena& arena);
                 /**
                  * @brief Construct a new Section object
                  */
                 Section() = default;
                 /**
-                 * @brief Destroy the Section object
+                 * @brief Destroy the Section object. Descendant sections are destroyed one at a time, so that very deep trees do not exhaust the stack.
+                 * Sections in an arena destroy their descendants as well, but leave the memory that came from the arena to it.
                  */
-                ~Section() = default;
+                ~Section();
                 /**
                  * @brief Set the tag, id, and classes of the section
                  * @param tag The tag of the section
@@ -971,11 +2338,21 @@ namespace docpp {
                  * @param tag The tag of the section
                  */
                 void set_tag(const Tag tag);
+                /**
+                 * @brief Set the tag of the section to a tag that is already interned
+                 * @param tag The tag of the section
+                 */
+                void set_tag(const Atom tag);
                 /**
                  * @brief Set the properties of the section
                  * @param properties The properties of the section
                  */
                 void set_properties(const Properties& properties);
+                /**
+                 * @brief Set the properties of the section
+                 * @param properties The properties to move from
+                 */
+                void set_properties(Properties&& properties);
                 /**
                  * @brief Swap two elements in the section
                  * @param index1 The index of the first element
@@ -995,21 +2372,53 @@ namespace docpp {
                  */
                 void swap(const Section& section1, const Section& section2);
                 /**
-                 * @brief Get the elements of the section
-                 * @return std::vector<Element> The elements of the section
+                 * @brief Get the elements of the section. Every call returns a new view, so keep the view rather than calling this for each index of a loop.
+                 * @return element_view The elements of the section
                  */
-                std::vector<Element> get_elements() const;
+                element_view get_elements() const;
                 /**
-                 * @brief Get the sections of the section
-                 * @return std::vector<Section> The sections of the section
+                 * @brief Get the sections of the section. Every call returns a new view, so keep the view rather than calling this for each index of a loop.
+                 * @return section_view The sections of the section
                  */
-                std::vector<Section> get_sections() const;
+                section_view get_sections() const;
 
                 /**
                  * @brief Dump the entire section.
                  * @return std::string The section
                  */
                 std::string get(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the exact number of bytes get() would return for the entire section, without rendering it.
+                 * @return size_type The size of the serialized output
+                 */
+                size_type serialized_size(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Append the entire section to a string, without building intermediate strings.
+                 * @param out The string to append to
+                 */
+                void get_into(std::string& out, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Write the entire section to a sink, without building intermediate strings.
+                 * @param sink The sink to write to
+                 */
+                void write_to(Sink& sink, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the entire section along with its hash, computed while the section is rendered.
+                 * @param hash The hash to set
+                 * @return std::string The section
+                 */
+                std::string get(Hash& hash, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the hash of what get() would return for the entire section, without building the output. Cached descendants contribute the hashes of their cached output instead of hashing it again.
+                 * @return Hash The hash
+                 */
+                Hash get_hash(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the hash of the structure of the section and its descendants, which diff() compares subtrees by. The hash of every section
+                 * in the subtree is kept until it or one of its descendants changes, so unchanged subtrees are not hashed again.
+                 * @return Hash The hash
+                 */
+                Hash get_tree_hash() const;
                 /**
                  * @brief Get the element in the form of a specific type.
                  * @return T The element in the form of a specific type
@@ -1021,44 +2430,324 @@ namespace docpp {
                     return T(this->get(formatting, tabc));
                 }
 
+                /**
+                 * @brief Enable or disable caching of the rendered section. While enabled, the output for each formatting and tab count is kept until the section or any of its descendants is modified.
+                 * @param caching True to enable caching, false to disable it and discard any cached output
+                 */
+                void set_caching(const bool caching);
+                /**
+                 * @brief Check if caching of the rendered section is enabled
+                 * @return bool True if caching is enabled, false otherwise
+                 */
+                bool is_caching() const;
+                /**
+                 * @brief Set the number of threads used to render the children of the section. With more than one thread, the children are split
+                 * into ranges that are rendered into separate buffers in parallel and written in order, so the output is identical to a sequential render.
+                 * The threads are taken from a pool shared by all sections, which has one thread less than the hardware. A caching section renders sequentially
+                 * whenever it has to fill its cache, and a parallel section nested in one that is already rendered in parallel renders sequentially as well.
+                 * @param threads The maximum number of threads, including the calling thread. 0 or 1 renders sequentially.
+                 */
+                void set_threads(const unsigned int threads);
+                /**
+                 * @brief Get the number of threads used to render the children of the section
+                 * @return unsigned int The maximum number of threads
+                 */
+                unsigned int get_threads() const;
+                /**
+                 * @brief Enable or disable the indexes of the descendants of the section by tag, id and class. While enabled, get_by_tag(), get_by_id() and get_by_class() do not scan the subtree.
+                 * The indexes are built by the first lookup, and push_back(), insert(), erase() and set_properties() on the section or its descendants keep them up to date.
+                 * Any other change to the subtree discards them until the next lookup.
+                 * @param indexing True to enable the indexes, false to disable them and free their memory
+                 */
+                void set_indexing(const bool indexing);
+                /**
+                 * @brief Check if the indexes of the descendants of the section are enabled
+                 * @return bool True if the indexes are enabled, false otherwise
+                 */
+                bool is_indexing() const;
+                /**
+                 * @brief Get the first descendant, in document order, with an id. Without indexes, the subtree is scanned.
+                 * @param id The value of the id property
+                 * @return const Node* The element or section, or nullptr if there is none. It is valid until the subtree is modified.
+                 */
+                const Node* get_by_id(const std::string& id) const;
+                /**
+                 * @brief Get the descendants, in document order, that have a class. Without indexes, the subtree is scanned.
+                 * @param name One of the whitespace separated names in the class property
+                 * @return std::vector<const Node*> The elements and sections. They are valid until the subtree is modified.
+                 */
+                std::vector<const Node*> get_by_class(const std::string& name) const;
+                /**
+                 * @brief Get the descendants, in document order, that have a tag. Without indexes, the subtree is scanned.
+                 * @param tag The tag
+                 * @return std::vector<const Node*> The elements and sections. They are valid until the subtree is modified.
+                 */
+                std::vector<const Node*> get_by_tag(const std::string& tag) const;
+                /**
+                 * @brief Get the descendants, in document order, that have a tag. Without indexes, the subtree is scanned.
+                 * @param tag The tag
+                 * @return std::vector<const Node*> The elements and sections. They are valid until the subtree is modified.
+                 */
+                std::vector<const Node*> get_by_tag(const Tag tag) const;
+                /**
+                 * @brief Get the first descendant, in document order, that matches a CSS selector. The indexes are used to find the candidates if they are enabled.
+                 * @param selector The selector
+                 * @return const Node* The element or section, or nullptr if there is none. It is valid until the subtree is modified.
+                 */
+                const Node* query_selector(const Selector& selector) const;
+                /**
+                 * @brief Get the first descendant, in document order, that matches a CSS selector
+                 * @param selector The selector, compiled for this call
+                 * @return const Node* The element or section, or nullptr if there is none. It is valid until the subtree is modified.
+                 */
+                const Node* query_selector(const std::string& selector) const;
+                /**
+                 * @brief Get the descendants, in document order, that match a CSS selector. The indexes are used to find the candidates if they are enabled.
+                 * @param selector The selector
+                 * @return std::vector<const Node*> The elements and sections. They are valid until the subtree is modified.
+                 */
+                std::vector<const Node*> query_selector_all(const Selector& selector) const;
+                /**
+                 * @brief Get the descendants, in document order, that match a CSS selector
+                 * @param selector The selector, compiled for this call
+                 * @return std::vector<const Node*> The elements and sections. They are valid until the subtree is modified.
+                 */
+                std::vector<const Node*> query_selector_all(const std::string& selector) const;
+                /**
+                 * @brief Apply a change produced by diff() to the section
+                 * @param patch The change to apply
+                 */
+                void apply(const Patch& patch);
+                /**
+                 * @brief Apply changes produced by diff() to the section, in order
+                 * @param patches The changes to apply
+                 */
+                void apply(const std::vector<Patch>& patches);
+
                 /**
                  * @brief Get the tag of the section
-                 * @return std::string The tag of the section
+                 * @return const std::string& The tag of the section
                  */
-                std::string get_tag() const;
+                const std::string& get_tag() const;
                 /**
                  * @brief Get the tag of the section in a specific type
                  * @return T The tag of the section
                  */
                 template <typename T> T get_tag() const {
                     if (std::is_same<T, std::string>::value) {
-                        return this->tag;
+                        return this->tag.get();
                     }
-                    return T(this->tag);
+                    return T(this->tag.get());
                 }
+                /**
+                 * @brief Get the interned tag of the section, which compares without comparing strings
+                 * @return const Atom& The tag of the section
+                 */
+                const Atom& get_tag_atom() const;
                 /**
                  * @brief Get the properties of the section
-                 * @return Properties The properties of the section
+                 * @return const Properties& The properties of the section
                  */
-                Properties get_properties() const;
+                const Properties& get_properties() const;
 
                 Section& operator=(const Section& section);
+                Section& operator=(Section&& section);
                 Section& operator+=(const Element& element);
+                Section& operator+=(Element&& element);
                 Section& operator+=(const Section& section);
+                Section& operator+=(Section&& section);
                 bool operator==(const Element& element) const;
                 bool operator==(const Section& section) const;
                 bool operator!=(const Element& element) const;
                 bool operator!=(const Section& section) const;
-                Element operator[](const int& index) const;
+                const Element& operator[](const int& index) const;
                 std::unordered_map<std::string, Element> operator[](const std::string& tag) const;
                 std::unordered_map<std::string, Element> operator[](const Tag tag) const;
             private:
-                size_type index{};
-                std::string tag{};
+                /**
+                 * @brief The rendered output of a section for one formatting and tab count. Child sections that keep their own cache are not copied into the text; they are written in between the pieces of text instead.
+                 */
+                struct CachedOutput {
+                    /**
+                     * @brief A stale entry keeps its buffers so that it can be filled again without allocating. Only one render fills an entry at a time,
+                     * and a valid entry is not modified again until the section is, so it is read without holding the lock.
+                     */
+                    enum class State {
+                        Stale,
+                        Filling,
+                        Valid,
+                    };
+
+                    Formatting formatting;
+                    int tabc;
+                    bool escape;
+                    bool omit_close; // minified output of a section that may leave out its closing tag, which depends on what follows it
+                    State state{State::Stale};
+                    bool hashed{false};
+                    int child_tabc{0};
+                    std::vector<std::string> text{}; // one more piece than there are sections, any pieces after that are left over from earlier output
+                    std::vector<const Section*> sections{};
+                    std::vector<bool> sections_omit_close{}; // whether each of the sections is written without its closing tag
+                    std::vector<Hash> hashes{}; // of each piece of text, computed the first time the output is hashed
+
+                    CachedOutput(const Formatting formatting, const int tabc, const bool escape, const bool omit_close) : formatting(formatting), tabc(tabc), escape(escape), omit_close(omit_close) {};
+                };
+
+                /**
+                 * @brief The descendants of a section by tag, id and class. A descendant is known by the section that holds it and its position in that section's nodes.
+                 */
+                struct Index {
+                    struct Entry {
+                        const Section* owner;
+                        size_type position;
+                    };
+
+                    /**
+                     * @brief The descendants with one key, in document order unless sorted is false
+                     */
+                    struct Bucket {
+                        std::vector<Entry> entries{};
+                        bool sorted{true};
+                    };
+
+                    std::unordered_map<std::string, Bucket> tags{};
+                    std::unordered_map<std::string, Bucket> ids{};
+                    std::unordered_map<std::string, Bucket> classes{};
+
+                    /**
+                     * @brief Add the child at a position of owner, without its descendants
+                     * @param in_order True if the child comes after everything already in the index
+                     */
+                    void add(const Section& owner, const size_type position, const bool in_order);
+                    /**
+                     * @brief Add the child at a position of owner along with all of its descendants
+                     * @param in_order True if the child comes after everything already in the index
+                     */
+                    void add_subtree(const Section& owner, const size_type position, const bool in_order);
+                    /**
+                     * @brief Remove the child at a position of owner, without its descendants
+                     */
+                    void remove(const Section& owner, const size_type position);
+                    /**
+                     * @brief Sort the entries of a bucket into document order if needed
+                     * @param root The section the index belongs to
+                     */
+                    void sort(Bucket& bucket, const Section& root);
+                    /**
+                     * @brief Get the descendants with a key, in document order
+                     * @param root The section the index belongs to
+                     * @param limit The maximum number of descendants to get
+                     */
+                    std::vector<const Node*> get(std::unordered_map<std::string, Bucket>& map, const std::string& key, const Section& root, const size_type limit);
+                };
+
+                Atom tag{};
                 Properties properties{};
 
-                std::map<int, Element> elements{};
-                std::unordered_map<int, Section> sections{};
+                std::vector<Node, ArenaAllocator<Node>> nodes{};
+
+                Section* parent{nullptr};
+                bool caching{false};
+                bool indexing{false};
+                unsigned int threads{0};
+                mutable std::vector<std::unique_ptr<CachedOutput>> cache{};
+                mutable std::mutex mutex{}; // guards the cache and the indexes, which const lookups and renders fill in
+                mutable std::unique_ptr<Index> index{}; // nullptr until the next lookup if indexing
+                mutable Hash tree_hash{}; // valid while tree_hashed, which invalidate() clears
+                mutable bool tree_hashed{false};
+
+                /**
+                 * @brief Make this section the parent of the section held by node, if any
+                 */
+                void adopt(Node& node);
+                /**
+                 * @brief Make this section the parent of all of its child sections
+                 */
+                void adopt();
+                /**
+                 * @brief Discard the cached output of this section and all of its ancestors, along with their indexes
+                 * @param indexed True if the change was already recorded in the indexes, which are then kept
+                 */
+                void invalidate(const bool indexed = false);
+                /**
+                 * @brief Add the child at a position, with its descendants, to the indexes of this section and its ancestors, or remove it.
+                 * Removing a section discards the indexes instead, since every one of its descendants would have to be looked up.
+                 * @param subtree False to add or remove only the child itself
+                 */
+                void reindex(const size_type position, const bool add, const bool subtree = true);
+                /**
+                 * @brief Get the position of this section in the nodes of its parent if the parent or one of its ancestors has indexes, since only then it is needed
+                 * @return size_type The position, or npos
+                 */
+                size_type find_indexed_position() const;
+                /**
+                 * @brief Get the position of this section in the nodes of its parent
+                 * @return size_type The position, or npos if the section has no parent
+                 */
+                size_type find_position() const;
+                /**
+                 * @brief Find the descendants that match a selector, in document order
+                 * @param limit The maximum number of descendants to find
+                 */
+                void query(const Selector& selector, std::vector<const Node*>& ret, const size_type limit) const;
+
+                friend class Selector;
+                /**
+                 * @brief Get the indexes of the section, building them if needed. Without indexing, they are built into scratch.
+                 */
+                Index& get_index(Index& scratch) const;
+                /**
+                 * @brief Write the entire section to a sink, through its cache if caching is enabled
+                 * @param omit_close Leave out the closing tag, which the caller has checked to be optional
+                 */
+                void write_section_to(Sink& sink, const Formatting formatting, const int tabc, const bool omit_close) const;
+                /**
+                 * @brief Write the entire section to a sink, bypassing the cache of this section
+                 * @param omit_close Leave out the closing tag, which the caller has checked to be optional
+                 * @param cached The cache entry to record the output in, or nullptr
+                 */
+                void write_uncached_to(Sink& sink, const Formatting formatting, const int tabc, const bool omit_close, CachedOutput* cached) const;
+                /**
+                 * @brief Write a range of the children of the section to a sink without recursing, keeping the open descendant sections on an explicit stack.
+                 * Caching and parallel descendants are written through their own write_section_to(), which is told whether their closing tag may be left out.
+                 * @param formatting The formatting of the children
+                 * @param tabcount The tab count of the tags of this section
+                 * @param first The index of the first child to write
+                 * @param last The index after the last child to write
+                 */
+                void write_children_to(Sink& sink, const Formatting formatting, const int tabcount, const size_type first, const size_type last) const;
+                /**
+                 * @brief Get the tab count the tags of the section are written with, given the tab count it is written at
+                 */
+                int get_tabcount(const int tabc) const;
+                /**
+                 * @brief Write the opening tag of the section and its properties
+                 */
+                void write_open_to(Sink& sink, const Formatting formatting, const int tabcount) const;
+                /**
+                 * @brief Write the closing tag of the section
+                 */
+                void write_close_to(Sink& sink, const Formatting formatting, const int tabcount) const;
+                /**
+                 * @brief Check if the section renders its children on several threads
+                 */
+                bool is_parallel() const;
+                /**
+                 * @brief Get the position in nodes of a child, counting children in document order and skipping erased ones
+                 * @param index The index of the child
+                 * @return size_type The position, or the number of nodes if index is the number of children
+                 */
+                size_type find_child(const size_type index) const;
+                /**
+                 * @brief Get the formatting the children of the section are written with, given the formatting of the section
+                 */
+                Formatting get_content_formatting(const Formatting formatting) const;
+                /**
+                 * @brief Write the children of the section to a sink, rendering them on up to threads threads
+                 * @param formatting The formatting of the children
+                 * @param tabcount The tab count of the tags of this section
+                 */
+                void write_parallel_to(Sink& sink, const Formatting formatting, const int tabcount) const;
         };
 
         /**
@@ -1066,8 +2755,8 @@ namespace docpp {
          */
         class Document {
             private:
-                std::string doctype{"<!DOCTYPE html>"};
                 Section document{};
+                std::string doctype{"<!DOCTYPE html>"};
             protected:
             public:
                 using size_type = std::size_t;
@@ -1083,6 +2772,32 @@ namespace docpp {
                  * @return std::string The document
                  */
                 std::string get(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the exact number of bytes get() would return for the document, without rendering it.
+                 * @return size_type The size of the serialized output
+                 */
+                size_type serialized_size(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Append the document to a string, without building intermediate strings.
+                 * @param out The string to append to
+                 */
+                void get_into(std::string& out, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Write the document to a sink, without building intermediate strings.
+                 * @param sink The sink to write to
+                 */
+                void write_to(Sink& sink, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the document along with its hash, computed while the document is rendered. The hash can be used as an ETag or a cache key.
+                 * @param hash The hash to set
+                 * @return std::string The document
+                 */
+                std::string get(Hash& hash, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the hash of what get() would return for the document, without building the output. Cached sections contribute the hashes of their cached output instead of hashing it again.
+                 * @return Hash The hash
+                 */
+                Hash get_hash(const Formatting formatting = Formatting::None, const int tabc = 0) const;
                 /**
                  * @brief Get the document in the form of a specific type.
                  * @return T The document in the form of a specific type
@@ -1099,12 +2814,41 @@ namespace docpp {
                  * @return Section The section
                  */
                 Section& get_section();
+                /**
+                 * @brief Get the section
+                 * @return const Section& The section
+                 */
+                const Section& get_section() const;
+                /**
+                 * @brief Get the first node of the document, in document order, that matches a CSS selector
+                 * @param selector The selector
+                 * @return const Section::Node* The element or section, or nullptr if there is none
+                 */
+                const Section::Node* query_selector(const Selector& selector) const;
+                /**
+                 * @brief Get the first node of the document, in document order, that matches a CSS selector
+                 * @param selector The selector, compiled for this call
+                 * @return const Section::Node* The element or section, or nullptr if there is none
+                 */
+                const Section::Node* query_selector(const std::string& selector) const;
+                /**
+                 * @brief Get the nodes of the document, in document order, that match a CSS selector
+                 * @param selector The selector
+                 * @return std::vector<const Section::Node*> The elements and sections
+                 */
+                std::vector<const Section::Node*> query_selector_all(const Selector& selector) const;
+                /**
+                 * @brief Get the nodes of the document, in document order, that match a CSS selector
+                 * @param selector The selector, compiled for this call
+                 * @return std::vector<const Section::Node*> The elements and sections
+                 */
+                std::vector<const Section::Node*> query_selector_all(const std::string& selector) const;
 
                 /**
                  * @brief Get the doctype of the document
-                 * @return std::string The doctype of the document
+                 * @return const std::string& The doctype of the document
                  */
-                std::string get_doctype() const;
+                const std::string& get_doctype() const;
                 /**
                  * @brief Get the doctype of the document in a specific type
                  * @return T The doctype of the document
@@ -1121,6 +2865,11 @@ namespace docpp {
                  * @param document The document to set
                  */
                 void set(const Section& document);
+                /**
+                 * @brief Set the document
+                 * @param document The document to move from
+                 */
+                void set(Section&& document);
                 /**
                  * @brief Set the doctype of the document
                  * @param doctype The doctype to set
@@ -1152,19 +2901,346 @@ namespace docpp {
                  * @param document The document to set
                  */
                 Document(const Section& document, const std::string& doctype = "<!DOCTYPE html>") : document(document), doctype(doctype) {};
+                /**
+                 * @brief Construct a new Document object
+                 * @param document The document to move from
+                 */
+                Document(Section&& document, const std::string& doctype = "<!DOCTYPE html>") : document(std::move(document)), doctype(doctype) {};
                 /**
                  * @brief Construct a new Document object
                  * @param document The document to set
                  */
                 Document(const Document& document) : document(document.document), doctype(document.doctype) {};
+                /**
+                 * @brief Construct a new Document object
+                 * @param document The document to move from
+                 */
+                Document(Document&& document) noexcept = default;
+                /**
+                 * @brief Construct a new Document object, allocating its children from an arena
+                 * @param arena The arena to allocate from
+                 * @param doctype The doctype to set
+                 */
+                explicit Document(Arena& arena, const std::string& doctype = "<!DOCTYPE html>") : document(arena), doctype(doctype) {};
 
                 Document& operator=(const Document& document);
                 Document& operator=(const Section& section);
+                Document& operator=(Document&& document);
+                Document& operator=(Section&& section);
                 bool operator==(const Document& document) const;
                 bool operator==(const Section& section) const;
                 bool operator!=(const Document& document) const;
                 bool operator!=(const Section& section) const;
         };
+
+        /**
+         * @brief A document or section frozen into pre-rendered bytes with holes for named placeholders. A placeholder is made with placeholder()
+         * and put anywhere in the data or property values of the source; any other text, including {{name}}, is kept as written. Rendering a template
+         * copies the static bytes and the slot values in order without walking a tree. Slot values are written as given, so values that come
+         * from untrusted input should be passed through escape() first. Minified output keeps the quotes of property values with a placeholder.
+         */
+        class Template {
+            public:
+                using size_type = std::size_t;
+            private:
+                /**
+                 * @brief A hole in the static bytes, filled with the value of a slot
+                 */
+                struct Hole {
+                    size_type offset;
+                    size_type slot;
+                };
+
+                std::string bytes{};
+                std::vector<Hole> holes{};
+                std::vector<std::string> slots{};
+
+                void compile(const std::string& rendered);
+            protected:
+            public:
+                /**
+                 * @brief The npos value
+                 */
+                static const size_type npos = -1;
+
+                /**
+                 * @brief Construct a new Template object
+                 * @param document The document to compile
+                 * @param formatting The formatting to render the document with
+                 * @param tabc The number of tabs to indent the document with
+                 */
+                explicit Template(const Document& document, const Formatting formatting = Formatting::None, const int tabc = 0);
+                /**
+                 * @brief Construct a new Template object
+                 * @param section The section to compile
+                 * @param formatting The formatting to render the section with
+                 * @param tabc The number of tabs to indent the section with
+                 */
+                explicit Template(const Section& section, const Formatting formatting = Formatting::None, const int tabc = 0);
+                /**
+                 * @brief Construct a new Template object
+                 */
+                Template() = default;
+                /**
+                 * @brief Construct a new Template object
+                 * @param templ The template to copy
+                 */
+                Template(const Template& templ) = default;
+                /**
+                 * @brief Construct a new Template object
+                 * @param templ The template to move from
+                 */
+                Template(Template&& templ) noexcept = default;
+                /**
+                 * @brief Destroy the Template object
+                 */
+                ~Template() = default;
+
+                /**
+                 * @brief Get the names of the slots, in the order their values are expected by get() and write_to()
+                 * @return std::vector<std::string> The names of the slots
+                 */
+                const std::vector<std::string>& get_slots() const;
+                /**
+                 * @brief Find the index of a slot
+                 * @param name The name of the slot
+                 * @return size_type The index of the slot, or npos if the template has no such slot
+                 */
+                size_type find(const std::string& name) const;
+                /**
+                 * @brief Get the number of slots in the template
+                 * @return size_type The number of slots
+                 */
+                size_type size() const;
+                /**
+                 * @brief Check if the template has no slots
+                 * @return bool True if the template has no slots, false otherwise
+                 */
+                bool empty() const;
+                /**
+                 * @brief Get the rendered output
+                 * @param values The value of each slot, indexed like get_slots()
+                 * @return std::string The rendered output
+                 */
+                std::string get(const std::vector<std::string>& values) const;
+                /**
+                 * @brief Get the rendered output
+                 * @param values The value of each slot by name. Slots without a value are left empty.
+                 * @return std::string The rendered output
+                 */
+                std::string get(const std::unordered_map<std::string, std::string>& values) const;
+                /**
+                 * @brief Get the exact number of bytes get() would return for the values, without rendering.
+                 * @param values The value of each slot, indexed like get_slots()
+                 * @return size_type The size of the rendered output
+                 */
+                size_type serialized_size(const std::vector<std::string>& values) const;
+                /**
+                 * @brief Append the rendered output to a string, growing it at most once.
+                 * @param out The string to append to
+                 * @param values The value of each slot, indexed like get_slots()
+                 */
+                void get_into(std::string& out, const std::vector<std::string>& values) const;
+                /**
+                 * @brief Write the rendered output to a sink.
+                 * @param sink The sink to write to
+                 * @param values The value of each slot, indexed like get_slots()
+                 */
+                void write_to(Sink& sink, const std::vector<std::string>& values) const;
+
+                Template& operator=(const Template& templ) = default;
+                Template& operator=(Template&& templ) noexcept = default;
+        };
+
+        /**
+         * @brief Parse HTML markup into a section with an empty tag, which holds the top level nodes. Tags with child tags become sections,
+         * tags with only text become elements, and text between tags, comments and doctypes become Type::Text_No_Formatting elements.
+         * Text, entities and attribute values are kept as written, tag and attribute names are lowercased. The parser never throws on malformed
+         * markup; unclosed tags are closed at the end of their parent and stray closing tags are ignored. Closing tags that HTML allows to be left
+         * out, such as those of p, li, dt, dd, tr, td, th and option, are implied where the next start tag requires it, so minified output parses back into the same tree.
+         * @param html The markup to parse
+         * @return Section The parsed markup
+         */
+        Section parse(const std::string& html);
+        /**
+         * @brief Parse HTML markup into a section with an empty tag, allocating the tree from an arena
+         * @param html The markup to parse
+         * @param arena The arena to allocate from
+         * @return Section The parsed markup
+         */
+        Section parse(const std::string& html, Arena& arena);
+        /**
+         * @brief Parse an HTML document. A leading doctype becomes the doctype of the document, and the rest is parsed with parse().
+         * @param html The markup to parse
+         * @return Document The parsed document
+         */
+        Document parse_document(const std::string& html);
+
+        /**
+         * @brief A class to represent one change to a tree of sections, as produced by diff()
+         */
+        class Patch {
+            public:
+                using size_type = std::size_t;
+
+                /**
+                 * @brief Enum for the kinds of change
+                 */
+                enum class Type {
+                    Insert, /* Insert the node so that it becomes the child at the path. */
+                    Remove, /* Remove the child at the path. */
+                    Replace, /* Replace the child at the path, or the root if the path is empty, with the node. */
+                    Set_Property, /* Set the value of the property with the key on the element or section at the path, adding it at the end if it is missing. */
+                    Remove_Property, /* Remove the property with the key from the element or section at the path. */
+                    Set_Data, /* Set the data of the element at the path. */
+                };
+            private:
+                Type type{Type::Insert};
+                std::vector<size_type> path{};
+                Section::Node node{};
+                std::string key{};
+                std::string value{};
+            public:
+                /**
+                 * @brief Construct a new Patch object that inserts or replaces a node
+                 * @param type The kind of change
+                 * @param path The index of each child on the way from the root, in document order
+                 * @param node The node to insert or replace with
+                 */
+                Patch(const Type type, const std::vector<size_type>& path, Section::Node&& node) : type(type), path(path), node(std::move(node)) {};
+                /**
+                 * @brief Construct a new Patch object that removes a node or changes a property or the data
+                 * @param type The kind of change
+                 * @param path The index of each child on the way from the root, in document order
+                 * @param key The key of the property, if any
+                 * @param value The value of the property or the data, if any
+                 */
+                Patch(const Type type, const std::vector<size_type>& path, const std::string& key = {}, const std::string& value = {}) : type(type), path(path), key(key), value(value) {};
+                /**
+                 * @brief Construct a new Patch object
+                 * @param patch The patch to copy
+                 */
+                Patch(const Patch& patch) : type(patch.type), path(patch.path), node(patch.node), key(patch.key), value(patch.value) {};
+                /**
+                 * @brief Construct a new Patch object
+                 * @param patch The patch to move from
+                 */
+                Patch(Patch&& patch) noexcept = default;
+
+                /**
+                 * @brief Get the kind of change
+                 * @return Type The kind of change
+                 */
+                Type get_type() const;
+                /**
+                 * @brief Get the index of each child on the way from the root to the changed node, in document order. Erased children are not counted.
+                 * @return const std::vector<size_type>& The path
+                 */
+                const std::vector<size_type>& get_path() const;
+                /**
+                 * @brief Get the node to insert or replace with
+                 * @return const Section::Node& The node, which holds nothing for other kinds of change
+                 */
+                const Section::Node& get_node() const;
+                /**
+                 * @brief Get the key of the property to set or remove
+                 * @return const std::string& The key
+                 */
+                const std::string& get_key() const;
+                /**
+                 * @brief Get the value of the property to set, or the data to set
+                 * @return const std::string& The value
+                 */
+                const std::string& get_value() const;
+
+                Patch& operator=(Patch&& patch) noexcept = default;
+        };
+
+        /**
+         * @brief Compute the changes that turn one tree of sections into another. Subtrees are compared by hash, so unchanged subtrees are skipped without looking inside them,
+         * and the children of changed sections are matched by hash so that insertions and removals do not disturb the children around them. Runs in time near linear in the size of the trees.
+         * @param before The tree to change
+         * @param after The tree to change it into
+         * @return std::vector<Patch> The changes, to be applied in order
+         */
+        std::vector<Patch> diff(const Section& before, const Section& after);
+        /**
+         * @brief Compute the changes that turn the section of one document into the section of another. The doctype is not compared.
+         * @param before The document to change
+         * @param after The document to change it into
+         * @return std::vector<Patch> The changes, to be applied in order to the section of the document
+         */
+        std::vector<Patch> diff(const Document& before, const Document& after);
+
+        /**
+         * @brief A class to represent a CSS selector, compiled once to be matched against the descendants of any number of sections.
+         * Supported are type selectors and *, #id, .class, [key], [key=value] along with ~=, |=, ^=, $= and *=, :first-child, :last-child, :only-child and :empty,
+         * the descendant, child (>), next sibling (+) and subsequent sibling (~) combinators, and lists separated by commas.
+         * Type selectors and attribute names are lowercased, like the tag and attribute names of parsed documents; ids, classes and attribute values are
+         * compared exactly as they are written. Text elements are not matched, and do not count as siblings.
+         */
+        class Selector {
+            public:
+                using size_type = std::size_t;
+            private:
+                struct Attribute {
+                    Atom key{};
+                    std::string value{};
+                    char operation{0}; // 0 if the property only has to exist, '=' for an exact match, or the character before the '='
+                };
+
+                struct Compound {
+                    Atom tag{}; // empty for any tag
+                    std::vector<std::string> ids{};
+                    std::vector<std::string> classes{};
+                    std::vector<Attribute> attributes{};
+                    bool first_child{false};
+                    bool last_child{false};
+                    bool empty{false};
+                    char combinator{0}; // how the compound before this one relates to it: ' ', '>', '+' or '~', or 0 for the first compound
+                };
+
+                /**
+                 * @brief A node being matched. Ancestors are sections, whose position is only looked up if a sibling is needed.
+                 */
+                struct Ref {
+                    const Section* owner; // the section that holds the node, or nullptr for a section without a parent
+                    size_type position; // the position of the node in the nodes of owner, or npos if not looked up yet
+                    const Section* section; // the section held by the node, or nullptr for an element
+                };
+
+                std::vector<std::vector<Compound>> selectors{};
+
+                /**
+                 * @brief Get the section that holds a node as a node itself
+                 * @return bool False if the node has no parent
+                 */
+                static bool get_parent(const Ref& ref, Ref& parent);
+                /**
+                 * @brief Get the closest sibling of a node that is not text
+                 * @param previous True for the sibling before the node, false for the one after it
+                 * @return bool False if there is no such sibling
+                 */
+                static bool get_sibling(const Ref& ref, const bool previous, Ref& sibling);
+                static bool match_compound(const Compound& compound, const Ref& ref);
+                /**
+                 * @brief Check if the compounds before index match the relatives of a node that matches the compound at index
+                 */
+                static bool match_relatives(const std::vector<Compound>& compounds, const size_type index, const Ref& ref);
+                /**
+                 * @brief Check if the child at a position of a section matches the selector
+                 */
+                bool match(const Section& owner, const size_type position) const;
+
+                friend class Section;
+            public:
+                /**
+                 * @brief Construct a new Selector object
+                 * @param selector The selector to compile
+                 * @throws docpp::invalid_argument If the selector is malformed or uses something that is not supported
+                 */
+                explicit Selector(const std::string& selector);
+        };
     } // namespace HTML
 
     /**
@@ -1178,6 +3254,15 @@ namespace docpp {
             None,
             Pretty,
             Newline,
+            Minified, /* Minified formatting. Like None, but without optional whitespace and the last semicolon of each rule, with colors and zero lengths shortened. Rules without declarations are left out. */
+        };
+
+        /**
+         * @brief Enum for element types.
+         */
+        enum class Type {
+            Rule, /* A selector, or an at-rule such as @font-face, with a block of declarations. */
+            Verbatim, /* Text written as is in every formatting, such as an @import or @media rule. The tag holds the whole text and the element has no properties. */
         };
 
         /**
@@ -1200,10 +3285,21 @@ namespace docpp {
                  * @param value The value of the property
                  */
                 Property(const std::string& key, const std::string& value) : property(std::make_pair(key, value)) {};
+                /**
+                 * @brief Construct a new Property object
+                 * @param key The key of the property
+                 * @param value The value of the property
+                 */
+                Property(std::string&& key, std::string&& value) : property(std::move(key), std::move(value)) {};
                 /**
                  * @brief Construct a new Property object
                  */
                 Property(const Property& property) : property(property.property) {};
+                /**
+                 * @brief Construct a new Property object
+                 * @param property The property to move from
+                 */
+                Property(Property&& property) noexcept = default;
                 /**
                  * @brief Construct a new Property object
                  */
@@ -1215,9 +3311,9 @@ namespace docpp {
 
                 /**
                  * @brief Get the key of the property
-                 * @return std::string The key of the property
+                 * @return const std::string& The key of the property
                  */
-                std::string get_key() const;
+                const std::string& get_key() const;
                 /**
                  * @brief Get the key of the property in a specific type
                  * @return T The key of the property
@@ -1230,9 +3326,9 @@ namespace docpp {
                 }
                 /**
                  * @brief Get the value of the property
-                 * @return std::string The value of the property
+                 * @return const std::string& The value of the property
                  */
-                std::string get_value() const;
+                const std::string& get_value() const;
                 /**
                  * @brief Get the value of the property in a specific type
                  * @return T The value of the property
@@ -1245,9 +3341,9 @@ namespace docpp {
                 }
                 /**
                  * @brief Get the property.
-                 * @return std::pair<std::string, std::string> The value of the property
+                 * @return const std::pair<std::string, std::string>& The value of the property
                  */
-                std::pair<std::string, std::string> get() const;
+                const std::pair<std::string, std::string>& get() const;
                 /**
                  * @brief Get the property in a specific type.
                  * @return std::pair<T, T> The value of the property
@@ -1276,6 +3372,7 @@ namespace docpp {
                 void set(const std::string& key, const std::string& value);
 
                 Property& operator=(const Property& property);
+                Property& operator=(Property&& property) noexcept = default;
                 bool operator==(const Property& property) const;
                 bool operator!=(const Property& property) const;
         };
@@ -1286,6 +3383,7 @@ namespace docpp {
         class Element {
             private:
                 std::pair<std::string, std::vector<Property>> element{};
+                Type type{Type::Rule};
             protected:
             public:
                 using size_type = std::size_t;
@@ -1346,11 +3444,35 @@ namespace docpp {
                  * @param properties The properties of the element
                  */
                 Element(const std::string& tag, const std::vector<Property>& properties) : element(std::make_pair(tag, properties)) {};
+                /**
+                 * @brief Construct a new Element object
+                 * @param tag The tag of the element
+                 * @param properties The properties of the element to move from
+                 */
+                Element(const std::string& tag, std::vector<Property>&& properties) : element(tag, std::move(properties)) {};
+                /**
+                 * @brief Construct a new Element object
+                 * @param tag The tag of the element to move from
+                 * @param properties The properties of the element to move from
+                 */
+                Element(std::string&& tag, std::vector<Property>&& properties) : element(std::move(tag), std::move(properties)) {};
+                /**
+                 * @brief Construct a new Element object
+                 * @param tag The tag of the element, or the whole text of a Type::Verbatim element
+                 * @param properties The properties of the element to move from
+                 * @param type The type of the element
+                 */
+                Element(std::string&& tag, std::vector<Property>&& properties, const Type type) : element(std::move(tag), std::move(properties)), type(type) {};
                 /**
                  * @brief Construct a new Element object
                  * @param element The element to set
                  */
-                Element(const Element& element) : element(element.element) {};
+                Element(const Element& element) : element(element.element), type(element.type) {};
+                /**
+                 * @brief Construct a new Element object
+                 * @param element The element to move from
+                 */
+                Element(Element&& element) noexcept = default;
                 /**
                  * @brief Construct a new Element object
                  */
@@ -1365,17 +3487,41 @@ namespace docpp {
                  * @param property The property to push
                  */
                 void push_front(const Property& property);
+                /**
+                 * @brief Prepend a property to the element
+                 * @param property The property to move from
+                 */
+                void push_front(Property&& property);
                 /**
                  * @brief Append a property to the element
                  * @param property The property to push
                  */
                 void push_back(const Property& property);
+                /**
+                 * @brief Append a property to the element
+                 * @param property The property to move from
+                 */
+                void push_back(Property&& property);
+                /**
+                 * @brief Construct a property in place at the end of the element
+                 * @param args The arguments to construct the property with
+                 */
+                template <typename... Args>
+                void emplace_back(Args&&... args) {
+                    this->element.second.emplace_back(std::forward<Args>(args)...);
+                }
                 /**
                  * @brief Insert a property into the element
                  * @param index The index to insert the property
                  * @param property The property to insert
                  */
                 void insert(const size_type index, const Property& property);
+                /**
+                 * @brief Insert a property into the element
+                 * @param index The index to insert the property
+                 * @param property The property to move from
+                 */
+                void insert(const size_type index, Property&& property);
                 /**
                  * @brief Erase a property from the element
                  * @param index The index of the property to erase
@@ -1390,9 +3536,9 @@ namespace docpp {
                 /**
                  * @brief Get the property at an index
                  * @param index The index of the property
-                 * @return Property The property at the index
+                 * @return const Property& The property at the index
                  */
-                Property at(const size_type index) const;
+                const Property& at(const size_type index) const;
                 /**
                  * @brief Find a property in the element
                  * @param str The property to find
@@ -1413,14 +3559,14 @@ namespace docpp {
                 void swap(const Property& property1, const Property& property2);
                 /**
                  * @brief Get the first property of the element
-                 * @return Property The first property of the element
+                 * @return const Property& The first property of the element
                  */
-                Property front() const;
+                const Property& front() const;
                 /**
                  * @brief Get the last property of the element
-                 * @return Property The last property of the element
+                 * @return const Property& The last property of the element
                  */
-                Property back() const;
+                const Property& back() const;
                 /**
                  * @brief Get the size of the element
                  * @return size_type The size of the element
@@ -1457,16 +3603,41 @@ namespace docpp {
                  * @param tag The tag to set
                  */
                 void set_tag(const HTML::Tag tag);
+                /**
+                 * @brief Set the type of the element
+                 * @param type The type to set
+                 */
+                void set_type(const Type type);
                 /**
                  * @brief Set the properties of the element
                  * @param properties The properties to set
                  */
                 void set_properties(const std::vector<Property>& properties);
+                /**
+                 * @brief Set the properties of the element
+                 * @param properties The properties to move from
+                 */
+                void set_properties(std::vector<Property>&& properties);
                 /**
                  * @brief Get the element
                  * @return std::pair<std::string, std::vector<Property>> The element
                  */
                 std::string get(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the exact number of bytes get() would return for the element, without rendering it.
+                 * @return size_type The size of the serialized output
+                 */
+                size_type serialized_size(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Append the element to a string, without building intermediate strings.
+                 * @param out The string to append to
+                 */
+                void get_into(std::string& out, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Write the element to a sink, without building intermediate strings.
+                 * @param sink The sink to write to
+                 */
+                void write_to(Sink& sink, const Formatting formatting = Formatting::None, const int tabc = 0) const;
                 /**
                  * @brief Get the element in the form of a specific type.
                  * @return T The element in the form of a specific type
@@ -1479,9 +3650,9 @@ namespace docpp {
                 }
                 /**
                  * @brief Get the tag of the element
-                 * @return std::string The tag of the element
+                 * @return const std::string& The tag of the element
                  */
-                std::string get_tag() const;
+                const std::string& get_tag() const;
                 /**
                  * @brief Get the tag of the element in a specific type
                  * @return T The tag of the element
@@ -1492,16 +3663,23 @@ namespace docpp {
                     }
                     return T(this->element.first);
                 }
+                /**
+                 * @brief Get the type of the element
+                 * @return Type The type of the element
+                 */
+                Type get_type() const;
                 /**
                  * @brief Get the properties of the element
-                 * @return std::vector<Property> The properties of the element
+                 * @return const std::vector<Property>& The properties of the element
                  */
-                std::vector<Property> get_properties() const;
+                const std::vector<Property>& get_properties() const;
 
                 Element& operator=(const Element& element);
+                Element& operator=(Element&& element) noexcept = default;
                 Element& operator=(const std::pair<std::string, std::vector<Property>>& element);
                 Element& operator+=(const Property& property);
-                Property operator[](const size_type& index) const;
+                Element& operator+=(Property&& property);
+                const Property& operator[](const size_type& index) const;
                 bool operator==(const Element& element) const;
                 bool operator!=(const Element& element) const;
         };
@@ -1571,11 +3749,21 @@ namespace docpp {
                  * @param elements The elements to set
                  */
                 explicit Stylesheet(const std::vector<Element>& elements) : elements(elements) {};
+                /**
+                 * @brief Construct a new Stylesheet object
+                 * @param elements The elements to move from
+                 */
+                explicit Stylesheet(std::vector<Element>&& elements) : elements(std::move(elements)) {};
                 /**
                  * @brief Construct a new Stylesheet object
                  * @param stylesheet The stylesheet to set
                  */
                 Stylesheet(const Stylesheet& stylesheet) : elements(stylesheet.elements) {};
+                /**
+                 * @brief Construct a new Stylesheet object
+                 * @param stylesheet The stylesheet to move from
+                 */
+                Stylesheet(Stylesheet&& stylesheet) noexcept = default;
                 /**
                  * @brief Construct a new Stylesheet object
                  */
@@ -1590,17 +3778,41 @@ namespace docpp {
                  * @param element The element to add
                  */
                 void push_front(const Element& element);
+                /**
+                 * @brief Prepend an element to the stylesheet
+                 * @param element The element to move from
+                 */
+                void push_front(Element&& element);
                 /**
                  * @brief Append an element to the stylesheet
                  * @param element The element to add
                  */
                 void push_back(const Element& element);
+                /**
+                 * @brief Append an element to the stylesheet
+                 * @param element The element to move from
+                 */
+                void push_back(Element&& element);
+                /**
+                 * @brief Construct an element in place at the end of the stylesheet
+                 * @param args The arguments to construct the element with
+                 */
+                template <typename... Args>
+                void emplace_back(Args&&... args) {
+                    this->elements.emplace_back(std::forward<Args>(args)...);
+                }
                 /**
                  * @brief Insert an element into the stylesheet
                  * @param index The index to insert the element
                  * @param element The element to insert
                  */
                 void insert(const size_type index, const Element& element);
+                /**
+                 * @brief Insert an element into the stylesheet
+                 * @param index The index to insert the element
+                 * @param element The element to move from
+                 */
+                void insert(const size_type index, Element&& element);
                 /**
                  * @brief Erase an element from the stylesheet. Note that this will NOT change the size/index.
                  * @param index The index of the element to erase
@@ -1621,9 +3833,9 @@ namespace docpp {
                 /**
                  * @brief Get the element at an index
                  * @param index The index of the element
-                 * @return Element The element at the index
+                 * @return const Element& The element at the index
                  */
-                Element at(const size_type index) const;
+                const Element& at(const size_type index) const;
                 /**
                  * @brief Get the size of the stylesheet
                  * @return size_type The size of the stylesheet
@@ -1640,14 +3852,14 @@ namespace docpp {
                 bool empty() const;
                 /**
                  * @brief Get the first element of the stylesheet
-                 * @return Element The first element of the stylesheet
+                 * @return const Element& The first element of the stylesheet
                  */
-                Element front() const;
+                const Element& front() const;
                 /**
                  * @brief Get the last element of the stylesheet
-                 * @return Element The last element of the stylesheet
+                 * @return const Element& The last element of the stylesheet
                  */
-                Element back() const;
+                const Element& back() const;
                 /**
                  * @brief Swap two elements in the stylesheet
                  * @param index1 The index of the first element
@@ -1665,16 +3877,42 @@ namespace docpp {
                  * @param elements The elements to set
                  */
                 void set(const std::vector<Element>& elements);
+                /**
+                 * @brief Set the elements of the stylesheet
+                 * @param elements The elements to move from
+                 */
+                void set(std::vector<Element>&& elements);
                 /**
                  * @brief Get the elements of the stylesheet
-                 * @return std::vector<Element> The elements of the stylesheet
+                 * @return const std::vector<Element>& The elements of the stylesheet
+                 */
+                const std::vector<Element>& get_elements() const;
+                /**
+                 * @brief Merge rules with the same selector and drop declarations that are overridden later in the same rule, without changing what the stylesheet matches.
+                 * A rule is only merged into an earlier one when no rule in between declares a related property, and a declaration is kept as a fallback when either it or the one overriding it is vendor prefixed, or the one overriding it uses a function.
+                 * At-rules are left as they are. Runs in time linear in the number of declarations.
                  */
-                std::vector<Element> get_elements() const;
+                void optimize();
                 /**
                  * @brief Get the stylesheet
                  * @return std::string The stylesheet
                  */
                 std::string get(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Get the exact number of bytes get() would return for the stylesheet, without rendering it.
+                 * @return size_type The size of the serialized output
+                 */
+                size_type serialized_size(const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Append the stylesheet to a string, without building intermediate strings.
+                 * @param out The string to append to
+                 */
+                void get_into(std::string& out, const Formatting formatting = Formatting::None, const int tabc = 0) const;
+                /**
+                 * @brief Write the stylesheet to a sink, without building intermediate strings.
+                 * @param sink The sink to write to
+                 */
+                void write_to(Sink& sink, const Formatting formatting = Formatting::None, const int tabc = 0) const;
                 /**
                  * @brief Get the stylesheet in the form of a specific type.
                  * @return T The stylesheet in the form of a specific type
@@ -1687,11 +3925,24 @@ namespace docpp {
                 }
 
                 Stylesheet& operator=(const Stylesheet& stylesheet);
+                Stylesheet& operator=(Stylesheet&& stylesheet) noexcept = default;
                 Stylesheet& operator+=(const Element& element);
-                Element operator[](const int& index) const;
+                Stylesheet& operator+=(Element&& element);
+                const Element& operator[](const int& index) const;
                 bool operator==(const Stylesheet& stylesheet) const;
                 bool operator!=(const Stylesheet& stylesheet) const;
         };
+
+        /**
+         * @brief Parse CSS into a stylesheet. Every rule becomes an element with the selector as its tag and the declarations as its properties.
+         * Comments are removed, whitespace outside of strings is collapsed to a single space and values, including !important, are otherwise kept as written.
+         * At-rules with a declaration block, such as @font-face and @page, become elements like any other rule. Other at-rules, such as @charset, @import
+         * and @media, become Type::Verbatim elements holding the rule exactly as written, so they are written back in place. The parser never throws on malformed CSS;
+         * invalid declarations are dropped and unclosed blocks are closed at the end of the input.
+         * @param css The CSS to parse
+         * @return Stylesheet The parsed stylesheet
+         */
+        Stylesheet parse(const std::string& css);
     } // namespace CSS
 
     /**
@@ -8,994 +8,6049 @@
 #include <include/docpp.hpp>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <ostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <system_error>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(__AVX2__) || (defined(__GNUC__) && defined(__x86_64__))
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// definitions for the npos constants, which are needed whenever one is bound to a reference
+const docpp::HTML::Property::size_type docpp::HTML::Property::npos;
+const docpp::HTML::Properties::size_type docpp::HTML::Properties::npos;
+const docpp::HTML::Element::size_type docpp::HTML::Element::npos;
+const docpp::HTML::Section::size_type docpp::HTML::Section::npos;
+const docpp::HTML::Document::size_type docpp::HTML::Document::npos;
+const docpp::HTML::Template::size_type docpp::HTML::Template::npos;
+const docpp::CSS::Property::size_type docpp::CSS::Property::npos;
+const docpp::CSS::Element::size_type docpp::CSS::Element::npos;
+const docpp::CSS::Stylesheet::size_type docpp::CSS::Stylesheet::npos;
+
+namespace {
+    bool is_space(const char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+    }
+
+    // the control character placeholder() wraps slot names in; it is never escaped and never part of whitespace collapsing
+    const char placeholder_marker{'\x1A'};
+
+    bool is_slot_char(const char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+    }
+
+    void write_tabs(docpp::Sink& sink, const int count) {
+        static const char tabs[]{"\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"};
+        static const int size{sizeof(tabs) - 1};
+
+        for (int remaining{count}; remaining > 0; remaining -= size) {
+            sink.write(tabs, std::min(remaining, size));
+        }
+    }
+
+    /**
+     * @brief A sink that discards its input and only counts the number of bytes written
+     */
+    class CountingSink : public docpp::Sink {
+        private:
+            size_type count{0};
+        public:
+            using Sink::write;
+
+            void write(const char*, const size_type size) override {
+                this->count += size;
+            }
+
+            size_type size() const {
+                return this->count;
+            }
+    };
+
+    /**
+     * @brief A sink that passes its input on to another sink, while also appending it to the current one of a list of strings.
+     * The strings are reused from earlier output where there are any, so that capturing the same output again does not allocate.
+     */
+    class CaptureSink : public docpp::Sink {
+        private:
+            docpp::Sink& sink;
+            std::vector<std::string>& text;
+            size_type piece{0};
+        public:
+            using Sink::write;
+
+            CaptureSink(docpp::Sink& sink, std::vector<std::string>& text) : sink(sink), text(text) {};
+
+            void write(const char* data, const size_type size) override {
+                this->sink.write(data, size);
+                this->text[this->piece].append(data, size);
+            }
+
+            /**
+             * @brief Start over at the first string
+             */
+            void reset() {
+                this->piece = 0;
+
+                if (this->text.empty()) {
+                    this->text.emplace_back();
+                }
+
+                this->text.front().clear();
+            }
+
+            /**
+             * @brief Append to the next string from now on
+             */
+            void next() {
+                if (++this->piece == this->text.size()) {
+                    this->text.emplace_back();
+                } else {
+                    this->text[this->piece].clear();
+                }
+            }
+    };
+
+    /**
+     * @brief The threads that render parallel sections, shared by all of them so that repeated and nested renders do not start threads of their own
+     */
+    class WorkerPool {
+        private:
+            std::mutex mutex{};
+            std::condition_variable ready{};
+            std::deque<std::function<void()>> tasks{};
+            std::size_t size{0};
+
+            WorkerPool() {
+                // the thread that starts a render takes part in it as well
+                const unsigned int hardware{std::max(std::thread::hardware_concurrency(), 2u)};
+
+                for (unsigned int i{1}; i < hardware; i++) {
+                    try {
+                        std::thread{&WorkerPool::work, this}.detach();
+                        this->size++;
+                    } catch (const std::system_error&) {
+                        break;
+                    }
+                }
+            }
+
+            void work() {
+                while (true) {
+                    std::function<void()> task{};
+
+                    {
+                        std::unique_lock<std::mutex> lock{this->mutex};
+                        this->ready.wait(lock, [this]() { return !this->tasks.empty(); });
+                        task = std::move(this->tasks.front());
+                        this->tasks.pop_front();
+                    }
+
+                    task();
+                }
+            }
+        public:
+            static WorkerPool& get() {
+                // never destroyed, since its threads keep waiting for tasks until the program exits
+                static WorkerPool* pool{new WorkerPool{}};
+                return *pool;
+            }
+
+            /**
+             * @brief Get the number of threads in the pool
+             */
+            std::size_t get_size() const {
+                return this->size;
+            }
+
+            /**
+             * @brief Queue a task to run on one of the threads. The task must not throw.
+             */
+            void submit(std::function<void()> task) {
+                {
+                    std::lock_guard<std::mutex> lock{this->mutex};
+                    this->tasks.push_back(std::move(task));
+                }
+
+                this->ready.notify_one();
+            }
+    };
+
+    // true while the current thread renders a range of a parallel section
+    thread_local bool rendering_in_parallel{false};
+
+    std::atomic<bool> escape_by_default{false};
+
+    /**
+     * @brief Write the entity for a character that must be escaped
+     */
+    void write_entity(docpp::Sink& sink, const char c) {
+        switch (c) {
+            case '&':
+                sink.write("&amp;", 5);
+                break;
+            case '<':
+                sink.write("&lt;", 4);
+                break;
+            case '>':
+                sink.write("&gt;", 4);
+                break;
+            case '"':
+                sink.write("&quot;", 6);
+                break;
+            case '\'':
+                sink.write("&#39;", 5);
+                break;
+            default:
+                sink.write(&c, 1);
+                break;
+        }
+    }
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    unsigned count_trailing_zeros(const std::uint32_t mask) {
+#ifdef _MSC_VER
+        unsigned long index{0};
+        _BitScanForward(&index, mask);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    /**
+     * @brief Write the characters of a block that need to be escaped, along with the text before each of them
+     * @param i The position of the block
+     * @param mask A bit for every character in the block that needs to be escaped
+     * @param start The first character that has not been written yet, which is moved past every escaped character
+     */
+    void write_escaped_block(docpp::Sink& sink, const char* const data, const std::size_t i, std::uint32_t mask, std::size_t& start) {
+        while (mask) {
+            const std::size_t position{i + count_trailing_zeros(mask)};
+
+            if (position > start) {
+                sink.write(data + start, position - start);
+            }
+
+            write_entity(sink, data[position]);
+            start = position + 1;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // AVX2 code is built for every x86-64 target with GCC and Clang, which can compile single functions for it, and only run if the processor has it
+#if defined(__AVX2__)
+#define DOCPP_AVX2
+    bool has_avx2() {
+        return true;
+    }
+#elif defined(__GNUC__) && defined(__x86_64__) && defined(__SSE2__)
+#define DOCPP_AVX2 __attribute__((target("avx2")))
+    bool has_avx2() {
+        static const bool supported{[]() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }()};
+
+        return supported;
+    }
+#endif
+
+#ifdef DOCPP_AVX2
+    /**
+     * @brief Escape the whole blocks of 32 characters, starting at i
+     * @return std::size_t The position after the last block
+     */
+    DOCPP_AVX2 std::size_t write_escaped_avx2(docpp::Sink& sink, const char* const data, const std::size_t size, std::size_t i, const char first, const char second, std::size_t& start) {
+        const __m256i amp32{_mm256_set1_epi8('&')};
+        const __m256i first32{_mm256_set1_epi8(first)};
+        const __m256i second32{_mm256_set1_epi8(second)};
+
+        for (; i + 32 <= size; i += 32) {
+            const __m256i block{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i))};
+            const __m256i matches{_mm256_or_si256(_mm256_cmpeq_epi8(block, amp32), _mm256_or_si256(_mm256_cmpeq_epi8(block, first32), _mm256_cmpeq_epi8(block, second32)))};
+
+            write_escaped_block(sink, data, i, static_cast<std::uint32_t>(_mm256_movemask_epi8(matches)), start);
+        }
+
+        return i;
+    }
+
+    /**
+     * @brief Look for a character in the whole blocks of 32 characters, starting at pos
+     * @return std::size_t The position of the character, or the position after the last block if it does not occur in them
+     */
+    DOCPP_AVX2 std::size_t find_byte_avx2(const char* const data, const std::size_t size, std::size_t pos, const char c) {
+        const __m256i needle32{_mm256_set1_epi8(c)};
+
+        for (; pos + 32 <= size; pos += 32) {
+            const __m256i block{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos))};
+            const std::uint32_t mask{static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle32)))};
+
+            if (mask) {
+                return pos + count_trailing_zeros(mask);
+            }
+        }
+
+        return pos;
+    }
+#endif
+
+    /**
+     * @brief Write a string to a sink, escaping & < > in text, or & " ' in attribute values. Runs of characters that need no escaping are written in one go.
+     */
+    void write_escaped(docpp::Sink& sink, const char* const data, const std::size_t size, const bool attribute) {
+        const char first{attribute ? '"' : '<'};
+        const char second{attribute ? '\'' : '>'};
+
+        std::size_t start{0}; // the first character that has not been written yet
+        std::size_t i{0};
+
+#ifdef DOCPP_AVX2
+        if (has_avx2()) {
+            i = write_escaped_avx2(sink, data, size, i, first, second, start);
+        }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+        const __m128i amp16{_mm_set1_epi8('&')};
+        const __m128i first16{_mm_set1_epi8(first)};
+        const __m128i second16{_mm_set1_epi8(second)};
+
+        for (; i + 16 <= size; i += 16) {
+            const __m128i block{_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))};
+            const __m128i matches{_mm_or_si128(_mm_cmpeq_epi8(block, amp16), _mm_or_si128(_mm_cmpeq_epi8(block, first16), _mm_cmpeq_epi8(block, second16)))};
+
+            write_escaped_block(sink, data, i, static_cast<std::uint32_t>(_mm_movemask_epi8(matches)), start);
+        }
+#endif
+
+        for (; i < size; i++) {
+            const char c{data[i]};
+
+            if (c == '&' || c == first || c == second) {
+                if (i > start) {
+                    sink.write(data + start, i - start);
+                }
+
+                write_entity(sink, c);
+                start = i + 1;
+            }
+        }
+
+        if (size > start) {
+            sink.write(data + start, size - start);
+        }
+    }
+
+    /**
+     * @brief Find the first occurrence of a character in a string, starting at pos, comparing 32 or 16 bytes at a time where possible
+     * @return std::size_t The position of the character, or the size of the string if it does not occur
+     */
+    std::size_t find_byte(const std::string& str, std::size_t pos, const char c) {
+        const char* const data{str.data()};
+        const std::size_t size{str.size()};
+
+#ifdef DOCPP_AVX2
+        // the blocks of 16 and the loop below find the character again at once if it stopped on it
+        if (has_avx2()) {
+            pos = find_byte_avx2(data, size, pos, c);
+        }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+        const __m128i needle16{_mm_set1_epi8(c)};
+
+        for (; pos + 16 <= size; pos += 16) {
+            const __m128i block{_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos))};
+            const std::uint32_t mask{static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16)))};
+
+            if (mask) {
+                return pos + count_trailing_zeros(mask);
+            }
+        }
+#endif
+
+        for (; pos < size; pos++) {
+            if (data[pos] == c) {
+                return pos;
+            }
+        }
+
+        return size;
+    }
+
+    void write_text(docpp::Sink& sink, const docpp::String& str, const bool escape) {
+        if (escape) {
+            write_escaped(sink, str.data(), str.size(), false);
+        } else {
+            sink.write(str.data(), str.size());
+        }
+    }
+
+    /**
+     * @brief Check if an attribute value can be written without quotes. A value with a placeholder keeps them, since a Template compiled
+     * from the output may fill in text that needs them.
+     */
+    bool is_unquotable(const docpp::String& value) {
+        if (value.find(placeholder_marker) != docpp::String::npos) {
+            return false;
+        }
+
+        for (const char c : value) {
+            // everything above '>' except '`' is allowed, which covers most characters with a single comparison
+            if ((static_cast<unsigned char>(c) > '>' && c != '`') || !(is_space(c) || c == '"' || c == '\'' || c == '=' || c == '<' || c == '>' || c == '`')) {
+                continue;
+            }
+
+            return false;
+        }
+
+        return !value.empty();
+    }
+
+    /**
+     * @brief Write properties to a sink. With unquoted set, values that do not need quotes are written without them.
+     */
+    void write_properties(docpp::Sink& sink, const docpp::HTML::Properties& properties, const bool escape, const bool unquoted = false) {
+        for (docpp::HTML::Properties::const_iterator it{properties.cbegin()}; it != properties.cend(); it++) {
+            const std::string& key{it->get_key()};
+            const docpp::String& value{it->get_value()};
+
+            if (key.empty() || value.empty()) continue;
+
+            const bool quoted{!unquoted || !is_unquotable(value)};
+
+            sink.write(" ", 1);
+            sink.write(key);
+            sink.write("=\"", quoted ? 2 : 1);
+
+            if (escape) {
+                write_escaped(sink, value.data(), value.size(), true);
+            } else {
+                sink.write(value.data(), value.size());
+            }
+
+            if (quoted) {
+                sink.write("\"", 1);
+            }
+        }
+    }
+
+    /**
+     * @brief A sink that passes its input on to another sink, replacing every run of whitespace with a single space
+     */
+    class CollapsingSink : public docpp::Sink {
+        private:
+            docpp::Sink& sink;
+            bool space{false};
+        public:
+            using Sink::write;
+
+            explicit CollapsingSink(docpp::Sink& sink) : sink(sink) {}
+
+            void write(const char* data, const size_type size) override {
+                if (!size) {
+                    return;
+                }
+
+                size_type start{0}; // the first character that has not been written yet
+                size_type previous{size}; // the last whitespace character, if this->space was set by it rather than by an earlier write
+
+                // only called for characters up to ' ', so that most characters are ruled out before looking at them one by one
+                const auto visit = [this, data, &start, &previous](const size_type i) {
+                    if (!is_space(data[i])) {
+                        return;
+                    }
+
+                    const bool run{previous == size_type(i - 1)};
+
+                    if (!run && data[i] == ' ') {
+                        // a single space is already collapsed, so it is passed on with the rest of the text
+                    } else {
+                        if (i > start) {
+                            this->sink.write(data + start, i - start);
+                        }
+                        if (!run) {
+                            this->sink.write(" ", 1);
+                        }
+
+                        start = i + 1;
+                    }
+
+                    this->space = true;
+                    previous = i;
+                };
+
+                if (this->space) {
+                    previous = size_type(-1);
+                }
+
+                size_type i{0};
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+                const __m128i limit{_mm_set1_epi8(' ')};
+
+                for (; i + 16 <= size; i += 16) {
+                    const __m128i block{_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))};
+                    // a byte is at most ' ' if taking the unsigned minimum with ' ' leaves it unchanged
+                    std::uint32_t mask{static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(block, limit), block)))};
+
+                    while (mask) {
+                        visit(i + count_trailing_zeros(mask));
+                        mask &= mask - 1;
+                    }
+                }
+#endif
+
+                for (; i < size; i++) {
+                    if (static_cast<unsigned char>(data[i]) <= ' ') {
+                        visit(i);
+                    }
+                }
+
+                this->space = previous == size - 1;
+
+                if (size > start) {
+                    this->sink.write(data + start, size - start);
+                }
+            }
+    };
+
+    /**
+     * @brief Check if whitespace in the content of an element is significant, so that minified output must keep it as written
+     */
+    bool is_preformatted(const std::string& tag) {
+        switch (tag.size()) {
+            case 3:
+                return tag == "pre";
+            case 5:
+                return tag == "style";
+            case 6:
+                return tag == "script";
+            case 8:
+                return tag == "textarea";
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Check if the content of an element is raw text, which browsers read up to the closing tag without decoding entities, so it is never escaped
+     */
+    bool is_unescaped_content(const std::string& tag) {
+        switch (tag.size()) {
+            case 5:
+                return tag == "style";
+            case 6:
+                return tag == "script";
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief When the closing tag of an element may be left out: if the element is followed by one of the follower tags,
+     * or if it is the last child of its parent and last is set
+     */
+    struct OptionalClose {
+        std::unordered_set<std::string> followers;
+        bool last;
+    };
+
+    /**
+     * @brief Look up when the HTML specification allows the closing tag of an element to be omitted
+     * @param tag The tag of the element
+     * @return const OptionalClose* The rule for the tag, or nullptr if its closing tag is required
+     */
+    const OptionalClose* find_optional_close(const std::string& tag) {
+        static const OptionalClose li{{"li"}, true};
+        static const OptionalClose dt{{"dt", "dd"}, false};
+        static const OptionalClose dd{{"dt", "dd"}, true};
+        static const OptionalClose rt_rp{{"rt", "rp"}, true};
+        static const OptionalClose optgroup{{"optgroup", "hr"}, true};
+        static const OptionalClose option{{"option", "optgroup", "hr"}, true};
+        static const OptionalClose thead{{"tbody", "tfoot"}, false};
+        static const OptionalClose tbody{{"tbody", "tfoot"}, true};
+        static const OptionalClose tfoot{{}, true};
+        static const OptionalClose tr{{"tr"}, true};
+        static const OptionalClose td_th{{"td", "th"}, true};
+        static const OptionalClose p{{"address", "article", "aside", "blockquote", "details", "dialog", "div", "dl", "fieldset", "figcaption", "figure", "footer",
+            "form", "h1", "h2", "h3", "h4", "h5", "h6", "header", "hgroup", "hr", "main", "menu", "nav", "ol", "p", "pre", "search", "section", "table", "ul"}, true};
+        // nothing but comments may follow these, so they are only omitted at the very end
+        static const OptionalClose html_body{{}, true};
+
+        // most tags have no optional closing tag, and the length rules them out before any comparison
+        switch (tag.size()) {
+            case 1:
+                return tag == "p" ? &p : nullptr;
+            case 2:
+                return tag == "li" ? &li : tag == "td" || tag == "th" ? &td_th : tag == "tr" ? &tr : tag == "dt" ? &dt : tag == "dd" ? &dd : tag == "rt" || tag == "rp" ? &rt_rp : nullptr;
+            case 4:
+                return tag == "html" || tag == "body" ? &html_body : nullptr;
+            case 5:
+                return tag == "tbody" ? &tbody : tag == "thead" ? &thead : tag == "tfoot" ? &tfoot : nullptr;
+            case 6:
+                return tag == "option" ? &option : nullptr;
+            case 8:
+                return tag == "optgroup" ? &optgroup : nullptr;
+            default:
+                return nullptr;
+        }
+    }
+
+    /**
+     * @brief Check if the HTML specification allows the closing tag of an element to be omitted
+     * @param tag The tag of the element
+     * @param parent The tag of its parent
+     * @param next The node that follows the element, or nullptr if it is the last child of its parent
+     */
+    bool is_close_optional(const std::string& tag, const std::string& parent, const docpp::HTML::Section::Node* next) {
+        static const std::unordered_set<std::string> p_parents{"a", "audio", "del", "ins", "map", "noscript", "video"};
+
+        const OptionalClose* rule{find_optional_close(tag)};
+
+        if (!rule) {
+            return false;
+        }
+
+        if (!next) {
+            if (tag == "html" || tag == "body") {
+                return true;
+            }
+
+            // a parent without a tag is not the real parent, so whatever follows it is unknown
+            return rule->last && !parent.empty() && (tag != "p" || !p_parents.count(parent));
+        }
+
+        if (next->is_section()) {
+            return rule->followers.count(next->get_section().get_tag()) != 0;
+        }
+
+        const docpp::HTML::Element& element{next->get_element()};
+        const docpp::HTML::Type type{element.get_type()};
+
+        return type != docpp::HTML::Type::Text && type != docpp::HTML::Type::Text_No_Formatting && type != docpp::HTML::Type::Non_Opened && rule->followers.count(element.get_tag()) != 0;
+    }
+
+    /**
+     * @brief Write an element to a sink
+     * @param omit_close Leave out the closing tag, which the caller has checked to be optional
+     * @param raw_text True if the element is in a section whose content is never escaped, see is_unescaped_content()
+     */
+    void write_element(docpp::Sink& sink, const docpp::HTML::Element& element, const docpp::HTML::Formatting formatting, const int tabc, const bool omit_close, const bool raw_text = false) {
+        using docpp::HTML::Type;
+
+        const docpp::HTML::Escape setting{element.get_escape()};
+        const bool escape{setting == docpp::HTML::Escape::Always || (setting == docpp::HTML::Escape::Default && docpp::HTML::get_escape())};
+        const bool minified{formatting == docpp::HTML::Formatting::Minified};
+        const Type type{element.get_type()};
+        const std::string& tag{element.get_tag()};
+        // the properties of a script or style element are escaped like any others, only its content is not
+        const bool escape_data{escape && !raw_text && !is_unescaped_content(tag)};
+
+        CollapsingSink collapsing{sink};
+        docpp::Sink& text{minified && !is_preformatted(tag) ? static_cast<docpp::Sink&>(collapsing) : sink};
+
+        if (type == Type::Text_No_Formatting) {
+            write_text(text, element.get_data(), escape_data);
+            return;
+        } else if (type == Type::Text) {
+            if (!minified) {
+                write_tabs(sink, tabc);
+            }
+
+            write_text(text, element.get_data(), escape_data);
+            return;
+        }
+
+        if (formatting == docpp::HTML::Formatting::Pretty) {
+            write_tabs(sink, tabc);
+        }
+
+        if (type == Type::Non_Opened) {
+            sink.write("</", 2);
+        } else {
+            sink.write("<", 1);
+        }
+
+        sink.write(tag);
+
+        // an unquoted value would run into the slash of a self closing tag
+        write_properties(sink, element.get_properties(), escape, minified && type != Type::Self_Closing);
+
+        if (type != Type::Self_Closing && type != Type::Non_Opened) {
+            sink.write(">", 1);
+        }
+
+        if (type == Type::Non_Self_Closing) {
+            write_text(text, element.get_data(), escape_data);
+
+            if (!omit_close) {
+                sink.write("</", 2);
+                sink.write(tag);
+                sink.write(">", 1);
+            }
+        } else if (type == Type::Self_Closing) {
+            write_text(text, element.get_data(), escape_data);
+            sink.write("/>", 2);
+        } else if (type == Type::Non_Opened) {
+            sink.write(">", 1);
+        }
+
+        if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
+            sink.write("\n", 1);
+        }
+    }
+
+} // namespace
+
+namespace {
+    /**
+     * @brief The modulus of both lanes of a docpp::Hash, the Mersenne prime 2^61 - 1
+     */
+    const std::uint64_t hash_modulus{(std::uint64_t{1} << 61) - 1};
+
+    std::uint64_t reduce(std::uint64_t value) {
+        value = (value & hash_modulus) + (value >> 61);
+
+        return value >= hash_modulus ? value - hash_modulus : value;
+    }
+
+    /**
+     * @brief Multiply two numbers below the modulus, modulo the modulus
+     */
+    std::uint64_t multiply(const std::uint64_t a, const std::uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        __extension__ const unsigned __int128 product{static_cast<unsigned __int128>(a) * b};
+
+        return reduce((static_cast<std::uint64_t>(product) & hash_modulus) + static_cast<std::uint64_t>(product >> 61));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        std::uint64_t high{0};
+        const std::uint64_t low{_umul128(a, b, &high)};
+
+        return reduce((low & hash_modulus) + ((low >> 61) | (high << 3)));
+#else
+        // 2^64 is 8 and 2^61 is 1 modulo the modulus
+        const std::uint64_t a_high{a >> 32};
+        const std::uint64_t a_low{a & 0xffffffff};
+        const std::uint64_t b_high{b >> 32};
+        const std::uint64_t b_low{b & 0xffffffff};
+        const std::uint64_t middle{a_high * b_low + a_low * b_high};
+        const std::uint64_t low{a_low * b_low};
+
+        return reduce((a_high * b_high << 3) + (middle >> 29) + ((middle & 0x1fffffff) << 32) + (low & hash_modulus) + (low >> 61));
+#endif
+    }
+
+    /**
+     * @brief The base of each lane of a docpp::Hash and its first powers, so that eight bytes can be hashed at once.
+     * For each of the eight positions in a block, every byte value is kept multiplied by the power of its position, so that a block costs one multiplication per lane.
+     */
+    struct HashPowers {
+        std::uint64_t power[2][9]{};
+        // the base raised to eight times the index, so that short outputs need no exponentiation
+        std::uint64_t blocks[2][32]{};
+        std::uint64_t table[8][256][2]{};
+
+        HashPowers() {
+            const std::uint64_t bases[2]{0x0f4e1c5a9b3d2e71, 0x1a2b3c4d5e6f7081};
+
+            for (int lane{0}; lane < 2; lane++) {
+                this->power[lane][0] = 1;
+
+                for (int i{1}; i < 9; i++) {
+                    this->power[lane][i] = multiply(this->power[lane][i - 1], bases[lane]);
+                }
+
+                this->blocks[lane][0] = 1;
+
+                for (int i{1}; i < 32; i++) {
+                    this->blocks[lane][i] = multiply(this->blocks[lane][i - 1], this->power[lane][8]);
+                }
+
+                for (int position{0}; position < 8; position++) {
+                    for (int byte{0}; byte < 256; byte++) {
+                        this->table[position][byte][lane] = multiply(this->power[lane][7 - position], static_cast<std::uint64_t>(byte));
+                    }
+                }
+            }
+        }
+    };
+
+    const HashPowers& get_hash_powers() {
+        static const HashPowers powers{};
+
+        return powers;
+    }
+
+    /**
+     * @brief The finalizer of SplitMix64, so that every bit of the hash depends on every bit of the lanes
+     */
+    std::uint64_t mix(std::uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+
+        return value ^ (value >> 31);
+    }
+
+    void write_hex(std::string& out, const std::uint64_t value, const int digits) {
+        static const char hex[]{"0123456789abcdef"};
+
+        for (int i{digits - 1}; i >= 0; i--) {
+            out += hex[(value >> (i * 4)) & 0xf];
+        }
+    }
+
+    std::uint32_t rotate_right(const std::uint32_t value, const int count) {
+        return (value >> count) | (value << (32 - count));
+    }
+} // namespace
+
+void docpp::Hash::update(const char* data, const size_type size) {
+    const HashPowers& powers{get_hash_powers()};
+    const unsigned char* bytes{reinterpret_cast<const unsigned char*>(data)};
+    const std::uint64_t* first{powers.power[0]};
+    const std::uint64_t* second{powers.power[1]};
+    std::uint64_t hash[2]{this->hash[0], this->hash[1]};
+    size_type i{0};
+
+#if defined(__SIZEOF_INT128__)
+    // each lane is the bytes read as the digits of a number in the base of the lane. the eight digits of a block are looked up already
+    // multiplied by their power of the base, and their sum stays below 2^64, so a block costs one multiplication and one reduction per lane
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t digits[2]{0, 0};
+
+        for (int j{0}; j < 8; j++) {
+            const std::uint64_t* entry{powers.table[j][bytes[i + j]]};
+
+            digits[0] += entry[0];
+            digits[1] += entry[1];
+        }
+
+        for (int lane{0}; lane < 2; lane++) {
+            __extension__ const unsigned __int128 sum{static_cast<unsigned __int128>(hash[lane]) * powers.power[lane][8] + digits[lane]};
+
+            hash[lane] = reduce((static_cast<std::uint64_t>(sum) & hash_modulus) + (static_cast<std::uint64_t>(sum >> 61) & hash_modulus) + static_cast<std::uint64_t>(sum >> 122));
+        }
+    }
+
+    // the last few bytes are a short block, whose digits are looked up at the end of the table
+    if (i < size) {
+        const size_type tail{size - i};
+        std::uint64_t digits[2]{0, 0};
+
+        for (size_type j{0}; j < tail; j++) {
+            const std::uint64_t* entry{powers.table[8 - tail + j][bytes[i + j]]};
+
+            digits[0] += entry[0];
+            digits[1] += entry[1];
+        }
+
+        for (int lane{0}; lane < 2; lane++) {
+            __extension__ const unsigned __int128 sum{static_cast<unsigned __int128>(hash[lane]) * powers.power[lane][tail] + digits[lane]};
+
+            hash[lane] = reduce((static_cast<std::uint64_t>(sum) & hash_modulus) + (static_cast<std::uint64_t>(sum >> 61) & hash_modulus) + static_cast<std::uint64_t>(sum >> 122));
+        }
+
+        i = size;
+    }
+#endif
+    for (; i < size; i++) {
+        hash[0] = reduce(multiply(hash[0], first[1]) + bytes[i]);
+        hash[1] = reduce(multiply(hash[1], second[1]) + bytes[i]);
+    }
+
+    // the base raised to the number of bytes, which append() needs to shift the hash of everything before this output
+    const size_type blocks{size / 8};
+
+    for (int lane{0}; lane < 2; lane++) {
+        const std::uint64_t* power{powers.power[lane]};
+        std::uint64_t total{this->power[lane]};
+
+        if (blocks < 32) {
+            total = multiply(total, powers.blocks[lane][blocks]);
+        } else {
+            std::uint64_t square{power[8]};
+
+            for (size_type remaining{blocks}; remaining != 0; remaining >>= 1) {
+                if (remaining & 1) {
+                    total = multiply(total, square);
+                }
+
+                square = multiply(square, square);
+            }
+        }
+
+        this->hash[lane] = hash[lane];
+        this->power[lane] = multiply(total, power[size % 8]);
+    }
+
+    this->length += size;
+}
+
+void docpp::Hash::append(const Hash& hash) {
+    for (int lane{0}; lane < 2; lane++) {
+        this->hash[lane] = reduce(multiply(this->hash[lane], hash.power[lane]) + hash.hash[lane]);
+        this->power[lane] = multiply(this->power[lane], hash.power[lane]);
+    }
+
+    this->length += hash.length;
+}
+
+docpp::Hash::size_type docpp::Hash::size() const {
+    return static_cast<size_type>(this->length);
+}
+
+std::uint64_t docpp::Hash::get_64() const {
+    return this->get_128().second;
+}
+
+std::pair<std::uint64_t, std::uint64_t> docpp::Hash::get_128() const {
+    // the length tells apart outputs that only differ in leading zero bytes
+    const std::uint64_t high{mix(this->hash[0] ^ mix(this->length + 0x9e3779b97f4a7c15))};
+
+    return std::make_pair(high, mix(this->hash[1] ^ high));
+}
+
+std::string docpp::Hash::get_string() const {
+    const std::pair<std::uint64_t, std::uint64_t> hash{this->get_128()};
+    std::string ret{};
+
+    ret.reserve(32);
+    write_hex(ret, hash.first, 16);
+    write_hex(ret, hash.second, 16);
+
+    return ret;
+}
+
+std::string docpp::Hash::get_etag() const {
+    return "\"" + this->get_string() + "\"";
+}
+
+bool docpp::Hash::operator==(const Hash& hash) const {
+    return this->hash[0] == hash.hash[0] && this->hash[1] == hash.hash[1] && this->length == hash.length;
+}
+
+bool docpp::Hash::operator!=(const Hash& hash) const {
+    return !(*this == hash);
+}
+
+void docpp::Sha256::transform(const unsigned char* data) {
+    static const std::uint32_t k[64]{
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    std::uint32_t w[64];
+
+    for (int i{0}; i < 16; i++) {
+        w[i] = static_cast<std::uint32_t>(data[i * 4]) << 24 | static_cast<std::uint32_t>(data[i * 4 + 1]) << 16 | static_cast<std::uint32_t>(data[i * 4 + 2]) << 8 | data[i * 4 + 3];
+    }
+
+    for (int i{16}; i < 64; i++) {
+        const std::uint32_t s0{rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3)};
+        const std::uint32_t s1{rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10)};
+
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    std::uint32_t v[8];
+
+    std::copy(this->state, this->state + 8, v);
+
+    for (int i{0}; i < 64; i++) {
+        const std::uint32_t s1{rotate_right(v[4], 6) ^ rotate_right(v[4], 11) ^ rotate_right(v[4], 25)};
+        const std::uint32_t choice{(v[4] & v[5]) ^ (~v[4] & v[6])};
+        const std::uint32_t first{v[7] + s1 + choice + k[i] + w[i]};
+        const std::uint32_t s0{rotate_right(v[0], 2) ^ rotate_right(v[0], 13) ^ rotate_right(v[0], 22)};
+        const std::uint32_t majority{(v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2])};
+
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = v[3] + first;
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = first + s0 + majority;
+    }
+
+    for (int i{0}; i < 8; i++) {
+        this->state[i] += v[i];
+    }
+}
+
+void docpp::Sha256::update(const char* data, const size_type size) {
+    const unsigned char* bytes{reinterpret_cast<const unsigned char*>(data)};
+    size_type buffered{static_cast<size_type>(this->length % 64)};
+    size_type i{0};
+
+    this->length += size;
+
+    if (buffered != 0) {
+        const size_type count{std::min(size, 64 - buffered)};
+
+        std::memcpy(this->block + buffered, bytes, count);
+        i = count;
+        buffered += count;
+
+        if (buffered < 64) {
+            return;
+        }
+
+        this->transform(this->block);
+    }
+
+    for (; i + 64 <= size; i += 64) {
+        this->transform(bytes + i);
+    }
+
+    if (i < size) {
+        std::memcpy(this->block, bytes + i, size - i);
+    }
+}
+
+std::string docpp::Sha256::get() const {
+    // the padding is added to a copy, so that more data can still be added to this one
+    Sha256 copy{*this};
+    const std::uint64_t bits{this->length * 8};
+    const size_type buffered{static_cast<size_type>(this->length % 64)};
+    const size_type padding{buffered < 56 ? 56 - buffered : 120 - buffered};
+    unsigned char tail[72]{0x80};
+
+    for (int i{0}; i < 8; i++) {
+        tail[padding + i] = static_cast<unsigned char>(bits >> (56 - i * 8));
+    }
+
+    copy.update(reinterpret_cast<const char*>(tail), padding + 8);
+
+    std::string ret{};
+
+    ret.reserve(64);
+
+    for (const std::uint32_t it : copy.state) {
+        write_hex(ret, it, 8);
+    }
+
+    return ret;
+}
+
+void docpp::StringSink::write(const char* data, const size_type size) {
+    this->str.append(data, size);
+}
+
+void docpp::StringSink::reserve(const size_type size) {
+    this->str.reserve(this->str.size() + size);
+}
+
+void docpp::StreamSink::write(const char* data, const size_type size) {
+    this->stream.write(data, static_cast<std::streamsize>(size));
+}
+
+void docpp::StreamSink::flush() {
+    this->stream.flush();
+}
+
+void docpp::FileSink::write(const char* data, const size_type size) {
+    if (std::fwrite(data, 1, size, this->file) != size) {
+        throw docpp::io_error("Failed to write to file");
+    }
+}
+
+void docpp::FileSink::flush() {
+    if (std::fflush(this->file) != 0) {
+        throw docpp::io_error("Failed to flush file");
+    }
+}
+
+void docpp::BufferedSink::write(const char* data, const size_type size) {
+    if (this->buffer.size() + size > this->capacity) {
+        this->flush();
+    }
+
+    if (size >= this->capacity) {
+        this->write_out(data, size);
+    } else {
+        this->buffer.append(data, size);
+    }
+}
+
+void docpp::BufferedSink::flush() {
+    if (this->buffer.empty()) {
+        return;
+    }
+
+    this->write_out(this->buffer.data(), this->buffer.size());
+    this->buffer.clear();
+}
+
+void docpp::DescriptorSink::write_out(const char* data, const size_type size) {
+    size_type written{0};
+
+    while (written < size) {
+#ifdef _WIN32
+        const int ret{_write(this->fd, data + written, static_cast<unsigned int>(size - written))};
+#else
+        const ssize_t ret{::write(this->fd, data + written, size - written)};
+#endif
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw docpp::io_error("Failed to write to file descriptor");
+        }
+
+        written += static_cast<size_type>(ret);
+    }
+}
+
+docpp::DescriptorSink::~DescriptorSink() {
+    try {
+        this->flush();
+    } catch (const docpp::io_error&) {
+        // destructors must not throw, call flush() yourself to handle errors
+    }
+}
+
+void docpp::CallbackSink::write_out(const char* data, const size_type size) {
+    this->callback(data, size);
+}
+
+docpp::CallbackSink::~CallbackSink() {
+    try {
+        this->flush();
+    } catch (...) {
+        // destructors must not throw, call flush() yourself to handle errors
+    }
+}
+
+void docpp::HashingSink::write_buffer() {
+    if (this->buffered == 0) {
+        return;
+    }
+
+    const size_type size{this->buffered};
+
+    this->buffered = 0;
+    this->hash.update(this->buffer, size);
+
+    if (this->sha256) {
+        this->digest.update(this->buffer, size);
+    }
+
+    if (this->sink) {
+        this->sink->write(this->buffer, size);
+    }
+}
+
+void docpp::HashingSink::write(const char* data, const size_type size) {
+    // output arrives a few bytes at a time, which is hashed and passed on much faster in larger pieces
+    if (this->buffered + size > sizeof(this->buffer)) {
+        this->write_buffer();
+    }
+
+    if (size < sizeof(this->buffer)) {
+        std::memcpy(this->buffer + this->buffered, data, size);
+        this->buffered += size;
+        return;
+    }
+
+    this->hash.update(data, size);
+
+    if (this->sha256) {
+        this->digest.update(data, size);
+    }
+
+    if (this->sink) {
+        this->sink->write(data, size);
+    }
+}
+
+void docpp::HashingSink::write(const char* data, const size_type size, const Hash& hash) {
+    this->write_buffer();
+    this->hash.append(hash);
+
+    if (this->sha256) {
+        this->digest.update(data, size);
+    }
+
+    if (this->sink) {
+        this->sink->write(data, size, hash);
+    }
+}
+
+bool docpp::HashingSink::uses_hash() const {
+    return true;
+}
+
+void docpp::HashingSink::reserve(const size_type size) {
+    if (this->sink) {
+        this->sink->reserve(this->buffered + size);
+    }
+}
+
+void docpp::HashingSink::flush() {
+    this->write_buffer();
+
+    if (this->sink) {
+        this->sink->flush();
+    }
+}
+
+docpp::HashingSink::~HashingSink() {
+    try {
+        this->write_buffer();
+    } catch (...) {
+        // destructors must not throw, call flush() yourself to handle errors
+    }
+}
+
+docpp::Hash docpp::HashingSink::get_hash() const {
+    Hash ret{this->hash};
+
+    ret.update(this->buffer, this->buffered);
+
+    return ret;
+}
+
+std::string docpp::HashingSink::get_sha256() const {
+    if (!this->sha256) {
+        return std::string{};
+    }
+
+    Sha256 ret{this->digest};
+
+    ret.update(this->buffer, this->buffered);
+
+    return ret.get();
+}
+
+struct docpp::HTML::Atom::Stored {
+    std::string str;
+    Arena* arena;
+    std::atomic<std::size_t> refs{1};
+
+    Stored(const std::string& str, Arena* arena) : str(str), arena(arena) {};
+};
+
+struct docpp::Arena::Atoms {
+    std::unordered_map<std::string, std::unique_ptr<HTML::Atom::Stored>> strings{};
+};
+
+docpp::Arena::~Arena() {
+    this->release();
+}
+
+void* docpp::Arena::allocate(const size_type size, const size_type alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw docpp::invalid_argument("Alignment must be a power of two");
+    }
+
+    std::uintptr_t address{reinterpret_cast<std::uintptr_t>(this->cursor)};
+    std::uintptr_t aligned{(address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1)};
+
+    if (!this->cursor || aligned + size > reinterpret_cast<std::uintptr_t>(this->last)) {
+        const size_type header{(sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1)};
+        const size_type needed{size + alignment};
+        const size_type block_size{needed > this->block_size ? needed : this->block_size};
+
+        Block* block{static_cast<Block*>(::operator new(header + block_size))};
+
+        block->next = this->blocks;
+        block->size = header + block_size;
+
+        this->blocks = block;
+        this->reserved += block->size;
+
+        this->cursor = reinterpret_cast<char*>(block) + header;
+        this->last = this->cursor + block_size;
+
+        address = reinterpret_cast<std::uintptr_t>(this->cursor);
+        aligned = (address + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+    }
+
+    this->cursor = reinterpret_cast<char*>(aligned + size);
+    this->used += size;
+
+    return reinterpret_cast<void*>(aligned);
+}
+
+void docpp::Arena::release() {
+    delete this->atoms;
+    this->atoms = nullptr;
+
+    while (this->blocks) {
+        Block* next{this->blocks->next};
+        ::operator delete(this->blocks);
+        this->blocks = next;
+    }
+
+    this->cursor = nullptr;
+    this->last = nullptr;
+    this->used = 0;
+    this->reserved = 0;
+}
+
+docpp::Arena::size_type docpp::Arena::size() const {
+    return this->used;
+}
+
+docpp::Arena::size_type docpp::Arena::capacity() const {
+    return this->reserved;
+}
+
+const std::string& docpp::HTML::Property::get_key() const {
+    return this->key.get();
+}
+
+const docpp::HTML::Atom& docpp::HTML::Property::get_key_atom() const {
+    return this->key;
+}
+
+const docpp::String& docpp::HTML::Property::get_value() const {
+    return this->value;
+}
+
+std::pair<std::string, std::string> docpp::HTML::Property::get() const {
+    return {this->key.get(), std::string{this->value}};
+}
+
+void docpp::HTML::Property::set_key(const std::string& key) {
+    this->key = Atom{key, this->value.get_arena()};
+}
+
+void docpp::HTML::Property::set_value(const std::string& value) {
+    this->value = value;
+}
+
+void docpp::HTML::Property::set(const std::pair<std::string, std::string>& property) {
+    this->key = Atom{property.first, this->value.get_arena()};
+    this->value = property.second;
+}
+
+docpp::HTML::Property& docpp::HTML::Property::operator=(const docpp::HTML::Property& property) {
+    this->key = Atom{property.key, this->value.get_arena()};
+    this->value = property.value;
+    return *this;
+}
+
+// like the value, the key stays in the storage of this property
+docpp::HTML::Property& docpp::HTML::Property::operator=(docpp::HTML::Property&& property) {
+    this->key = Atom{property.key, this->value.get_arena()};
+    this->value = std::move(property.value);
+    return *this;
+}
+
+bool docpp::HTML::Property::operator==(const docpp::HTML::Property& property) const {
+    return this->key == property.key && this->value == property.value;
+}
+
+bool docpp::HTML::Property::operator!=(const docpp::HTML::Property& property) const {
+    return this->key != property.key || this->value != property.value;
+}
+
+void docpp::HTML::Property::clear() {
+    this->key = {};
+    this->value.clear();
+}
+
+bool docpp::HTML::Property::empty() const {
+    return this->key.empty() && this->value.empty();
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator=(const docpp::HTML::Property& property) {
+    this->properties = {property};
+    return *this;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator=(const docpp::HTML::Properties& properties) {
+    this->properties = properties.properties;
+    return *this;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator=(const std::vector<docpp::HTML::Property>& properties) {
+    this->set(properties);
+    return *this;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator=(std::vector<docpp::HTML::Property>&& properties) {
+    this->set(std::move(properties));
+    return *this;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator=(docpp::HTML::Property&& property) {
+    this->properties.clear();
+    this->properties.push_back(std::move(property));
+    return *this;
+}
+
+const docpp::HTML::Property& docpp::HTML::Properties::operator[](const size_type& index) const {
+    return this->at(index);
+}
+
+bool docpp::HTML::Properties::operator==(const docpp::HTML::Properties& properties) const {
+    return this->properties == properties.properties;
+}
+
+bool docpp::HTML::Properties::operator==(const docpp::HTML::Property& property) const {
+    for (const docpp::HTML::Property& it : this->properties) {
+        if (it.get() == property.get()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool docpp::HTML::Properties::operator!=(const docpp::HTML::Properties& properties) const {
+    return this->properties != properties.properties;
+}
+
+bool docpp::HTML::Properties::operator!=(const docpp::HTML::Property& property) const {
+    for (const docpp::HTML::Property& it : this->properties) {
+        if (it.get() == property.get()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator+=(const docpp::HTML::Property& property) {
+    this->push_back(property);
+    return *this;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator+=(docpp::HTML::Property&& property) {
+    this->push_back(std::move(property));
+    return *this;
+}
+
+docpp::HTML::Properties& docpp::HTML::Properties::operator+=(const docpp::HTML::Properties& properties) {
+    for (docpp::HTML::Properties::const_iterator it{properties.cbegin()}; it != properties.cend(); it++) {
+        this->push_back(*it);
+    }
+
+    return *this;
+}
+
+const std::vector<docpp::HTML::Property, docpp::ArenaAllocator<docpp::HTML::Property>>& docpp::HTML::Properties::get_properties() const {
+    return this->properties;
+}
+
+docpp::Arena* docpp::HTML::Properties::get_arena() const {
+    return this->properties.get_allocator().arena();
+}
+
+const docpp::HTML::Property& docpp::HTML::Properties::at(const size_type index) const {
+    if (index < 0 || index >= this->properties.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    return this->properties.at(index);
+}
+
+void docpp::HTML::Properties::set(const std::vector<docpp::HTML::Property>& properties) {
+    this->properties.assign(properties.begin(), properties.end());
+}
+
+void docpp::HTML::Properties::set(std::vector<docpp::HTML::Property>&& properties) {
+    this->properties.assign(std::make_move_iterator(properties.begin()), std::make_move_iterator(properties.end()));
+}
+
+void docpp::HTML::Properties::insert(const size_type index, const docpp::HTML::Property& property) {
+    if (index < 0 || index >= this->properties.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    this->properties.insert(this->properties.begin() + index, property);
+}
+
+void docpp::HTML::Properties::insert(const size_type index, docpp::HTML::Property&& property) {
+    if (index >= this->properties.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    this->properties.insert(this->properties.begin() + index, std::move(property));
+}
+
+void docpp::HTML::Properties::erase(const size_type index) {
+    if (index < 0 || index >= this->properties.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    this->properties.erase(this->properties.begin() + index);
+}
+
+void docpp::HTML::Properties::push_front(const docpp::HTML::Property& property) {
+    this->properties.insert(this->properties.begin(), property);
+}
+
+void docpp::HTML::Properties::push_front(docpp::HTML::Property&& property) {
+    this->properties.insert(this->properties.begin(), std::move(property));
+}
+
+void docpp::HTML::Properties::push_back(const docpp::HTML::Property& property) {
+    this->properties.push_back(property);
+}
+
+void docpp::HTML::Properties::push_back(docpp::HTML::Property&& property) {
+    this->properties.push_back(std::move(property));
+}
+
+docpp::HTML::Properties::size_type docpp::HTML::Properties::find(const docpp::HTML::Property& property) {
+    for (size_type i{0}; i < this->properties.size(); i++) {
+        if (this->properties.at(i).get_key_atom() == property.get_key_atom()) {
+            return i;
+        } else if (!this->properties.at(i).get_value().compare(property.get_value())) {
+            return i;
+        } else if (this->properties.at(i).get_value().find(property.get_value()) != std::string::npos) {
+            return i;
+        } else if (this->properties.at(i).get_key().find(property.get_key()) != std::string::npos) {
+            return i;
+        } else if (this->properties.at(i).get() == property.get()) {
+            return i;
+        }
+    }
+
+    return docpp::HTML::Properties::npos;
+}
+
+docpp::HTML::Properties::size_type docpp::HTML::Properties::find(const std::string& str) {
+    for (size_type i{0}; i < this->properties.size(); i++) {
+        if (!this->properties.at(i).get_key().compare(str) || !this->properties.at(i).get_value().compare(str)) {
+            return i;
+        } else if (this->properties.at(i).get_key().find(str) != std::string::npos || this->properties.at(i).get_value().find(str) != std::string::npos) {
+            return i;
+        }
+    }
+
+    return docpp::HTML::Properties::npos;
+}
+
+const docpp::HTML::Property& docpp::HTML::Properties::front() const {
+    if (this->properties.empty()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    return this->properties.front();
+}
+
+const docpp::HTML::Property& docpp::HTML::Properties::back() const {
+    if (this->properties.empty()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    return this->properties.back();
+}
+
+docpp::HTML::Properties::size_type docpp::HTML::Properties::size() const {
+    return this->properties.size();
+}
+
+void docpp::HTML::Properties::clear() {
+    this->properties.clear();
+}
+
+void docpp::HTML::Properties::reserve(const size_type size) {
+    this->properties.reserve(size);
+}
+
+bool docpp::HTML::Properties::empty() const {
+    return this->properties.empty();
+}
+
+void docpp::HTML::Properties::swap(const size_type index1, const size_type index2) {
+    if (index1 < 0 || index1 >= this->properties.size() || index2 < 0 || index2 >= this->properties.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    std::swap(this->properties[index1], this->properties[index2]);
+}
+
+void docpp::HTML::Properties::swap(const docpp::HTML::Property& property1, const docpp::HTML::Property& property2) {
+    this->swap(this->find(property1), this->find(property2));
+}
+
+
+docpp::HTML::Element& docpp::HTML::Element::operator=(const docpp::HTML::Element& element) {
+    this->tag = Atom{element.tag, this->data.get_arena()};
+    this->properties = element.properties;
+    this->data = element.data;
+    this->type = element.type;
+    this->escape = element.escape;
+    return *this;
+}
+
+// like the data, the tag stays in the storage of this element
+docpp::HTML::Element& docpp::HTML::Element::operator=(docpp::HTML::Element&& element) {
+    this->tag = Atom{element.tag, this->data.get_arena()};
+    this->properties = std::move(element.properties);
+    this->data = std::move(element.data);
+    this->type = element.type;
+    this->escape = element.escape;
+    return *this;
+}
+
+docpp::HTML::Element& docpp::HTML::Element::operator+=(const std::string& data) {
+    this->data.append(data.data(), data.size());
+    return *this;
+}
+
+bool docpp::HTML::Element::operator==(const docpp::HTML::Element& element) const {
+    return this->tag == element.tag && this->type == element.type && this->data == element.data && this->properties == element.properties;
+}
+
+bool docpp::HTML::Element::operator!=(const docpp::HTML::Element& element) const {
+    return !(*this == element);
+}
+
+void docpp::HTML::Element::set(const std::string& tag, const Properties& properties, const String& data, const Type type) {
+    this->set_tag(tag);
+    this->set_properties(properties);
+    this->set_data(data);
+    this->set_type(type);
+}
+
+void docpp::HTML::Element::set(const Tag tag, const Properties& properties, const String& data) {
+    this->set_tag(tag);
+    this->set_properties(properties);
+    this->set_data(data);
+}
+
+void docpp::HTML::Element::set_tag(const std::string& tag) {
+    this->tag = Atom{tag, this->data.get_arena()};
+}
+
+void docpp::HTML::Element::set_data(const String& data) {
+    this->data = data;
+}
+
+void docpp::HTML::Element::set_data(String&& data) {
+    this->data = std::move(data);
+}
+
+void docpp::HTML::Element::set_type(const Type type) {
+    this->type = type;
+}
+
+void docpp::HTML::Element::set_properties(const Properties& properties) {
+    this->properties = properties;
+}
+
+void docpp::HTML::Element::set_properties(Properties&& properties) {
+    // moving would carry the allocator over, so properties from another arena are copied to keep the element's own
+    if (properties.get_arena() == this->properties.get_arena()) {
+        this->properties = std::move(properties);
+    } else {
+        this->properties = properties;
+    }
+}
+
+std::string docpp::HTML::Element::get(const Formatting formatting, const int tabc) const {
+    std::string ret{};
+
+    ret.reserve(this->serialized_size(formatting, tabc));
+    this->get_into(ret, formatting, tabc);
+
+    return ret;
+}
+
+docpp::HTML::Element::size_type docpp::HTML::Element::serialized_size(const Formatting formatting, const int tabc) const {
+    CountingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.size();
+}
+
+void docpp::HTML::Element::get_into(std::string& out, const Formatting formatting, const int tabc) const {
+    StringSink sink{out};
+
+    this->write_to(sink, formatting, tabc);
+}
+
+void docpp::HTML::Element::write_to(Sink& sink, const Formatting formatting, const int tabc) const {
+    write_element(sink, *this, formatting, tabc, false);
+}
+
+const std::string& docpp::HTML::Element::get_tag() const {
+    return this->tag.get();
+}
+
+const docpp::HTML::Atom& docpp::HTML::Element::get_tag_atom() const {
+    return this->tag;
+}
+
+const docpp::String& docpp::HTML::Element::get_data() const {
+    return this->data;
+}
+
+docpp::HTML::Type docpp::HTML::Element::get_type() const {
+    return this->type;
+}
+
+void docpp::HTML::Element::set_escape(const Escape escape) {
+    this->escape = escape;
+}
+
+docpp::HTML::Escape docpp::HTML::Element::get_escape() const {
+    return this->escape;
+}
+
+const docpp::HTML::Properties& docpp::HTML::Element::get_properties() const {
+    return this->properties;
+}
+
+bool docpp::HTML::Element::empty() const {
+    return this->tag.empty() && this->data.empty() && this->properties.empty();
+}
+
+void docpp::HTML::Element::clear() {
+    this->tag = {};
+    this->data.clear();
+    this->properties.clear();
+}
+
+std::unique_ptr<docpp::HTML::Section, docpp::HTML::Section::Node::Deleter> docpp::HTML::Section::Node::copy_section(const Section& section, Arena* arena) {
+    if (!arena) {
+        return std::unique_ptr<Section, Deleter>{new Section(section), Deleter{false}};
+    }
+
+    void* memory{arena->allocate(sizeof(Section), alignof(Section))};
+
+    return std::unique_ptr<Section, Deleter>{new (memory) Section(section, *arena), Deleter{true}};
+}
+
+std::unique_ptr<docpp::HTML::Section, docpp::HTML::Section::Node::Deleter> docpp::HTML::Section::Node::move_section(Section&& section, Arena* arena) {
+    if (!arena) {
+        if (section.get_arena()) {
+            return copy_section(section, nullptr);
+        }
+
+        return std::unique_ptr<Section, Deleter>{new Section(std::move(section)), Deleter{false}};
+    }
+
+    void* memory{arena->allocate(sizeof(Section), alignof(Section))};
+
+    return std::unique_ptr<Section, Deleter>{new (memory) Section(std::move(section), *arena), Deleter{true}};
+}
+
+void docpp::HTML::Section::Node::Deleter::operator()(Section* section) const {
+    if (this->arena) {
+        section->~Section();
+    } else {
+        delete section;
+    }
+}
+
+docpp::HTML::Section::Node::Node(const Element& element, Arena* arena) : kind(Kind::Element), element(arena ? Element{element, *arena} : element) {}
+
+docpp::HTML::Section::Node::Node(const Section& section, Arena* arena) : kind(Kind::Section), section(copy_section(section, arena)) {}
+
+// an element moved into a heap section is copied if its properties, data or tag live in an arena, like move_section() does for sections
+docpp::HTML::Section::Node::Node(Element&& element, Arena* arena) : kind(Kind::Element),
+    element(arena ? Element{std::move(element), *arena} : element.get_properties().get_arena() || element.get_data().get_arena() || element.get_tag_atom().get_arena() ? Element{element} : std::move(element)) {}
+
+docpp::HTML::Section::Node::Node(Section&& section, Arena* arena) : kind(Kind::Section), section(move_section(std::move(section), arena)) {}
+
+docpp::HTML::Section::Node::Node(const Node& node, Arena* arena) : kind(node.kind), element(arena ? Element{node.element, *arena} : node.element) {
+    if (node.section) {
+        this->section = copy_section(*node.section, arena);
+    }
+}
+
+docpp::HTML::Section::Node::Node(Node&& node) noexcept : kind(node.kind), element(std::move(node.element)), section(std::move(node.section)) {
+    node.kind = Kind::None;
+}
+
+docpp::HTML::Section::Node::~Node() = default;
+
+docpp::HTML::Section::Node& docpp::HTML::Section::Node::operator=(Node&& node) noexcept {
+    this->kind = node.kind;
+    this->element = std::move(node.element);
+    this->section = std::move(node.section);
+    node.kind = Kind::None;
+
+    return *this;
+}
+
+bool docpp::HTML::Section::Node::operator==(const Node& node) const {
+    if (this->kind != node.kind) {
+        return false;
+    }
+
+    switch (this->kind) {
+        case Kind::Element:
+            return this->element == node.element;
+        case Kind::Section:
+            return *this->section == *node.section;
+        default:
+            return true;
+    }
+}
+
+bool docpp::HTML::Section::Node::operator!=(const Node& node) const {
+    return !(*this == node);
+}
+
+const docpp::HTML::Element& docpp::HTML::Section::Node::get_element() const {
+    if (this->kind != Kind::Element) {
+        throw docpp::invalid_argument("Node does not hold an element");
+    }
+
+    return this->element;
+}
+
+docpp::HTML::Section& docpp::HTML::Section::Node::get_section() {
+    if (this->kind != Kind::Section) {
+        throw docpp::invalid_argument("Node does not hold a section");
+    }
+
+    return *this->section;
+}
+
+const docpp::HTML::Section& docpp::HTML::Section::Node::get_section() const {
+    if (this->kind != Kind::Section) {
+        throw docpp::invalid_argument("Node does not hold a section");
+    }
+
+    return *this->section;
+}
+
+docpp::HTML::Section::~Section() {
+    // take the child sections out of every descendant first, so that each one is destroyed without any children left to recurse into;
+    // sections in an arena are destroyed too, since elements and sections moved or assigned below them may still own heap memory
+    std::vector<std::unique_ptr<Section, Node::Deleter>, ArenaAllocator<std::unique_ptr<Section, Node::Deleter>>> pending{ArenaAllocator<std::unique_ptr<Section, Node::Deleter>>{this->get_arena()}};
+
+    for (Node& it : this->nodes) {
+        if (it.kind == Node::Kind::Section && it.section) {
+            pending.push_back(std::move(it.section));
+        }
+    }
+
+    while (!pending.empty()) {
+        std::unique_ptr<Section, Node::Deleter> section{std::move(pending.back())};
+        pending.pop_back();
+
+        for (Node& it : section->nodes) {
+            if (it.kind == Node::Kind::Section && it.section) {
+                pending.push_back(std::move(it.section));
+            }
+        }
+    }
+}
+
+docpp::HTML::Section::Section(const Section& section, Arena& arena) : tag(section.tag, &arena), properties(section.properties, arena), nodes(ArenaAllocator<Node>{&arena}) {
+    this->nodes.reserve(section.nodes.size());
+
+    for (const Node& it : section.nodes) {
+        this->nodes.emplace_back(it, &arena);
+    }
+
+    this->caching = section.caching;
+    this->threads = section.threads;
+    this->indexing = section.indexing;
+    this->adopt();
+}
+
+docpp::HTML::Section::Section(Section&& section, Arena& arena) : tag(section.tag, &arena), properties(std::move(section.properties), arena), nodes(ArenaAllocator<Node>{&arena}) {
+    this->caching = section.caching;
+    this->threads = section.threads;
+    this->indexing = section.indexing;
+    section.index.reset();
+
+    if (section.get_arena() == &arena) {
+        this->nodes = std::move(section.nodes);
+        this->cache = std::move(section.cache);
+        this->adopt();
+        return;
+    }
+
+    this->nodes.reserve(section.nodes.size());
+
+    for (Node& it : section.nodes) {
+        if (it.kind == Node::Kind::Section) {
+            this->nodes.emplace_back(std::move(*it.section), &arena);
+        } else if (it.kind == Node::Kind::Element) {
+            this->nodes.emplace_back(std::move(it.element), &arena);
+        } else {
+            this->nodes.emplace_back();
+        }
+    }
+
+    section.nodes.clear();
+    this->adopt();
+}
+
+docpp::HTML::Section& docpp::HTML::Section::operator=(const docpp::HTML::Section& section) {
+    if (this != &section) {
+        // copy the children into this section's own storage, which may be an arena
+        std::vector<Node, ArenaAllocator<Node>> nodes{this->nodes.get_allocator()};
+        nodes.reserve(section.nodes.size());
+
+        for (const Node& it : section.nodes) {
+            nodes.emplace_back(it, this->get_arena());
+        }
+
+        this->tag = Atom{section.tag, this->get_arena()};
+        this->properties = section.properties;
+        this->nodes = std::move(nodes);
+        this->caching = section.caching;
+        this->threads = section.threads;
+        this->indexing = section.indexing;
+        this->adopt();
+        this->invalidate();
+    }
+
+    return *this;
+}
+
+docpp::HTML::Section& docpp::HTML::Section::operator=(docpp::HTML::Section&& section) {
+    if (this == &section) {
+        return *this;
+    }
+
+    if (this->get_arena() != section.get_arena()) {
+        // the children must end up in this section's own storage, so they are copied or moved one by one
+        if (!this->get_arena()) {
+            return *this = static_cast<const Section&>(section);
+        }
+
+        Section moved{std::move(section), *this->get_arena()};
+        return *this = std::move(moved);
+    }
+
+    this->tag = std::move(section.tag);
+    this->properties = std::move(section.properties);
+    this->nodes = std::move(section.nodes);
+    this->caching = section.caching;
+    this->threads = section.threads;
+    this->indexing = section.indexing;
+    section.index.reset();
+    this->adopt();
+    this->invalidate();
+
+    return *this;
+}
+
+docpp::HTML::Section& docpp::HTML::Section::operator+=(const docpp::HTML::Element& element) {
+    this->push_back(element);
+    return *this;
+}
+
+docpp::HTML::Section& docpp::HTML::Section::operator+=(const docpp::HTML::Section& section) {
+    this->push_back(section);
+    return *this;
+}
+
+docpp::HTML::Section& docpp::HTML::Section::operator+=(docpp::HTML::Element&& element) {
+    this->push_back(std::move(element));
+    return *this;
+}
+
+docpp::HTML::Section& docpp::HTML::Section::operator+=(docpp::HTML::Section&& section) {
+    this->push_back(std::move(section));
+    return *this;
+}
+
+const docpp::HTML::Element& docpp::HTML::Section::operator[](const int& index) const {
+    return this->at(index);
+}
+
+std::unordered_map<std::string, docpp::HTML::Element> docpp::HTML::Section::operator[](const std::string& tag) const {
+    std::unordered_map<std::string, docpp::HTML::Element> ret{};
+    Atom atom{};
+
+    // a tag that was never interned cannot be the tag of any element
+    if (!Atom::find(tag, atom)) {
+        return ret;
+    }
+
+    for (const Element& it : this->get_elements()) {
+        if (it.get_tag_atom() == atom) {
+            ret[static_cast<std::string>(it.get_data())] = it;
+        }
+    }
+
+    return ret;
+}
+
+std::unordered_map<std::string, docpp::HTML::Element> docpp::HTML::Section::operator[](const Tag tag) const {
+    std::unordered_map<std::string, docpp::HTML::Element> ret{};
+    const Atom atom{tag};
+
+    for (const Element& it : this->get_elements()) {
+        if (it.get_tag_atom() == atom) {
+            ret[static_cast<std::string>(it.get_data())] = it;
+        }
+    }
+
+    return ret;
+}
+
+bool docpp::HTML::Section::operator==(const docpp::HTML::Section& section) const {
+    return this->tag == section.tag && this->properties == section.properties && this->nodes == section.nodes;
+}
+
+bool docpp::HTML::Section::operator==(const docpp::HTML::Element& element) const {
+    for (const Element& it : this->get_elements()) {
+        if (it.get() == element.get()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool docpp::HTML::Section::operator!=(const docpp::HTML::Section& section) const {
+    return !(*this == section);
+}
+
+bool docpp::HTML::Section::operator!=(const docpp::HTML::Element& element) const {
+    for (const Element& it : this->get_elements()) {
+        if (it.get() == element.get()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void docpp::HTML::Section::set(const std::string& tag, const Properties& properties) {
+    this->tag = Atom{tag, this->get_arena()};
+    this->properties = properties;
+    this->invalidate();
+}
+
+void docpp::HTML::Section::set_tag(const std::string& tag) {
+    this->tag = Atom{tag, this->get_arena()};
+    this->invalidate();
+}
+
+void docpp::HTML::Section::set_tag(const Tag tag) {
+    this->tag = Atom{tag};
+    this->invalidate();
+}
+
+void docpp::HTML::Section::set_tag(const Atom tag) {
+    this->tag = Atom{tag, this->get_arena()};
+    this->invalidate();
+}
+
+void docpp::HTML::Section::set_properties(const Properties& properties) {
+    const size_type position{this->find_indexed_position()};
+
+    if (position != docpp::HTML::Section::npos) {
+        this->parent->reindex(position, false, false);
+    }
+
+    this->properties = properties;
+
+    if (position != docpp::HTML::Section::npos) {
+        this->parent->reindex(position, true, false);
+    }
+
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::set_properties(Properties&& properties) {
+    const size_type position{this->find_indexed_position()};
+
+    if (position != docpp::HTML::Section::npos) {
+        this->parent->reindex(position, false, false);
+    }
+
+    if (properties.get_arena() == this->properties.get_arena()) {
+        this->properties = std::move(properties);
+    } else {
+        this->properties = properties;
+    }
+
+    if (position != docpp::HTML::Section::npos) {
+        this->parent->reindex(position, true, false);
+    }
+
+    this->invalidate(true);
+}
+
+namespace docpp {
+    namespace HTML {
+        namespace {
+            constexpr std::size_t length(const char* str) {
+                return *str ? 1 + length(str + 1) : 0;
+            }
+
+            constexpr bool equal(const char* str1, const char* str2) {
+                return *str1 == *str2 && (*str1 == '\0' || equal(str1 + 1, str2 + 1));
+            }
+
+            /**
+             * @brief An entry in the tag table
+             */
+            struct TagEntry {
+                Tag tag;
+                const char* name;
+                std::size_t size;
+                Type type;
+
+                constexpr TagEntry(const Tag tag, const char* name, const Type type) : tag(tag), name(name), size(length(name)), type(type) {}
+            };
+
+            /**
+             * @brief Every tag, indexed by the value of the Tag enum.
+             */
+            constexpr TagEntry tag_table[]{
+                {Tag::Empty, "", Type::Text},
+                {Tag::Empty_No_Formatting, "", Type::Text_No_Formatting},
+                {Tag::Abbreviation, "abbr", Type::Non_Self_Closing},
+                {Tag::Abbr, "abbr", Type::Non_Self_Closing},
+                {Tag::Acronym, "acronym", Type::Non_Self_Closing},
+                {Tag::Address, "address", Type::Non_Self_Closing},
+                {Tag::Anchor, "a", Type::Non_Self_Closing},
+                {Tag::A, "a", Type::Non_Self_Closing},
+                {Tag::Applet, "applet", Type::Non_Self_Closing},
+                {Tag::Article, "article", Type::Non_Self_Closing},
+                {Tag::Area, "area", Type::Non_Closed},
+                {Tag::Aside, "aside", Type::Non_Self_Closing},
+                {Tag::Audio, "audio", Type::Non_Self_Closing},
+                {Tag::Base, "base", Type::Non_Closed},
+                {Tag::Basefont, "basefont", Type::Non_Closed},
+                {Tag::Bdi, "bdi", Type::Non_Self_Closing},
+                {Tag::Bdo, "bdo", Type::Non_Self_Closing},
+                {Tag::Bgsound, "bgsound", Type::Non_Self_Closing},
+                {Tag::Big, "big", Type::Non_Self_Closing},
+                {Tag::Blockquote, "blockquote", Type::Non_Self_Closing},
+                {Tag::Body, "body", Type::Non_Self_Closing},
+                {Tag::Bold, "b", Type::Non_Self_Closing},
+                {Tag::B, "b", Type::Non_Self_Closing},
+                {Tag::Br, "br", Type::Non_Closed},
+                {Tag::Break, "br", Type::Non_Closed},
+                {Tag::Button, "button", Type::Non_Closed},
+                {Tag::Caption, "caption", Type::Non_Self_Closing},
+                {Tag::Canvas, "canvas", Type::Non_Self_Closing},
+                {Tag::Center, "center", Type::Non_Self_Closing},
+                {Tag::Cite, "cite", Type::Non_Self_Closing},
+                {Tag::Code, "code", Type::Non_Self_Closing},
+                {Tag::Colgroup, "colgroup", Type::Non_Self_Closing},
+                {Tag::Col, "col", Type::Non_Closed},
+                {Tag::Column, "col", Type::Non_Closed},
+                {Tag::Data, "data", Type::Non_Self_Closing},
+                {Tag::Datalist, "datalist", Type::Non_Self_Closing},
+                {Tag::Dd, "dd", Type::Non_Self_Closing},
+                {Tag::Dfn, "dfn", Type::Non_Self_Closing},
+                {Tag::Define, "dfn", Type::Non_Self_Closing},
+                {Tag::Delete, "del", Type::Non_Self_Closing},
+                {Tag::Del, "del", Type::Non_Self_Closing},
+                {Tag::Details, "details", Type::Non_Self_Closing},
+                {Tag::Dialog, "dialog", Type::Non_Self_Closing},
+                {Tag::Dir, "dir", Type::Non_Self_Closing},
+                {Tag::Div, "div", Type::Non_Self_Closing},
+                {Tag::Dl, "dl", Type::Non_Self_Closing},
+                {Tag::Dt, "dt", Type::Non_Self_Closing},
+                {Tag::Embed, "embed", Type::Non_Closed},
+                {Tag::Fieldset, "fieldset", Type::Non_Self_Closing},
+                {Tag::Figcaption, "figcaption", Type::Non_Self_Closing},
+                {Tag::Figure, "figure", Type::Non_Self_Closing},
+                {Tag::Font, "font", Type::Non_Self_Closing},
+                {Tag::Footer, "footer", Type::Non_Self_Closing},
+                {Tag::Form, "form", Type::Non_Self_Closing},
+                {Tag::Frame, "frame", Type::Self_Closing},
+                {Tag::Frameset, "frameset", Type::Non_Self_Closing},
+                {Tag::Head, "head", Type::Non_Self_Closing},
+                {Tag::Header, "header", Type::Non_Self_Closing},
+                {Tag::H1, "h1", Type::Non_Self_Closing},
+                {Tag::H2, "h2", Type::Non_Self_Closing},
+                {Tag::H3, "h3", Type::Non_Self_Closing},
+                {Tag::H4, "h4", Type::Non_Self_Closing},
+                {Tag::H5, "h5", Type::Non_Self_Closing},
+                {Tag::H6, "h6", Type::Non_Self_Closing},
+                {Tag::Hgroup, "hgroup", Type::Non_Self_Closing},
+                {Tag::Hr, "hr", Type::Non_Closed},
+                {Tag::Html, "html", Type::Non_Self_Closing},
+                {Tag::Iframe, "iframe", Type::Non_Self_Closing},
+                {Tag::Image, "img", Type::Non_Closed},
+                {Tag::Img, "img", Type::Non_Closed},
+                {Tag::Input, "input", Type::Self_Closing},
+                {Tag::Ins, "ins", Type::Non_Self_Closing},
+                {Tag::Isindex, "isindex", Type::Non_Closed},
+                {Tag::Italic, "i", Type::Non_Self_Closing},
+                {Tag::I, "i", Type::Non_Self_Closing},
+                {Tag::Kbd, "kbd", Type::Non_Self_Closing},
+                {Tag::Keygen, "keygen", Type::Non_Closed},
+                {Tag::Label, "label", Type::Non_Self_Closing},
+                {Tag::Legend, "legend", Type::Non_Self_Closing},
+                {Tag::List, "li", Type::Non_Self_Closing},
+                {Tag::Li, "li", Type::Non_Self_Closing},
+                {Tag::Link, "link", Type::Non_Closed},
+                {Tag::Main, "main", Type::Non_Self_Closing},
+                {Tag::Mark, "mark", Type::Non_Self_Closing},
+                {Tag::Marquee, "marquee", Type::Non_Self_Closing},
+                {Tag::Menuitem, "menuitem", Type::Non_Self_Closing},
+                {Tag::Meta, "meta", Type::Non_Closed},
+                {Tag::Meter, "meter", Type::Non_Self_Closing},
+                {Tag::Nav, "nav", Type::Non_Self_Closing},
+                {Tag::Nobreak, "nobr", Type::Non_Self_Closing},
+                {Tag::Nobr, "nobr", Type::Non_Self_Closing},
+                {Tag::Noembed, "noembed", Type::Non_Self_Closing},
+                {Tag::Noscript, "noscript", Type::Non_Self_Closing},
+                {Tag::Object, "object", Type::Non_Self_Closing},
+                {Tag::Optgroup, "optgroup", Type::Non_Self_Closing},
+                {Tag::Option, "option", Type::Non_Self_Closing},
+                {Tag::Output, "output", Type::Non_Self_Closing},
+                {Tag::Paragraph, "p", Type::Non_Self_Closing},
+                {Tag::P, "p", Type::Non_Self_Closing},
+                {Tag::Param, "param", Type::Non_Closed},
+                {Tag::Phrase, "phrase", Type::Non_Self_Closing},
+                {Tag::Pre, "pre", Type::Non_Self_Closing},
+                {Tag::Progress, "progress", Type::Non_Self_Closing},
+                {Tag::Quote, "q", Type::Non_Self_Closing},
+                {Tag::Q, "q", Type::Non_Self_Closing},
+                {Tag::Rp, "rp", Type::Non_Self_Closing},
+                {Tag::Rt, "rt", Type::Non_Self_Closing},
+                {Tag::Ruby, "ruby", Type::Non_Self_Closing},
+                {Tag::Outdated, "s", Type::Non_Self_Closing},
+                {Tag::S, "s", Type::Non_Self_Closing},
+                {Tag::Sample, "samp", Type::Non_Self_Closing},
+                {Tag::Samp, "samp", Type::Non_Self_Closing},
+                {Tag::Script, "script", Type::Non_Self_Closing},
+                {Tag::Section, "section", Type::Non_Self_Closing},
+                {Tag::Small, "small", Type::Non_Self_Closing},
+                {Tag::Source, "source", Type::Non_Self_Closing},
+                {Tag::Spacer, "spacer", Type::Non_Self_Closing},
+                {Tag::Span, "span", Type::Non_Self_Closing},
+                {Tag::Strike, "strike", Type::Non_Self_Closing},
+                {Tag::Strong, "strong", Type::Non_Self_Closing},
+                {Tag::Style, "style", Type::Non_Self_Closing},
+                {Tag::Sub, "sub", Type::Non_Self_Closing},
+                {Tag::Subscript, "sub", Type::Non_Self_Closing},
+                {Tag::Sup, "sup", Type::Non_Self_Closing},
+                {Tag::Superscript, "sup", Type::Non_Self_Closing},
+                {Tag::Summary, "summary", Type::Non_Self_Closing},
+                {Tag::Svg, "svg", Type::Non_Closed},
+                {Tag::Table, "table", Type::Non_Self_Closing},
+                {Tag::Tbody, "tbody", Type::Non_Self_Closing},
+                {Tag::Td, "td", Type::Non_Self_Closing},
+                {Tag::Template, "template", Type::Non_Self_Closing},
+                {Tag::Tfoot, "tfoot", Type::Non_Self_Closing},
+                {Tag::Th, "th", Type::Non_Self_Closing},
+                {Tag::Thead, "thead", Type::Non_Self_Closing},
+                {Tag::Time, "time", Type::Non_Self_Closing},
+                {Tag::Title, "title", Type::Non_Self_Closing},
+                {Tag::Tr, "tr", Type::Non_Self_Closing},
+                {Tag::Track, "track", Type::Non_Closed},
+                {Tag::Tt, "tt", Type::Non_Self_Closing},
+                {Tag::Underline, "u", Type::Non_Self_Closing},
+                {Tag::U, "u", Type::Non_Self_Closing},
+                {Tag::Var, "var", Type::Non_Self_Closing},
+                {Tag::Video, "video", Type::Non_Self_Closing},
+                {Tag::Wbr, "wbr", Type::Non_Closed},
+                {Tag::Xmp, "xmp", Type::Non_Self_Closing},
+            };
+
+            constexpr std::size_t tag_count{sizeof(tag_table) / sizeof(tag_table[0])};
+
+            constexpr bool tag_table_in_order(const std::size_t index) {
+                return index == tag_count || (static_cast<std::size_t>(tag_table[index].tag) == index && tag_table_in_order(index + 1));
+            }
+
+            static_assert(tag_count == static_cast<std::size_t>(Tag::Xmp) + 1, "tag_table must contain every Tag");
+            static_assert(tag_table_in_order(0), "tag_table must be in the same order as the Tag enum");
+
+            /*
+             * Tag names are resolved through a perfect hash: a seeded FNV-1a hash maps every distinct name to its own slot in a
+             * table of tag_slot_count slots, which is built at compile time. The seed was found by trying seeds until no two
+             * names collided, and is verified by the static_assert below, so if you add a tag and the build fails, pick a new seed.
+             */
+            constexpr std::uint32_t tag_hash_seed{2166141967u};
+            constexpr std::size_t tag_slot_count{1024};
+            constexpr std::uint8_t tag_slot_empty{0xFF};
+
+            static_assert(tag_count < tag_slot_empty, "Tag indices must fit in a slot");
+
+            constexpr std::uint32_t tag_hash(const char* str, const std::uint32_t hash = tag_hash_seed) {
+                return *str ? tag_hash(str + 1, (hash ^ static_cast<unsigned char>(*str)) * 16777619u) : hash;
+            }
+
+            constexpr std::size_t tag_slot(const std::uint32_t hash) {
+                return (hash ^ (hash >> 15)) & (tag_slot_count - 1);
+            }
+
+            std::uint32_t tag_hash(const std::string& str) {
+                std::uint32_t hash{tag_hash_seed};
+
+                for (const char c : str) {
+                    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+                }
+
+                return hash;
+            }
+
+            template <std::size_t... Is> struct index_sequence {};
+
+            template <typename, typename> struct concat_sequence;
+            template <std::size_t... Is1, std::size_t... Is2> struct concat_sequence<index_sequence<Is1...>, index_sequence<Is2...>> {
+                using type = index_sequence<Is1..., (sizeof...(Is1) + Is2)...>;
+            };
+
+            template <std::size_t N> struct make_index_sequence {
+                using type = typename concat_sequence<typename make_index_sequence<N / 2>::type, typename make_index_sequence<N - N / 2>::type>::type;
+            };
+            template <> struct make_index_sequence<0> { using type = index_sequence<>; };
+            template <> struct make_index_sequence<1> { using type = index_sequence<0>; };
+
+            struct TagEntrySlots {
+                std::uint16_t slots[tag_count];
+            };
+
+            template <std::size_t... Is> constexpr TagEntrySlots make_tag_entry_slots(index_sequence<Is...>) {
+                return TagEntrySlots{{static_cast<std::uint16_t>(tag_slot(tag_hash(tag_table[Is].name)))...}};
+            }
+
+            constexpr TagEntrySlots tag_entry_slots{make_tag_entry_slots(make_index_sequence<tag_count>::type{})};
+
+            // the first tag whose name hashes to the slot, so aliases such as Tag::Abbr resolve to the first declared tag
+            constexpr std::uint8_t find_slot_entry(const std::size_t slot, const std::size_t index = 0) {
+                return index == tag_count ? tag_slot_empty :
+                    tag_entry_slots.slots[index] == slot ? static_cast<std::uint8_t>(index) : find_slot_entry(slot, index + 1);
+            }
+
+            struct TagSlots {
+                std::uint8_t slots[tag_slot_count];
+            };
+
+            template <std::size_t... Is> constexpr TagSlots make_tag_slots(index_sequence<Is...>) {
+                return TagSlots{{find_slot_entry(Is)...}};
+            }
+
+            constexpr TagSlots tag_slots{make_tag_slots(make_index_sequence<tag_slot_count>::type{})};
+
+            constexpr bool tag_hash_is_perfect(const std::size_t index = 0) {
+                return index == tag_count || (equal(tag_table[tag_slots.slots[tag_entry_slots.slots[index]]].name, tag_table[index].name) && tag_hash_is_perfect(index + 1));
+            }
+
+            static_assert(tag_hash_is_perfect(), "tag_hash_seed does not produce a perfect hash for the tag names, pick another seed");
+
+            /**
+             * @brief Look up a tag by name without throwing
+             * @return bool True if the name is a known tag, false otherwise
+             */
+            bool find_tag(const std::string& name, Tag& tag) {
+                const std::uint8_t index{tag_slots.slots[tag_slot(tag_hash(name))]};
+
+                if (index != tag_slot_empty && name.size() == tag_table[index].size && !name.compare(0, name.size(), tag_table[index].name, tag_table[index].size)) {
+                    tag = tag_table[index].tag;
+                    return true;
+                }
+
+                return false;
+            }
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
+
+void docpp::HTML::set_escape(const bool escape) {
+    escape_by_default.store(escape, std::memory_order_relaxed);
+}
+
+bool docpp::HTML::get_escape() {
+    return escape_by_default.load(std::memory_order_relaxed);
+}
+
+std::string docpp::HTML::escape(const std::string& str, const bool attribute) {
+    std::string ret{};
+    StringSink sink{ret};
+
+    ret.reserve(str.size());
+    write_escaped(sink, str.data(), str.size(), attribute);
+
+    return ret;
+}
+
+std::string docpp::HTML::placeholder(const std::string& name) {
+    if (name.empty() || !std::all_of(name.begin(), name.end(), is_slot_char)) {
+        throw docpp::invalid_argument("Invalid placeholder name");
+    }
+
+    std::string ret{};
+
+    ret.reserve(name.size() + 2);
+    ret += placeholder_marker;
+    ret += name;
+    ret += placeholder_marker;
+
+    return ret;
+}
+
+std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> docpp::HTML::get_tag_map() {
+    std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> ret{};
+
+    for (const TagEntry& it : tag_table) {
+        ret[it.tag] = {std::string{it.name, it.size}, it.type};
+    }
+
+    return ret;
+}
+
+std::pair<std::string, docpp::HTML::Type> docpp::HTML::resolve_tag(const Tag tag) {
+    const std::size_t index{static_cast<std::size_t>(tag)};
+
+    if (index < tag_count) {
+        return {std::string{tag_table[index].name, tag_table[index].size}, tag_table[index].type};
+    }
+
+    const std::string throwmsg{"Invalid tag: " + std::to_string(static_cast<int>(tag))};
+    throw docpp::invalid_argument{throwmsg.c_str()};
+}
+
+docpp::HTML::Tag docpp::HTML::resolve_tag(const std::string& tag) {
+    Tag ret{};
+
+    if (find_tag(tag, ret)) {
+        return ret;
+    }
+
+    throw docpp::invalid_argument{"Invalid tag"};
+}
+
+namespace docpp {
+    namespace HTML {
+        namespace {
+            /**
+             * @brief The interned names of the tags, indexed by the value of the Tag enum. Aliases such as Tag::Abbr share the string of the first tag with the same name.
+             */
+            struct TagAtoms {
+                std::string names[tag_count];
+                const std::string* atoms[tag_count];
+
+                TagAtoms() {
+                    for (std::size_t i{0}; i < tag_count; i++) {
+                        this->names[i].assign(tag_table[i].name, tag_table[i].size);
+                        this->atoms[i] = this->names[i].empty() ? nullptr : &this->names[tag_slots.slots[tag_entry_slots.slots[i]]];
+                    }
+                }
+            };
+
+            /**
+             * @brief The strings interned at run time
+             */
+            struct AtomTable {
+                std::mutex mutex{};
+                std::unordered_set<std::string> strings{};
+                Atom::size_type limit{4096};
+            };
+
+            // the tables are never destroyed, so atoms stay valid in the destructors of static objects
+            const TagAtoms& tag_atoms() {
+                static const TagAtoms* atoms{new TagAtoms{}};
+                return *atoms;
+            }
+
+            // common property keys that are not also tag names, interned up front so they resolve without locking
+            const std::unordered_set<std::string>& key_atoms() {
+                static const std::unordered_set<std::string>* keys{new std::unordered_set<std::string>{
+                    "id", "class", "href", "src", "alt", "type", "name", "value", "content", "rel", "charset", "lang",
+                    "width", "height", "action", "method", "target", "placeholder", "for", "role", "disabled", "checked",
+                    "selected", "colspan", "rowspan", "tabindex", "hidden", "http-equiv", "async", "defer", "crossorigin",
+                    "integrity", "media", "sizes", "srcset", "loading", "dir", "onclick", "aria-label", "aria-hidden",
+                }};
+                return *keys;
+            }
+
+            AtomTable& atom_table() {
+                static AtomTable* table{new AtomTable{}};
+                return *table;
+            }
+
+            /**
+             * @brief Look up the empty string, a tag name or a common property key, which are interned without locking
+             * @return bool True if the string is one of them, false if it has to be looked up in the atom table
+             */
+            bool find_fixed_atom(const std::string& str, const std::string*& atom) {
+                Tag tag{};
+
+                if (str.empty()) {
+                    atom = nullptr;
+                    return true;
+                } else if (find_tag(str, tag)) {
+                    atom = tag_atoms().atoms[static_cast<std::size_t>(tag)];
+                    return true;
+                }
+
+                const std::unordered_set<std::string>& keys{key_atoms()};
+                const std::unordered_set<std::string>::const_iterator it{keys.find(str)};
+
+                if (it != keys.end()) {
+                    atom = &*it;
+                    return true;
+                }
+
+                return false;
+            }
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
+
+void docpp::HTML::Atom::assign(const std::string& str, Arena* arena) {
+    if (find_fixed_atom(str, this->str)) {
+        return;
+    }
+
+    {
+        AtomTable& table{atom_table()};
+        std::lock_guard<std::mutex> lock{table.mutex};
+        const std::unordered_set<std::string>::const_iterator it{table.strings.find(str)};
+
+        if (it != table.strings.end()) {
+            this->str = &*it;
+            return;
+        } else if (table.strings.size() < table.limit) {
+            this->str = &*table.strings.insert(str).first;
+            return;
+        }
+    }
+
+    // the table is full, so the string is stored outside of it; an arena keeps one copy of each string, which is never counted
+    if (arena) {
+        if (!arena->atoms) {
+            arena->atoms = new Arena::Atoms{};
+        }
+
+        std::unique_ptr<Stored>& stored{arena->atoms->strings[str]};
+
+        if (!stored) {
+            stored.reset(new Stored{str, arena});
+        }
+
+        this->stored = stored.get();
+    } else {
+        this->stored = new Stored{str, nullptr};
+    }
+
+    this->str = &this->stored->str;
+}
+
+void docpp::HTML::Atom::retain() {
+    if (!this->stored->arena) {
+        this->stored->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void docpp::HTML::Atom::release() {
+    if (!this->stored->arena && this->stored->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this->stored;
+    }
+}
+
+docpp::HTML::Atom::Atom(const Atom& atom, Arena* arena) {
+    if (!atom.stored || atom.stored->arena == arena) {
+        this->str = atom.str;
+        this->stored = atom.stored;
+
+        if (this->stored) {
+            this->retain();
+        }
+
+        return;
+    }
+
+    this->assign(*atom.str, arena);
+}
+
+bool docpp::HTML::Atom::find(const std::string& str, Atom& atom) {
+    atom = Atom{};
+
+    if (find_fixed_atom(str, atom.str)) {
+        return true;
+    }
+
+    {
+        AtomTable& table{atom_table()};
+        std::lock_guard<std::mutex> lock{table.mutex};
+        const std::unordered_set<std::string>::const_iterator it{table.strings.find(str)};
+
+        if (it != table.strings.end()) {
+            atom.str = &*it;
+            return true;
+        } else if (table.strings.size() < table.limit) {
+            return false;
+        }
+    }
+
+    atom = Atom{str};
+    return true;
+}
+
+void docpp::HTML::Atom::set_limit(const size_type limit) {
+    AtomTable& table{atom_table()};
+    std::lock_guard<std::mutex> lock{table.mutex};
+
+    table.limit = limit;
+}
+
+docpp::HTML::Atom::size_type docpp::HTML::Atom::get_limit() {
+    AtomTable& table{atom_table()};
+    std::lock_guard<std::mutex> lock{table.mutex};
+
+    return table.limit;
+}
+
+docpp::Arena* docpp::HTML::Atom::get_arena() const {
+    return this->stored ? this->stored->arena : nullptr;
+}
+
+docpp::HTML::Atom::Atom(const Tag tag) {
+    const std::size_t index{static_cast<std::size_t>(tag)};
+
+    if (index >= tag_count) {
+        const std::string throwmsg{"Invalid tag: " + std::to_string(static_cast<int>(tag))};
+        throw docpp::invalid_argument{throwmsg.c_str()};
+    }
+
+    this->str = tag_atoms().atoms[index];
+}
+
+// the atom is initialized first, so an invalid tag throws before the tag table is read
+docpp::HTML::Element::Element(const Tag tag, const Properties& properties, const String& data) : tag(tag), properties(properties), data(data), type(tag_table[static_cast<std::size_t>(tag)].type) {}
+
+docpp::HTML::Element::Element(const Tag tag, Properties&& properties, String&& data) : tag(tag), properties(std::move(properties)), data(std::move(data)), type(tag_table[static_cast<std::size_t>(tag)].type) {}
+
+void docpp::HTML::Element::set_tag(const Tag tag) {
+    this->tag = Atom{tag};
+    this->type = tag_table[static_cast<std::size_t>(tag)].type;
+}
+
+const std::string& docpp::HTML::Atom::get() const {
+    static const std::string empty{};
+    return this->str ? *this->str : empty;
+}
+
+void docpp::HTML::Section::set(const Tag tag, const Properties& properties) {
+    this->tag = Atom{tag};
+    this->properties = properties;
+    this->invalidate();
+}
+
+void docpp::HTML::Section::push_front(const Element& element) {
+    this->adopt(*this->nodes.insert(this->nodes.begin(), Node{element, this->get_arena()}));
+    this->invalidate();
+}
+
+void docpp::HTML::Section::push_front(const Section& section) {
+    this->adopt(*this->nodes.insert(this->nodes.begin(), Node{section, this->get_arena()}));
+    this->invalidate();
+}
+
+void docpp::HTML::Section::push_front(Element&& element) {
+    this->adopt(*this->nodes.insert(this->nodes.begin(), Node{std::move(element), this->get_arena()}));
+    this->invalidate();
+}
+
+void docpp::HTML::Section::push_front(Section&& section) {
+    this->adopt(*this->nodes.insert(this->nodes.begin(), Node{std::move(section), this->get_arena()}));
+    this->invalidate();
+}
+
+void docpp::HTML::Section::push_back(const Element& element) {
+    this->nodes.push_back(Node{element, this->get_arena()});
+    this->reindex(this->nodes.size() - 1, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::push_back(const Section& section) {
+    // the node is built before the vector grows, so appending a section to itself is fine
+    Node node{section, this->get_arena()};
+    this->nodes.push_back(std::move(node));
+    this->adopt(this->nodes.back());
+    this->reindex(this->nodes.size() - 1, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::push_back(Element&& element) {
+    this->nodes.push_back(Node{std::move(element), this->get_arena()});
+    this->reindex(this->nodes.size() - 1, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::push_back(Section&& section) {
+    Node node{std::move(section), this->get_arena()};
+    this->nodes.push_back(std::move(node));
+    this->adopt(this->nodes.back());
+    this->reindex(this->nodes.size() - 1, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::erase(const size_type index) {
+    if (index >= this->nodes.size() || this->nodes[index].kind == Node::Kind::None) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    this->reindex(index, false);
+    this->nodes[index] = Node{};
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::erase(const Section& section) {
+    const size_type index{this->find(section)};
+
+    if (index == docpp::HTML::Section::npos) {
+        throw docpp::out_of_range("Section not found");
+    }
+
+    this->erase(index);
+}
+
+void docpp::HTML::Section::erase(const Element& element) {
+    const size_type index{this->find(element)};
+
+    if (index == docpp::HTML::Section::npos) {
+        throw docpp::out_of_range("Element not found");
+    }
+
+    this->erase(index);
+}
+
+void docpp::HTML::Section::insert(const size_type index, const Element& element) {
+    if (index < this->nodes.size() && this->nodes[index].kind == Node::Kind::Section) {
+        throw docpp::invalid_argument("Index already occupied by a section");
+    }
+
+    if (index >= this->nodes.size()) {
+        this->nodes.resize(index + 1);
+    } else if (this->nodes[index].kind != Node::Kind::None) {
+        this->reindex(index, false);
+    }
+
+    this->nodes[index] = Node{element, this->get_arena()};
+    this->reindex(index, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::insert(const size_type index, const Section& section) {
+    Node node{section, this->get_arena()};
+
+    if (index >= this->nodes.size()) {
+        this->nodes.resize(index + 1);
+    } else if (this->nodes[index].kind != Node::Kind::None) {
+        this->reindex(index, false);
+    }
+
+    this->nodes[index] = std::move(node);
+    this->adopt(this->nodes[index]);
+    this->reindex(index, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::insert(const size_type index, Element&& element) {
+    if (index < this->nodes.size() && this->nodes[index].kind == Node::Kind::Section) {
+        throw docpp::invalid_argument("Index already occupied by a section");
+    }
+
+    if (index >= this->nodes.size()) {
+        this->nodes.resize(index + 1);
+    } else if (this->nodes[index].kind != Node::Kind::None) {
+        this->reindex(index, false);
+    }
+
+    this->nodes[index] = Node{std::move(element), this->get_arena()};
+    this->reindex(index, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::insert(const size_type index, Section&& section) {
+    Node node{std::move(section), this->get_arena()};
+
+    if (index >= this->nodes.size()) {
+        this->nodes.resize(index + 1);
+    } else if (this->nodes[index].kind != Node::Kind::None) {
+        this->reindex(index, false);
+    }
+
+    this->nodes[index] = std::move(node);
+    this->adopt(this->nodes[index]);
+    this->reindex(index, true);
+    this->invalidate(true);
+}
+
+void docpp::HTML::Section::replace(const Node& node, const Element& element) {
+    this->replace(node, Element{element});
+}
+
+void docpp::HTML::Section::replace(const Node& node, Element&& element) {
+    const std::less<const Node*> less{};
+
+    if (less(&node, this->nodes.data()) || !less(&node, this->nodes.data() + this->nodes.size())) {
+        throw docpp::out_of_range("Node does not belong to the section");
+    }
+
+    if (node.kind != Node::Kind::Element) {
+        throw docpp::invalid_argument("Node does not hold an element");
+    }
+
+    this->insert(static_cast<size_type>(&node - this->nodes.data()), std::move(element));
+}
+
+const docpp::HTML::Element& docpp::HTML::Section::at(const size_type index) const {
+    if (index < this->nodes.size() && this->nodes[index].kind == Node::Kind::Element) {
+        return this->nodes[index].element;
+    }
+
+    throw docpp::out_of_range("Index out of range");
+}
+
+const docpp::HTML::Section& docpp::HTML::Section::at_section(const size_type index) const {
+    if (index < this->nodes.size() && this->nodes[index].kind == Node::Kind::Section) {
+        return *this->nodes[index].section;
+    }
+
+    throw docpp::out_of_range("Index out of range");
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::find(const Element& element) {
+    const std::string str{element.get()};
+
+    for (size_type i{0}; i < this->nodes.size(); i++) {
+        if (this->nodes[i].kind == Node::Kind::Element && this->nodes[i].element.get() == str) {
+            return i;
+        }
+    }
+
+    return docpp::HTML::Section::npos;
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::find(const Section& section) {
+    const std::string str{section.get()};
+
+    for (size_type i{0}; i < this->nodes.size(); i++) {
+        if (this->nodes[i].kind == Node::Kind::Section && this->nodes[i].section->get() == str) {
+            return i;
+        }
+    }
+
+    return docpp::HTML::Section::npos;
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::find(const std::string& str) {
+    for (size_type i{0}; i < this->nodes.size(); i++) {
+        if (this->nodes[i].kind == Node::Kind::Element && this->nodes[i].element.get().find(str) != std::string::npos) {
+            return i;
+        }
+    }
+
+    for (size_type i{0}; i < this->nodes.size(); i++) {
+        if (this->nodes[i].kind == Node::Kind::Section && this->nodes[i].section->get().find(str) != std::string::npos) {
+            return i;
+        }
+    }
+
+    return docpp::HTML::Section::npos;
+}
+
+const docpp::HTML::Element& docpp::HTML::Section::front() const {
+    return this->at(0);
+}
+
+const docpp::HTML::Section& docpp::HTML::Section::front_section() const {
+    return this->at_section(0);
+}
+
+const docpp::HTML::Element& docpp::HTML::Section::back() const {
+    return this->at(this->nodes.size() - 1);
+}
+
+const docpp::HTML::Section& docpp::HTML::Section::back_section() const {
+    return this->at_section(this->nodes.size() - 1);
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::size() const {
+    return this->nodes.size();
+}
+
+void docpp::HTML::Section::reserve(const size_type size) {
+    this->nodes.reserve(size);
+}
+
+void docpp::HTML::Section::clear() {
+    this->tag = {};
+    this->properties.clear();
+    this->nodes.clear();
+    this->invalidate();
+}
+
+bool docpp::HTML::Section::empty() const {
+    return this->nodes.empty();
+}
+
+docpp::Arena* docpp::HTML::Section::get_arena() const {
+    return this->nodes.get_allocator().arena();
+}
+
+docpp::HTML::Section::element_view docpp::HTML::Section::get_elements() const {
+    return element_view{this->nodes};
+}
+
+docpp::HTML::Section::section_view docpp::HTML::Section::get_sections() const {
+    return section_view{this->nodes};
+}
+
+std::string docpp::HTML::Section::get(const Formatting formatting, const int tabc) const {
+    std::string ret{};
+
+    // a parallel render is not run twice just to know the size, its ranges are written into the string at once instead
+    if (!this->is_parallel()) {
+        ret.reserve(this->serialized_size(formatting, tabc));
+    }
+
+    this->get_into(ret, formatting, tabc);
+
+    return ret;
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::serialized_size(const Formatting formatting, const int tabc) const {
+    CountingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.size();
+}
+
+void docpp::HTML::Section::get_into(std::string& out, const Formatting formatting, const int tabc) const {
+    StringSink sink{out};
+
+    this->write_to(sink, formatting, tabc);
+}
+
+std::string docpp::HTML::Section::get(Hash& hash, const Formatting formatting, const int tabc) const {
+    std::string ret{};
+    StringSink string_sink{ret};
+    HashingSink sink{string_sink};
+
+    if (!this->is_parallel()) {
+        ret.reserve(this->serialized_size(formatting, tabc));
+    }
+
+    this->write_to(sink, formatting, tabc);
+    sink.flush();
+    hash = sink.get_hash();
+
+    return ret;
+}
+
+docpp::Hash docpp::HTML::Section::get_hash(const Formatting formatting, const int tabc) const {
+    HashingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.get_hash();
+}
+
+void docpp::HTML::Section::write_to(Sink& sink, const Formatting formatting, const int tabc) const {
+    this->write_section_to(sink, formatting, tabc, false);
+}
+
+void docpp::HTML::Section::write_section_to(Sink& sink, const Formatting formatting, const int tabc, const bool omit_close) const {
+    if (!this->caching) {
+        this->write_uncached_to(sink, formatting, tabc, omit_close, nullptr);
+        return;
+    }
+
+    const bool escape{docpp::HTML::get_escape()};
+    CachedOutput* cached{nullptr};
+    bool fill{false};
+
+    {
+        std::lock_guard<std::mutex> lock{this->mutex};
+
+        for (const std::unique_ptr<CachedOutput>& it : this->cache) {
+            if (it->formatting == formatting && it->tabc == tabc && it->escape == escape && it->omit_close == omit_close) {
+                cached = it.get();
+                break;
+            }
+        }
+
+        if (!cached) {
+            this->cache.emplace_back(new CachedOutput{formatting, tabc, escape, omit_close});
+            cached = this->cache.back().get();
+        }
+
+        if (cached->state == CachedOutput::State::Filling) {
+            cached = nullptr; // another render is filling it
+        } else if (cached->state == CachedOutput::State::Stale) {
+            cached->state = CachedOutput::State::Filling;
+            fill = true;
+        } else if (sink.uses_hash() && !cached->hashed) {
+            cached->hashes.clear();
+
+            for (size_type i{0}; i <= cached->sections.size(); i++) {
+                cached->hashes.emplace_back(cached->text[i]);
+            }
+
+            cached->hashed = true;
+        }
+    }
+
+    if (!cached) {
+        this->write_uncached_to(sink, formatting, tabc, omit_close, nullptr);
+        return;
+    }
+
+    if (fill) {
+        try {
+            this->write_uncached_to(sink, formatting, tabc, omit_close, cached);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            cached->state = CachedOutput::State::Stale;
+            throw;
+        }
+
+        std::lock_guard<std::mutex> lock{this->mutex};
+        cached->state = CachedOutput::State::Valid;
+        cached->hashed = false;
+
+        return;
+    }
+
+    const size_type count{cached->sections.size()};
+    const Formatting content{this->get_content_formatting(formatting)};
+
+    if (sink.uses_hash()) {
+        for (size_type i{0}; i < count; i++) {
+            sink.write(cached->text[i].data(), cached->text[i].size(), cached->hashes[i]);
+            cached->sections[i]->write_section_to(sink, content, cached->child_tabc, cached->sections_omit_close[i]);
+        }
+
+        sink.write(cached->text[count].data(), cached->text[count].size(), cached->hashes[count]);
+        return;
+    }
+
+    // cached child sections are not part of the text, they are written from their own caches in between
+    for (size_type i{0}; i < count; i++) {
+        sink.write(cached->text[i]);
+        cached->sections[i]->write_section_to(sink, content, cached->child_tabc, cached->sections_omit_close[i]);
+    }
+
+    sink.write(cached->text[count]);
+}
+
+void docpp::HTML::Section::write_uncached_to(Sink& output, const Formatting formatting, const int tabc, const bool omit_close, CachedOutput* cached) const {
+    std::vector<std::string> discarded{};
+    CaptureSink capture{output, cached ? cached->text : discarded};
+    Sink& sink{cached ? static_cast<Sink&>(capture) : output};
+
+    const int tabcount{this->get_tabcount(tabc)};
+    const Formatting content{this->get_content_formatting(formatting)};
+
+    if (cached) {
+        capture.reset();
+        cached->sections.clear();
+        cached->sections_omit_close.clear();
+    }
+
+    this->write_open_to(sink, formatting, tabcount);
+
+    if (!cached && this->is_parallel()) {
+        this->write_parallel_to(sink, content, tabcount);
+    } else if (!cached) {
+        this->write_children_to(sink, content, tabcount, 0, this->nodes.size());
+    } else {
+        size_type first{0};
+
+        for (size_type i{0}; i < this->nodes.size(); i++) {
+            const Node& it{this->nodes[i]};
+
+            if (it.kind != Node::Kind::Section || !it.section->caching) {
+                continue;
+            }
+
+            this->write_children_to(sink, content, tabcount, first, i);
+            first = i + 1;
+
+            const Node* next{i + 1 < this->nodes.size() ? &this->nodes[i + 1] : nullptr};
+            const bool omit{content == Formatting::Minified && is_close_optional(it.section->tag.get(), this->tag.get(), next)};
+
+            cached->child_tabc = tabcount + 1;
+            cached->sections.push_back(it.section.get());
+            cached->sections_omit_close.push_back(omit);
+            capture.next();
+
+            it.section->write_section_to(output, content, tabcount + 1, omit);
+
+            if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
+                sink.write("\n", 1);
+            }
+        }
+
+        this->write_children_to(sink, content, tabcount, first, this->nodes.size());
+    }
+
+    if (!omit_close) {
+        this->write_close_to(sink, formatting, tabcount);
+    }
+}
+
+void docpp::HTML::Section::write_children_to(Sink& sink, const Formatting formatting, const int tabcount, const size_type first, const size_type last) const {
+    struct Frame {
+        const Section* section;
+        size_type next;
+        size_type last;
+        int tabcount;
+        Formatting formatting; // minified output keeps the content of preformatted sections as written
+    };
+
+    // shared by every render on this thread so that rendering does not allocate a stack each time. caching and parallel descendants
+    // re-enter through their own write_section_to(), so each render only uses the frames above the ones that were there when it started.
+    static thread_local std::vector<Frame> stack{};
+
+    struct Guard {
+        std::vector<Frame>& stack;
+        const size_type base;
+
+        ~Guard() {
+            this->stack.resize(this->base, Frame{nullptr, 0, 0, 0, Formatting::None});
+        }
+    } guard{stack, stack.size()};
+
+    stack.push_back(Frame{this, first, last, tabcount, formatting});
+
+    while (true) {
+        Frame& frame{stack.back()};
+        const Formatting current{frame.formatting};
+
+        if (frame.next == frame.last) {
+            if (stack.size() == guard.base + 1) {
+                break; // the tags of this section are written by the caller
+            }
+
+            const Frame& parent{stack[stack.size() - 2]};
+            // the next sibling may lie outside of the range the parent is written for, but it still follows in the output
+            const Node* next{parent.next < parent.section->nodes.size() ? &parent.section->nodes[parent.next] : nullptr};
+
+            if (current != Formatting::Minified || !is_close_optional(frame.section->tag.get(), parent.section->tag.get(), next)) {
+                frame.section->write_close_to(sink, current, frame.tabcount);
+            }
+
+            stack.pop_back();
+
+            if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
+                sink.write("\n", 1);
+            }
+
+            continue;
+        }
+
+        const Node& node{frame.section->nodes[frame.next++]};
+        const Node* next{frame.next < frame.section->nodes.size() ? &frame.section->nodes[frame.next] : nullptr};
+        const int child_tabc{frame.tabcount + 1};
+
+        if (node.kind == Node::Kind::Element) {
+            write_element(sink, node.element, current, child_tabc, current == Formatting::Minified && is_close_optional(node.element.get_tag(), frame.section->tag.get(), next), is_unescaped_content(frame.section->tag.get()));
+        } else if (node.kind == Node::Kind::Section && (node.section->caching || node.section->is_parallel())) {
+            node.section->write_section_to(sink, current, child_tabc, current == Formatting::Minified && is_close_optional(node.section->tag.get(), frame.section->tag.get(), next));
+
+            if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
+                sink.write("\n", 1);
+            }
+        } else if (node.kind == Node::Kind::Section) {
+            const Section& section{*node.section};
+
+            // frame is invalidated by the push, so everything needed from it was read above
+            stack.push_back(Frame{&section, 0, section.nodes.size(), section.get_tabcount(child_tabc), section.get_content_formatting(current)});
+            section.write_open_to(sink, current, stack.back().tabcount);
+        }
+    }
+}
+
+docpp::HTML::Formatting docpp::HTML::Section::get_content_formatting(const Formatting formatting) const {
+    return formatting == Formatting::Minified && is_preformatted(this->tag.get()) ? Formatting::None : formatting;
+}
+
+int docpp::HTML::Section::get_tabcount(const int tabc) const {
+    if (!this->tag.empty()) {
+        return tabc;
+    }
+
+    // i guess this means the section only contains elements and sections, and isn't a tag itself
+    // never below -1, which will be incremented by 1, so it will be 0
+    return std::max(tabc - 1, -1);
+}
+
+void docpp::HTML::Section::write_open_to(Sink& sink, const Formatting formatting, const int tabcount) const {
+    if (formatting == docpp::HTML::Formatting::Pretty) {
+        write_tabs(sink, tabcount);
+    }
+
+    if (!this->tag.empty()) {
+        sink.write("<", 1);
+        sink.write(this->tag.get());
+
+        write_properties(sink, this->properties, docpp::HTML::get_escape(), formatting == docpp::HTML::Formatting::Minified);
+
+        sink.write(">", 1);
+
+        if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
+            sink.write("\n", 1);
+        }
+    }
+}
+
+void docpp::HTML::Section::write_close_to(Sink& sink, const Formatting formatting, const int tabcount) const {
+    if (formatting == docpp::HTML::Formatting::Pretty) {
+        write_tabs(sink, tabcount);
+    }
+
+    if (!this->tag.empty()) {
+        sink.write("</", 2);
+        sink.write(this->tag.get());
+        sink.write(">", 1);
+    }
+}
+
+bool docpp::HTML::Section::is_parallel() const {
+    return this->threads > 1 && this->nodes.size() > 1;
+}
+
+void docpp::HTML::Section::write_parallel_to(Sink& sink, const Formatting formatting, const int tabcount) const {
+    WorkerPool& pool{WorkerPool::get()};
+    const size_type workers{std::min<size_type>(std::min<size_type>(this->threads, pool.get_size() + 1), this->nodes.size())};
+
+    // within a range that is already rendered in parallel every thread of the pool is busy, so waiting for one would only slow the render down
+    if (rendering_in_parallel || workers < 2) {
+        this->write_children_to(sink, formatting, tabcount, 0, this->nodes.size());
+        return;
+    }
+
+    /**
+     * @brief The state of a render, kept alive by any task that is still queued after the render is done
+     */
+    struct Render {
+        std::vector<std::string> output;
+        std::vector<std::exception_ptr> errors;
+        std::atomic<size_type> next{0};
+        size_type done{0};
+        std::mutex mutex{};
+        std::condition_variable finished{};
+
+        explicit Render(const size_type ranges) : output(ranges), errors(ranges) {};
+    };
+
+    // more ranges than threads, so that a thread which finishes early can take over work from one with heavier children
+    const size_type ranges{std::min<size_type>(workers * 4, this->nodes.size())};
+    const std::shared_ptr<Render> render{std::make_shared<Render>(ranges)};
+    const Section* section{this};
+
+    // a task that only gets to run after every range is taken returns without touching the section
+    const auto work = [section, render, ranges, formatting, tabcount]() {
+        const bool nested{rendering_in_parallel};
+        rendering_in_parallel = true;
+
+        for (size_type range{render->next++}; range < ranges; range = render->next++) {
+            try {
+                StringSink range_sink{render->output[range]};
+
+                section->write_children_to(range_sink, formatting, tabcount, range * section->nodes.size() / ranges, (range + 1) * section->nodes.size() / ranges);
+            } catch (...) {
+                render->errors[range] = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock{render->mutex};
+
+            if (++render->done == ranges) {
+                render->finished.notify_all();
+            }
+        }
+
+        rendering_in_parallel = nested;
+    };
+
+    for (size_type i{1}; i < workers; i++) {
+        pool.submit(work);
+    }
+
+    work();
+
+    {
+        std::unique_lock<std::mutex> lock{render->mutex};
+        render->finished.wait(lock, [&render, ranges]() { return render->done == ranges; });
+    }
+
+    size_type size{0};
+
+    for (size_type i{0}; i < ranges; i++) {
+        if (render->errors[i]) {
+            std::rethrow_exception(render->errors[i]);
+        }
+
+        size += render->output[i].size();
+    }
+
+    sink.reserve(size);
+
+    for (size_type i{0}; i < ranges; i++) {
+        sink.write(render->output[i]);
+    }
+}
+
+void docpp::HTML::Section::set_threads(const unsigned int threads) {
+    this->threads = threads;
+}
+
+unsigned int docpp::HTML::Section::get_threads() const {
+    return this->threads;
+}
+
+namespace docpp {
+    namespace HTML {
+        namespace {
+            Properties patch_properties(const Properties& properties, const Patch& patch) {
+                std::vector<Property> list{properties.get_properties().begin(), properties.get_properties().end()};
+                std::vector<Property>::iterator it{std::find_if(list.begin(), list.end(), [&patch](const Property& property) { return property.get_key() == patch.get_key(); })};
+
+                if (patch.get_type() == Patch::Type::Set_Property) {
+                    if (it != list.end()) {
+                        it->set_value(patch.get_value());
+                    } else {
+                        list.emplace_back(patch.get_key(), patch.get_value());
+                    }
+                } else {
+                    if (it == list.end()) {
+                        throw docpp::out_of_range("Property not found");
+                    }
+
+                    list.erase(it);
+                }
+
+                return Properties{std::move(list)};
+            }
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
+
+docpp::HTML::Section::size_type docpp::HTML::Section::find_child(const size_type index) const {
+    size_type count{0};
+
+    for (size_type i{0}; i < this->nodes.size(); i++) {
+        if (this->nodes[i].kind == Node::Kind::None) {
+            continue;
+        }
+
+        if (count++ == index) {
+            return i;
+        }
+    }
+
+    if (count == index) {
+        return this->nodes.size();
+    }
+
+    return docpp::HTML::Section::npos;
+}
+
+void docpp::HTML::Section::apply(const Patch& patch) {
+    const std::vector<size_type>& path{patch.get_path()};
+    const Patch::Type type{patch.get_type()};
+    const Node& node{patch.get_node()};
+
+    if ((type == Patch::Type::Insert || type == Patch::Type::Replace) && !node.is_element() && !node.is_section()) {
+        throw docpp::invalid_argument("Patch holds no node");
+    }
+
+    if (path.empty()) {
+        if (type == Patch::Type::Replace && node.is_section()) {
+            *this = node.get_section();
+        } else if (type == Patch::Type::Set_Property || type == Patch::Type::Remove_Property) {
+            // copy rather than move, so that the properties stay in this section's arena
+            const Properties properties{patch_properties(this->properties, patch)};
+
+            this->set_properties(properties);
+        } else {
+            throw docpp::invalid_argument("Patch does not apply to the root section");
+        }
+
+        return;
+    }
+
+    Section* parent{this};
+
+    for (size_type i{0}; i + 1 < path.size(); i++) {
+        const size_type position{parent->find_child(path[i])};
+
+        if (position >= parent->nodes.size() || parent->nodes[position].kind != Node::Kind::Section) {
+            throw docpp::out_of_range("Path out of range");
+        }
+
+        parent = parent->nodes[position].section.get();
+    }
+
+    const size_type position{parent->find_child(path.back())};
+
+    if (position == docpp::HTML::Section::npos || (type != Patch::Type::Insert && position == parent->nodes.size())) {
+        throw docpp::out_of_range("Path out of range");
+    }
+
+    switch (type) {
+        case Patch::Type::Insert:
+            parent->nodes.insert(parent->nodes.begin() + position, Node{node, parent->get_arena()});
+            parent->adopt(parent->nodes[position]);
+            break;
+        case Patch::Type::Remove:
+            parent->nodes[position] = Node{};
+            break;
+        case Patch::Type::Replace:
+            parent->nodes[position] = Node{node, parent->get_arena()};
+            parent->adopt(parent->nodes[position]);
+            break;
+        case Patch::Type::Set_Property:
+        case Patch::Type::Remove_Property:
+            if (parent->nodes[position].kind == Node::Kind::Section) {
+                Section& section{*parent->nodes[position].section};
+                const Properties properties{patch_properties(section.properties, patch)};
+
+                section.set_properties(properties);
+            } else {
+                Element& element{parent->nodes[position].element};
+                const Properties properties{patch_properties(element.get_properties(), patch)};
+
+                element.set_properties(properties);
+            }
+
+            break;
+        case Patch::Type::Set_Data:
+            if (parent->nodes[position].kind != Node::Kind::Element) {
+                throw docpp::invalid_argument("Patch does not apply to a section");
+            }
+
+            parent->nodes[position].element.set_data(patch.get_value());
+            break;
+    }
+
+    parent->invalidate();
+}
+
+void docpp::HTML::Section::apply(const std::vector<Patch>& patches) {
+    for (const Patch& it : patches) {
+        this->apply(it);
+    }
+}
+
+namespace docpp {
+    namespace HTML {
+        namespace {
+            /* Call f with each key a child is indexed by: 0 and its tag, 1 and its id, and 2 and each name in its class.
+             * Only the first id and class properties count, as in a browser. */
+            template <typename F>
+            void for_each_key(const Section::Node& node, F f) {
+                const std::string& tag{node.is_element() ? node.get_element().get_tag() : node.get_section().get_tag()};
+                const Properties& properties{node.is_element() ? node.get_element().get_properties() : node.get_section().get_properties()};
+                static const Atom id_key{"id"};
+                static const Atom class_key{"class"};
+                bool id{false};
+                bool name{false};
+
+                if (!tag.empty()) {
+                    f(0, tag);
+                }
+
+                for (const Property& it : properties.get_properties()) {
+                    if (!id && it.get_key_atom() == id_key) {
+                        id = true;
+
+                        if (!it.get_value().empty()) {
+                            f(1, static_cast<std::string>(it.get_value()));
+                        }
+                    } else if (!name && it.get_key_atom() == class_key) {
+                        const String& value{it.get_value()};
+                        std::size_t i{0};
+
+                        name = true;
+
+                        while (i < value.size()) {
+                            while (i < value.size() && is_space(value[i])) {
+                                ++i;
+                            }
+
+                            std::size_t end{i};
+
+                            while (end < value.size() && !is_space(value[end])) {
+                                ++end;
+                            }
+
+                            if (end > i) {
+                                f(2, std::string{value.data() + i, end - i});
+                            }
+
+                            i = end;
+                        }
+                    }
+                }
+            }
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
+
+void docpp::HTML::Section::Index::add(const Section& owner, const size_type position, const bool in_order) {
+    for_each_key(owner.nodes[position], [this, &owner, position, in_order](const int kind, const std::string& key) {
+        Bucket& bucket{(kind == 0 ? this->tags : kind == 1 ? this->ids : this->classes)[key]};
+
+        if (!bucket.entries.empty()) {
+            const Entry& last{bucket.entries.back()};
+
+            // a name given twice in the same class
+            if (last.owner == &owner && last.position == position) {
+                return;
+            }
+
+            bucket.sorted = bucket.sorted && in_order;
+        }
+
+        bucket.entries.push_back(Entry{&owner, position});
+    });
+}
+
+void docpp::HTML::Section::Index::add_subtree(const Section& owner, const size_type position, const bool in_order) {
+    this->add(owner, position, in_order);
+
+    if (owner.nodes[position].kind != Node::Kind::Section) {
+        return;
+    }
+
+    // each section with the position of its next child, so that the descendants are added in document order without recursion
+    std::vector<std::pair<const Section*, size_type>> stack{std::make_pair(owner.nodes[position].section.get(), size_type{0})};
+
+    while (!stack.empty()) {
+        const Section& section{*stack.back().first};
+        const size_type index{stack.back().second++};
+
+        if (index == section.nodes.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        const Node& node{section.nodes[index]};
+
+        if (node.kind == Node::Kind::None) {
+            continue;
+        }
+
+        this->add(section, index, in_order);
+
+        if (node.kind == Node::Kind::Section) {
+            stack.emplace_back(node.section.get(), 0);
+        }
+    }
+}
+
+void docpp::HTML::Section::Index::remove(const Section& owner, const size_type position) {
+    for_each_key(owner.nodes[position], [this, &owner, position](const int kind, const std::string& key) {
+        std::unordered_map<std::string, Bucket>& map{kind == 0 ? this->tags : kind == 1 ? this->ids : this->classes};
+        const std::unordered_map<std::string, Bucket>::iterator it{map.find(key)};
+
+        if (it == map.end()) {
+            return;
+        }
+
+        std::vector<Entry>& entries{it->second.entries};
+
+        for (size_type i{entries.size()}; i > 0; i--) {
+            if (entries[i - 1].owner == &owner && entries[i - 1].position == position) {
+                entries.erase(entries.begin() + (i - 1));
+                break;
+            }
+        }
 
-std::string docpp::HTML::Property::get_key() const {
-    return this->property.first;
+        if (entries.empty()) {
+            map.erase(it);
+        }
+    });
 }
 
-std::string docpp::HTML::Property::get_value() const {
-    return this->property.second;
+void docpp::HTML::Section::Index::sort(Bucket& bucket, const Section& root) {
+    if (bucket.sorted) {
+        return;
+    }
+
+    // the path of each section from the root, built from the positions of the sections in their parents, both computed once per section
+    std::unordered_map<const Section*, std::vector<size_type>> paths{};
+    std::unordered_map<const Section*, size_type> positions{};
+    std::vector<std::pair<std::vector<size_type>, Entry>> keyed{};
+
+    paths[&root] = {};
+
+    const auto get_path = [&paths, &positions](const Section* section) -> const std::vector<size_type>& {
+        std::vector<const Section*> chain{};
+
+        for (const Section* it{section}; !paths.count(it); it = it->parent) {
+            chain.push_back(it);
+        }
+
+        for (std::vector<const Section*>::reverse_iterator it{chain.rbegin()}; it != chain.rend(); ++it) {
+            const Section* parent{(*it)->parent};
+
+            if (!positions.count(*it)) {
+                for (size_type i{0}; i < parent->nodes.size(); i++) {
+                    if (parent->nodes[i].kind == Node::Kind::Section) {
+                        positions[parent->nodes[i].section.get()] = i;
+                    }
+                }
+            }
+
+            std::vector<size_type> path{paths[parent]};
+            path.push_back(positions[*it]);
+            paths[*it] = std::move(path);
+        }
+
+        return paths[section];
+    };
+
+    keyed.reserve(bucket.entries.size());
+
+    for (const Entry& entry : bucket.entries) {
+        std::vector<size_type> path{get_path(entry.owner)};
+        path.push_back(entry.position);
+        keyed.emplace_back(std::move(path), entry);
+    }
+
+    std::sort(keyed.begin(), keyed.end(), [](const std::pair<std::vector<size_type>, Entry>& a, const std::pair<std::vector<size_type>, Entry>& b) {
+        return a.first < b.first;
+    });
+
+    for (size_type i{0}; i < keyed.size(); i++) {
+        bucket.entries[i] = keyed[i].second;
+    }
+
+    bucket.sorted = true;
 }
 
-std::pair<std::string, std::string> docpp::HTML::Property::get() const {
-    return this->property;
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Section::Index::get(std::unordered_map<std::string, Bucket>& map, const std::string& key, const Section& root, const size_type limit) {
+    const std::unordered_map<std::string, Bucket>::iterator it{map.find(key)};
+
+    if (it == map.end()) {
+        return {};
+    }
+
+    Bucket& bucket{it->second};
+
+    this->sort(bucket, root);
+
+    std::vector<const Node*> ret{};
+    const size_type count{std::min(limit, bucket.entries.size())};
+
+    ret.reserve(count);
+
+    for (size_type i{0}; i < count; i++) {
+        ret.push_back(&bucket.entries[i].owner->nodes[bucket.entries[i].position]);
+    }
+
+    return ret;
 }
 
-void docpp::HTML::Property::set_key(const std::string& key) {
-    this->property.first = key;
+void docpp::HTML::Section::set_indexing(const bool indexing) {
+    this->indexing = indexing;
+
+    if (!indexing) {
+        this->index.reset();
+    }
 }
 
-void docpp::HTML::Property::set_value(const std::string& value) {
-    this->property.second = value;
+bool docpp::HTML::Section::is_indexing() const {
+    return this->indexing;
 }
 
-void docpp::HTML::Property::set(const std::pair<std::string, std::string>& property) {
-    this->property = property;
+docpp::HTML::Section::Index& docpp::HTML::Section::get_index(Index& scratch) const {
+    if (this->indexing && this->index) {
+        return *this->index;
+    }
+
+    Index* index{&scratch};
+
+    if (this->indexing) {
+        this->index.reset(new Index{});
+        index = this->index.get();
+    }
+
+    for (size_type i{0}; i < this->nodes.size(); i++) {
+        if (this->nodes[i].kind != Node::Kind::None) {
+            index->add_subtree(*this, i, true);
+        }
+    }
+
+    return *index;
+}
+
+void docpp::HTML::Section::reindex(const size_type position, const bool add, const bool subtree) {
+    const bool section{this->nodes[position].kind == Node::Kind::Section};
+    // whether the child comes after everything else below the section whose index is updated, which keeps that index in document order
+    bool last{position + 1 == this->nodes.size()};
+
+    for (Section* it{this}; it; it = it->parent) {
+        if (it->index) {
+            if (add && subtree) {
+                it->index->add_subtree(*this, position, last);
+            } else if (add) {
+                it->index->add(*this, position, last);
+            } else if (subtree && section) {
+                it->index.reset();
+            } else {
+                it->index->remove(*this, position);
+            }
+        }
+
+        if (it->parent) {
+            const Node& back{it->parent->nodes.back()};
+            last = last && back.kind == Node::Kind::Section && back.section.get() == it;
+        }
+    }
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::find_indexed_position() const {
+    for (const Section* it{this->parent}; it; it = it->parent) {
+        if (it->index) {
+            return this->find_position();
+        }
+    }
+
+    return docpp::HTML::Section::npos;
+}
+
+docpp::HTML::Section::size_type docpp::HTML::Section::find_position() const {
+    if (this->parent) {
+        for (size_type i{0}; i < this->parent->nodes.size(); i++) {
+            if (this->parent->nodes[i].kind == Node::Kind::Section && this->parent->nodes[i].section.get() == this) {
+                return i;
+            }
+        }
+    }
+
+    return docpp::HTML::Section::npos;
+}
+
+const docpp::HTML::Section::Node* docpp::HTML::Section::get_by_id(const std::string& id) const {
+    std::lock_guard<std::mutex> lock{this->mutex};
+    Index scratch{};
+    Index& index{this->get_index(scratch)};
+    const std::vector<const Node*> ret{index.get(index.ids, id, *this, 1)};
+
+    return ret.empty() ? nullptr : ret.front();
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Section::get_by_class(const std::string& name) const {
+    std::lock_guard<std::mutex> lock{this->mutex};
+    Index scratch{};
+    Index& index{this->get_index(scratch)};
+
+    return index.get(index.classes, name, *this, static_cast<size_type>(-1));
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Section::get_by_tag(const std::string& tag) const {
+    std::lock_guard<std::mutex> lock{this->mutex};
+    Index scratch{};
+    Index& index{this->get_index(scratch)};
+
+    return index.get(index.tags, tag, *this, static_cast<size_type>(-1));
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Section::get_by_tag(const Tag tag) const {
+    return this->get_by_tag(resolve_tag(tag).first);
+}
+
+const docpp::HTML::Section::Node* docpp::HTML::Section::query_selector(const Selector& selector) const {
+    std::vector<const Node*> ret{};
+
+    this->query(selector, ret, 1);
+
+    return ret.empty() ? nullptr : ret.front();
+}
+
+const docpp::HTML::Section::Node* docpp::HTML::Section::query_selector(const std::string& selector) const {
+    return this->query_selector(Selector{selector});
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Section::query_selector_all(const Selector& selector) const {
+    std::vector<const Node*> ret{};
+
+    this->query(selector, ret, static_cast<size_type>(-1));
+
+    return ret;
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Section::query_selector_all(const std::string& selector) const {
+    return this->query_selector_all(Selector{selector});
+}
+
+void docpp::HTML::Section::query(const Selector& selector, std::vector<const Node*>& ret, const size_type limit) const {
+    if (limit == 0) {
+        return;
+    }
+
+    // with indexes, a single selector only has to be tried on the descendants that have the rarest key of its last compound
+    if (this->indexing && selector.selectors.size() == 1) {
+        const Selector::Compound& last{selector.selectors.front().back()};
+        std::lock_guard<std::mutex> lock{this->mutex};
+        Index scratch{};
+        Index& index{this->get_index(scratch)};
+        Index::Bucket* candidates{nullptr};
+        bool keyed{false};
+        bool missing{false};
+
+        const auto narrow = [&candidates, &keyed, &missing](std::unordered_map<std::string, Index::Bucket>& map, const std::string& key) {
+            const std::unordered_map<std::string, Index::Bucket>::iterator it{map.find(key)};
+
+            keyed = true;
+
+            if (it == map.end()) {
+                missing = true;
+            } else if (!candidates || it->second.entries.size() < candidates->entries.size()) {
+                candidates = &it->second;
+            }
+        };
+
+        for (const std::string& it : last.ids) {
+            narrow(index.ids, it);
+        }
+
+        for (const std::string& it : last.classes) {
+            narrow(index.classes, it);
+        }
+
+        if (!last.tag.empty()) {
+            narrow(index.tags, last.tag.get());
+        }
+
+        if (keyed) {
+            // a key that no descendant has leaves nothing to match
+            if (missing) {
+                return;
+            }
+
+            index.sort(*candidates, *this);
+
+            for (const Index::Entry& it : candidates->entries) {
+                if (selector.match(*it.owner, it.position)) {
+                    ret.push_back(&it.owner->nodes[it.position]);
+
+                    if (ret.size() >= limit) {
+                        return;
+                    }
+                }
+            }
+
+            return;
+        }
+    }
+
+    // otherwise every descendant is tried, in document order
+    std::vector<std::pair<const Section*, size_type>> stack{std::make_pair(this, size_type{0})};
+
+    while (!stack.empty()) {
+        const Section& section{*stack.back().first};
+        const size_type position{stack.back().second++};
+
+        if (position == section.nodes.size()) {
+            stack.pop_back();
+            continue;
+        }
+
+        const Node& node{section.nodes[position]};
+
+        if (node.kind == Node::Kind::None) {
+            continue;
+        }
+
+        if (selector.match(section, position)) {
+            ret.push_back(&node);
+
+            if (ret.size() >= limit) {
+                return;
+            }
+        }
+
+        if (node.kind == Node::Kind::Section) {
+            stack.emplace_back(node.section.get(), 0);
+        }
+    }
+}
+
+void docpp::HTML::Section::set_caching(const bool caching) {
+    this->caching = caching;
+
+    if (!caching) {
+        this->cache.clear();
+    }
+}
+
+bool docpp::HTML::Section::is_caching() const {
+    return this->caching;
+}
+
+void docpp::HTML::Section::adopt(Node& node) {
+    if (node.kind == Node::Kind::Section) {
+        node.section->parent = this;
+    }
+}
+
+void docpp::HTML::Section::adopt() {
+    for (Node& it : this->nodes) {
+        this->adopt(it);
+    }
+}
+
+void docpp::HTML::Section::invalidate(const bool indexed) {
+    for (Section* it{this}; it; it = it->parent) {
+        for (std::unique_ptr<CachedOutput>& cached : it->cache) {
+            cached->state = CachedOutput::State::Stale;
+        }
+
+        if (!indexed) {
+            it->index.reset();
+        }
+
+        it->tree_hashed = false;
+    }
+}
+
+const std::string& docpp::HTML::Section::get_tag() const {
+    return this->tag.get();
+}
+
+const docpp::HTML::Atom& docpp::HTML::Section::get_tag_atom() const {
+    return this->tag;
+}
+
+const docpp::HTML::Properties& docpp::HTML::Section::get_properties() const {
+    return this->properties;
+}
+
+void docpp::HTML::Section::swap(const size_type index1, const size_type index2) {
+    if (index1 >= this->nodes.size() || index2 >= this->nodes.size() || this->nodes[index1].kind == Node::Kind::None || this->nodes[index1].kind != this->nodes[index2].kind) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    std::swap(this->nodes[index1], this->nodes[index2]);
+    this->invalidate();
+}
+
+void docpp::HTML::Section::swap(const Element& element1, const Element& element2) {
+    this->swap(this->find(element1), this->find(element2));
+}
+
+void docpp::HTML::Section::swap(const Section& section1, const Section& section2) {
+    this->swap(this->find(section1), this->find(section2));
+}
+
+std::string docpp::HTML::Document::get(const Formatting formatting, const int tabc) const {
+    std::string ret{};
+
+    if (this->document.get_threads() < 2) {
+        ret.reserve(this->serialized_size(formatting, tabc));
+    }
+
+    this->get_into(ret, formatting, tabc);
+
+    return ret;
+}
+
+docpp::HTML::Document::size_type docpp::HTML::Document::serialized_size(const Formatting formatting, const int tabc) const {
+    CountingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.size();
+}
+
+void docpp::HTML::Document::get_into(std::string& out, const Formatting formatting, const int tabc) const {
+    StringSink sink{out};
+
+    this->write_to(sink, formatting, tabc);
+}
+
+std::string docpp::HTML::Document::get(Hash& hash, const Formatting formatting, const int tabc) const {
+    std::string ret{};
+    StringSink string_sink{ret};
+    HashingSink sink{string_sink};
+
+    if (this->document.get_threads() < 2) {
+        ret.reserve(this->serialized_size(formatting, tabc));
+    }
+
+    this->write_to(sink, formatting, tabc);
+    sink.flush();
+    hash = sink.get_hash();
+
+    return ret;
+}
+
+docpp::Hash docpp::HTML::Document::get_hash(const Formatting formatting, const int tabc) const {
+    HashingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.get_hash();
+}
+
+void docpp::HTML::Document::write_to(Sink& sink, const Formatting formatting, const int tabc) const {
+    sink.write(this->doctype);
+
+    if (formatting == Formatting::Pretty || formatting == Formatting::Newline) {
+        sink.write("\n", 1);
+    }
+
+    this->document.write_to(sink, formatting, tabc);
+}
+
+docpp::HTML::Section& docpp::HTML::Document::get_section() {
+    return this->document;
+}
+
+const docpp::HTML::Section& docpp::HTML::Document::get_section() const {
+    return this->document;
+}
+
+const docpp::HTML::Section::Node* docpp::HTML::Document::query_selector(const Selector& selector) const {
+    return this->document.query_selector(selector);
+}
+
+const docpp::HTML::Section::Node* docpp::HTML::Document::query_selector(const std::string& selector) const {
+    return this->document.query_selector(selector);
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Document::query_selector_all(const Selector& selector) const {
+    return this->document.query_selector_all(selector);
+}
+
+std::vector<const docpp::HTML::Section::Node*> docpp::HTML::Document::query_selector_all(const std::string& selector) const {
+    return this->document.query_selector_all(selector);
+}
+
+void docpp::HTML::Document::set(const docpp::HTML::Section& document) {
+    this->document = document;
+}
+
+void docpp::HTML::Document::set(docpp::HTML::Section&& document) {
+    this->document = std::move(document);
+}
+
+docpp::HTML::Document::size_type docpp::HTML::Document::size() const {
+    return this->document.size();
+}
+
+void docpp::HTML::Document::set_doctype(const std::string& doctype) {
+    this->doctype = doctype;
+}
+
+void docpp::HTML::Document::clear() {
+    this->doctype.clear();
+    this->document.clear();
+}
+
+bool docpp::HTML::Document::empty() const {
+    return this->doctype.empty() && this->document.empty();
+}
+
+docpp::HTML::Document& docpp::HTML::Document::operator=(const docpp::HTML::Document& document) {
+    this->document = document.document;
+    this->doctype = document.doctype;
+    return *this;
+}
+
+docpp::HTML::Document& docpp::HTML::Document::operator=(docpp::HTML::Document&& document) {
+    this->document = std::move(document.document);
+    this->doctype = std::move(document.doctype);
+    return *this;
+}
+
+docpp::HTML::Document& docpp::HTML::Document::operator=(const docpp::HTML::Section& section) {
+    this->set(section);
+    return *this;
 }
 
-docpp::HTML::Property& docpp::HTML::Property::operator=(const docpp::HTML::Property& property) {
-    this->set(property.get());
+docpp::HTML::Document& docpp::HTML::Document::operator=(docpp::HTML::Section&& section) {
+    this->set(std::move(section));
     return *this;
 }
 
-bool docpp::HTML::Property::operator==(const docpp::HTML::Property& property) const {
-    return this->property == property.get();
+bool docpp::HTML::Document::operator==(const docpp::HTML::Document& document) const {
+    return this->get() == document.get();
 }
 
-bool docpp::HTML::Property::operator!=(const docpp::HTML::Property& property) const {
-    return this->property != property.get();
+bool docpp::HTML::Document::operator==(const docpp::HTML::Section& section) const {
+    return this->document == section;
 }
 
-void docpp::HTML::Property::clear() {
-    this->property = {};
+bool docpp::HTML::Document::operator!=(const docpp::HTML::Document& document) const {
+    return this->doctype != document.get_doctype() || this->document != document.document;
 }
 
-bool docpp::HTML::Property::empty() const {
-    return this->property.first.empty() && this->property.second.empty();
+bool docpp::HTML::Document::operator!=(const docpp::HTML::Section& section) const {
+    return this->document != section;
 }
 
-docpp::HTML::Properties& docpp::HTML::Properties::operator=(const docpp::HTML::Property& property) {
-    this->properties = {property};
-    return *this;
+const std::string& docpp::HTML::Document::get_doctype() const {
+    return this->doctype;
 }
 
-docpp::HTML::Properties& docpp::HTML::Properties::operator=(const docpp::HTML::Properties& properties) {
-    this->set(properties.get_properties());
-    return *this;
+docpp::HTML::Template::Template(const Document& document, const Formatting formatting, const int tabc) {
+    this->compile(document.get(formatting, tabc));
 }
 
-docpp::HTML::Properties& docpp::HTML::Properties::operator=(const std::vector<docpp::HTML::Property>& properties) {
-    this->set(properties);
-    return *this;
+docpp::HTML::Template::Template(const Section& section, const Formatting formatting, const int tabc) {
+    this->compile(section.get(formatting, tabc));
 }
 
-docpp::HTML::Property docpp::HTML::Properties::operator[](const size_type& index) const {
-    return this->at(index);
-}
+void docpp::HTML::Template::compile(const std::string& rendered) {
+    this->bytes.reserve(rendered.size());
 
-bool docpp::HTML::Properties::operator==(const docpp::HTML::Properties& properties) const {
-    return this->properties == properties.get_properties();
-}
+    size_type pos{0};
 
-bool docpp::HTML::Properties::operator==(const docpp::HTML::Property& property) const {
-    for (const docpp::HTML::Property& it : this->properties) {
-        if (it.get() == property.get()) {
-            return true;
+    while (pos < rendered.size()) {
+        const size_type open{rendered.find(placeholder_marker, pos)};
+
+        if (open == std::string::npos) {
+            break;
         }
-    }
 
-    return false;
-}
+        size_type end{open + 1};
 
-bool docpp::HTML::Properties::operator!=(const docpp::HTML::Properties& properties) const {
-    return this->properties != properties.get_properties();
-}
+        while (end < rendered.size() && is_slot_char(rendered[end])) {
+            ++end;
+        }
 
-bool docpp::HTML::Properties::operator!=(const docpp::HTML::Property& property) const {
-    for (const docpp::HTML::Property& it : this->properties) {
-        if (it.get() == property.get()) {
-            return false;
+        // a marker that does not enclose a valid name was not made by placeholder(), so it is kept as written
+        if (end == open + 1 || end == rendered.size() || rendered[end] != placeholder_marker) {
+            this->bytes.append(rendered, pos, open + 1 - pos);
+            pos = open + 1;
+            continue;
         }
-    }
 
-    return true;
-}
+        this->bytes.append(rendered, pos, open - pos);
 
-docpp::HTML::Properties& docpp::HTML::Properties::operator+=(const docpp::HTML::Property& property) {
-    this->push_back(property);
-    return *this;
-}
+        const std::string name{rendered.substr(open + 1, end - open - 1)};
+        size_type slot{this->find(name)};
 
-docpp::HTML::Properties& docpp::HTML::Properties::operator+=(const docpp::HTML::Properties& properties) {
-    for (docpp::HTML::Properties::const_iterator it{properties.cbegin()}; it != properties.cend(); it++) {
-        this->push_back(*it);
+        if (slot == npos) {
+            slot = this->slots.size();
+            this->slots.push_back(name);
+        }
+
+        this->holes.push_back(Hole{this->bytes.size(), slot});
+        pos = end + 1;
     }
 
-    return *this;
+    this->bytes.append(rendered, pos, std::string::npos);
+    this->bytes.shrink_to_fit();
 }
 
-std::vector<docpp::HTML::Property> docpp::HTML::Properties::get_properties() const {
-    return this->properties;
+const std::vector<std::string>& docpp::HTML::Template::get_slots() const {
+    return this->slots;
 }
 
-docpp::HTML::Property docpp::HTML::Properties::at(const size_type index) const {
-    if (index < 0 || index >= this->properties.size()) {
-        throw docpp::out_of_range("Index out of range");
+docpp::HTML::Template::size_type docpp::HTML::Template::find(const std::string& name) const {
+    for (size_type i{0}; i < this->slots.size(); i++) {
+        if (this->slots[i] == name) {
+            return i;
+        }
     }
 
-    return this->properties.at(index);
+    return npos;
 }
 
-void docpp::HTML::Properties::set(const std::vector<docpp::HTML::Property>& properties) {
-    this->properties = properties;
+docpp::HTML::Template::size_type docpp::HTML::Template::size() const {
+    return this->slots.size();
 }
 
-void docpp::HTML::Properties::insert(const size_type index, const docpp::HTML::Property& property) {
-    if (index < 0 || index >= this->properties.size()) {
-        throw docpp::out_of_range("Index out of range");
-    }
-
-    this->properties.insert(this->properties.begin() + index, property);
+bool docpp::HTML::Template::empty() const {
+    return this->slots.empty();
 }
 
-void docpp::HTML::Properties::erase(const size_type index) {
-    if (index < 0 || index >= this->properties.size()) {
-        throw docpp::out_of_range("Index out of range");
-    }
+std::string docpp::HTML::Template::get(const std::vector<std::string>& values) const {
+    std::string ret{};
 
-    this->properties.erase(this->properties.begin() + index);
-}
+    this->get_into(ret, values);
 
-void docpp::HTML::Properties::push_front(const docpp::HTML::Property& property) {
-    this->properties.insert(this->properties.begin(), property);
+    return ret;
 }
 
-void docpp::HTML::Properties::push_back(const docpp::HTML::Property& property) {
-    this->properties.push_back(property);
-}
+std::string docpp::HTML::Template::get(const std::unordered_map<std::string, std::string>& values) const {
+    std::vector<std::string> ordered(this->slots.size());
 
-docpp::HTML::Properties::size_type docpp::HTML::Properties::find(const docpp::HTML::Property& property) {
-    for (size_type i{0}; i < this->properties.size(); i++) {
-        if (!this->properties.at(i).get_key().compare(property.get_key())) {
-            return i;
-        } else if (!this->properties.at(i).get_value().compare(property.get_value())) {
-            return i;
-        } else if (this->properties.at(i).get_value().find(property.get_value()) != std::string::npos) {
-            return i;
-        } else if (this->properties.at(i).get_key().find(property.get_key()) != std::string::npos) {
-            return i;
-        } else if (this->properties.at(i).get() == property.get()) {
-            return i;
+    for (size_type i{0}; i < this->slots.size(); i++) {
+        const auto it = values.find(this->slots[i]);
+
+        if (it != values.end()) {
+            ordered[i] = it->second;
         }
     }
 
-    return docpp::HTML::Properties::npos;
+    return this->get(ordered);
 }
 
-docpp::HTML::Properties::size_type docpp::HTML::Properties::find(const std::string& str) {
-    for (size_type i{0}; i < this->properties.size(); i++) {
-        if (!this->properties.at(i).get_key().compare(str) || !this->properties.at(i).get_value().compare(str)) {
-            return i;
-        } else if (this->properties.at(i).get_key().find(str) != std::string::npos || this->properties.at(i).get_value().find(str) != std::string::npos) {
-            return i;
-        }
+docpp::HTML::Template::size_type docpp::HTML::Template::serialized_size(const std::vector<std::string>& values) const {
+    if (values.size() != this->slots.size()) {
+        throw docpp::invalid_argument("Expected one value per slot");
     }
 
-    return docpp::HTML::Properties::npos;
-}
+    size_type ret{this->bytes.size()};
 
-docpp::HTML::Property docpp::HTML::Properties::front() const {
-    return this->properties.front();
-}
+    for (const Hole& it : this->holes) {
+        ret += values[it.slot].size();
+    }
 
-docpp::HTML::Property docpp::HTML::Properties::back() const {
-    return this->properties.back();
+    return ret;
 }
 
-docpp::HTML::Properties::size_type docpp::HTML::Properties::size() const {
-    return this->properties.size();
-}
+void docpp::HTML::Template::get_into(std::string& out, const std::vector<std::string>& values) const {
+    out.reserve(out.size() + this->serialized_size(values));
 
-void docpp::HTML::Properties::clear() {
-    this->properties.clear();
-}
+    StringSink sink{out};
 
-bool docpp::HTML::Properties::empty() const {
-    return this->properties.empty();
+    this->write_to(sink, values);
 }
 
-void docpp::HTML::Properties::swap(const size_type index1, const size_type index2) {
-    if (index1 < 0 || index1 >= this->properties.size() || index2 < 0 || index2 >= this->properties.size()) {
-        throw docpp::out_of_range("Index out of range");
+void docpp::HTML::Template::write_to(Sink& sink, const std::vector<std::string>& values) const {
+    if (values.size() != this->slots.size()) {
+        throw docpp::invalid_argument("Expected one value per slot");
     }
 
-    std::swap(this->properties[index1], this->properties[index2]);
-}
+    size_type pos{0};
 
-void docpp::HTML::Properties::swap(const docpp::HTML::Property& property1, const docpp::HTML::Property& property2) {
-    this->swap(this->find(property1), this->find(property2));
+    for (const Hole& it : this->holes) {
+        sink.write(this->bytes.data() + pos, it.offset - pos);
+        sink.write(values[it.slot]);
+        pos = it.offset;
+    }
+
+    sink.write(this->bytes.data() + pos, this->bytes.size() - pos);
 }
 
+namespace docpp {
+    namespace HTML {
+        namespace {
+            bool is_alpha(const char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            }
 
-docpp::HTML::Element& docpp::HTML::Element::operator=(const docpp::HTML::Element& element) {
-    this->set(element.get_tag(), element.properties, element.get_data(), element.type);
-    return *this;
+            bool is_name_char(const char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == ':' || c == '.';
+            }
+
+            char to_lower(const char c) {
+                return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+
+            bool equal_lower(const std::string& str, const std::size_t pos, const std::string& lower) {
+                if (pos + lower.size() > str.size()) {
+                    return false;
+                }
+
+                for (std::size_t i{0}; i < lower.size(); i++) {
+                    if (to_lower(str[pos + i]) != lower[i]) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            /**
+             * @brief Look up a tag by a name in any case, straight from the input
+             * @return bool True if the name is a known tag, false otherwise
+             */
+            bool find_tag_lower(const char* name, const std::size_t size, Tag& tag) {
+                std::uint32_t hash{tag_hash_seed};
+
+                for (std::size_t i{0}; i < size; i++) {
+                    hash = (hash ^ static_cast<unsigned char>(to_lower(name[i]))) * 16777619u;
+                }
+
+                const std::uint8_t index{tag_slots.slots[tag_slot(hash)]};
+
+                if (index == tag_slot_empty || size != tag_table[index].size) {
+                    return false;
+                }
+
+                for (std::size_t i{0}; i < size; i++) {
+                    if (to_lower(name[i]) != tag_table[index].name[i]) {
+                        return false;
+                    }
+                }
+
+                tag = tag_table[index].tag;
+                return true;
+            }
+
+            /**
+             * @brief A tag name read from markup
+             */
+            struct Name {
+                Atom atom{};
+                Tag tag{};
+                bool known{false}; // whether tag is set
+            };
+
+            /**
+             * @brief Check if an element never has content or a closing tag
+             */
+            bool is_void(const Name& name) {
+                if (!name.known) {
+                    return false;
+                }
+
+                switch (name.tag) {
+                    case Tag::Area:
+                    case Tag::Base:
+                    case Tag::Basefont:
+                    case Tag::Br:
+                    case Tag::Break:
+                    case Tag::Col:
+                    case Tag::Column:
+                    case Tag::Embed:
+                    case Tag::Frame:
+                    case Tag::Hr:
+                    case Tag::Image:
+                    case Tag::Img:
+                    case Tag::Input:
+                    case Tag::Isindex:
+                    case Tag::Keygen:
+                    case Tag::Link:
+                    case Tag::Meta:
+                    case Tag::Param:
+                    case Tag::Source:
+                    case Tag::Track:
+                    case Tag::Wbr:
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * @brief Check if the content of an element is raw text, which runs until the closing tag and is not parsed
+             */
+            bool is_raw_text(const Name& name) {
+                if (!name.known) {
+                    return name.atom.get() == "textarea";
+                }
+
+                switch (name.tag) {
+                    case Tag::Script:
+                    case Tag::Style:
+                    case Tag::Title:
+                    case Tag::Xmp:
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * @brief Builds a section from markup. Tags with child tags become sections, tags with only text become elements,
+             * and text between child tags becomes Type::Text_No_Formatting elements. Text and entities are kept as written,
+             * so rendering the result without escaping reproduces the input.
+             */
+            class Parser {
+                private:
+                    struct Frame {
+                        Atom tag{};
+                        Properties properties;
+                        Section section;
+                        std::string text{};
+                        std::size_t children{0}; // of the last tag closed at this depth, which siblings tend to have as many of
+
+                        explicit Frame(Arena* arena) : properties(arena ? Properties{*arena} : Properties{}), section(arena ? Section{*arena} : Section{}) {};
+                    };
+
+                    const std::string& html;
+                    Arena* arena;
+                    // the frames of closed tags are kept to be reused by the next tags opened at the same depth, along with their buffers
+                    std::vector<Frame> frames{};
+                    std::size_t depth{0};
+                    std::vector<Property> scratch{};
+
+                    Frame& top() {
+                        return this->frames[this->depth - 1];
+                    }
+
+                    Properties make_properties() const {
+                        return this->arena ? Properties{*this->arena} : Properties{};
+                    }
+
+                    /**
+                     * @brief Copy text into a string in the arena of the document, so that adding it to a section does not copy it again
+                     */
+                    String make_text(const char* data, const std::size_t size) const {
+                        return String{data, size, ArenaAllocator<char>{this->arena}};
+                    }
+
+                    /**
+                     * @brief Move the properties collected in scratch into properties of exactly the right size. Their values are already in the arena.
+                     */
+                    Properties take_properties() {
+                        Properties ret{this->make_properties()};
+
+                        ret.reserve(this->scratch.size());
+
+                        for (Property& it : this->scratch) {
+                            ret.push_back(std::move(it));
+                        }
+
+                        this->scratch.clear();
+
+                        return ret;
+                    }
+
+                    void push_frame(const Atom tag, Properties&& properties) {
+                        if (this->depth == this->frames.size()) {
+                            this->frames.emplace_back(this->arena);
+                        }
+
+                        Frame& frame{this->frames[this->depth++]};
+
+                        // a reused frame was left empty when its section was moved into the parent
+                        frame.tag = tag;
+                        frame.properties = std::move(properties);
+                        frame.section.reserve(frame.children);
+                    }
+
+                    void flush_text(Frame& frame) {
+                        if (!frame.text.empty()) {
+                            // copied rather than moved, so the buffer of the frame keeps its size for the next text
+                            frame.section.push_back(Element{Atom{}, Properties{}, this->make_text(frame.text.data(), frame.text.size()), Type::Text_No_Formatting});
+                            frame.text.clear();
+                        }
+                    }
+
+                    void add(Frame& frame, Element&& element) {
+                        this->flush_text(frame);
+                        frame.section.push_back(std::move(element));
+                    }
+
+                    void add(Element&& element) {
+                        this->add(this->top(), std::move(element));
+                    }
+
+                    /**
+                     * @brief Close the innermost open tag and add it to its parent
+                     */
+                    void pop_frame() {
+                        Frame& frame{this->top()};
+                        Frame& parent{this->frames[this->depth - 2]};
+
+                        if (frame.section.empty()) {
+                            this->add(parent, Element{frame.tag, std::move(frame.properties), this->make_text(frame.text.data(), frame.text.size()), Type::Non_Self_Closing});
+                            frame.text.clear();
+                        } else {
+                            this->flush_text(frame);
+                            frame.children = frame.section.size();
+                            frame.section.set_tag(frame.tag);
+                            frame.section.set_properties(std::move(frame.properties));
+
+                            this->flush_text(parent);
+                            parent.section.push_back(std::move(frame.section));
+                        }
+
+                        --this->depth;
+                    }
+
+                    /**
+                     * @brief Close the innermost open tag named name, and any tags opened after it. Stray closing tags are ignored.
+                     */
+                    void close(const Atom name) {
+                        for (std::size_t i{this->depth - 1}; i > 0; i--) {
+                            if (this->frames[i].tag == name) {
+                                while (this->depth > i) {
+                                    this->pop_frame();
+                                }
+
+                                return;
+                            }
+                        }
+                    }
+
+                    /**
+                     * @brief Close the open tags whose closing tags are implied by a start tag, the way minified output leaves them out: the innermost
+                     * tag that the start tag may follow without its closing tag, along with the tags opened after it that may be left open at the end of their parent
+                     */
+                    void close_implied(const Atom name) {
+                        for (;;) {
+                            std::size_t i{this->depth - 1};
+
+                            for (; i > 0; i--) {
+                                const OptionalClose* rule{find_optional_close(this->frames[i].tag.get())};
+
+                                if (!rule || rule->followers.empty()) {
+                                    return;
+                                } else if (rule->followers.count(name.get())) {
+                                    break;
+                                } else if (!rule->last) {
+                                    return;
+                                }
+                            }
+
+                            if (i == 0) {
+                                return;
+                            }
+
+                            while (this->depth > i) {
+                                this->pop_frame();
+                            }
+                        }
+                    }
+
+                    /**
+                     * @brief Read a tag name, lowercased. Known tags are resolved straight from the input, without building a string.
+                     */
+                    Name read_name(std::size_t& pos) const {
+                        const std::size_t start{pos};
+                        Name ret{};
+
+                        while (pos < this->html.size() && is_name_char(this->html[pos])) {
+                            ++pos;
+                        }
+
+                        if (find_tag_lower(this->html.data() + start, pos - start, ret.tag)) {
+                            ret.atom = Atom{ret.tag};
+                            ret.known = true;
+                            return ret;
+                        }
+
+                        std::string name{this->html, start, pos - start};
+
+                        for (char& c : name) {
+                            c = to_lower(c);
+                        }
+
+                        ret.atom = Atom{name, this->arena};
+                        return ret;
+                    }
+
+                    void skip_space(std::size_t& pos) const {
+                        while (pos < this->html.size() && is_space(this->html[pos])) {
+                            ++pos;
+                        }
+                    }
+
+                    /**
+                     * @brief Parse the attributes of an opening tag, up to and including the closing >
+                     * @return bool False if the input ends before the tag does
+                     */
+                    bool read_properties(std::size_t& pos, std::vector<Property>& properties, bool& self_closing) const {
+                        const std::string& html{this->html};
+
+                        for (;;) {
+                            this->skip_space(pos);
+
+                            if (pos >= html.size()) {
+                                return false;
+                            }
+
+                            if (html[pos] == '>') {
+                                ++pos;
+                                return true;
+                            }
+
+                            if (html[pos] == '/') {
+                                ++pos;
+
+                                if (pos < html.size() && html[pos] == '>') {
+                                    self_closing = true;
+                                    ++pos;
+                                    return true;
+                                }
+
+                                continue;
+                            }
+
+                            const std::size_t start{pos};
+
+                            while (pos < html.size() && !is_space(html[pos]) && html[pos] != '=' && html[pos] != '>' && html[pos] != '/') {
+                                ++pos;
+                            }
+
+                            if (pos == start) {
+                                ++pos; // a stray =
+                                continue;
+                            }
+
+                            std::string key{html, start, pos - start};
+                            String value{ArenaAllocator<char>{this->arena}};
+
+                            for (char& c : key) {
+                                c = to_lower(c);
+                            }
+
+                            this->skip_space(pos);
+
+                            if (pos < html.size() && html[pos] == '=') {
+                                ++pos;
+                                this->skip_space(pos);
+
+                                if (pos < html.size() && (html[pos] == '"' || html[pos] == '\'')) {
+                                    const std::size_t end{find_byte(html, pos + 1, html[pos])};
+
+                                    value.assign(html.data() + pos + 1, end - pos - 1);
+                                    pos = end + 1;
+                                } else {
+                                    const std::size_t value_start{pos};
+
+                                    while (pos < html.size() && !is_space(html[pos]) && html[pos] != '>') {
+                                        ++pos;
+                                    }
+
+                                    value.assign(html.data() + value_start, pos - value_start);
+                                }
+
+                                // values are always written between double quotes
+                                for (std::size_t quote{value.find('"')}; quote != String::npos; quote = value.find('"', quote)) {
+                                    value.replace(quote, 1, "&quot;");
+                                }
+                            } else {
+                                value = key; // a boolean attribute, such as disabled
+                            }
+
+                            properties.push_back(Property{std::move(key), std::move(value)});
+                        }
+                    }
+
+                    /**
+                     * @brief Parse the markup starting at a <, which is known not to start a comment
+                     */
+                    void read_tag(std::size_t& pos) {
+                        const std::string& html{this->html};
+                        const std::size_t start{pos};
+
+                        if (html[pos + 1] == '!' || html[pos + 1] == '?') {
+                            // a doctype or processing instruction is kept as it is
+                            const std::size_t end{find_byte(html, pos, '>')};
+
+                            pos = end < html.size() ? end + 1 : end;
+                            this->add(Element{Atom{}, Properties{}, this->make_text(html.data() + start, pos - start), Type::Text_No_Formatting});
+                            return;
+                        }
+
+                        if (html[pos + 1] == '/') {
+                            pos += 2;
+
+                            const Name name{this->read_name(pos)};
+                            const std::size_t end{find_byte(html, pos, '>')};
+
+                            pos = end < html.size() ? end + 1 : end;
+                            this->close(name.atom);
+                            return;
+                        }
+
+                        pos += 1;
+
+                        const Name name{this->read_name(pos)};
+                        bool self_closing{false};
+
+                        if (!this->read_properties(pos, this->scratch, self_closing)) {
+                            // the input ends inside the tag, so it was not a tag after all
+                            this->top().text.append(html, start, std::string::npos);
+                            this->scratch.clear();
+                            pos = html.size();
+                            return;
+                        }
+
+                        this->close_implied(name.atom);
+
+                        Properties properties{this->take_properties()};
+
+                        if (self_closing) {
+                            this->add(Element{name.atom, std::move(properties), String{}, Type::Self_Closing});
+                        } else if (is_void(name)) {
+                            this->add(Element{name.atom, std::move(properties), String{}, Type::Non_Closed});
+                        } else if (is_raw_text(name)) {
+                            const std::string& tag{name.atom.get()};
+                            std::size_t end{pos};
+
+                            for (;;) {
+                                end = find_byte(html, end, '<');
+
+                                if (end >= html.size() || (html.compare(end, 2, "</") == 0 && equal_lower(html, end + 2, tag))) {
+                                    break;
+                                }
+
+                                ++end;
+                            }
+
+                            String data{this->make_text(html.data() + pos, end - pos)};
+
+                            pos = end < html.size() ? find_byte(html, end, '>') : end;
+                            pos = pos < html.size() ? pos + 1 : pos;
+
+                            this->add(Element{name.atom, std::move(properties), std::move(data), Type::Non_Self_Closing});
+                        } else {
+                            this->push_frame(name.atom, std::move(properties));
+                        }
+                    }
+                public:
+                    Parser(const std::string& html, Arena* arena) : html(html), arena(arena) {
+                        this->frames.reserve(32);
+                    };
+
+                    Section parse() {
+                        const std::string& html{this->html};
+                        std::size_t pos{0};
+
+                        this->push_frame(Atom{}, this->make_properties());
+
+                        while (pos < html.size()) {
+                            const std::size_t next{find_byte(html, pos, '<')};
+
+                            this->top().text.append(html, pos, next - pos);
+                            pos = next;
+
+                            if (pos >= html.size()) {
+                                break;
+                            }
+
+                            if (html.compare(pos, 4, "<!--") == 0) {
+                                const std::size_t end{html.find("-->", pos + 4)};
+                                const std::size_t stop{end == std::string::npos ? html.size() : end + 3};
+
+                                this->add(Element{Atom{}, Properties{}, this->make_text(html.data() + pos, stop - pos), Type::Text_No_Formatting});
+                                pos = stop;
+                            } else if (pos + 1 < html.size() && (html[pos + 1] == '/' || html[pos + 1] == '!' || html[pos + 1] == '?' || is_alpha(html[pos + 1]))) {
+                                this->read_tag(pos);
+                            } else {
+                                this->top().text.push_back('<');
+                                ++pos;
+                            }
+                        }
+
+                        while (this->depth > 1) {
+                            this->pop_frame();
+                        }
+
+                        this->flush_text(this->top());
+
+                        return std::move(this->top().section);
+                    }
+            };
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
+
+docpp::HTML::Section docpp::HTML::parse(const std::string& html) {
+    return Parser{html, nullptr}.parse();
 }
 
-docpp::HTML::Element& docpp::HTML::Element::operator+=(const std::string& data) {
-    this->data += data;
-    return *this;
+docpp::HTML::Section docpp::HTML::parse(const std::string& html, Arena& arena) {
+    return Parser{html, &arena}.parse();
 }
 
-bool docpp::HTML::Element::operator==(const docpp::HTML::Element& element) const {
-    return this->tag == element.get_tag() && this->properties == element.properties && this->data == element.get_data() && this->type == element.type;
+docpp::HTML::Document docpp::HTML::parse_document(const std::string& html) {
+    std::size_t start{0};
+
+    while (start < html.size() && is_space(html[start])) {
+        ++start;
+    }
+
+    if (!equal_lower(html, start, "<!doctype")) {
+        return Document{parse(html), std::string{}};
+    }
+
+    const std::size_t end{find_byte(html, start, '>')};
+    const std::size_t stop{end < html.size() ? end + 1 : end};
+
+    return Document{parse(html.substr(stop)), html.substr(start, stop - start)};
 }
 
-bool docpp::HTML::Element::operator!=(const docpp::HTML::Element& element) const {
-    return this->tag != element.get_tag() || this->properties != element.properties || this->data != element.get_data() || this->type != element.type;
+docpp::HTML::Patch::Type docpp::HTML::Patch::get_type() const {
+    return this->type;
 }
 
-void docpp::HTML::Element::set(const std::string& tag, const Properties& properties, const std::string& data, const Type type) {
-    this->set_tag(tag);
-    this->set_properties(properties);
-    this->set_data(data);
-    this->set_type(type);
+const std::vector<docpp::HTML::Patch::size_type>& docpp::HTML::Patch::get_path() const {
+    return this->path;
 }
 
-void docpp::HTML::Element::set(const Tag tag, const Properties& properties, const std::string& data) {
-    this->set_tag(tag);
-    this->set_properties(properties);
-    this->set_data(data);
+const docpp::HTML::Section::Node& docpp::HTML::Patch::get_node() const {
+    return this->node;
 }
 
-void docpp::HTML::Element::set_tag(const std::string& tag) {
-    this->tag = tag;
+const std::string& docpp::HTML::Patch::get_key() const {
+    return this->key;
 }
 
-void docpp::HTML::Element::set_tag(const Tag tag) {
-    std::pair<std::string, docpp::HTML::Type> resolved{resolve_tag(tag)};
-    this->tag = resolved.first;
-    this->type = resolved.second;
+const std::string& docpp::HTML::Patch::get_value() const {
+    return this->value;
 }
 
-void docpp::HTML::Element::set_data(const std::string& data) {
-    this->data = data;
-}
+namespace docpp {
+    namespace HTML {
+        namespace {
+            using Path = std::vector<std::size_t>;
+            // the hashes of the children of each section, in document order
+            // seven bits at a time, so that the short strings of a tree cost a byte each
+            void append_size(std::string& out, std::size_t size) {
+                for (; size >= 0x80; size >>= 7) {
+                    out += static_cast<char>((size & 0x7f) | 0x80);
+                }
+
+                out += static_cast<char>(size);
+            }
+
+            void append_field(std::string& out, const std::string& str) {
+                append_size(out, str.size());
+                out += str;
+            }
+
+            void append_field(std::string& out, const String& str) {
+                append_size(out, str.size());
+                out.append(str.data(), str.size());
+            }
+
+            void append_properties(std::string& out, const Properties& properties) {
+                append_size(out, properties.get_properties().size());
+
+                for (const Property& it : properties.get_properties()) {
+                    append_field(out, it.get_key());
+                    append_field(out, it.get_value());
+                }
+            }
+
+            // every field is length prefixed, so the encoding of a subtree is never the prefix of another
+            Hash hash_element(const Element& element, std::string& scratch) {
+                scratch.assign(1, 'e');
+                scratch += static_cast<char>(element.get_type());
+                scratch += static_cast<char>(element.get_escape());
+                append_field(scratch, element.get_tag());
+                append_properties(scratch, element.get_properties());
+                append_field(scratch, element.get_data());
+
+                return Hash{scratch.data(), scratch.size()};
+            }
+
+            // the hash of a section covers its own fields followed by the hashes of its children, which is the same as hashing the encoding of the whole subtree
+            Hash hash_section(const Section& section, const std::vector<Hash>& children, std::string& scratch) {
+                scratch.assign(1, 's');
+                append_field(scratch, section.get_tag());
+                append_properties(scratch, section.get_properties());
+                append_size(scratch, children.size());
+
+                Hash ret{scratch.data(), scratch.size()};
+
+                for (const Hash& it : children) {
+                    ret.append(it);
+                }
+
+                return ret;
+            }
+
+            std::vector<Hash> hash_children(const Section& section, std::string& scratch) {
+                std::vector<Hash> ret{};
+
+                for (const Section::Node& it : section.children()) {
+                    ret.push_back(it.is_element() ? hash_element(it.get_element(), scratch) : it.get_section().get_tree_hash());
+                }
+
+                return ret;
+            }
+
+            // keys are interned, so equal keys are the same string
+            bool has_duplicate_keys(const Properties& properties) {
+                std::unordered_set<const std::string*> keys{};
+
+                for (const Property& it : properties.get_properties()) {
+                    if (!keys.insert(&it.get_key()).second) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            // keys must be unique in both lists; the patches leave the properties in the order of after
+            void diff_properties(const Properties& before, const Properties& after, const Path& path, std::vector<Patch>& patches) {
+                if (before == after) {
+                    return;
+                }
+
+                const std::vector<Property, ArenaAllocator<Property>>& old_list{before.get_properties()};
+                const std::vector<Property, ArenaAllocator<Property>>& new_list{after.get_properties()};
+                std::unordered_map<const std::string*, std::size_t> new_keys{};
+
+                for (std::size_t i{0}; i < new_list.size(); i++) {
+                    new_keys[&new_list[i].get_key()] = i;
+                }
+
+                std::vector<const Property*> kept{};
+
+                for (const Property& it : old_list) {
+                    if (new_keys.count(&it.get_key())) {
+                        kept.push_back(&it);
+                    } else {
+                        patches.emplace_back(Patch::Type::Remove_Property, path, it.get_key());
+                    }
+                }
+
+                std::size_t common{0};
+
+                while (common < kept.size() && kept[common]->get_key_atom() == new_list[common].get_key_atom()) {
+                    if (kept[common]->get_value() != new_list[common].get_value()) {
+                        patches.emplace_back(Patch::Type::Set_Property, path, new_list[common].get_key(), static_cast<std::string>(new_list[common].get_value()));
+                    }
+
+                    ++common;
+                }
+
+                // whatever is out of order is removed, then appended again in the right order
+                for (std::size_t i{common}; i < kept.size(); i++) {
+                    patches.emplace_back(Patch::Type::Remove_Property, path, kept[i]->get_key());
+                }
+
+                for (std::size_t i{common}; i < new_list.size(); i++) {
+                    patches.emplace_back(Patch::Type::Set_Property, path, new_list[i].get_key(), static_cast<std::string>(new_list[i].get_value()));
+                }
+            }
+
+            Path child_path(const Path& path, const std::size_t index) {
+                Path ret{};
+
+                ret.reserve(path.size() + 1);
+                ret.assign(path.begin(), path.end());
+                ret.push_back(index);
+
+                return ret;
+            }
+
+            // the longest run of matches that keeps the order of the old children, so that they can stay where they are
+            std::vector<std::pair<std::size_t, std::size_t>> find_anchors(const std::vector<std::pair<std::size_t, std::size_t>>& matches) {
+                const std::size_t none{static_cast<std::size_t>(-1)};
+                std::vector<std::size_t> tails{};
+                std::vector<std::size_t> previous(matches.size(), none);
+
+                for (std::size_t i{0}; i < matches.size(); i++) {
+                    const std::vector<std::size_t>::iterator it{std::lower_bound(tails.begin(), tails.end(), matches[i].first, [&matches](const std::size_t index, const std::size_t value) {
+                        return matches[index].first < value;
+                    })};
+
+                    if (it != tails.begin()) {
+                        previous[i] = *(it - 1);
+                    }
+
+                    if (it == tails.end()) {
+                        tails.push_back(i);
+                    } else {
+                        *it = i;
+                    }
+                }
+
+                std::vector<std::pair<std::size_t, std::size_t>> ret(tails.size());
+                std::size_t index{tails.empty() ? none : tails.back()};
+
+                for (std::size_t i{ret.size()}; i > 0; i--) {
+                    ret[i - 1] = matches[index];
+                    index = previous[index];
+                }
 
-void docpp::HTML::Element::set_type(const Type type) {
-    this->type = type;
-}
+                return ret;
+            }
 
-void docpp::HTML::Element::set_properties(const Properties& properties) {
-    this->properties = properties;
-}
+            class Differ {
+                private:
+                    struct Task {
+                        const Section* before;
+                        const Section* after;
+                        Path path;
+                    };
+
+                    std::vector<Task> tasks{};
+                    std::string scratch{};
+                    std::vector<Patch> patches{};
+
+                    static bool is_compatible(const Section::Node& before, const Section::Node& after) {
+                        if (before.is_section() && after.is_section()) {
+                            return before.get_section().get_tag_atom() == after.get_section().get_tag_atom();
+                        }
+
+                        if (before.is_element() && after.is_element()) {
+                            const Element& old_element{before.get_element()};
+                            const Element& new_element{after.get_element()};
+
+                            return old_element.get_tag_atom() == new_element.get_tag_atom() && old_element.get_type() == new_element.get_type() && old_element.get_escape() == new_element.get_escape();
+                        }
+
+                        return false;
+                    }
+
+                    // turns a child into another in place, or replaces it if they are too different
+                    void diff_node(const Section::Node& before, const Section::Node& after, Path&& path) {
+                        if (!is_compatible(before, after)) {
+                            this->patches.emplace_back(Patch::Type::Replace, path, Section::Node{after, nullptr});
+                        } else if (after.is_section()) {
+                            this->tasks.push_back(Task{&before.get_section(), &after.get_section(), std::move(path)});
+                        } else if (has_duplicate_keys(before.get_element().get_properties()) || has_duplicate_keys(after.get_element().get_properties())) {
+                            this->patches.emplace_back(Patch::Type::Replace, path, Section::Node{after, nullptr});
+                        } else {
+                            const Element& old_element{before.get_element()};
+                            const Element& new_element{after.get_element()};
+
+                            if (old_element.get_data() != new_element.get_data()) {
+                                this->patches.emplace_back(Patch::Type::Set_Data, path, std::string{}, static_cast<std::string>(new_element.get_data()));
+                            }
+
+                            diff_properties(old_element.get_properties(), new_element.get_properties(), path, this->patches);
+                        }
+                    }
+
+                    /* Only the children that changed are looked at: the common prefix and suffix are skipped, and the children in between are matched by hash.
+                     * The matches that keep their order stay where they are, and the children between them are diffed pairwise, removed or inserted.
+                     * Children to the left of the current position are always final, so the position is both the index in the tree being patched and in after. */
+                    void diff_children(const Task& task) {
+                        std::vector<const Section::Node*> old_nodes{};
+                        std::vector<const Section::Node*> new_nodes{};
+
+                        for (const Section::Node& it : task.before->children()) {
+                            old_nodes.push_back(&it);
+                        }
+
+                        for (const Section::Node& it : task.after->children()) {
+                            new_nodes.push_back(&it);
+                        }
+
+                        // child sections hash in constant time unless they changed, so only the children of changed sections are looked at
+                        const std::vector<Hash> old_hashes{hash_children(*task.before, this->scratch)};
+                        const std::vector<Hash> new_hashes{hash_children(*task.after, this->scratch)};
+                        std::size_t first{0};
+                        std::size_t old_last{old_hashes.size()};
+                        std::size_t new_last{new_hashes.size()};
+
+                        while (first < old_last && first < new_last && old_hashes[first] == new_hashes[first]) {
+                            ++first;
+                        }
+
+                        while (old_last > first && new_last > first && old_hashes[old_last - 1] == new_hashes[new_last - 1]) {
+                            --old_last;
+                            --new_last;
+                        }
+
+                        std::unordered_map<std::uint64_t, std::vector<std::size_t>> candidates{};
+                        std::unordered_map<std::uint64_t, std::size_t> used{};
+                        std::vector<std::pair<std::size_t, std::size_t>> matches{};
+
+                        for (std::size_t i{first}; i < old_last; i++) {
+                            candidates[old_hashes[i].get_64()].push_back(i);
+                        }
+
+                        for (std::size_t i{first}; i < new_last; i++) {
+                            const std::uint64_t key{new_hashes[i].get_64()};
+                            const std::unordered_map<std::uint64_t, std::vector<std::size_t>>::const_iterator it{candidates.find(key)};
+
+                            if (it == candidates.end()) {
+                                continue;
+                            }
+
+                            std::size_t& next{used[key]};
+
+                            if (next < it->second.size() && old_hashes[it->second[next]] == new_hashes[i]) {
+                                matches.emplace_back(it->second[next++], i);
+                            }
+                        }
+
+                        std::vector<std::pair<std::size_t, std::size_t>> anchors{find_anchors(matches)};
+                        std::size_t old_index{first};
+                        std::size_t position{first};
+
+                        anchors.emplace_back(old_last, new_last);
+
+                        for (const std::pair<std::size_t, std::size_t>& anchor : anchors) {
+                            while (old_index < anchor.first && position < anchor.second) {
+                                if (old_hashes[old_index] != new_hashes[position]) {
+                                    this->diff_node(*old_nodes[old_index], *new_nodes[position], child_path(task.path, position));
+                                }
+
+                                ++old_index;
+                                ++position;
+                            }
+
+                            for (; old_index < anchor.first; old_index++) {
+                                this->patches.emplace_back(Patch::Type::Remove, child_path(task.path, position));
+                            }
+
+                            for (; position < anchor.second; position++) {
+                                this->patches.emplace_back(Patch::Type::Insert, child_path(task.path, position), Section::Node{*new_nodes[position], nullptr});
+                            }
+
+                            ++old_index;
+                            ++position;
+                        }
+                    }
+                public:
+                    std::vector<Patch> diff(const Section& before, const Section& after) {
+                        if (before.get_tree_hash() == after.get_tree_hash()) {
+                            return {};
+                        }
+
+                        this->tasks.push_back(Task{&before, &after, Path{}});
+
+                        while (!this->tasks.empty()) {
+                            const Task task{std::move(this->tasks.back())};
+                            this->tasks.pop_back();
+
+                            if (task.before->get_tag_atom() != task.after->get_tag_atom() || has_duplicate_keys(task.before->get_properties()) || has_duplicate_keys(task.after->get_properties())) {
+                                this->patches.emplace_back(Patch::Type::Replace, task.path, Section::Node{*task.after, nullptr});
+
+                                continue;
+                            }
+
+                            diff_properties(task.before->get_properties(), task.after->get_properties(), task.path, this->patches);
+                            this->diff_children(task);
+                        }
+
+                        return std::move(this->patches);
+                    }
+            };
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
+
+// hashed bottom up without recursion, stopping at the sections whose hash is still known
+docpp::Hash docpp::HTML::Section::get_tree_hash() const {
+    struct Frame {
+        const Section* section;
+        const_child_iterator current;
+        const_child_iterator last;
+        std::vector<Hash> children;
+    };
 
-std::string docpp::HTML::Element::get(const Formatting formatting, const int tabc) const {
-    std::string ret{};
+    const auto find_cached = [](const Section& section, Hash& hash) {
+        std::lock_guard<std::mutex> lock{section.mutex};
 
-    if (this->type == docpp::HTML::Type::Text_No_Formatting) {
-        return this->data;
-    } else if (this->type == docpp::HTML::Type::Text) {
-        for (size_type i{0}; i < tabc; i++) {
-            ret += "\t";
+        if (section.tree_hashed) {
+            hash = section.tree_hash;
         }
 
-        return ret + this->data;
-    }
+        return section.tree_hashed;
+    };
 
-    if (formatting == docpp::HTML::Formatting::Pretty) {
-        for (size_type i{0}; i < tabc; i++) {
-            ret += "\t";
-        }
-    }
+    Hash ret{};
 
-    if (this->type == docpp::HTML::Type::Non_Opened) {
-        ret += "</" + this->tag;
-    } else {
-        ret += "<" + this->tag;
+    if (find_cached(*this, ret)) {
+        return ret;
     }
 
-    for (const Property& it : this->properties.get_properties()) {
-        if (!it.get_key().compare("")) continue;
-        if (!it.get_value().compare("")) continue;
+    std::vector<Frame> stack{};
+    std::string scratch{};
 
-        ret += " " + it.get_key() + "=\"" + it.get_value() + "\"";
-    }
+    stack.push_back(Frame{this, this->children().begin(), this->children().end(), {}});
 
-    if (this->type != docpp::HTML::Type::Self_Closing && this->type != docpp::HTML::Type::Non_Opened) {
-        ret += ">";
-    }
+    while (!stack.empty()) {
+        Frame& frame{stack.back()};
 
-    if (this->type == docpp::HTML::Type::Non_Self_Closing) {
-        ret += this->data + "</" + this->tag + ">";
-    } else if (this->type == docpp::HTML::Type::Self_Closing) {
-        ret += this->data + "/>";
-    } else if (this->type == docpp::HTML::Type::Non_Opened) {
-        ret += ">";
-    }
+        if (frame.current != frame.last) {
+            const Node& node{*frame.current};
+            Hash hash{};
+
+            ++frame.current;
+
+            if (node.is_element()) {
+                frame.children.push_back(hash_element(node.get_element(), scratch));
+            } else if (find_cached(node.get_section(), hash)) {
+                frame.children.push_back(hash);
+            } else {
+                const Section& section{node.get_section()};
+                stack.push_back(Frame{&section, section.children().begin(), section.children().end(), {}});
+            }
+
+            continue;
+        }
+
+        const Hash hash{hash_section(*frame.section, frame.children, scratch)};
 
-    if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
-        ret += "\n";
+        {
+            std::lock_guard<std::mutex> lock{frame.section->mutex};
+            frame.section->tree_hash = hash;
+            frame.section->tree_hashed = true;
+        }
+
+        stack.pop_back();
+
+        if (stack.empty()) {
+            ret = hash;
+        } else {
+            stack.back().children.push_back(hash);
+        }
     }
 
     return ret;
 }
 
-std::string docpp::HTML::Element::get_tag() const {
-    return this->tag;
+std::vector<docpp::HTML::Patch> docpp::HTML::diff(const Section& before, const Section& after) {
+    return Differ{}.diff(before, after);
 }
 
-std::string docpp::HTML::Element::get_data() const {
-    return this->data;
+std::vector<docpp::HTML::Patch> docpp::HTML::diff(const Document& before, const Document& after) {
+    return diff(before.get_section(), after.get_section());
 }
 
-docpp::HTML::Type docpp::HTML::Element::get_type() const {
-    return this->type;
-}
+namespace docpp {
+    namespace HTML {
+        namespace {
+            bool is_selector_name_char(const char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '\\' || static_cast<unsigned char>(c) >= 0x80;
+            }
 
-docpp::HTML::Properties docpp::HTML::Element::get_properties() const {
-    return this->properties;
-}
+            // text does not take part in selectors: it is never matched, and is not counted as a sibling
+            bool is_tag_element(const Element& element) {
+                const Type type{element.get_type()};
 
-bool docpp::HTML::Element::empty() const {
-    return this->tag.empty() && this->data.empty() && this->properties.empty();
-}
+                return !element.get_tag().empty() && type != Type::Text && type != Type::Text_No_Formatting && type != Type::Non_Opened;
+            }
 
-void docpp::HTML::Element::clear() {
-    this->tag.clear();
-    this->data.clear();
-    this->properties.clear();
-}
+            const String* find_value(const Properties& properties, const Atom& key) {
+                for (const Property& it : properties.get_properties()) {
+                    if (it.get_key_atom() == key) {
+                        return &it.get_value();
+                    }
+                }
 
-docpp::HTML::Section& docpp::HTML::Section::operator=(const docpp::HTML::Section& section) {
-    this->tag = section.tag;
-    this->properties = section.properties;
-    this->elements = section.elements;
-    this->sections = section.sections;
-    this->index = section.index;
+                return nullptr;
+            }
 
-    return *this;
-}
+            bool has_word(const String& str, const std::string& word) {
+                std::size_t i{0};
 
-docpp::HTML::Section& docpp::HTML::Section::operator+=(const docpp::HTML::Element& element) {
-    this->push_back(element);
-    return *this;
-}
+                while (i < str.size()) {
+                    while (i < str.size() && is_space(str[i])) {
+                        ++i;
+                    }
 
-docpp::HTML::Section& docpp::HTML::Section::operator+=(const docpp::HTML::Section& section) {
-    this->push_back(section);
-    return *this;
-}
+                    std::size_t end{i};
 
-docpp::HTML::Element docpp::HTML::Section::operator[](const int& index) const {
-    return this->at(index);
-}
+                    while (end < str.size() && !is_space(str[end])) {
+                        ++end;
+                    }
 
-std::unordered_map<std::string, docpp::HTML::Element> docpp::HTML::Section::operator[](const std::string& tag) const {
-    std::unordered_map<std::string, docpp::HTML::Element> ret{};
+                    if (end - i == word.size() && !str.compare(i, end - i, word)) {
+                        return true;
+                    }
 
-    for (const Element& it : this->get_elements()) {
-        if (!it.get_tag().compare(tag)) {
-            ret[it.get_data()] = it;
-        }
-    }
+                    i = end;
+                }
 
-    return ret;
-}
+                return false;
+            }
+        } // namespace
+    } // namespace HTML
+} // namespace docpp
 
-std::unordered_map<std::string, docpp::HTML::Element> docpp::HTML::Section::operator[](const Tag tag) const {
-    std::unordered_map<std::string, docpp::HTML::Element> ret{};
+docpp::HTML::Selector::Selector(const std::string& selector) {
+    const std::size_t size{selector.size()};
+    std::size_t i{0};
 
-    for (const Element& it : this->get_elements()) {
-        if (!it.get_tag().compare(resolve_tag(tag).first)) {
-            ret[it.get_data()] = it;
+    const auto skip_space = [&selector, &size, &i]() {
+        while (i < size && is_space(selector[i])) {
+            ++i;
         }
-    }
+    };
 
-    return ret;
-}
+    const auto read_name = [&selector, &size, &i]() {
+        std::string ret{};
 
-bool docpp::HTML::Section::operator==(const docpp::HTML::Section& section) const {
-    return this->tag == section.tag && this->properties == section.properties && this->elements == section.elements && this->sections == section.sections && this->index == section.index;
-}
+        while (i < size && is_selector_name_char(selector[i])) {
+            if (selector[i] == '\\') {
+                if (++i == size) {
+                    break;
+                }
+            }
 
-bool docpp::HTML::Section::operator==(const docpp::HTML::Element& element) const {
-    for (const Element& it : this->get_elements()) {
-        if (it.get() == element.get()) {
-            return true;
+            ret += selector[i++];
         }
-    }
 
-    return false;
-}
+        if (ret.empty()) {
+            throw docpp::invalid_argument("Invalid selector");
+        }
 
-bool docpp::HTML::Section::operator!=(const docpp::HTML::Section& section) const {
-    return this->tag != section.tag || this->properties != section.properties || this->elements != section.elements || this->sections != section.sections || this->index != section.index;
-}
+        return ret;
+    };
 
-bool docpp::HTML::Section::operator!=(const docpp::HTML::Element& element) const {
-    for (const Element& it : this->get_elements()) {
-        if (it.get() == element.get()) {
-            return false;
+    // tag and attribute names are case-insensitive in HTML, and the parser lowercases them in documents
+    const auto read_lower_name = [&read_name]() {
+        std::string ret{read_name()};
+
+        for (char& c : ret) {
+            c = to_lower(c);
         }
-    }
 
-    return true;
-}
+        return ret;
+    };
 
-void docpp::HTML::Section::set(const std::string& tag, const Properties& properties) {
-    this->tag = tag;
-    this->properties = properties;
-}
+    const auto read_value = [&selector, &size, &i, &read_name]() {
+        if (i == size || (selector[i] != '"' && selector[i] != '\'')) {
+            return read_name();
+        }
 
-void docpp::HTML::Section::set_tag(const std::string& tag) {
-    this->tag = tag;
-}
+        const char quote{selector[i++]};
+        std::string ret{};
 
-void docpp::HTML::Section::set_tag(const Tag tag) {
-    std::pair<std::string, docpp::HTML::Type> resolved{resolve_tag(tag)};
-    this->tag = resolved.first;
-}
+        while (i < size && selector[i] != quote) {
+            if (selector[i] == '\\' && i + 1 < size) {
+                ++i;
+            }
 
-void docpp::HTML::Section::set_properties(const Properties& properties) {
-    this->properties = properties;
-}
+            ret += selector[i++];
+        }
 
-std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> docpp::HTML::get_tag_map() {
-    return {
-        {Tag::Empty, {"", Type::Text}},
-        {Tag::Empty_No_Formatting, {"", Type::Text_No_Formatting}},
-        {Tag::Abbreviation, {"abbr", Type::Non_Self_Closing}},
-        {Tag::Abbr, {"abbr", Type::Non_Self_Closing}},
-        {Tag::Acronym, {"acronym", Type::Non_Self_Closing}},
-        {Tag::Address, {"address", Type::Non_Self_Closing}},
-        {Tag::Applet, {"applet", Type::Non_Self_Closing}},
-        {Tag::Anchor, {"a", Type::Non_Self_Closing}},
-        {Tag::A, {"a", Type::Non_Self_Closing}},
-        {Tag::Article, {"article", Type::Non_Self_Closing}},
-        {Tag::Area, {"area", Type::Non_Closed}},
-        {Tag::Aside, {"aside", Type::Non_Self_Closing}},
-        {Tag::Audio, {"audio", Type::Non_Self_Closing}},
-        {Tag::Base, {"base", Type::Non_Closed}},
-        {Tag::Basefont, {"basefont", Type::Non_Closed}},
-        {Tag::Bdi, {"bdi", Type::Non_Self_Closing}},
-        {Tag::Bdo, {"bdo", Type::Non_Self_Closing}},
-        {Tag::Bgsound, {"bgsound", Type::Non_Self_Closing}},
-        {Tag::Big, {"big", Type::Non_Self_Closing}},
-        {Tag::Blockquote, {"blockquote", Type::Non_Self_Closing}},
-        {Tag::Body, {"body", Type::Non_Self_Closing}},
-        {Tag::B, {"b", Type::Non_Self_Closing}},
-        {Tag::Bold, {"b", Type::Non_Self_Closing}},
-        {Tag::Br, {"br", Type::Non_Closed}},
-        {Tag::Break, {"br", Type::Non_Closed}},
-        {Tag::Button, {"button", Type::Non_Closed}},
-        {Tag::Caption, {"caption", Type::Non_Self_Closing}},
-        {Tag::Canvas, {"canvas", Type::Non_Self_Closing}},
-        {Tag::Center, {"center", Type::Non_Self_Closing}},
-        {Tag::Cite, {"cite", Type::Non_Self_Closing}},
-        {Tag::Code, {"code", Type::Non_Self_Closing}},
-        {Tag::Colgroup, {"colgroup", Type::Non_Self_Closing}},
-        {Tag::Column, {"col", Type::Non_Closed}},
-        {Tag::Col, {"col", Type::Non_Closed}},
-        {Tag::Data, {"data", Type::Non_Self_Closing}},
-        {Tag::Datalist, {"datalist", Type::Non_Self_Closing}},
-        {Tag::Dd, {"dd", Type::Non_Self_Closing}},
-        {Tag::Dfn, {"dfn", Type::Non_Self_Closing}},
-        {Tag::Define, {"dfn", Type::Non_Self_Closing}},
-        {Tag::Delete, {"del", Type::Non_Self_Closing}},
-        {Tag::Del, {"del", Type::Non_Self_Closing}},
-        {Tag::Details, {"details", Type::Non_Self_Closing}},
-        {Tag::Dialog, {"dialog", Type::Non_Self_Closing}},
-        {Tag::Dir, {"dir", Type::Non_Self_Closing}},
-        {Tag::Div, {"div", Type::Non_Self_Closing}},
-        {Tag::Dl, {"dl", Type::Non_Self_Closing}},
-        {Tag::Dt, {"dt", Type::Non_Self_Closing}},
-        {Tag::Embed, {"embed", Type::Non_Closed}},
-        {Tag::Fieldset, {"fieldset", Type::Non_Self_Closing}},
-        {Tag::Figcaption, {"figcaption", Type::Non_Self_Closing}},
-        {Tag::Figure, {"figure", Type::Non_Self_Closing}},
-        {Tag::Font, {"font", Type::Non_Self_Closing}},
-        {Tag::Footer, {"footer", Type::Non_Self_Closing}},
-        {Tag::Form, {"form", Type::Non_Self_Closing}},
-        {Tag::Frame, {"frame", Type::Self_Closing}},
-        {Tag::Frameset, {"frameset", Type::Non_Self_Closing}},
-        {Tag::Head, {"head", Type::Non_Self_Closing}},
-        {Tag::Header, {"header", Type::Non_Self_Closing}},
-        {Tag::H1, {"h1", Type::Non_Self_Closing}},
-        {Tag::H2, {"h2", Type::Non_Self_Closing}},
-        {Tag::H3, {"h3", Type::Non_Self_Closing}},
-        {Tag::H4, {"h4", Type::Non_Self_Closing}},
-        {Tag::H5, {"h5", Type::Non_Self_Closing}},
-        {Tag::H6, {"h6", Type::Non_Self_Closing}},
-        {Tag::Hr, {"hr", Type::Non_Closed}},
-        {Tag::Hgroup, {"hgroup", Type::Non_Self_Closing}},
-        {Tag::Html, {"html", Type::Non_Self_Closing}},
-        {Tag::Iframe, {"iframe", Type::Non_Self_Closing}},
-        {Tag::Image, {"img", Type::Non_Closed}},
-        {Tag::Img, {"img", Type::Non_Closed}},
-        {Tag::Input, {"input", Type::Self_Closing}},
-        {Tag::Ins, {"ins", Type::Non_Self_Closing}},
-        {Tag::Isindex, {"isindex", Type::Non_Closed}},
-        {Tag::Italic, {"i", Type::Non_Self_Closing}},
-        {Tag::I, {"i", Type::Non_Self_Closing}},
-        {Tag::Kbd, {"kbd", Type::Non_Self_Closing}},
-        {Tag::Keygen, {"keygen", Type::Non_Closed}},
-        {Tag::Label, {"label", Type::Non_Self_Closing}},
-        {Tag::Legend, {"legend", Type::Non_Self_Closing}},
-        {Tag::List, {"li", Type::Non_Self_Closing}},
-        {Tag::Li, {"li", Type::Non_Self_Closing}},
-        {Tag::Link, {"link", Type::Non_Closed}},
-        {Tag::Main, {"main", Type::Non_Self_Closing}},
-        {Tag::Mark, {"mark", Type::Non_Self_Closing}},
-        {Tag::Marquee, {"marquee", Type::Non_Self_Closing}},
-        {Tag::Menuitem, {"menuitem", Type::Non_Self_Closing}},
-        {Tag::Meta, {"meta", Type::Non_Closed}},
-        {Tag::Meter, {"meter", Type::Non_Self_Closing}},
-        {Tag::Nav, {"nav", Type::Non_Self_Closing}},
-        {Tag::Nobreak, {"nobr", Type::Non_Self_Closing}},
-        {Tag::Nobr, {"nobr", Type::Non_Self_Closing}},
-        {Tag::Noembed, {"noembed", Type::Non_Self_Closing}},
-        {Tag::Noscript, {"noscript", Type::Non_Self_Closing}},
-        {Tag::Object, {"object", Type::Non_Self_Closing}},
-        {Tag::Optgroup, {"optgroup", Type::Non_Self_Closing}},
-        {Tag::Option, {"option", Type::Non_Self_Closing}},
-        {Tag::Output, {"output", Type::Non_Self_Closing}},
-        {Tag::Paragraph, {"p", Type::Non_Self_Closing}},
-        {Tag::P, {"p", Type::Non_Self_Closing}},
-        {Tag::Param, {"param", Type::Non_Closed}},
-        {Tag::Phrase, {"phrase", Type::Non_Self_Closing}},
-        {Tag::Pre, {"pre", Type::Non_Self_Closing}},
-        {Tag::Progress, {"progress", Type::Non_Self_Closing}},
-        {Tag::Quote, {"q", Type::Non_Self_Closing}},
-        {Tag::Q, {"q", Type::Non_Self_Closing}},
-        {Tag::Rp, {"rp", Type::Non_Self_Closing}},
-        {Tag::Rt, {"rt", Type::Non_Self_Closing}},
-        {Tag::Ruby, {"ruby", Type::Non_Self_Closing}},
-        {Tag::Outdated, {"s", Type::Non_Self_Closing}},
-        {Tag::S, {"s", Type::Non_Self_Closing}},
-        {Tag::Sample, {"samp", Type::Non_Self_Closing}},
-        {Tag::Samp, {"samp", Type::Non_Self_Closing}},
-        {Tag::Script, {"script", Type::Non_Self_Closing}},
-        {Tag::Section, {"section", Type::Non_Self_Closing}},
-        {Tag::Small, {"small", Type::Non_Self_Closing}},
-        {Tag::Source, {"source", Type::Non_Self_Closing}},
-        {Tag::Spacer, {"spacer", Type::Non_Self_Closing}},
-        {Tag::Span, {"span", Type::Non_Self_Closing}},
-        {Tag::Strike, {"strike", Type::Non_Self_Closing}},
-        {Tag::Strong, {"strong", Type::Non_Self_Closing}},
-        {Tag::Style, {"style", Type::Non_Self_Closing}},
-        {Tag::Sub, {"sub", Type::Non_Self_Closing}},
-        {Tag::Subscript, {"sub", Type::Non_Self_Closing}},
-        {Tag::Sup, {"sup", Type::Non_Self_Closing}},
-        {Tag::Superscript, {"sup", Type::Non_Self_Closing}},
-        {Tag::Summary, {"summary", Type::Non_Self_Closing}},
-        {Tag::Svg, {"svg", Type::Non_Closed}},
-        {Tag::Table, {"table", Type::Non_Self_Closing}},
-        {Tag::Tbody, {"tbody", Type::Non_Self_Closing}},
-        {Tag::Td, {"td", Type::Non_Self_Closing}},
-        {Tag::Template, {"template", Type::Non_Self_Closing}},
-        {Tag::Tfoot, {"tfoot", Type::Non_Self_Closing}},
-        {Tag::Th, {"th", Type::Non_Self_Closing}},
-        {Tag::Tr, {"tr", Type::Non_Self_Closing}},
-        {Tag::Thead, {"thead", Type::Non_Self_Closing}},
-        {Tag::Time, {"time", Type::Non_Self_Closing}},
-        {Tag::Title, {"title", Type::Non_Self_Closing}},
-        {Tag::Track, {"track", Type::Non_Closed}},
-        {Tag::Tt, {"tt", Type::Non_Self_Closing}},
-        {Tag::Underline, {"u", Type::Non_Self_Closing}},
-        {Tag::U, {"u", Type::Non_Self_Closing}},
-        {Tag::Var, {"var", Type::Non_Self_Closing}},
-        {Tag::Video, {"video", Type::Non_Self_Closing}},
-        {Tag::Wbr, {"wbr", Type::Non_Closed}},
-        {Tag::Xmp, {"xmp", Type::Non_Self_Closing}},
+        if (i == size) {
+            throw docpp::invalid_argument("Invalid selector");
+        }
+
+        ++i;
+        return ret;
     };
-}
 
-std::pair<std::string, docpp::HTML::Type> docpp::HTML::resolve_tag(const Tag tag) {
-    const std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> tag_map{get_tag_map()};
+    std::vector<Compound> compounds{};
+    char combinator{0};
 
-    if (tag_map.find(tag) != tag_map.end()) {
-        return tag_map.at(tag);
-    }
+    skip_space();
 
-    const std::string throwmsg{"Invalid tag: " + std::to_string(static_cast<int>(tag))};
-    throw docpp::invalid_argument{throwmsg.c_str()};
-}
+    while (true) {
+        Compound compound{};
+        bool any{false};
 
-docpp::HTML::Tag docpp::HTML::resolve_tag(const std::string& tag) {
-    const std::unordered_map<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>> tag_map{get_tag_map()};
+        compound.combinator = combinator;
 
-    for (const std::pair<docpp::HTML::Tag, std::pair<std::string, docpp::HTML::Type>>& it : tag_map) {
-        if (!it.second.first.compare(tag)) {
-            return it.first;
+        if (i < size && selector[i] == '*') {
+            ++i;
+            any = true;
+        } else if (i < size && is_selector_name_char(selector[i])) {
+            compound.tag = Atom{read_lower_name()};
+            any = true;
         }
-    }
 
-    throw docpp::invalid_argument{"Invalid tag"};
-}
+        for (; i < size; any = true) {
+            if (selector[i] == '#') {
+                ++i;
+                compound.ids.push_back(read_name());
+            } else if (selector[i] == '.') {
+                ++i;
+                compound.classes.push_back(read_name());
+            } else if (selector[i] == '[') {
+                Attribute attribute{};
+
+                ++i;
+                skip_space();
+                attribute.key = Atom{read_lower_name()};
+                skip_space();
+
+                if (i < size && selector[i] == '=') {
+                    attribute.operation = selector[i++];
+                } else if (i + 1 < size && std::strchr("~|^$*", selector[i]) && selector[i + 1] == '=') {
+                    attribute.operation = selector[i];
+                    i += 2;
+                }
 
-void docpp::HTML::Section::set(const Tag tag, const Properties& properties) {
-    this->tag = resolve_tag(tag).first;
-    this->properties = properties;
+                if (attribute.operation) {
+                    skip_space();
+                    attribute.value = read_value();
+                    skip_space();
+                }
+
+                if (i == size || selector[i] != ']') {
+                    throw docpp::invalid_argument("Invalid selector");
+                }
+
+                ++i;
+                compound.attributes.push_back(std::move(attribute));
+            } else if (selector[i] == ':') {
+                ++i;
+
+                const std::string name{read_name()};
+
+                if (name == "first-child") {
+                    compound.first_child = true;
+                } else if (name == "last-child") {
+                    compound.last_child = true;
+                } else if (name == "only-child") {
+                    compound.first_child = true;
+                    compound.last_child = true;
+                } else if (name == "empty") {
+                    compound.empty = true;
+                } else {
+                    throw docpp::invalid_argument("Unsupported pseudo-class");
+                }
+            } else {
+                break;
+            }
+        }
+
+        if (!any) {
+            throw docpp::invalid_argument("Invalid selector");
+        }
+
+        compounds.push_back(std::move(compound));
+
+        const std::size_t end{i};
+
+        skip_space();
+
+        if (i == size || selector[i] == ',') {
+            this->selectors.push_back(std::move(compounds));
+            compounds.clear();
+            combinator = 0;
+
+            if (i == size) {
+                break;
+            }
+
+            ++i;
+            skip_space();
+        } else if (selector[i] == '>' || selector[i] == '+' || selector[i] == '~') {
+            combinator = selector[i++];
+            skip_space();
+        } else if (i > end) {
+            combinator = ' ';
+        } else {
+            throw docpp::invalid_argument("Invalid selector");
+        }
+    }
 }
 
-void docpp::HTML::Section::push_front(const Element& element) {
-    for (size_type i{this->index}; i > 0; i--) {
-        this->elements[i] = this->elements.at(i - 1);
+bool docpp::HTML::Selector::get_parent(const Ref& ref, Ref& parent) {
+    if (!ref.owner) {
+        return false;
     }
 
-    this->elements[0] = element;
-    this->index++;
+    parent = Ref{ref.owner->parent, docpp::HTML::Section::npos, ref.owner};
+    return true;
 }
 
-void docpp::HTML::Section::push_front(const Section& section) {
-    for (size_type i{this->index}; i > 0; i--) {
-        this->sections.at(i) = this->sections.at(i - 1);
+bool docpp::HTML::Selector::get_sibling(const Ref& ref, const bool previous, Ref& sibling) {
+    if (!ref.owner) {
+        return false;
     }
 
-    this->sections[0] = section;
-    this->index++;
-}
+    const std::vector<Section::Node, ArenaAllocator<Section::Node>>& nodes{ref.owner->nodes};
+    size_type position{ref.position == docpp::HTML::Section::npos ? ref.section->find_position() : ref.position};
 
-void docpp::HTML::Section::push_back(const Element& element) {
-    this->elements[this->index++] = element;
-}
+    while (previous ? position-- > 0 : ++position < nodes.size()) {
+        const Section::Node& node{nodes[position]};
 
-void docpp::HTML::Section::push_back(const Section& section) {
-    this->sections[this->index++] = section;
+        if (node.is_section()) {
+            sibling = Ref{ref.owner, position, &node.get_section()};
+            return true;
+        }
+
+        if (node.is_element() && is_tag_element(node.get_element())) {
+            sibling = Ref{ref.owner, position, nullptr};
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void docpp::HTML::Section::erase(const size_type index) {
-    bool erased{false};
+bool docpp::HTML::Selector::match_compound(const Compound& compound, const Ref& ref) {
+    const Element* element{ref.section ? nullptr : &ref.owner->nodes[ref.position].get_element()};
 
-    if (this->elements.find(index) != this->elements.end()) {
-        this->elements.erase(index);
-        erased = true;
-    } else if (this->sections.find(index) != this->sections.end()) {
-        this->sections.erase(index);
-        erased = true;
+    if (element && !is_tag_element(*element)) {
+        return false;
     }
 
-    if (!erased) {
-        throw docpp::out_of_range("Index out of range");
+    if (!compound.tag.empty() && compound.tag != (element ? element->get_tag_atom() : ref.section->get_tag_atom())) {
+        return false;
     }
-}
 
-void docpp::HTML::Section::erase(const Section& section) {
-    for (size_type i{0}; i < this->size(); i++) {
-        const Section it = this->get_sections().at(i);
+    static const Atom id{"id"};
+    static const Atom name{"class"};
+    const Properties& properties{element ? element->get_properties() : ref.section->get_properties()};
 
-        if (it.get() == section.get()) {
-            this->erase(i);
-            return;
+    for (const std::string& it : compound.ids) {
+        const String* value{find_value(properties, id)};
+
+        if (!value || *value != it) {
+            return false;
         }
     }
 
-    throw docpp::out_of_range("Section not found");
-}
-
-void docpp::HTML::Section::erase(const Element& element) {
-    for (size_type i{0}; i < this->size(); i++) {
-        const Element it = this->get_elements().at(i);
+    if (!compound.classes.empty()) {
+        const String* value{find_value(properties, name)};
 
-        if (it.get() == element.get()) {
-            this->erase(i);
-            return;
+        for (const std::string& it : compound.classes) {
+            if (!value || !has_word(*value, it)) {
+                return false;
+            }
         }
     }
 
-    throw docpp::out_of_range("Element not found");
-}
+    for (const Attribute& it : compound.attributes) {
+        const String* value{find_value(properties, it.key)};
 
-void docpp::HTML::Section::insert(const size_type index, const Element& element) {
-    if (this->sections.find(index) != this->sections.end()) {
-        throw docpp::invalid_argument("Index already occupied by a section");
-    } else {
-        this->elements[index] = element;
+        if (!value) {
+            return false;
+        }
+
+        const std::string& expected{it.value};
+        bool matches{true};
+
+        switch (it.operation) {
+            case '=':
+                matches = *value == expected;
+                break;
+            case '~':
+                matches = has_word(*value, expected);
+                break;
+            case '|':
+                matches = !value->compare(0, expected.size(), expected) && (value->size() == expected.size() || (*value)[expected.size()] == '-');
+                break;
+            case '^':
+                matches = !expected.empty() && !value->compare(0, expected.size(), expected);
+                break;
+            case '$':
+                matches = !expected.empty() && value->size() >= expected.size() && !value->compare(value->size() - expected.size(), expected.size(), expected);
+                break;
+            case '*':
+                matches = !expected.empty() && value->find(expected) != std::string::npos;
+                break;
+            default:
+                break;
+        }
+
+        if (!matches) {
+            return false;
+        }
     }
 
-    this->index = std::max(this->index, index) + 1;
-}
+    Ref sibling{};
 
-void docpp::HTML::Section::insert(const size_type index, const Section& section) {
-    this->sections[index] = section;
-    this->index = std::max(this->index, index) + 1;
-}
+    if ((compound.first_child && get_sibling(ref, true, sibling)) || (compound.last_child && get_sibling(ref, false, sibling))) {
+        return false;
+    }
 
-docpp::HTML::Element docpp::HTML::Section::at(const size_type index) const {
-    if (this->elements.find(index) != this->elements.end()) {
-        return this->elements.at(index);
+    if (compound.empty && (element ? !element->get_data().empty() : ref.section->children().begin() != ref.section->children().end())) {
+        return false;
     }
 
-    throw docpp::out_of_range("Index out of range");
+    return true;
 }
 
-docpp::HTML::Section docpp::HTML::Section::at_section(const size_type index) const {
-    if (this->sections.find(index) != this->sections.end()) {
-        return this->sections.at(index);
+bool docpp::HTML::Selector::match_relatives(const std::vector<Compound>& compounds, const size_type index, const Ref& ref) {
+    if (index == 0) {
+        return true;
     }
 
-    throw docpp::out_of_range("Index out of range");
-}
+    const Compound& compound{compounds[index - 1]};
+    Ref current{ref};
+    Ref relative{};
+
+    switch (compounds[index].combinator) {
+        case '>':
+            return get_parent(ref, relative) && match_compound(compound, relative) && match_relatives(compounds, index - 1, relative);
+        case '+':
+            return get_sibling(ref, true, relative) && match_compound(compound, relative) && match_relatives(compounds, index - 1, relative);
+        case '~':
+            for (; get_sibling(current, true, relative); current = relative) {
+                if (match_compound(compound, relative) && match_relatives(compounds, index - 1, relative)) {
+                    return true;
+                }
+            }
 
-docpp::HTML::Section::size_type docpp::HTML::Section::find(const Element& element) {
-    for (size_type i{0}; i < this->size(); i++) {
-        const Element it = this->get_elements().at(i);
+            return false;
+        default:
+            for (; get_parent(current, relative); current = relative) {
+                if (match_compound(compound, relative) && match_relatives(compounds, index - 1, relative)) {
+                    return true;
+                }
+            }
 
-        if (it.get() == element.get()) {
-            return i;
-        }
+            return false;
     }
-
-    return docpp::HTML::Section::npos;
 }
 
-docpp::HTML::Section::size_type docpp::HTML::Section::find(const Section& section) {
-    for (size_type i{0}; i < this->size(); i++) {
-        const Section it = this->get_sections().at(i);
+bool docpp::HTML::Selector::match(const Section& owner, const size_type position) const {
+    const Section::Node& node{owner.nodes[position]};
+    const Ref ref{&owner, position, node.is_section() ? &node.get_section() : nullptr};
 
-        if (it.get() == section.get()) {
-            return i;
+    for (const std::vector<Compound>& it : this->selectors) {
+        if (match_compound(it.back(), ref) && match_relatives(it, it.size() - 1, ref)) {
+            return true;
         }
     }
 
-    return docpp::HTML::Section::npos;
+    return false;
 }
 
-docpp::HTML::Section::size_type docpp::HTML::Section::find(const std::string& str) {
-    const std::vector<docpp::HTML::Element> elements{this->get_elements()};
+namespace docpp {
+    namespace CSS {
+        namespace {
+            bool is_digit(const char c) {
+                return c >= '0' && c <= '9';
+            }
 
-    for (size_type i{0}; i < this->size(); i++) {
-        if (elements.size() <= i) {
-            break;
-        }
+            bool is_hex(const char c) {
+                return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+            }
 
-        if (elements.at(i).get().find(str) != docpp::HTML::Section::npos) {
-            return i;
-        }
-    }
+            char to_lower(const char c) {
+                return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+
+            /**
+             * @brief Check if a character can be part of an identifier, a number or a unit
+             */
+            bool is_name_char(const char c) {
+                return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) || c == '-' || c == '_' || static_cast<unsigned char>(c) >= 0x80;
+            }
 
-    const std::vector<docpp::HTML::Section> sections{this->get_sections()};
+            bool equal_lower(const char* data, const std::size_t size, const char* lower) {
+                const std::size_t length{std::strlen(lower)};
 
-    for (size_type i{0}; i < this->size(); i++) {
-        if (elements.size() <= i) {
-            break;
-        }
+                if (size != length) {
+                    return false;
+                }
 
-        if (elements.at(i).get().find(str) != docpp::HTML::Section::npos) {
-            return i;
-        }
-    }
+                for (std::size_t i{0}; i < size; ++i) {
+                    if (to_lower(data[i]) != lower[i]) {
+                        return false;
+                    }
+                }
 
-    return docpp::HTML::Section::npos;
-}
+                return true;
+            }
 
-docpp::HTML::Element docpp::HTML::Section::front() const {
-    if (this->elements.find(0) != this->elements.end()) {
-        return this->elements.at(0);
-    }
+            bool is_length_unit(const char* unit, const std::size_t size) {
+                static const char* const units[]{"px", "em", "rem", "ex", "ch", "vw", "vh", "vmin", "vmax", "cm", "mm", "q", "in", "pt", "pc"};
 
-    throw docpp::out_of_range("Index out of range");
-}
+                for (const char* it : units) {
+                    if (equal_lower(unit, size, it)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            /**
+             * @brief Get the index after the string that starts at an index
+             */
+            std::size_t skip_string(const std::string& str, std::size_t i) {
+                const char quote{str[i]};
+
+                for (++i; i < str.size(); ++i) {
+                    if (str[i] == '\\') {
+                        ++i;
+                    } else if (str[i] == quote) {
+                        return i + 1;
+                    }
+                }
+
+                return str.size();
+            }
+
+            /**
+             * @brief Append a selector to a string with runs of whitespace collapsed, and the whitespace around combinators, commas and parentheses removed
+             */
+            void append_minified_selector(std::string& out, const std::string& selector) {
+                bool space{false};
+                bool joined{true};
+                int bracket{0};
+
+                for (std::size_t i{0}; i < selector.size();) {
+                    const char c{selector[i]};
+
+                    if (is_space(c)) {
+                        space = true;
+                        ++i;
+                        continue;
+                    }
+
+                    const bool combinator{bracket == 0 && (c == '>' || c == '+' || c == '~' || c == ',')};
+
+                    if (space && !joined && !combinator && c != ')') {
+                        out += ' ';
+                    }
+
+                    space = false;
+
+                    if (c == '"' || c == '\'') {
+                        const std::size_t end{skip_string(selector, i)};
+
+                        out.append(selector, i, end - i);
+                        joined = false;
+                        i = end;
+                        continue;
+                    }
+
+                    if (c == '\\') {
+                        // an escaped character is never a combinator, not even an escaped space
+                        out.append(selector, i, 2);
+                        joined = false;
+                        i += 2;
+                        continue;
+                    }
+
+                    if (c == '[') {
+                        ++bracket;
+                    } else if (c == ']' && bracket > 0) {
+                        --bracket;
+                    }
+
+                    out += c;
+                    joined = combinator || c == '(';
+                    ++i;
+                }
+            }
+
+            /**
+             * @brief Append a number and its unit to a string, without the zero before its decimal point, or as a bare zero if it is a zero length
+             * @return std::size_t The index after the number and its unit
+             */
+            std::size_t append_minified_number(std::string& out, const std::string& value, std::size_t i, const bool bare_zero) {
+                const std::size_t start{i};
+
+                if (value[i] == '+' || value[i] == '-') {
+                    ++i;
+                }
+
+                const std::size_t integer{i};
+                bool zero{true};
+
+                for (; i < value.size() && is_digit(value[i]); ++i) {
+                    zero = zero && value[i] == '0';
+                }
+
+                const std::size_t fraction{i};
+
+                if (i + 1 < value.size() && value[i] == '.' && is_digit(value[i + 1])) {
+                    for (++i; i < value.size() && is_digit(value[i]); ++i) {
+                        zero = zero && value[i] == '0';
+                    }
+                }
 
-docpp::HTML::Section docpp::HTML::Section::front_section() const {
-    if (this->sections.find(0) != this->sections.end()) {
-        return this->sections.at(0);
-    }
+                const std::size_t unit{i};
 
-    throw docpp::out_of_range("Index out of range");
-}
+                if (i < value.size() && value[i] == '%') {
+                    ++i;
+                } else {
+                    for (; i < value.size() && ((value[i] >= 'a' && value[i] <= 'z') || (value[i] >= 'A' && value[i] <= 'Z')); ++i);
+                }
 
-docpp::HTML::Element docpp::HTML::Section::back() const {
-    if (this->elements.find(this->index - 1) != this->elements.end()) {
-        return this->elements.at(this->index - 1);
-    }
+                if (i < value.size() && is_name_char(value[i])) {
+                    // not a plain number, such as an exponent or a name with a leading digit
+                    for (; i < value.size() && is_name_char(value[i]); ++i);
 
-    throw docpp::out_of_range("Index out of range");
-}
+                    out.append(value, start, i - start);
+                    return i;
+                }
 
-docpp::HTML::Section docpp::HTML::Section::back_section() const {
-    if (this->sections.find(this->index - 1) != this->sections.end()) {
-        return this->sections.at(this->index - 1);
-    }
+                if (zero && bare_zero && is_length_unit(value.data() + unit, i - unit)) {
+                    out += '0';
+                    return i;
+                }
 
-    throw docpp::out_of_range("Index out of range");
-}
+                out.append(value, start, integer - start);
 
-docpp::HTML::Section::size_type docpp::HTML::Section::size() const {
-    return this->index;
-}
+                if (fraction == integer + 1 && value[integer] == '0' && unit > fraction) {
+                    out.append(value, fraction, i - fraction);
+                } else {
+                    out.append(value, integer, i - integer);
+                }
 
-void docpp::HTML::Section::clear() {
-    this->tag.clear();
-    this->properties.clear();
-    this->elements.clear();
-    this->sections.clear();
-    this->index = 0;
-}
+                return i;
+            }
 
-bool docpp::HTML::Section::empty() const {
-    return this->index == 0;
-}
+            /**
+             * @brief Append the value of a declaration to a string with optional whitespace removed, and colors and numbers shortened
+             */
+            void append_minified_value(std::string& out, const std::string& key, const std::string& value) {
+                // custom properties are substituted as written, so even their whitespace may matter
+                if (key.size() >= 2 && key[0] == '-' && key[1] == '-') {
+                    out += value;
+                    return;
+                }
 
-std::vector<docpp::HTML::Element> docpp::HTML::Section::get_elements() const {
-    std::vector<docpp::HTML::Element> ret{};
-    ret.reserve(this->index);
-    for (size_type i{0}; i < this->index; i++) {
-        if (this->elements.find(i) != this->elements.end()) {
-            ret.push_back(this->elements.at(i));
-        }
-    }
-    return ret;
-}
+                // "flex: 0" means something else than "flex: 0px"
+                const bool bare_zero{!equal_lower(key.data(), key.size(), "flex")};
+                int depth{0};
+                bool space{false};
+                char previous{0};
+
+                for (std::size_t i{0}; i < value.size();) {
+                    const char c{value[i]};
+
+                    if (is_space(c)) {
+                        space = true;
+                        ++i;
+                        continue;
+                    }
+
+                    if (space && previous != 0 && previous != ',' && previous != '(' && previous != '/' && previous != '!' && c != ',' && c != ')' && c != '/' && c != '!') {
+                        out += ' ';
+                    }
+
+                    space = false;
+
+                    if (c == '"' || c == '\'') {
+                        const std::size_t end{skip_string(value, i)};
+
+                        out.append(value, i, end - i);
+                        previous = c;
+                        i = end;
+                        continue;
+                    }
+
+                    if (c == '\\') {
+                        out.append(value, i, 2);
+                        previous = 'a';
+                        i += 2;
+                        continue;
+                    }
+
+                    if (is_digit(c) || ((c == '.' || c == '+' || c == '-') && i + 1 < value.size() && (is_digit(value[i + 1]) || (value[i + 1] == '.' && i + 2 < value.size() && is_digit(value[i + 2]))))) {
+                        // zero lengths inside calc() and similar functions must keep their unit
+                        i = append_minified_number(out, value, i, bare_zero && depth == 0);
+                        previous = '0';
+                        continue;
+                    }
+
+                    if (c == '#') {
+                        std::size_t end{i + 1};
+
+                        for (; end < value.size() && is_hex(value[end]); ++end);
+
+                        const std::size_t size{end - i - 1};
+                        bool pairs{(size == 6 || size == 8) && (end == value.size() || !is_name_char(value[end]))};
+
+                        for (std::size_t j{i + 1}; pairs && j < end; j += 2) {
+                            pairs = to_lower(value[j]) == to_lower(value[j + 1]);
+                        }
+
+                        if (pairs) {
+                            out += '#';
+
+                            for (std::size_t j{i + 1}; j < end; j += 2) {
+                                out += value[j];
+                            }
+                        } else {
+                            out.append(value, i, end - i);
+                        }
+
+                        previous = 'a';
+                        i = end;
+                        continue;
+                    }
+
+                    if (is_name_char(c)) {
+                        std::size_t end{i};
+
+                        for (; end < value.size() && is_name_char(value[end]); ++end);
+
+                        if (end < value.size() && value[end] == '(' && equal_lower(value.data() + i, end - i, "url")) {
+                            // a url is copied as written, a fragment like url(#aabbcc) is not a color
+                            for (++end; end < value.size() && value[end] != ')';) {
+                                end = value[end] == '"' || value[end] == '\'' ? skip_string(value, end) : end + (value[end] == '\\' ? 2 : 1);
+                            }
+
+                            end = std::min(end + 1, value.size());
+                            previous = ')';
+                        } else {
+                            previous = 'a';
+                        }
+
+                        out.append(value, i, end - i);
+                        i = end;
+                        continue;
+                    }
+
+                    if (c == '(') {
+                        ++depth;
+                    } else if (c == ')' && depth > 0) {
+                        --depth;
+                    }
+
+                    out += c;
+                    previous = c;
+                    ++i;
+                }
+            }
 
-std::vector<docpp::HTML::Section> docpp::HTML::Section::get_sections() const {
-    std::vector<docpp::HTML::Section> ret{};
-    ret.reserve(this->index);
+            /**
+             * @brief Write an element without optional whitespace and without the semicolon after its last declaration
+             */
+            void write_minified_element(Sink& sink, const Element& element) {
+                const std::vector<Property>& properties{element.get_properties()};
+                std::size_t last{properties.size()};
 
-    for (size_type i{0}; i < this->index; i++) {
-        if (this->sections.find(i) != this->sections.end()) {
-            ret.push_back(this->sections.at(i));
-        }
-    }
+                while (last > 0 && (properties[last - 1].get_key().empty() || properties[last - 1].get_value().empty())) {
+                    --last;
+                }
 
-    return ret;
-}
+                if (last == 0) {
+                    return;
+                }
 
-std::string docpp::HTML::Section::get(const Formatting formatting, const int tabc) const {
-    std::string ret{};
-    int tabcount{tabc};
+                // built in one reused buffer, so that the sink is called once per rule
+                thread_local std::string buffer{};
 
-    if (!this->tag.compare("")) {
-        --tabcount; // i guess this means the section only contains elements and sections, and isn't a tag itself
+                buffer.clear();
+                append_minified_selector(buffer, element.get_tag());
+                buffer += '{';
 
-        if (tabcount < -1) {
-            tabcount = -1; // will be incremented by 1, so it will be 0
-        }
-    }
+                for (std::size_t i{0}; i < last; ++i) {
+                    const std::string& key{properties[i].get_key()};
+                    const std::string& value{properties[i].get_value()};
 
-    if (formatting == docpp::HTML::Formatting::Pretty) {
-        for (size_type i{0}; i < tabcount; i++) {
-            ret += "\t";
-        }
-    }
+                    if (key.empty() || value.empty()) continue;
 
-    if (this->tag.compare("")) {
-        ret += "<" + this->tag;
+                    buffer += key;
+                    buffer += ':';
+                    append_minified_value(buffer, key, value);
 
-        for (const Property& it : this->properties.get_properties()) {
-            if (!it.get_key().compare("")) continue;
-            if (!it.get_value().compare("")) continue;
+                    if (i + 1 < last) {
+                        buffer += ';';
+                    }
+                }
 
-            ret += " " + it.get_key() + "=\"" + it.get_value() + "\"";
-        }
+                buffer += '}';
+                sink.write(buffer);
+            }
 
-        ret += ">";
+            /**
+             * @brief Get the name shared by a property and the shorthands and aliases that can set it, such as "margin" for "margin-top"
+             */
+            std::string get_family(const std::string& key) {
+                if (key.size() >= 2 && key[0] == '-' && key[1] == '-') {
+                    return key;
+                }
 
-        if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
-            ret += "\n";
-        }
-    }
+                std::size_t start{0};
 
-    for (size_type i{0}; i < this->index; i++) {
-        if (this->elements.find(i) != this->elements.end()) {
-            ret += this->elements.at(i).get(formatting, tabcount + 1);
-        } else if (this->sections.find(i) != this->sections.end()) {
-            ret += this->sections.at(i).get(formatting, tabcount + 1);
+                // -webkit-box-shadow and box-shadow set the same thing
+                if (!key.empty() && key[0] == '-') {
+                    start = key.find('-', 1);
+                    start = start == std::string::npos ? key.size() : start + 1;
+                }
 
-            if (formatting == docpp::HTML::Formatting::Pretty || formatting == docpp::HTML::Formatting::Newline) {
-                ret += "\n";
-            }
-        }
-    }
+                std::size_t end{key.find('-', start)};
 
-    if (formatting == docpp::HTML::Formatting::Pretty) {
-        for (size_type i{0}; i < tabcount; i++) {
-            ret += "\t";
-        }
-    }
+                if (end == std::string::npos) {
+                    end = key.size();
+                }
 
-    ret += this->tag.compare("") ? ("</" + this->tag + ">") : "";
+                std::string family{};
 
-    return ret;
-}
+                for (std::size_t i{start}; i < end; ++i) {
+                    family += to_lower(key[i]);
+                }
 
-std::string docpp::HTML::Section::get_tag() const {
-    return this->tag;
-}
+                static const std::unordered_map<std::string, std::string> aliases{
+                    {"top", "inset"}, {"right", "inset"}, {"bottom", "inset"}, {"left", "inset"},
+                    {"width", "size"}, {"height", "size"}, {"min", "size"}, {"max", "size"}, {"inline", "size"}, {"block", "size"},
+                    {"line", "font"},
+                    {"gap", "grid"}, {"row", "grid"}, {"column", "grid"}, {"columns", "grid"},
+                    {"align", "place"}, {"justify", "place"},
+                    {"word", "overflow"},
+                    {"white", "text"},
+                    {"page", "break"},
+                };
 
-docpp::HTML::Properties docpp::HTML::Section::get_properties() const {
-    return this->properties;
-}
+                const auto alias = aliases.find(family);
 
-void docpp::HTML::Section::swap(const size_type index1, const size_type index2) {
-    if (this->elements.find(index1) != this->elements.end() && this->elements.find(index2) != this->elements.end()) {
-        std::swap(this->elements[index1], this->elements[index2]);
-    } else if (this->sections.find(index1) != this->sections.end() && this->sections.find(index2) != this->sections.end()) {
-        std::swap(this->sections[index1], this->sections[index2]);
-    } else {
-        throw docpp::out_of_range("Index out of range");
-    }
-}
+                return alias == aliases.end() ? family : alias->second;
+            }
 
-void docpp::HTML::Section::swap(const Element& element1, const Element& element2) {
-    this->swap(this->find(element1), this->find(element2));
-}
+            bool is_important(const std::string& value) {
+                const std::size_t bang{value.rfind('!')};
 
-void docpp::HTML::Section::swap(const Section& section1, const Section& section2) {
-    this->swap(this->find(section1), this->find(section2));
-}
+                if (bang == std::string::npos) {
+                    return false;
+                }
 
-std::string docpp::HTML::Document::get(const Formatting formatting, const int tabc) const {
-    return this->doctype + (formatting == Formatting::Pretty ? "\n" : formatting == Formatting::Newline ? "\n" : "") + this->document.get(formatting, tabc);
-}
+                std::size_t start{bang + 1};
+                std::size_t end{value.size()};
 
-docpp::HTML::Section& docpp::HTML::Document::get_section() {
-    return this->document;
-}
+                for (; start < end && is_space(value[start]); ++start);
+                for (; end > start && is_space(value[end - 1]); --end);
 
-void docpp::HTML::Document::set(const docpp::HTML::Section& document) {
-    this->document = document;
-}
+                return equal_lower(value.data() + start, end - start, "important");
+            }
 
-docpp::HTML::Document::size_type docpp::HTML::Document::size() const {
-    return this->document.size();
-}
+            /**
+             * @brief Drop the declarations of a rule that a later declaration of the same property overrides
+             * @param element The rule
+             * @param seen Scratch space, reused between rules
+             */
+            void drop_overridden(Element& element, std::unordered_map<std::string, std::size_t>& seen) {
+                std::vector<Property> properties{};
+                std::size_t dropped{0};
 
-void docpp::HTML::Document::set_doctype(const std::string& doctype) {
-    this->doctype = doctype;
-}
+                properties.reserve(element.size());
+                seen.clear();
 
-void docpp::HTML::Document::clear() {
-    this->doctype.clear();
-    this->document.clear();
-}
+                for (Property& it : element) {
+                    if (it.get_key().empty() || it.get_value().empty()) continue;
 
-bool docpp::HTML::Document::empty() const {
-    return this->doctype.empty() && this->document.empty();
-}
+                    const auto found = seen.find(it.get_key());
 
-docpp::HTML::Document& docpp::HTML::Document::operator=(const docpp::HTML::Document& document) {
-    this->set(document.get());
-    this->set_doctype(document.get_doctype());
-    return *this;
-}
+                    if (found != seen.end()) {
+                        Property& previous{properties[found->second]};
+                        const std::string& value{it.get_value()};
 
-docpp::HTML::Document& docpp::HTML::Document::operator=(const docpp::HTML::Section& section) {
-    this->set(section);
-    return *this;
-}
+                        if (is_important(previous.get_value()) && !is_important(value)) {
+                            continue;
+                        }
 
-bool docpp::HTML::Document::operator==(const docpp::HTML::Document& document) const {
-    return this->get() == document.get();
-}
+                        // prefixed values and functions are how fallbacks for older browsers are written, so both are kept
+                        if (value == previous.get_value() || (value[0] != '-' && previous.get_value()[0] != '-' && value.find('(') == std::string::npos)) {
+                            previous.set_key(std::string{});
+                            ++dropped;
+                        }
 
-bool docpp::HTML::Document::operator==(const docpp::HTML::Section& section) const {
-    return this->document == section;
-}
+                        found->second = properties.size();
+                    } else {
+                        seen.emplace(it.get_key(), properties.size());
+                    }
 
-bool docpp::HTML::Document::operator!=(const docpp::HTML::Document& document) const {
-    return this->doctype != document.get_doctype() || this->document != document.document;
-}
+                    properties.push_back(std::move(it));
+                }
 
-bool docpp::HTML::Document::operator!=(const docpp::HTML::Section& section) const {
-    return this->document != section;
-}
+                if (dropped != 0) {
+                    properties.erase(std::remove_if(properties.begin(), properties.end(), [](const Property& property) {
+                        return property.get_key().empty();
+                    }), properties.end());
+                }
 
-std::string docpp::HTML::Document::get_doctype() const {
-    return this->doctype;
-}
+                element.set_properties(std::move(properties));
+            }
+        } // namespace
+    } // namespace CSS
+} // namespace docpp
 
-std::string docpp::CSS::Property::get_key() const {
+const std::string& docpp::CSS::Property::get_key() const {
     return this->property.first;
 }
 
-std::string docpp::CSS::Property::get_value() const {
+const std::string& docpp::CSS::Property::get_value() const {
     return this->property.second;
 }
 
-std::pair<std::string, std::string> docpp::CSS::Property::get() const {
+const std::pair<std::string, std::string>& docpp::CSS::Property::get() const {
     return this->property;
 }
 
@@ -1012,7 +6067,7 @@ void docpp::CSS::Property::set(const std::string& key, const std::string& value)
 }
 
 docpp::CSS::Property& docpp::CSS::Property::operator=(const docpp::CSS::Property& property) {
-    this->set(property.get().first, property.get().second);
+    this->property = property.property;
     return *this;
 }
 
@@ -1025,7 +6080,8 @@ bool docpp::CSS::Property::operator!=(const docpp::CSS::Property& property) cons
 }
 
 docpp::CSS::Element& docpp::CSS::Element::operator=(const docpp::CSS::Element& element) {
-    this->set(element.get_tag(), element.get_properties());
+    this->element = element.element;
+    this->type = element.type;
     return *this;
 }
 
@@ -1034,7 +6090,12 @@ docpp::CSS::Element& docpp::CSS::Element::operator+=(const Property& property) {
     return *this;
 }
 
-docpp::CSS::Property docpp::CSS::Element::operator[](const size_type& index) const {
+docpp::CSS::Element& docpp::CSS::Element::operator+=(Property&& property) {
+    this->push_back(std::move(property));
+    return *this;
+}
+
+const docpp::CSS::Property& docpp::CSS::Element::operator[](const size_type& index) const {
     return this->at(index);
 }
 
@@ -1049,6 +6110,7 @@ bool docpp::CSS::Element::operator!=(const docpp::CSS::Element& element) const {
 void docpp::CSS::Element::set(const std::string& tag, const std::vector<Property>& properties) {
     this->element.first = tag;
     this->element.second = properties;
+    this->type = Type::Rule;
 }
 
 void docpp::CSS::Element::set_tag(const std::string& tag) {
@@ -1059,18 +6121,34 @@ void docpp::CSS::Element::set_tag(const HTML::Tag tag) {
     this->element.first = resolve_tag(tag).first;
 }
 
+void docpp::CSS::Element::set_type(const Type type) {
+    this->type = type;
+}
+
 void docpp::CSS::Element::set_properties(const std::vector<Property>& properties) {
     this->element.second = properties;
 }
 
+void docpp::CSS::Element::set_properties(std::vector<Property>&& properties) {
+    this->element.second = std::move(properties);
+}
+
 void docpp::CSS::Element::push_front(const Property& property) {
     this->element.second.insert(this->element.second.begin(), property);
 }
 
+void docpp::CSS::Element::push_front(Property&& property) {
+    this->element.second.insert(this->element.second.begin(), std::move(property));
+}
+
 void docpp::CSS::Element::push_back(const Property& property) {
     this->element.second.push_back(property);
 }
 
+void docpp::CSS::Element::push_back(Property&& property) {
+    this->element.second.push_back(std::move(property));
+}
+
 void docpp::CSS::Element::insert(const size_type index, const Property& property) {
     if (index < 0 || index >= this->element.second.size()) {
         throw docpp::out_of_range("Index out of range");
@@ -1079,6 +6157,14 @@ void docpp::CSS::Element::insert(const size_type index, const Property& property
     this->element.second.insert(this->element.second.begin() + index, property);
 }
 
+void docpp::CSS::Element::insert(const size_type index, Property&& property) {
+    if (index >= this->element.second.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    this->element.second.insert(this->element.second.begin() + index, std::move(property));
+}
+
 void docpp::CSS::Element::erase(const size_type index) {
     if (index < 0 || index >= this->element.second.size()) {
         throw docpp::out_of_range("Index out of range");
@@ -1087,7 +6173,7 @@ void docpp::CSS::Element::erase(const size_type index) {
     this->element.second.erase(this->element.second.begin() + index);
 }
 
-docpp::CSS::Property docpp::CSS::Element::at(const size_type index) const {
+const docpp::CSS::Property& docpp::CSS::Element::at(const size_type index) const {
     if (index < 0 || index >= this->element.second.size()) {
         throw docpp::out_of_range("Index out of range");
     }
@@ -1115,11 +6201,19 @@ docpp::CSS::Element::size_type docpp::CSS::Element::find(const std::string& str)
     return docpp::CSS::Element::npos;
 }
 
-docpp::CSS::Property docpp::CSS::Element::front() const {
+const docpp::CSS::Property& docpp::CSS::Element::front() const {
+    if (this->element.second.empty()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
     return this->element.second.front();
 }
 
-docpp::CSS::Property docpp::CSS::Element::back() const {
+const docpp::CSS::Property& docpp::CSS::Element::back() const {
+    if (this->element.second.empty()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
     return this->element.second.back();
 }
 
@@ -1134,6 +6228,7 @@ bool docpp::CSS::Element::empty() const {
 void docpp::CSS::Element::clear() {
     this->element.first.clear();
     this->element.second.clear();
+    this->type = Type::Rule;
 }
 
 void docpp::CSS::Element::swap(const size_type index1, const size_type index2) {
@@ -1151,57 +6246,101 @@ void docpp::CSS::Element::swap(const Property& property1, const Property& proper
 std::string docpp::CSS::Element::get(const Formatting formatting, const int tabc) const {
     std::string ret{};
 
-    if (this->element.first.compare("")) {
+    ret.reserve(this->serialized_size(formatting, tabc));
+    this->get_into(ret, formatting, tabc);
+
+    return ret;
+}
+
+docpp::CSS::Element::size_type docpp::CSS::Element::serialized_size(const Formatting formatting, const int tabc) const {
+    CountingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.size();
+}
+
+void docpp::CSS::Element::get_into(std::string& out, const Formatting formatting, const int tabc) const {
+    StringSink sink{out};
+
+    this->write_to(sink, formatting, tabc);
+}
+
+void docpp::CSS::Element::write_to(Sink& sink, const Formatting formatting, const int tabc) const {
+    if (this->element.first.empty()) {
+        return;
+    }
+
+    if (this->type == Type::Verbatim) {
         if (formatting == docpp::CSS::Formatting::Pretty) {
-            for (size_type i{0}; i < tabc; i++) {
-                ret += "\t";
-            }
+            write_tabs(sink, tabc);
         }
 
-        ret += this->element.first + " {";
+        sink.write(this->element.first);
 
         if (formatting == docpp::CSS::Formatting::Pretty || formatting == docpp::CSS::Formatting::Newline) {
-            ret += "\n";
+            sink.write("\n", 1);
         }
 
-        for (const Property& it : this->element.second) {
-            if (!it.get_key().compare("")) continue;
-            if (!it.get_value().compare("")) continue;
+        return;
+    }
 
-            if (formatting == docpp::CSS::Formatting::Pretty) {
-                for (size_type i{0}; i < tabc + 1; i++) {
-                    ret += "\t";
-                }
-            }
+    if (formatting == docpp::CSS::Formatting::Minified) {
+        write_minified_element(sink, *this);
+        return;
+    }
 
-            ret += it.get_key() + ": " + it.get_value() + ";";
+    if (formatting == docpp::CSS::Formatting::Pretty) {
+        write_tabs(sink, tabc);
+    }
 
-            if (formatting == docpp::CSS::Formatting::Pretty || formatting == docpp::CSS::Formatting::Newline) {
-                ret += "\n";
-            }
-        }
+    sink.write(this->element.first);
+    sink.write(" {", 2);
+
+    if (formatting == docpp::CSS::Formatting::Pretty || formatting == docpp::CSS::Formatting::Newline) {
+        sink.write("\n", 1);
+    }
+
+    for (const Property& it : this->element.second) {
+        const std::string& key{it.get_key()};
+        const std::string& value{it.get_value()};
+
+        if (key.empty() || value.empty()) continue;
 
         if (formatting == docpp::CSS::Formatting::Pretty) {
-            for (size_type i{0}; i < tabc; i++) {
-                ret += "\t";
-            }
+            write_tabs(sink, tabc + 1);
         }
 
-        ret += "}";
+        sink.write(key);
+        sink.write(": ", 2);
+        sink.write(value);
+        sink.write(";", 1);
 
         if (formatting == docpp::CSS::Formatting::Pretty || formatting == docpp::CSS::Formatting::Newline) {
-            ret += "\n";
+            sink.write("\n", 1);
         }
     }
 
-    return ret;
+    if (formatting == docpp::CSS::Formatting::Pretty) {
+        write_tabs(sink, tabc);
+    }
+
+    sink.write("}", 1);
+
+    if (formatting == docpp::CSS::Formatting::Pretty || formatting == docpp::CSS::Formatting::Newline) {
+        sink.write("\n", 1);
+    }
 }
 
-std::string docpp::CSS::Element::get_tag() const {
+const std::string& docpp::CSS::Element::get_tag() const {
     return this->element.first;
 }
 
-std::vector<docpp::CSS::Property> docpp::CSS::Element::get_properties() const {
+docpp::CSS::Type docpp::CSS::Element::get_type() const {
+    return this->type;
+}
+
+const std::vector<docpp::CSS::Property>& docpp::CSS::Element::get_properties() const {
     return this->element.second;
 }
 
@@ -1209,14 +6348,26 @@ void docpp::CSS::Stylesheet::set(const std::vector<Element>& elements) {
     this->elements = elements;
 }
 
+void docpp::CSS::Stylesheet::set(std::vector<Element>&& elements) {
+    this->elements = std::move(elements);
+}
+
 void docpp::CSS::Stylesheet::push_front(const Element& element) {
     this->elements.insert(this->elements.begin(), element);
 }
 
+void docpp::CSS::Stylesheet::push_front(Element&& element) {
+    this->elements.insert(this->elements.begin(), std::move(element));
+}
+
 void docpp::CSS::Stylesheet::push_back(const Element& element) {
     this->elements.push_back(element);
 }
 
+void docpp::CSS::Stylesheet::push_back(Element&& element) {
+    this->elements.push_back(std::move(element));
+}
+
 void docpp::CSS::Stylesheet::insert(const size_type index, const Element& element) {
     if (index < 0 || index >= this->elements.size()) {
         throw docpp::out_of_range("Index out of range");
@@ -1225,6 +6376,14 @@ void docpp::CSS::Stylesheet::insert(const size_type index, const Element& elemen
     this->elements.insert(this->elements.begin() + index, element);
 }
 
+void docpp::CSS::Stylesheet::insert(const size_type index, Element&& element) {
+    if (index >= this->elements.size()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
+    this->elements.insert(this->elements.begin() + index, std::move(element));
+}
+
 void docpp::CSS::Stylesheet::erase(const size_type index) {
     if (index < 0 || index >= this->elements.size()) {
         throw docpp::out_of_range("Index out of range");
@@ -1234,7 +6393,7 @@ void docpp::CSS::Stylesheet::erase(const size_type index) {
 }
 
 docpp::CSS::Stylesheet& docpp::CSS::Stylesheet::operator=(const docpp::CSS::Stylesheet& stylesheet) {
-    this->set(stylesheet.get_elements());
+    this->elements = stylesheet.elements;
     return *this;
 }
 
@@ -1243,19 +6402,24 @@ docpp::CSS::Stylesheet& docpp::CSS::Stylesheet::operator+=(const Element& elemen
     return *this;
 }
 
-docpp::CSS::Element docpp::CSS::Stylesheet::operator[](const int& index) const {
+docpp::CSS::Stylesheet& docpp::CSS::Stylesheet::operator+=(Element&& element) {
+    this->push_back(std::move(element));
+    return *this;
+}
+
+const docpp::CSS::Element& docpp::CSS::Stylesheet::operator[](const int& index) const {
     return this->at(index);
 }
 
 bool docpp::CSS::Stylesheet::operator==(const docpp::CSS::Stylesheet& stylesheet) const {
-    return this->get_elements() == stylesheet.get_elements();
+    return this->elements == stylesheet.elements;
 }
 
 bool docpp::CSS::Stylesheet::operator!=(const docpp::CSS::Stylesheet& stylesheet) const {
-    return this->get_elements() != stylesheet.get_elements();
+    return this->elements != stylesheet.elements;
 }
 
-docpp::CSS::Element docpp::CSS::Stylesheet::at(const size_type index) const {
+const docpp::CSS::Element& docpp::CSS::Stylesheet::at(const size_type index) const {
     if (index < 0 || index >= this->elements.size()) {
         throw docpp::out_of_range("Index out of range");
     }
@@ -1295,11 +6459,19 @@ void docpp::CSS::Stylesheet::clear() {
     this->elements.clear();
 }
 
-docpp::CSS::Element docpp::CSS::Stylesheet::front() const {
+const docpp::CSS::Element& docpp::CSS::Stylesheet::front() const {
+    if (this->elements.empty()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
     return this->elements.front();
 }
 
-docpp::CSS::Element docpp::CSS::Stylesheet::back() const {
+const docpp::CSS::Element& docpp::CSS::Stylesheet::back() const {
+    if (this->elements.empty()) {
+        throw docpp::out_of_range("Index out of range");
+    }
+
     return this->elements.back();
 }
 
@@ -1315,18 +6487,397 @@ void docpp::CSS::Stylesheet::swap(const Element& element1, const Element& elemen
     this->swap(this->find(element1), this->find(element2));
 }
 
-std::vector<docpp::CSS::Element> docpp::CSS::Stylesheet::get_elements() const {
+const std::vector<docpp::CSS::Element>& docpp::CSS::Stylesheet::get_elements() const {
     return this->elements;
 }
 
+void docpp::CSS::Stylesheet::optimize() {
+    std::vector<Element> rules{};
+    std::unordered_map<std::string, size_type> targets{};
+    std::unordered_map<std::string, size_type> last{};
+    std::vector<std::string> families{};
+    std::string selector{};
+    size_type last_any{0};
+
+    rules.reserve(this->elements.size());
+
+    for (Element& element : this->elements) {
+        if (element.get_tag().empty()) continue;
+
+        // at-rules such as @font-face are not cascaded by selector, so several of them are not the same as one
+        if (element.get_tag()[0] == '@' || element.get_type() == Type::Verbatim) {
+            // a verbatim rule such as @media may set any property of any selector, so no rule is moved across it
+            if (element.get_type() == Type::Verbatim) {
+                targets.clear();
+            }
+
+            rules.push_back(std::move(element));
+            continue;
+        }
+
+        selector.clear();
+        append_minified_selector(selector, element.get_tag());
+        families.clear();
+
+        for (const Property& it : element.get_properties()) {
+            families.push_back(get_family(it.get_key()));
+        }
+
+        // moving the declarations up to the earlier rule is only safe if no rule in between sets any of the same properties
+        const auto target = targets.find(selector);
+        bool merge{target != targets.end()};
+
+        if (merge) {
+            const size_type position{target->second};
+            const auto all = last.find("all");
+
+            merge = all == last.end() || all->second <= position;
+
+            for (std::size_t i{0}; merge && i < families.size(); ++i) {
+                const auto found = last.find(families[i]);
+
+                merge = (found == last.end() || found->second <= position) && (families[i] != "all" || last_any <= position);
+            }
+        }
+
+        size_type index{rules.size()};
+
+        if (merge) {
+            index = target->second;
+
+            for (Property& it : element) {
+                rules[index].push_back(std::move(it));
+            }
+        } else {
+            targets[selector] = index;
+            rules.push_back(std::move(element));
+        }
+
+        for (const std::string& family : families) {
+            size_type& position{last[family]};
+            position = std::max(position, index);
+        }
+
+        if (!families.empty()) {
+            last_any = std::max(last_any, index);
+        }
+    }
+
+    std::unordered_map<std::string, std::size_t> seen{};
+
+    this->elements.clear();
+
+    for (Element& rule : rules) {
+        if (rule.get_tag()[0] != '@' && rule.get_type() != Type::Verbatim) {
+            drop_overridden(rule, seen);
+
+            if (rule.empty()) continue;
+        }
+
+        this->elements.push_back(std::move(rule));
+    }
+}
+
 std::string docpp::CSS::Stylesheet::get(const Formatting formatting, const int tabc) const {
     std::string ret{};
 
+    ret.reserve(this->serialized_size(formatting, tabc));
+    this->get_into(ret, formatting, tabc);
+
+    return ret;
+}
+
+docpp::CSS::Stylesheet::size_type docpp::CSS::Stylesheet::serialized_size(const Formatting formatting, const int tabc) const {
+    CountingSink sink{};
+
+    this->write_to(sink, formatting, tabc);
+
+    return sink.size();
+}
+
+void docpp::CSS::Stylesheet::get_into(std::string& out, const Formatting formatting, const int tabc) const {
+    StringSink sink{out};
+
+    this->write_to(sink, formatting, tabc);
+}
+
+void docpp::CSS::Stylesheet::write_to(Sink& sink, const Formatting formatting, const int tabc) const {
     for (const Element& it : this->elements) {
-        ret += it.get(formatting, tabc);
+        it.write_to(sink, formatting, tabc);
     }
+}
 
-    return ret;
+namespace docpp {
+    namespace CSS {
+        namespace {
+            /**
+             * @brief Check if an at-rule holds declarations rather than nested rules, so that it can be represented by an element
+             */
+            bool is_declaration_at_rule(const std::string& selector) {
+                const std::size_t end{selector.find_first_of(" (")};
+                const std::string name{selector.substr(0, end)};
+
+                return name == "@font-face" || name == "@page" || name == "@property" || name == "@counter-style" || name == "@font-palette-values" || name == "@viewport";
+            }
+
+            bool is_stop(const char* stops, const char c) {
+                return c != '\0' && std::strchr(stops, c) != nullptr;
+            }
+
+            /**
+             * @brief Builds a stylesheet from CSS in a single pass, writing selectors, keys and values straight into the strings the stylesheet keeps
+             */
+            class Parser {
+                private:
+                    const std::string& css;
+                    std::size_t pos{0};
+                    Stylesheet stylesheet{};
+                    std::vector<Property> scratch{};
+
+                    bool at_comment() const {
+                        return this->css[this->pos] == '/' && this->pos + 1 < this->css.size() && this->css[this->pos + 1] == '*';
+                    }
+
+                    void skip_comment() {
+                        const std::size_t end{this->css.find("*/", this->pos + 2)};
+                        this->pos = end == std::string::npos ? this->css.size() : end + 2;
+                    }
+
+                    /**
+                     * @brief Skip whitespace and comments
+                     */
+                    void skip_space() {
+                        while (this->pos < this->css.size()) {
+                            if (is_space(this->css[this->pos])) {
+                                ++this->pos;
+                            } else if (this->at_comment()) {
+                                this->skip_comment();
+                            } else {
+                                break;
+                            }
+                        }
+                    }
+
+                    /**
+                     * @brief Skip a quoted string, appending it to out if out is not null
+                     */
+                    void read_string(std::string* out) {
+                        const std::size_t start{this->pos};
+                        const char quote{this->css[this->pos++]};
+
+                        while (this->pos < this->css.size() && this->css[this->pos] != quote) {
+                            this->pos += this->css[this->pos] == '\\' ? 2 : 1;
+                        }
+
+                        this->pos = std::min(this->pos + 1, this->css.size());
+
+                        if (out) {
+                            out->append(this->css, start, this->pos - start);
+                        }
+                    }
+
+                    /**
+                     * @brief Skip the rest of a block, including any nested blocks
+                     * @return int The number of blocks left open at the end of the input
+                     */
+                    int skip_block() {
+                        int depth{1};
+
+                        while (this->pos < this->css.size() && depth > 0) {
+                            const char c{this->css[this->pos]};
+
+                            if (c == '"' || c == '\'') {
+                                this->read_string(nullptr);
+                            } else if (this->at_comment()) {
+                                this->skip_comment();
+                            } else {
+                                if (c == '{') {
+                                    ++depth;
+                                } else if (c == '}') {
+                                    --depth;
+                                } else if (c == '\\') {
+                                    ++this->pos;
+                                }
+
+                                ++this->pos;
+                            }
+                        }
+
+                        this->pos = std::min(this->pos, this->css.size());
+
+                        return depth;
+                    }
+
+                    /**
+                     * @brief Read up to the first of stops outside of strings, parentheses and brackets. Comments and runs of whitespace
+                     * become a single space, and leading and trailing whitespace is dropped. The stop character is not consumed.
+                     * @return char The stop character, or 0 at the end of the input
+                     */
+                    char read(std::string& out, const char* stops) {
+                        int depth{0};
+                        bool space{false};
+
+                        while (this->pos < this->css.size()) {
+                            std::size_t end{this->pos};
+
+                            while (end < this->css.size()) {
+                                const char c{this->css[end]};
+
+                                if (is_space(c) || c == '/' || c == '"' || c == '\'' || c == '\\' || c == '(' || c == ')' || c == '[' || c == ']' || is_stop(stops, c)) {
+                                    break;
+                                }
+
+                                ++end;
+                            }
+
+                            if (end != this->pos) {
+                                if (space) {
+                                    out.push_back(' ');
+                                    space = false;
+                                }
+
+                                out.append(this->css, this->pos, end - this->pos);
+                                this->pos = end;
+
+                                if (this->pos == this->css.size()) {
+                                    break;
+                                }
+                            }
+
+                            const char c{this->css[this->pos]};
+
+                            if (depth == 0 && is_stop(stops, c)) {
+                                return c;
+                            } else if (is_space(c) || this->at_comment()) {
+                                if (c == '/') {
+                                    this->skip_comment();
+                                } else {
+                                    ++this->pos;
+                                }
+
+                                space = !out.empty();
+                                continue;
+                            }
+
+                            if (space) {
+                                out.push_back(' ');
+                                space = false;
+                            }
+
+                            if (c == '"' || c == '\'') {
+                                this->read_string(&out);
+                                continue;
+                            } else if (c == '\\') {
+                                out.append(this->css, this->pos, 2);
+                                this->pos = std::min(this->pos + 2, this->css.size());
+                                continue;
+                            } else if (c == '(' || c == '[') {
+                                ++depth;
+                            } else if ((c == ')' || c == ']') && depth > 0) {
+                                --depth;
+                            }
+
+                            out.push_back(c);
+                            ++this->pos;
+                        }
+
+                        return 0;
+                    }
+
+                    /**
+                     * @brief Read the declarations of a block up to and including its closing brace, into a vector sized to fit them
+                     */
+                    std::vector<Property> read_declarations() {
+                        this->scratch.clear();
+
+                        while (this->pos < this->css.size()) {
+                            std::string key{};
+                            const char stop{this->read(key, ":;{}")};
+
+                            if (stop == '}') {
+                                ++this->pos;
+                                break;
+                            } else if (stop == '{') {
+                                ++this->pos;
+                                this->skip_block();
+                                continue;
+                            } else if (stop != ':') {
+                                this->pos = std::min(this->pos + 1, this->css.size());
+                                continue;
+                            }
+
+                            ++this->pos;
+
+                            std::string value{};
+                            const char end{this->read(value, ";}")};
+
+                            if (!key.empty() && !value.empty()) {
+                                this->scratch.emplace_back(std::move(key), std::move(value));
+                            }
+
+                            if (end == ';') {
+                                ++this->pos;
+                            }
+                        }
+
+                        return std::vector<Property>(std::make_move_iterator(this->scratch.begin()), std::make_move_iterator(this->scratch.end()));
+                    }
+                public:
+                    explicit Parser(const std::string& css) : css(css) {}
+
+                    Stylesheet parse() {
+                        while (this->pos < this->css.size()) {
+                            this->skip_space();
+
+                            if (this->css.compare(this->pos, 4, "<!--") == 0) {
+                                this->pos += 4;
+                                continue;
+                            } else if (this->css.compare(this->pos, 3, "-->") == 0) {
+                                this->pos += 3;
+                                continue;
+                            }
+
+                            const std::size_t start{this->pos};
+                            std::string selector{};
+                            const char stop{this->read(selector, "{;}")};
+
+                            // at-rules that a stylesheet cannot represent are kept as written, up to the end of their statement or block
+                            const bool verbatim{!selector.empty() && selector[0] == '@' && (stop == ';' || (stop == '{' && !is_declaration_at_rule(selector)))};
+
+                            if (stop == 0) {
+                                break;
+                            }
+
+                            ++this->pos;
+
+                            if (verbatim) {
+                                const int open{stop == '{' ? this->skip_block() : 0};
+                                std::string text{this->css, start, this->pos - start};
+
+                                // like any other block, an unclosed one is closed at the end of the input
+                                text.append(static_cast<std::size_t>(open), '}');
+
+                                this->stylesheet.emplace_back(std::move(text), std::vector<Property>{}, Type::Verbatim);
+                                continue;
+                            } else if (stop != '{') {
+                                continue;
+                            } else if (selector.empty()) {
+                                this->skip_block();
+                                continue;
+                            }
+
+                            this->stylesheet.emplace_back(std::move(selector), this->read_declarations());
+                        }
+
+                        return std::move(this->stylesheet);
+                    }
+            };
+        } // namespace
+    } // namespace CSS
+} // namespace docpp
+
+docpp::CSS::Stylesheet docpp::CSS::parse(const std::string& css) {
+    return Parser{css}.parse();
 }
 
 std::tuple<int, int, int> docpp::version() {
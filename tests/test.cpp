@@ -1,7 +1,15 @@
 #include <string>
+#include <sstream>
+#include <cstdio>
 #include <unordered_map>
+#include <thread>
 #include <src/docpp.cpp>
+#ifdef DOCPP_CATCH2_V2
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#else
 #include <catch2/catch_test_macros.hpp>
+#endif
 
 inline namespace HTML {
     void test_tag() {
@@ -9,6 +17,30 @@ inline namespace HTML {
 
         for (const auto& it : expected_values) {
             REQUIRE((docpp::HTML::resolve_tag(it.first).first == it.second.first && docpp::HTML::resolve_tag(it.first).second == it.second.second));
+            REQUIRE(docpp::HTML::resolve_tag(docpp::HTML::resolve_tag(docpp::HTML::resolve_tag(it.first).first)).first == it.second.first);
+        }
+
+        REQUIRE(expected_values.size() == static_cast<std::size_t>(docpp::HTML::Tag::Xmp) + 1);
+
+        REQUIRE(docpp::HTML::resolve_tag("div") == docpp::HTML::Tag::Div);
+        REQUIRE(docpp::HTML::resolve_tag("blockquote") == docpp::HTML::Tag::Blockquote);
+        REQUIRE(docpp::HTML::resolve_tag("abbr") == docpp::HTML::Tag::Abbreviation);
+        REQUIRE(docpp::HTML::resolve_tag("a") == docpp::HTML::Tag::Anchor);
+        REQUIRE(docpp::HTML::resolve_tag("") == docpp::HTML::Tag::Empty);
+
+        for (const char* it : {"not-a-tag", "DIV", "di", "divv", "x"}) {
+            try {
+                docpp::HTML::resolve_tag(it);
+                REQUIRE(false);
+            } catch (const docpp::invalid_argument& e) {
+                REQUIRE(std::string(e.what()) == "Invalid tag");
+            }
+        }
+
+        try {
+            docpp::HTML::resolve_tag(static_cast<docpp::HTML::Tag>(-1));
+            REQUIRE(false);
+        } catch (const docpp::invalid_argument&) {
         }
     }
 
@@ -493,11 +525,85 @@ inline namespace HTML {
             REQUIRE(element.get<std::string>() == "</h1>");
         };
 
+        const auto test_escape = []() {
+            using namespace docpp::HTML;
+
+            REQUIRE(docpp::HTML::escape("") == "");
+            REQUIRE(docpp::HTML::escape("plain text") == "plain text");
+            REQUIRE(docpp::HTML::escape("a < b && c > d \"'") == "a &lt; b &amp;&amp; c &gt; d \"'");
+            REQUIRE(docpp::HTML::escape("a < b && c > d \"'", true) == "a < b &amp;&amp; c > d &quot;&#39;");
+
+            // long enough to go through the vector paths, with special characters at the block edges
+            std::string input{};
+            std::string expected{};
+            for (int i{0}; i < 100; i++) {
+                const char c{i % 15 == 0 ? '<' : (i % 31 == 0 ? '&' : static_cast<char>('a' + i % 26))};
+                input += c;
+                expected += c == '<' ? "&lt;" : (c == '&' ? "&amp;" : std::string(1, c));
+            }
+            input += "\xc3\xa9<";
+            expected += "\xc3\xa9&lt;";
+
+            REQUIRE(docpp::HTML::escape(input) == expected);
+
+            Element element{docpp::HTML::Tag::P, Properties{Property{"title", "\"quoted\" & <b>"}}, "<script>"};
+
+            REQUIRE(docpp::HTML::get_escape() == false);
+            REQUIRE(element.get_escape() == Escape::Default);
+            REQUIRE(element.get() == "<p title=\"\"quoted\" & <b>\"><script></p>");
+
+            element.set_escape(Escape::Always);
+
+            REQUIRE(element.get() == "<p title=\"&quot;quoted&quot; &amp; <b>\">&lt;script&gt;</p>");
+            REQUIRE(element.serialized_size() == element.get().size());
+            REQUIRE(Element{element}.get_escape() == Escape::Always);
+
+            Section section{docpp::HTML::Tag::Div, Properties{Property{"data-x", "'"}}};
+            section.push_back(Element{docpp::HTML::Tag::Span, {}, "a&b"});
+            section.push_back(Element{"", {}, "<raw>", docpp::HTML::Type::Text_No_Formatting});
+
+            Element verbatim{element};
+            verbatim.set_escape(Escape::Never);
+            section.push_back(verbatim);
+            section.set_caching(true);
+
+            REQUIRE(section.get() == "<div data-x=\"'\"><span>a&b</span><raw><p title=\"\"quoted\" & <b>\"><script></p></div>");
+
+            docpp::HTML::set_escape(true);
+
+            REQUIRE(section.get() == "<div data-x=\"&#39;\"><span>a&amp;b</span>&lt;raw&gt;<p title=\"\"quoted\" & <b>\"><script></p></div>");
+
+            docpp::HTML::set_escape(false);
+
+            REQUIRE(section.get() == "<div data-x=\"'\"><span>a&b</span><raw><p title=\"\"quoted\" & <b>\"><script></p></div>");
+
+            // the content of script and style is raw text, which entities would break, but their properties are still escaped
+            docpp::CSS::Stylesheet stylesheet{};
+            stylesheet.push_back(docpp::CSS::Element{"ul > li::before", {{docpp::CSS::Property{"content", "\"&\""}}}});
+
+            Element style{docpp::HTML::Tag::Style, {}, stylesheet.get()};
+            Element script{docpp::HTML::Tag::Script, Properties{Property{"data-x", "a&b"}}, "if (a < b && c > d) { f('x'); }"};
+            script.set_escape(Escape::Always);
+
+            Section raw{docpp::HTML::Tag::Script, {}};
+            raw.push_back(Element{"", {}, "x = \"<b>\";", docpp::HTML::Type::Text_No_Formatting});
+
+            docpp::HTML::set_escape(true);
+
+            REQUIRE(style.get() == "<style>" + stylesheet.get() + "</style>");
+            REQUIRE(script.get() == "<script data-x=\"a&amp;b\">if (a < b && c > d) { f('x'); }</script>");
+            REQUIRE(raw.get() == "<script>x = \"<b>\";</script>");
+            REQUIRE(style.serialized_size() == style.get().size());
+
+            docpp::HTML::set_escape(false);
+        };
+
         test_get_and_set();
         test_copy_element();
         test_operators();
         test_constructors();
         test_string_get();
+        test_escape();
     }
 
     void test_section() {
@@ -977,263 +1083,1858 @@ inline namespace HTML {
             REQUIRE(retrieved_elem3.get_data() == "data");
         };
 
-        const auto the_test_to_end_all_tests = []() {
+        const auto test_mixed_children = []() {
             using namespace docpp::HTML;
 
-            Section base_section{docpp::HTML::Tag::Html, {}};
+            Section section{docpp::HTML::Tag::Div, {}};
 
-            base_section.push_back(Element{docpp::HTML::Tag::H2, {}, "data"});
-            base_section.push_back(Element{docpp::HTML::Tag::H3, {}, "data"});
-            base_section.push_back(Element{docpp::HTML::Tag::H4, {}, "data"});
-            base_section.push_back(Element{docpp::HTML::Tag::H5, {}, "data"});
+            section.push_back(Element{docpp::HTML::Tag::P, {}, "first"});
+            section.push_back(Section{docpp::HTML::Tag::Span, {}, std::vector<Element>{Element{docpp::HTML::Tag::B, {}, "bold"}}});
+            section.push_back(Element{docpp::HTML::Tag::P, {}, "last"});
+            section.push_front(Section{docpp::HTML::Tag::Header, {}});
 
-            REQUIRE(base_section.get() == "<html><h2>data</h2><h3>data</h3><h4>data</h4><h5>data</h5></html>");
+            REQUIRE(section.size() == 4);
+            REQUIRE(section.get() == "<div><header></header><p>first</p><span><b>bold</b></span><p>last</p></div>");
+            REQUIRE(section.at_section(0).get_tag() == "header");
+            REQUIRE(section.at(1).get_data() == "first");
+            REQUIRE(section.at_section(2).get_tag() == "span");
+            REQUIRE(section.find(Element{docpp::HTML::Tag::P, {}, "last"}) == 3);
+            REQUIRE(section.find("bold") == 2);
 
-            Section section{docpp::HTML::Tag::Html, {}};
-            Section section_plus_plus{docpp::HTML::Tag::Html, {}};
+            section.erase(Element{docpp::HTML::Tag::P, {}, "first"});
 
-            // just... why? because i can, that's why
-            for (std::size_t i = 0; i < 10; ++i) {
-                Section _section{docpp::HTML::Tag::Div, {}};
+            REQUIRE(section.size() == 4);
+            REQUIRE(section.get() == "<div><header></header><span><b>bold</b></span><p>last</p></div>");
 
-                _section.push_back(Element{docpp::HTML::Tag::P, {}, "Data " + std::to_string(i)});
+            try {
+                section.at(1);
+                REQUIRE(false);
+            } catch (const docpp::out_of_range& e) {
+                REQUIRE(true);
+            }
 
-                section_plus_plus += _section;
-                section_plus_plus += section_plus_plus;
+            try {
+                section.insert(2, Element{docpp::HTML::Tag::P, {}, "data"});
+                REQUIRE(false);
+            } catch (const docpp::invalid_argument& e) {
+                REQUIRE(true);
+            }
 
-                REQUIRE(section_plus_plus.size() == (i + 1) * 2);
+            section.insert(1, Element{docpp::HTML::Tag::P, {}, "second"});
+            section.insert(5, Element{docpp::HTML::Tag::Footer, {}, "end"});
+
+            REQUIRE(section.size() == 6);
+            REQUIRE(section.get() == "<div><header></header><p>second</p><span><b>bold</b></span><p>last</p><footer>end</footer></div>");
+
+            std::string elements{};
+            for (const auto& it : section) {
+                elements += it.get_data();
             }
-        };
 
-        test_get_and_set();
-        test_copy_section();
-        test_operators();
-        test_constructors();
-        test_iterators();
-        test_find();
-        test_insert();
-        test_swap();
-        test_front_and_back();
-        test_size_empty_and_clear();
-        test_push_front_and_back();
-        test_string_get();
-        test_constructors();
-        test_handle_elements();
-        test_handle_sections();
-        the_test_to_end_all_tests();
-    }
+            REQUIRE(elements == "secondlastend");
+        };
 
-    void test_document() {
-        const auto test_get_and_set = []() {
+        const auto test_arena = []() {
             using namespace docpp::HTML;
 
-            Document document;
+            docpp::Arena arena{1024};
+            Section section{docpp::HTML::Tag::Div, Properties{Property{"class", "content"}}, arena};
+            Section heap_section{docpp::HTML::Tag::Div, Properties{Property{"class", "content"}}};
 
-            document.set(Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H1, {}, "data1"},
-                    Element{docpp::HTML::Tag::H2, {}, "data2"},
-                    Element{docpp::HTML::Tag::H3, {}, "data3"},
-                    Element{docpp::HTML::Tag::H4, {}, "data4"},
-                    Element{docpp::HTML::Tag::H5, {}, "data5"},
-                    Element{docpp::HTML::Tag::H6, {}, "data6"}
-                }
-            });
+            for (std::size_t i{0}; i < 32; i++) {
+                const Element element{docpp::HTML::Tag::P, Properties{Property{"id", "p" + std::to_string(i)}}, "Paragraph " + std::to_string(i)};
+                const Section child{docpp::HTML::Tag::Span, {}, std::vector<Element>{element}};
 
-            REQUIRE(document.get() == "<!DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
-            REQUIRE(document.get<std::string>() == "<!DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
-            REQUIRE(document.get<std::string>(docpp::HTML::Formatting::None) == "<!DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
-            REQUIRE(document.get<std::string>(docpp::HTML::Formatting::Pretty) == "<!DOCTYPE html>\n<html>\n\t<h1>data1</h1>\n\t<h2>data2</h2>\n\t<h3>data3</h3>\n\t<h4>data4</h4>\n\t<h5>data5</h5>\n\t<h6>data6</h6>\n</html>");
-            REQUIRE(document.get<std::string>(docpp::HTML::Formatting::Newline) == "<!DOCTYPE html>\n<html>\n<h1>data1</h1>\n<h2>data2</h2>\n<h3>data3</h3>\n<h4>data4</h4>\n<h5>data5</h5>\n<h6>data6</h6>\n</html>");
+                section.push_back(element);
+                section.push_back(child);
+                heap_section.push_back(element);
+                heap_section.push_back(child);
+            }
 
-            REQUIRE(document.get_doctype() == "<!DOCTYPE html>");
-            REQUIRE(document.get_section() == Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H1, {}, "data1"},
-                    Element{docpp::HTML::Tag::H2, {}, "data2"},
-                    Element{docpp::HTML::Tag::H3, {}, "data3"},
-                    Element{docpp::HTML::Tag::H4, {}, "data4"},
-                    Element{docpp::HTML::Tag::H5, {}, "data5"},
-                    Element{docpp::HTML::Tag::H6, {}, "data6"}
-                }
-            });
+            REQUIRE(section.get_arena() == &arena);
+            REQUIRE(heap_section.get_arena() == nullptr);
+            REQUIRE(arena.size() > 0);
+            REQUIRE(arena.capacity() >= arena.size());
+            REQUIRE(section.get() == heap_section.get());
+            REQUIRE(section == heap_section);
+            REQUIRE(section.at_section(1).get_arena() == &arena);
 
-            REQUIRE(document.get_section().get() == "<html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
+            Section copy = section;
 
-            document.set_doctype("<!NEW_DOCTYPE html>");
+            REQUIRE(copy.get_arena() == nullptr);
+            REQUIRE(copy.get() == heap_section.get());
 
-            REQUIRE(document.get_doctype() == "<!NEW_DOCTYPE html>");
-            REQUIRE(document.get() == "<!NEW_DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
-        };
+            Section arena_copy{heap_section, arena};
 
-        const auto test_copy_document = []() {
-            using namespace docpp::HTML;
+            REQUIRE(arena_copy.get_arena() == &arena);
+            REQUIRE(arena_copy.get() == heap_section.get());
 
-            Document document;
+            section = Section{docpp::HTML::Tag::Html, {}};
+            section.push_back(arena_copy);
 
-            document.set(Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H1, {}, "data1"},
-                    Element{docpp::HTML::Tag::H2, {}, "data2"},
-                    Element{docpp::HTML::Tag::H3, {}, "data3"},
-                    Element{docpp::HTML::Tag::H4, {}, "data4"},
-                    Element{docpp::HTML::Tag::H5, {}, "data5"},
-                    Element{docpp::HTML::Tag::H6, {}, "data6"}
-                }
-            });
+            REQUIRE(section.get_arena() == &arena);
+            REQUIRE(section.get() == "<html>" + heap_section.get() + "</html>");
 
-            Document new_document = document;
+            Document document{arena};
+            document.get_section() = section;
 
-            REQUIRE(document == new_document);
-            REQUIRE(document.empty() == false);
+            REQUIRE(document.get_section().get_arena() == &arena);
+            REQUIRE(document.get() == "<!DOCTYPE html><html>" + heap_section.get() + "</html>");
 
-            document.clear();
+            try {
+                arena.allocate(8, 3);
+                REQUIRE(false);
+            } catch (const docpp::invalid_argument& e) {
+                REQUIRE(true);
+            }
 
-            REQUIRE(document.empty() == true);
+            void* large = arena.allocate(4096, 64);
 
-            document = std::move(new_document);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(large) % 64 == 0);
 
-            REQUIRE(document.empty() == false);
-        };
+            // parts from an arena that dies before the heap section must be copied, not moved
+            Section heap{docpp::HTML::Tag::Div, {}};
+            Element heap_element{docpp::HTML::Tag::Span, {}, "span"};
 
-        const auto test_operators = []() {
-            using namespace docpp::HTML;
+            {
+                docpp::Arena scratch{};
+                Element element{docpp::HTML::Tag::P, Properties{Properties{Property{"data-arena", "p"}}, scratch}, "text"};
 
-            Document document1;
-            Document document2;
+                REQUIRE(element.get_properties().get_arena() == &scratch);
 
-            document1.set(Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H1, {}, "data1"},
-                    Element{docpp::HTML::Tag::H2, {}, "data2"},
-                    Element{docpp::HTML::Tag::H3, {}, "data3"},
-                    Element{docpp::HTML::Tag::H4, {}, "data4"},
-                    Element{docpp::HTML::Tag::H5, {}, "data5"},
-                    Element{docpp::HTML::Tag::H6, {}, "data6"}
-                }
-            });
+                heap.push_back(std::move(element));
+                heap.set_properties(Properties{Properties{Property{"data-arena", "div"}}, scratch});
+                heap_element.set_properties(Properties{Properties{Property{"data-arena", "span"}}, scratch});
+            }
 
-            document2.set(Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H1, {}, "data1"},
-                    Element{docpp::HTML::Tag::H2, {}, "data2"},
-                    Element{docpp::HTML::Tag::H3, {}, "data3"},
-                    Element{docpp::HTML::Tag::H4, {}, "data4"},
-                    Element{docpp::HTML::Tag::H5, {}, "data5"},
-                    Element{docpp::HTML::Tag::H6, {}, "data6"}
-                }
-            });
+            REQUIRE(heap.at(0).get_properties().get_arena() == nullptr);
+            REQUIRE(heap.get_properties().get_arena() == nullptr);
+            REQUIRE(heap.get() == "<div data-arena=\"div\"><p data-arena=\"p\">text</p></div>");
+            REQUIRE(heap_element.get() == "<span data-arena=\"span\">span</span>");
 
-            REQUIRE(document1 == document2);
+            // data and property values are allocated from the arena as well, and stay there when they are added to a section in it
+            const std::string text(64, 't');
+            Section stored{docpp::HTML::Tag::Div, {}, arena};
 
-            document2.set(Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H6, {}, "data1"},
-                    Element{docpp::HTML::Tag::H5, {}, "data2"},
-                    Element{docpp::HTML::Tag::H4, {}, "data3"},
-                    Element{docpp::HTML::Tag::H3, {}, "data4"},
-                    Element{docpp::HTML::Tag::H2, {}, "data5"},
-                    Element{docpp::HTML::Tag::H1, {}, "data6"}
-                }
-            });
+            stored.push_back(Element{docpp::HTML::Tag::P, Properties{Property{"title", text}}, text});
+            stored.emplace_back(docpp::HTML::Tag::P, Properties{}, docpp::String{text, docpp::ArenaAllocator<char>{&arena}});
 
-            REQUIRE(document1 != document2);
-        };
+            REQUIRE(stored.at(0).get_data().get_arena() == &arena);
+            REQUIRE(stored.at(0).get_properties().at(0).get_value().get_arena() == &arena);
+            REQUIRE(stored.at(1).get_data().get_arena() == &arena);
+            REQUIRE(stored.at(0).get_data() == text);
+            REQUIRE(stored.get() == "<div><p title=\"" + text + "\">" + text + "</p><p>" + text + "</p></div>");
 
-        const auto test_constructors = []() {
-            using namespace docpp::HTML;
+            const std::string converted{stored.at(0).get_data()};
 
-            Document document{};
+            REQUIRE(converted == text);
+            REQUIRE(stored.at(0).get_data() + "!" == text + "!");
+            REQUIRE(stored.at(0).get_data().find(text) == 0);
 
-            REQUIRE(document.get_doctype() == "<!DOCTYPE html>");
-            REQUIRE(document.get_section().get_tag() == "");
-            REQUIRE(document.get_section().get_sections().empty());
-            REQUIRE(document.get_section().get_elements().empty());
-            REQUIRE(document.get_section().get_properties().empty());
+            Properties values{arena};
+            values.emplace_back("title", text);
+            values.push_back(Property{"alt", text});
+            values.insert(0, Property{"id", text});
 
-            Document document2(Section {
-                docpp::HTML::Tag::Html, {},
-                {
-                    Element{docpp::HTML::Tag::H1, {}, "data1"},
-                    Element{docpp::HTML::Tag::H2, {}, "data2"},
-                    Element{docpp::HTML::Tag::H3, {}, "data3"},
-                    Element{docpp::HTML::Tag::H4, {}, "data4"},
-                    Element{docpp::HTML::Tag::H5, {}, "data5"},
-                    Element{docpp::HTML::Tag::H6, {}, "data6"}
-                }
-            });
+            REQUIRE(values.at(0).get_value().get_arena() == &arena);
+            REQUIRE(values.at(1).get_value().get_arena() == &arena);
+            REQUIRE(values.at(2).get_value().get_arena() == &arena);
+            REQUIRE(Properties{values}.at(0).get_value().get_arena() == nullptr);
 
-            REQUIRE(document2.get_doctype() == "<!DOCTYPE html>");
-            REQUIRE(document2.get_section().get_tag() == "html");
-            REQUIRE(document2.get_section().get_sections().empty());
-            REQUIRE(document2.get_section().get_elements().size() == 6);
-            REQUIRE(document2.get_section().get_properties().empty());
+            Section heap_data{docpp::HTML::Tag::Div, {}};
 
-            Document document3(Section(docpp::HTML::Tag::Html, {}, {
-                Section(docpp::HTML::Tag::Head, {}, {
-                    Element(docpp::HTML::Tag::Title, {}, "Title")
-                }),
-                Section(docpp::HTML::Tag::Body, {}, {
-                    Element(docpp::HTML::Tag::H1, {}, "Hello, World!")
-                }),
-            }), "<!NEW_DOCTYPE html>");
+            {
+                docpp::Arena scratch{};
+                heap_data.push_back(Element{docpp::HTML::Tag::B, {}, docpp::String{text, docpp::ArenaAllocator<char>{&scratch}}});
+            }
 
-            REQUIRE(document3.get_doctype() == "<!NEW_DOCTYPE html>");
-            REQUIRE(document3.get_section().get_tag() == "html");
-            REQUIRE(document3.get_section().get_sections().size() == 2);
-            REQUIRE(document3.get_section().get_elements().empty());
-            REQUIRE(document3.get_section().get_properties().empty());
-        };
+            REQUIRE(heap_data.at(0).get_data().get_arena() == nullptr);
+            REQUIRE(heap_data.get() == "<div><b>" + text + "</b></div>");
 
-        test_get_and_set();
-        test_copy_document();
-        test_operators();
-        test_constructors();
-    }
+            // the descendants of a section in an arena are destroyed as well, so their cached output and indexes are freed
+            {
+                Section root{docpp::HTML::Tag::Div, {}, arena};
+                Section child{docpp::HTML::Tag::Section, Properties{Property{"id", "child"}}};
 
-    void test_html() {
-        test_tag();
-        test_property();
-        test_properties();
-        test_element();
-        test_section();
-        test_document();
-    }
-} // namespace HTML
+                child.set_caching(true);
+                child.set_indexing(true);
+                child.push_back(Element{docpp::HTML::Tag::P, Properties{Property{"id", "leaf"}}, text});
+                root.push_back(Section{child});
+                root.push_back(std::move(child));
 
-inline namespace CSS {
-    void test_property() {
-        const auto test_get_and_set = []() {
-            using namespace docpp::CSS;
+                REQUIRE(root.get() == "<div><section id=\"child\"><p id=\"leaf\">" + text + "</p></section><section id=\"child\"><p id=\"leaf\">" + text + "</p></section></div>");
+                REQUIRE(root.at_section(0).get_by_id("leaf") != nullptr);
+                REQUIRE(root.at_section(1).get_by_id("leaf") != nullptr);
+            }
 
-            Property property;
+            // a node assigned through children() may be on the heap, below a section in the arena, and must still be freed
+            {
+                Section root{docpp::HTML::Tag::Div, {}, arena};
+                Section child{docpp::HTML::Tag::Section, {}};
 
-            property.set("key", "value");
+                child.push_back(Element{docpp::HTML::Tag::P, {}, "placeholder"});
+                child.push_back(Element{docpp::HTML::Tag::P, {}, "placeholder"});
+                root.push_back(std::move(child));
 
-            REQUIRE(property.get().first == "key");
-            REQUIRE(property.get().second == "value");
-            REQUIRE(property.get_key() == "key");
-            REQUIRE(property.get_value() == "value");
+                Section heap_child{docpp::HTML::Tag::Span, {}};
+                heap_child.push_back(Element{docpp::HTML::Tag::B, Properties{Property{"title", text}}, text});
 
-            property.set_key("new_key");
+                Section& in_arena{root.children().begin()->get_section()};
+                std::size_t index{0};
 
-            REQUIRE(property.get().first == "new_key");
-            REQUIRE(property.get().second == "value");
-            REQUIRE(property.get_key() == "new_key");
-            REQUIRE(property.get_value() == "value");
+                REQUIRE(in_arena.get_arena() == &arena);
 
-            property.set_value("new_value");
+                for (Section::Node& it : in_arena.children()) {
+                    if (index++ == 0) {
+                        it = Section::Node{Element{docpp::HTML::Tag::I, Properties{Property{"title", text}}, text}, nullptr};
+                    } else {
+                        it = Section::Node{Section{heap_child}, nullptr};
+                    }
+                }
 
-            REQUIRE(property.get().first == "new_key");
-            REQUIRE(property.get().second == "new_value");
-            REQUIRE(property.get_key() == "new_key");
-            REQUIRE(property.get_value() == "new_value");
+                REQUIRE(root.get() == "<div><section><i title=\"" + text + "\">" + text + "</i><span><b title=\"" + text + "\">" + text + "</b></span></section></div>");
+            }
+        };
+
+        const auto test_move = []() {
+            using namespace docpp::HTML;
+
+            const std::string data(64, 'x');
+
+            Section section{docpp::HTML::Tag::Div, {}};
+            Element element{docpp::HTML::Tag::P, Properties{Property{"class", "row"}}, std::string{data}};
+
+            section.push_back(std::move(element));
+            section.emplace_back(docpp::HTML::Tag::Span, Properties{Property{"id", "span"}}, "emplaced");
+            section.emplace_back("custom", Properties{}, "", docpp::HTML::Type::Self_Closing);
+
+            Section child{docpp::HTML::Tag::Footer, {}};
+            child.push_back(Element{docpp::HTML::Tag::B, {}, "bold"});
+
+            section.push_back(std::move(child));
+            section.emplace(1, docpp::HTML::Tag::I, Properties{}, "replaced");
+
+            REQUIRE(section.size() == 4);
+            REQUIRE(section.get() == "<div><p class=\"row\">" + data + "</p><i>replaced</i><custom/><footer><b>bold</b></footer></div>");
+
+            Section moved{std::move(section)};
+
+            REQUIRE(moved.size() == 4);
+            REQUIRE(moved.at_section(3).get() == "<footer><b>bold</b></footer>");
+
+            Section assigned{};
+            assigned = std::move(moved);
+
+            REQUIRE(assigned.size() == 4);
+            REQUIRE(assigned.at(0).get_data() == data);
+
+            Properties properties{};
+            properties.emplace_back("key", "value");
+            properties.push_back(Property{"key2", "value2"});
+            properties.emplace(0, "key0", "value0");
+
+            REQUIRE(properties.size() == 3);
+            REQUIRE(properties.at(0).get_key() == "key0");
+            REQUIRE(properties.at(2).get_value() == "value2");
+        };
+
+        const auto test_views = []() {
+            using namespace docpp::HTML;
+
+            Section section{docpp::HTML::Tag::Div, {}};
+
+            section.push_back(Element{docpp::HTML::Tag::P, Properties{Property{"id", "first"}}, "first"});
+            section.push_back(Section{docpp::HTML::Tag::Span, {}});
+            section.push_back(Element{docpp::HTML::Tag::P, {}, "second"});
+            section.push_back(Section{docpp::HTML::Tag::Footer, {}});
+
+            REQUIRE(&section.at(0) == &section.at(0));
+            REQUIRE(&section.at(0).get_properties() == &section.at(0).get_properties());
+            REQUIRE(&section.at(0).get_properties().at(0).get_key() == &section.front().get_properties().front().get_key());
+            REQUIRE(&section.at_section(1) == &section.get_sections().front());
+
+            const Section::element_view elements{section.get_elements()};
+            const Section::section_view sections{section.get_sections()};
+
+            REQUIRE(elements.size() == 2);
+            REQUIRE(sections.size() == 2);
+            REQUIRE(elements.empty() == false);
+            REQUIRE(elements.at(1).get_data() == "second");
+            REQUIRE(elements.back().get_data() == "second");
+            REQUIRE(sections[1].get_tag() == "footer");
+            REQUIRE(sections.back().get_tag() == "footer");
+
+            std::string tags{};
+            for (const Section& it : section.get_sections()) {
+                tags += it.get_tag();
+            }
+
+            REQUIRE(tags == "spanfooter");
+
+            const std::vector<Element> copied = section.get_elements();
+
+            REQUIRE(copied.size() == 2);
+            REQUIRE(copied.at(0).get_data() == "first");
+
+            try {
+                elements.at(2);
+                REQUIRE(false);
+            } catch (const docpp::out_of_range& e) {
+                REQUIRE(true);
+            }
+
+            REQUIRE(Section{}.get_sections().empty());
+
+            Section list{docpp::HTML::Tag::Div, {}};
+
+            for (std::size_t i{0}; i < 10; i++) {
+                list.push_back(Element{docpp::HTML::Tag::Li, {}, std::to_string(i)});
+                list.push_back(Section{docpp::HTML::Tag::Div, {}});
+            }
+
+            const Section::element_view items{list.get_elements()};
+            std::string order{};
+
+            for (std::size_t i{0}; i < items.size(); i++) {
+                order += items.at(i).get_data();
+            }
+
+            order += items.at(3).get_data() + items.at(9).get_data() + items.at(0).get_data() + items.back().get_data();
+
+            REQUIRE(order == "01234567893909");
+            REQUIRE(items.size() == 10);
+
+            try {
+                items.at(10);
+                REQUIRE(false);
+            } catch (const docpp::out_of_range& e) {
+                REQUIRE(items.at(2).get_data() == "2");
+            }
+
+            const std::vector<Property> properties{section.at(0).get_properties().get_properties<std::vector<Property>>()};
+
+            REQUIRE(properties.size() == 1);
+            REQUIRE(properties.at(0).get_value() == "first");
+        };
+
+        const auto test_children = []() {
+            using namespace docpp::HTML;
+
+            Section section{docpp::HTML::Tag::Div, {}};
+
+            section.push_back(Element{docpp::HTML::Tag::P, {}, "first"});
+            section.push_back(Section{docpp::HTML::Tag::Span, {}});
+            section.push_back(Element{docpp::HTML::Tag::P, {}, "second"});
+            section.push_back(Element{docpp::HTML::Tag::P, {}, "erased"});
+            section.push_back(Section{docpp::HTML::Tag::Footer, {}});
+            section.erase(3);
+
+            std::string order{};
+            for (const Section::Node& it : static_cast<const Section&>(section).children()) {
+                order += it.is_element() ? std::string{it.get_element().get_data()} : it.get_section().get_tag();
+                order += ",";
+            }
+
+            REQUIRE(order == "first,span,second,footer,");
+            REQUIRE(&section.children().begin()->get_element() == &section.at(0));
+
+            for (Section::Node& it : section.children()) {
+                if (it.is_section()) {
+                    it.get_section().push_back(Element{docpp::HTML::Tag::B, {}, "inner"});
+                } else {
+                    Element element{it.get_element()};
+                    element.set_data("changed");
+                    section.replace(it, std::move(element));
+                }
+            }
+
+            REQUIRE(section.at(2).get_data() == "changed");
+            REQUIRE(section.at_section(4).at(0).get_data() == "inner");
+            REQUIRE(section.get() == "<div><p>changed</p><span><b>inner</b></span><p>changed</p><footer><b>inner</b></footer></div>");
+
+            try {
+                section.children().begin()->get_section();
+                REQUIRE(false);
+            } catch (const docpp::invalid_argument& e) {
+                REQUIRE(true);
+            }
+
+            try {
+                section.replace(*++section.children().begin(), Element{docpp::HTML::Tag::P, {}, "not an element"});
+                REQUIRE(false);
+            } catch (const docpp::invalid_argument& e) {
+                REQUIRE(true);
+            }
+
+            try {
+                Section other{docpp::HTML::Tag::Div, {}};
+                other.push_back(Element{docpp::HTML::Tag::P, {}, "other"});
+                section.replace(*other.children().begin(), Element{docpp::HTML::Tag::P, {}, "elsewhere"});
+                REQUIRE(false);
+            } catch (const docpp::out_of_range& e) {
+                REQUIRE(true);
+            }
+
+            Section empty{};
+            empty.push_back(Element{docpp::HTML::Tag::P, {}, "gone"});
+            empty.erase(0);
+
+            REQUIRE(empty.children().begin() == empty.children().end());
+        };
+
+        const auto test_caching = []() {
+            using namespace docpp::HTML;
+
+            const auto child = [](Section& section, const std::size_t index) -> Section& {
+                std::size_t i{0};
+
+                for (Section::Node& it : section.children()) {
+                    if (i++ == index) {
+                        return it.get_section();
+                    }
+                }
+
+                throw docpp::out_of_range("Index out of range");
+            };
+
+            Section nav{docpp::HTML::Tag::Nav, {}};
+            nav.push_back(Element{docpp::HTML::Tag::A, Properties{Property{"href", "/"}}, "Home"});
+            nav.push_back(Section{"ul", {}});
+
+            Section page{docpp::HTML::Tag::Body, {}};
+            page.push_back(nav);
+            page.push_back(Element{docpp::HTML::Tag::P, {}, "content"});
+
+            const std::string expected{page.get()};
+            const std::string expected_pretty{page.get(Formatting::Pretty)};
+
+            REQUIRE(page.is_caching() == false);
+
+            page.set_caching(true);
+            for (Section::Node& it : page.children()) {
+                if (it.is_section()) {
+                    it.get_section().set_caching(true);
+
+                    for (Section::Node& child : it.get_section().children()) {
+                        if (child.is_section()) {
+                            child.get_section().set_caching(true);
+                        }
+                    }
+                }
+            }
+
+            REQUIRE(page.is_caching() == true);
+            REQUIRE(page.get() == expected);
+            REQUIRE(page.get() == expected);
+            REQUIRE(page.get(Formatting::Pretty) == expected_pretty);
+            REQUIRE(page.get(Formatting::Pretty) == expected_pretty);
+            REQUIRE(page.serialized_size() == expected.size());
+
+            // fill the caches again, then modify the innermost section and check the change shows up at the top
+            Section& list = child(child(page, 0), 1);
+
+            REQUIRE(page.get() == expected);
+
+            list.push_back(Element{docpp::HTML::Tag::Li, {}, "item"});
+
+            REQUIRE(page.get() == "<body><nav><a href=\"/\">Home</a><ul><li>item</li></ul></nav><p>content</p></body>");
+
+            list.set_tag("ol");
+
+            REQUIRE(page.get() == "<body><nav><a href=\"/\">Home</a><ol><li>item</li></ol></nav><p>content</p></body>");
+
+            for (Section::Node& it : page.children()) {
+                if (it.is_element()) {
+                    page.replace(it, Element{docpp::HTML::Tag::P, {}, "changed"});
+                }
+            }
+
+            REQUIRE(page.get() == "<body><nav><a href=\"/\">Home</a><ol><li>item</li></ol></nav><p>changed</p></body>");
+
+            // a child section taken from the range before the output was cached still discards it when it is modified later on
+            Section* nav_section{nullptr};
+
+            for (Section::Node& it : page.children()) {
+                if (it.is_section()) {
+                    nav_section = &it.get_section();
+                }
+            }
+
+            REQUIRE(page.get() == "<body><nav><a href=\"/\">Home</a><ol><li>item</li></ol></nav><p>changed</p></body>");
+
+            nav_section->set_tag("header");
+
+            REQUIRE(page.get() == "<body><header><a href=\"/\">Home</a><ol><li>item</li></ol></header><p>changed</p></body>");
+
+            nav_section->set_tag("nav");
+
+            // moving the section must keep its children pointing at it
+            Section moved{std::move(page)};
+            Section& moved_nav = child(moved, 0);
+
+            REQUIRE(moved.get() == "<body><nav><a href=\"/\">Home</a><ol><li>item</li></ol></nav><p>changed</p></body>");
+
+            moved_nav.erase(0);
+
+            REQUIRE(moved.get() == "<body><nav><ol><li>item</li></ol></nav><p>changed</p></body>");
+
+            Section copied{moved};
+            child(copied, 0).set_properties(Properties{Property{"id", "copy"}});
+
+            REQUIRE(copied.is_caching() == true);
+            REQUIRE(copied.get() == "<body><nav id=\"copy\"><ol><li>item</li></ol></nav><p>changed</p></body>");
+            REQUIRE(moved.get() == "<body><nav><ol><li>item</li></ol></nav><p>changed</p></body>");
+
+            Document document{};
+            document.set(std::move(moved));
+            const std::string cached_document{document.get()};
+            document.get_section().swap(0, 0);
+            child(document.get_section(), 0).clear();
+
+            REQUIRE(document.get() != cached_document);
+            REQUIRE(document.get() == "<!DOCTYPE html><body><p>changed</p></body>");
+
+            copied.set_caching(false);
+
+            REQUIRE(copied.is_caching() == false);
+            REQUIRE(copied.get() == "<body><nav id=\"copy\"><ol><li>item</li></ol></nav><p>changed</p></body>");
+
+            // a const section may be rendered from several threads at once, which fill and read the same caches
+            copied.set_caching(true);
+            child(copied, 0).set_caching(true);
+
+            const Section& shared{copied};
+            const std::string expected_shared{shared.get()};
+            const std::string expected_shared_pretty{shared.get(Formatting::Pretty)};
+            std::vector<std::string> outputs(8);
+            std::vector<std::thread> threads{};
+
+            child(copied, 0).set_tag("nav");
+
+            for (std::size_t i{0}; i < outputs.size(); i++) {
+                threads.emplace_back([&shared, &outputs, i]() {
+                    for (int j{0}; j < 100; j++) {
+                        outputs[i] = shared.get(i % 2 == 0 ? Formatting::None : Formatting::Pretty);
+                    }
+                });
+            }
+
+            for (std::thread& it : threads) {
+                it.join();
+            }
+
+            for (std::size_t i{0}; i < outputs.size(); i++) {
+                REQUIRE(outputs[i] == (i % 2 == 0 ? expected_shared : expected_shared_pretty));
+            }
+        };
+
+        const auto test_threads = []() {
+            using namespace docpp::HTML;
+
+            Section root{Tag::Div, {Property{"class", "report"}}};
+
+            for (std::size_t i{0}; i < 37; i++) {
+                Section row{Tag::Div, {Property{"id", "row-" + std::to_string(i)}}};
+                row.push_back(Element{Tag::P, {}, "Row " + std::to_string(i)});
+                row.push_back(Section{Tag::Span, {}, std::vector<Element>{Element{Tag::B, {}, "nested"}}});
+
+                if (i % 5 == 0) {
+                    row.set_caching(true);
+                }
+                if (i % 7 == 0) {
+                    row.set_threads(2);
+                }
+
+                root.push_back(row);
+                root.push_back(Element{Tag::Hr, {}});
+            }
+
+            Section sequential{root};
+            REQUIRE(sequential.get_threads() == 0);
+
+            for (const unsigned int threads : {1u, 2u, 3u, 8u, 100u}) {
+                root.set_threads(threads);
+
+                REQUIRE(root.get_threads() == threads);
+                REQUIRE(Section{root}.get_threads() == threads);
+
+                for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Newline, Formatting::Minified}) {
+                    for (int tabc{0}; tabc < 3; tabc++) {
+                        REQUIRE(root.get(formatting, tabc) == sequential.get(formatting, tabc));
+                    }
+                }
+            }
+
+            Section wrapper{};
+            wrapper.push_back(root);
+            wrapper.push_back(Element{Tag::P, {}, "end"});
+            wrapper.set_threads(2);
+
+            Section sequential_wrapper{};
+            sequential_wrapper.push_back(sequential);
+            sequential_wrapper.push_back(Element{Tag::P, {}, "end"});
+
+            REQUIRE(wrapper.get(Formatting::Pretty) == sequential_wrapper.get(Formatting::Pretty));
+            REQUIRE(Document{wrapper}.get(Formatting::Newline) == Document{sequential_wrapper}.get(Formatting::Newline));
+
+            docpp::Hash hash{};
+            docpp::Hash sequential_hash{};
+
+            REQUIRE(wrapper.get(hash) == sequential_wrapper.get(sequential_hash));
+            REQUIRE(hash == sequential_hash);
+
+            // renders started from several threads at once share the same workers
+            const Section& shared{root};
+            std::vector<std::string> outputs(4);
+            std::vector<std::thread> threads{};
+
+            for (std::size_t i{0}; i < outputs.size(); i++) {
+                threads.emplace_back([&shared, &outputs, i]() {
+                    for (int j{0}; j < 20; j++) {
+                        outputs[i] = shared.get(Formatting::Pretty);
+                    }
+                });
+            }
+
+            for (std::thread& it : threads) {
+                it.join();
+            }
+
+            for (const std::string& it : outputs) {
+                REQUIRE(it == sequential.get(Formatting::Pretty));
+            }
+        };
+
+        const auto test_deep = []() {
+            using namespace docpp::HTML;
+
+            const std::size_t depth{100000};
+
+            Section section{Tag::Div, {}};
+            section.push_back(Element{Tag::P, {}, "x"});
+
+            for (std::size_t i{1}; i < depth; i++) {
+                Section parent{Tag::Div, {}};
+                parent.push_back(std::move(section));
+                section = std::move(parent);
+            }
+
+            std::string expected{};
+            for (std::size_t i{0}; i < depth; i++) {
+                expected += "<div>";
+            }
+            expected += "<p>x</p>";
+            for (std::size_t i{0}; i < depth; i++) {
+                expected += "</div>";
+            }
+
+            REQUIRE(section.get() == expected);
+            REQUIRE(section.serialized_size(Formatting::Newline) == section.get(Formatting::Newline).size());
+
+            Section small{Tag::Div, {}};
+            small.push_back(Element{Tag::P, {}, "x"});
+
+            for (std::size_t i{1}; i < 4; i++) {
+                Section parent{i % 2 ? Section{} : Section{Tag::Div, {}}};
+                parent.push_back(std::move(small));
+                parent.push_back(Element{Tag::Span, {}, "y"});
+                small = std::move(parent);
+            }
+
+            REQUIRE(small.get(Formatting::Pretty) == "<div>\n\t<div>\n\t\t<p>x</p>\n\t</div>\n\t<span>y</span>\n\n\t<span>y</span>\n</div>\n<span>y</span>\n");
+        };
+
+        const auto test_minified = []() {
+            using namespace docpp::HTML;
+
+            Section list{"ul", {Property{"class", "items"}}};
+            list.push_back(Element{Tag::Li, {}, "one"});
+            list.push_back(Element{Tag::Li, {}, "two  \n  words"});
+
+            Section pre{Tag::Pre, {}};
+            pre.push_back(Element{"", {}, "  keep   this  ", Type::Text_No_Formatting});
+            pre.push_back(Element{Tag::B, {}, " and  this "});
+
+            Section link{Tag::A, {Property{"href", "/a b"}}};
+            link.push_back(Element{Tag::P, {}, "inside"});
+
+            Section body{Tag::Body, Properties{std::vector<Property>{Property{"id", "main"}, Property{"title", ""}}}};
+            body.push_back(list);
+            body.push_back(Element{Tag::P, {}, "  spaced   out  "});
+            body.push_back(Section{Tag::Div, {}, std::vector<Element>{Element{Tag::P, {}, "last"}}});
+            body.push_back(pre);
+            body.push_back(link);
+            body.push_back(Element{"img", {Property{"src", "a.png"}}, "", Type::Self_Closing});
+            body.push_back(Element{Tag::Script, {}, "if (a  <  b) {}"});
+            body.push_back(Element{Tag::P, {}, "end"});
+
+            Section html{Tag::Html, {}};
+            html.push_back(body);
+
+            const std::string expected{"<html><body id=main><ul class=items><li>one<li>two words</ul><p> spaced out <div><p>last</div>"
+                "<pre>  keep   this  <b> and  this </b></pre><a href=\"/a b\"><p>inside</p></a><img src=\"a.png\"/><script>if (a  <  b) {}</script><p>end"};
+
+            REQUIRE(Document{html}.get(Formatting::Minified) == "<!DOCTYPE html>" + expected + "</html>");
+            REQUIRE(html.get(Formatting::Minified) == expected + "</html>");
+            REQUIRE(html.serialized_size(Formatting::Minified) == html.get(Formatting::Minified).size());
+
+            Section table{Tag::Table, {}};
+            Section row{Tag::Tr, {}};
+            row.push_back(Element{Tag::Td, {}, "1"});
+            row.push_back(Element{Tag::Th, {}, "2"});
+            table.push_back(row);
+            table.push_back(row);
+
+            REQUIRE(table.get(Formatting::Minified) == "<table><tr><td>1<th>2<tr><td>1<th>2</table>");
+
+            Section cached{table};
+            cached.set_caching(true);
+            REQUIRE(cached.get(Formatting::Minified) == table.get(Formatting::Minified));
+            REQUIRE(cached.get(Formatting::None) == table.get(Formatting::None));
+
+            // cached and parallel children leave out the same closing tags as the children written in place
+            Section cached_rows{table};
+            Section parallel_rows{table};
+
+            for (Section::Node& it : cached_rows.children()) {
+                it.get_section().set_caching(true);
+            }
+
+            for (Section::Node& it : parallel_rows.children()) {
+                it.get_section().set_threads(2);
+            }
+
+            parallel_rows.set_threads(2);
+
+            for (int i{0}; i < 2; i++) {
+                REQUIRE(cached_rows.get(Formatting::Minified) == table.get(Formatting::Minified));
+                REQUIRE(parallel_rows.get(Formatting::Minified) == table.get(Formatting::Minified));
+            }
+
+            cached_rows.set_caching(true);
+            REQUIRE(cached_rows.get(Formatting::Minified) == table.get(Formatting::Minified));
+            REQUIRE(cached_rows.get(Formatting::Minified) == table.get(Formatting::Minified));
+            REQUIRE(cached_rows.serialized_size(Formatting::Minified) == table.get(Formatting::Minified).size());
+            REQUIRE(cached_rows.get(Formatting::None) == table.get(Formatting::None));
+
+            // the same cached section may keep its closing tag in one place and leave it out in another
+            Section paragraph{Tag::P, {}};
+            paragraph.push_back(Element{Tag::B, {}, "text"});
+            paragraph.set_caching(true);
+
+            Section page{Tag::Div, {}};
+            page.push_back(paragraph);
+            page.push_back(Element{Tag::Span, {}, "after"});
+            page.push_back(paragraph);
+            page.push_back(Element{Tag::Div, {}, "after"});
+
+            Section cached_page{page};
+
+            for (Section::Node& it : cached_page.children()) {
+                if (it.is_section()) {
+                    it.get_section().set_caching(true);
+                }
+            }
+
+            cached_page.set_caching(true);
+
+            REQUIRE(page.get(Formatting::Minified) == "<div><p><b>text</b></p><span>after</span><p><b>text</b><div>after</div></div>");
+            REQUIRE(cached_page.get(Formatting::Minified) == page.get(Formatting::Minified));
+            REQUIRE(cached_page.get(Formatting::Minified) == page.get(Formatting::Minified));
+
+            Section cached_html{html};
+            cached_html.set_caching(true);
+
+            for (Section::Node& it : cached_html.children()) {
+                it.get_section().set_caching(true);
+
+                for (Section::Node& child : it.get_section().children()) {
+                    if (child.is_section()) {
+                        child.get_section().set_caching(true);
+                    }
+                }
+            }
+
+            REQUIRE(cached_html.get(Formatting::Minified) == expected + "</html>");
+            REQUIRE(cached_html.get(Formatting::Minified) == expected + "</html>");
+            REQUIRE(cached_html.get(Formatting::Pretty) == html.get(Formatting::Pretty));
+
+            Section fragment{};
+            fragment.push_back(Element{Tag::Li, {}, "a"});
+            fragment.push_back(Element{"", {}, " text ", Type::Text});
+
+            REQUIRE(fragment.get(Formatting::Minified) == "<li>a</li> text ");
+            REQUIRE(Element{Tag::P, {Property{"class", "x"}}, "a \t b"}.get(Formatting::Minified) == "<p class=x>a b</p>");
+        };
+
+        const auto test_diff = []() {
+            using namespace docpp::HTML;
+
+            const auto make_list = [](const std::vector<std::string>& items) {
+                Section list{"ul", {Property{"class", "items"}}};
+
+                for (const std::string& it : items) {
+                    list.push_back(Element{Tag::Li, {}, it});
+                }
+
+                return list;
+            };
+
+            const auto make_page = [](const Section& list) {
+                Section body{Tag::Body, {}};
+                body.push_back(Element{Tag::H1, {}, "title"});
+                body.push_back(list);
+                body.push_back(Element{Tag::P, {Property{"id", "footer"}}, "end"});
+
+                Section html{Tag::Html, {}};
+                html.push_back(body);
+                return html;
+            };
+
+            const auto check = [](const Section& before, const Section& after) {
+                const std::vector<Patch> patches{diff(before, after)};
+                Section patched{before};
+
+                patched.set_caching(true);
+                REQUIRE(patched.get() == before.get());
+
+                patched.apply(patches);
+
+                REQUIRE(patched.get() == after.get());
+                REQUIRE(patched.get(Formatting::Pretty) == after.get(Formatting::Pretty));
+                REQUIRE(diff(patched, after).empty());
+
+                return patches;
+            };
+
+            const Section before{make_page(make_list({"a", "b", "c", "d", "e"}))};
+
+            REQUIRE(diff(before, before).empty());
+            REQUIRE(diff(before, Section{before}).empty());
+
+            // the hashes of unchanged subtrees are kept, and a change anywhere below a section is seen by it
+            {
+                Section changed{before};
+                const docpp::Hash tree_hash{changed.get_tree_hash()};
+
+                REQUIRE(tree_hash == before.get_tree_hash());
+                REQUIRE(changed.get_tree_hash() == tree_hash);
+
+                Section& body{changed.children().begin()->get_section()};
+                Section* list{nullptr};
+
+                for (Section::Node& it : body.children()) {
+                    if (it.is_section()) {
+                        list = &it.get_section();
+                    }
+                }
+
+                list->push_back(Element{Tag::Li, {}, "f"});
+                REQUIRE(changed.get_tree_hash() != tree_hash);
+                REQUIRE(body.get_tree_hash() != before.at_section(0).get_tree_hash());
+                REQUIRE(diff(before, changed).size() == 1);
+
+                list->erase(5);
+                REQUIRE(changed.get_tree_hash() == tree_hash);
+                REQUIRE(diff(before, changed).empty());
+            }
+
+            std::vector<Patch> patches{check(before, make_page(make_list({"a", "b", "x", "d", "e"})))};
+
+            REQUIRE(patches.size() == 1);
+            REQUIRE(patches[0].get_type() == Patch::Type::Set_Data);
+            REQUIRE(patches[0].get_path() == std::vector<std::size_t>{0, 1, 2});
+            REQUIRE(patches[0].get_value() == "x");
+
+            patches = check(before, make_page(make_list({"new", "a", "b", "c", "d", "e"})));
+
+            REQUIRE(patches.size() == 1);
+            REQUIRE(patches[0].get_type() == Patch::Type::Insert);
+            REQUIRE(patches[0].get_path() == std::vector<std::size_t>{0, 1, 0});
+            REQUIRE(patches[0].get_node().get_element().get_data() == "new");
+
+            patches = check(before, make_page(make_list({"a", "b", "d", "e"})));
+
+            REQUIRE(patches.size() == 1);
+            REQUIRE(patches[0].get_type() == Patch::Type::Remove);
+            REQUIRE(patches[0].get_path() == std::vector<std::size_t>{0, 1, 2});
+
+            // moving one child keeps the others in place
+            patches = check(before, make_page(make_list({"b", "c", "d", "a", "e"})));
+            REQUIRE(patches.size() == 2);
+
+            check(before, make_page(make_list({"e", "d", "c", "b", "a"})));
+            check(before, make_page(make_list({})));
+            check(make_page(make_list({})), before);
+            check(before, make_page(make_list({"a", "a", "b", "x", "y", "e", "e"})));
+
+            Section list{make_list({"a", "b", "c", "d", "e"})};
+            list.set_properties(Properties{std::vector<Property>{Property{"id", "list"}, Property{"class", "items"}}});
+            check(before, make_page(list));
+
+            list.set_properties(Properties{std::vector<Property>{Property{"class", "other"}, Property{"hidden", ""}}});
+            patches = check(before, make_page(list));
+
+            REQUIRE(patches.size() == 2);
+            REQUIRE(patches[0].get_type() == Patch::Type::Set_Property);
+            REQUIRE(patches[0].get_path() == std::vector<std::size_t>{0, 1});
+            REQUIRE(patches[0].get_key() == "class");
+            REQUIRE(patches[0].get_value() == "other");
+
+            list.set_properties(Properties{std::vector<Property>{Property{"class", "a"}, Property{"class", "b"}}});
+            check(before, make_page(list));
+
+            Section changed{make_page(make_list({"a", "b", "c", "d", "e"}))};
+            changed.set_tag(Tag::Div);
+            patches = check(before, changed);
+
+            REQUIRE(patches.size() == 1);
+            REQUIRE(patches[0].get_type() == Patch::Type::Replace);
+            REQUIRE(patches[0].get_path().empty());
+
+            Section mixed{Tag::Body, {}};
+            mixed.push_back(Element{Tag::P, {}, "text"});
+            mixed.push_back(make_list({"a"}));
+
+            Section swapped{Tag::Body, {}};
+            swapped.push_back(make_list({"a"}));
+            swapped.push_back(Element{Tag::Span, {}, "text"});
+            swapped.push_back(Element{"", {}, " raw ", Type::Text});
+
+            check(mixed, swapped);
+            check(swapped, mixed);
+
+            // erased children are not counted in paths
+            Section holes{make_list({"a", "b", "c"})};
+            holes.erase(0);
+            check(holes, make_list({"b", "x"}));
+            check(make_list({"b", "x"}), holes);
+
+            docpp::Arena arena{};
+            Section allocated{parse(before.get(), arena)};
+            allocated.apply(diff(allocated, make_page(make_list({"a", "z"}))));
+            REQUIRE(allocated.get() == make_page(make_list({"a", "z"})).get());
+
+            Document document{before};
+            Document other{make_page(make_list({"a"}))};
+            document.get_section().apply(diff(document, other));
+            REQUIRE(document.get() == other.get());
+
+            Section target{before};
+
+            for (const Patch& it : std::vector<Patch>{Patch{Patch::Type::Remove, {0, 9}}, Patch{Patch::Type::Remove, {0, 0, 0}}, Patch{Patch::Type::Remove_Property, {0, 2}, "missing"}}) {
+                try {
+                    target.apply(it);
+                    REQUIRE(false);
+                } catch (const docpp::out_of_range&) {
+                }
+            }
+
+            for (const Patch& it : std::vector<Patch>{Patch{Patch::Type::Set_Data, {}, "", "x"}, Patch{Patch::Type::Set_Data, {0, 1}, "", "x"}, Patch{Patch::Type::Insert, {0, 0}}}) {
+                try {
+                    target.apply(it);
+                    REQUIRE(false);
+                } catch (const docpp::invalid_argument&) {
+                }
+            }
+
+            REQUIRE(target.get() == before.get());
+        };
+
+        const auto test_indexes = []() {
+            using namespace docpp::HTML;
+
+            const auto make_product = [](const std::string& id) {
+                Section product{Tag::Div, Properties{std::vector<Property>{Property{"class", "product  card product"}, Property{"id", "product-" + id}}}};
+                product.push_back(Element{Tag::H2, {Property{"class", "title"}}, "Product " + id});
+                product.push_back(Element{Tag::Span, {Property{"class", "price"}}, "$" + id});
+                return product;
+            };
+
+            const auto get_data = [](const std::vector<const Section::Node*>& nodes) {
+                std::vector<std::string> ret{};
+
+                for (const Section::Node* it : nodes) {
+                    ret.push_back(it->is_element() ? std::string{it->get_element().get_data()} : it->get_section().get_tag());
+                }
+
+                return ret;
+            };
+
+            for (const bool indexing : {false, true}) {
+                Section body{Tag::Body, {}};
+                body.set_indexing(indexing);
+                REQUIRE(body.is_indexing() == indexing);
+
+                REQUIRE(body.get_by_id("product-1") == nullptr);
+                REQUIRE(body.get_by_tag(Tag::Div).empty());
+
+                for (int i{0}; i < 3; i++) {
+                    body.push_back(make_product(std::to_string(i)));
+                }
+
+                REQUIRE(body.get_by_id("product-1") != nullptr);
+                REQUIRE(body.get_by_id("product-1")->get_section().at(0).get_data() == "Product 1");
+                REQUIRE(body.get_by_id("product-7") == nullptr);
+                REQUIRE(body.get_by_class("product").size() == 3);
+                REQUIRE(body.get_by_class("card").size() == 3);
+                REQUIRE(body.get_by_class("").empty());
+                REQUIRE(get_data(body.get_by_class("title")) == std::vector<std::string>{"Product 0", "Product 1", "Product 2"});
+                REQUIRE(get_data(body.get_by_tag("span")) == std::vector<std::string>{"$0", "$1", "$2"});
+                REQUIRE(body.get_by_tag(Tag::Body).empty());
+
+                // changes are kept in document order, wherever they happen
+                body.push_back(make_product("3"));
+                body.insert(1, Section{Tag::Span, {Property{"id", "note"}}});
+                REQUIRE(get_data(body.get_by_tag(Tag::Span)) == std::vector<std::string>{"$0", "span", "$2", "$3"});
+                REQUIRE(body.get_by_id("product-1") == nullptr);
+                REQUIRE(body.get_by_id("note")->get_section().get_tag() == "span");
+
+                body.insert(5, Element{Tag::Span, {Property{"id", "last"}}, "last"});
+                REQUIRE(get_data(body.get_by_tag(Tag::Span)) == std::vector<std::string>{"$0", "span", "$2", "$3", "last"});
+                body.insert(5, Element{Tag::P, {}, "replaced"});
+                REQUIRE(body.get_by_id("last") == nullptr);
+                REQUIRE(get_data(body.get_by_tag(Tag::P)) == std::vector<std::string>{"replaced"});
+
+                body.erase(1);
+                REQUIRE(body.get_by_id("note") == nullptr);
+                REQUIRE(get_data(body.get_by_tag(Tag::Span)) == std::vector<std::string>{"$0", "$2", "$3"});
+
+                body.erase(0);
+                REQUIRE(get_data(body.get_by_class("price")) == std::vector<std::string>{"$2", "$3"});
+
+                body.push_front(Element{Tag::Span, {}, "first"});
+                REQUIRE(get_data(body.get_by_tag(Tag::Span)) == std::vector<std::string>{"first", "$2", "$3"});
+
+                Section& product{body.children().begin()->is_section() ? body.children().begin()->get_section() : (++body.children().begin())->get_section()};
+                product.push_back(Element{Tag::Span, {Property{"class", "price sale"}}, "$1"});
+                product.set_properties(Properties{Property{"id", "renamed"}});
+
+                REQUIRE(body.get_by_id("product-2") == nullptr);
+                REQUIRE(body.get_by_id("renamed") == &*++body.children().begin());
+                REQUIRE(get_data(body.get_by_class("price")) == std::vector<std::string>{"$2", "$1", "$3"});
+                REQUIRE(get_data(body.get_by_class("sale")) == std::vector<std::string>{"$1"});
+                REQUIRE(get_data(body.get_by_class("product")) == std::vector<std::string>{"div"});
+            }
+
+            // the indexes of every ancestor follow changes deep in the tree
+            Section html{Tag::Html, {}};
+            html.set_indexing(true);
+            html.push_back(Section{Tag::Body, {}});
+            REQUIRE(html.get_by_tag(Tag::Body).size() == 1);
+
+            Section& body{html.children().begin()->get_section()};
+            body.set_indexing(true);
+            REQUIRE(html.get_by_tag(Tag::Div).empty());
+            REQUIRE(body.get_by_tag(Tag::Div).empty());
+
+            body.push_back(Section{Tag::Div, {Property{"id", "a"}}});
+            body.insert(3, Element{Tag::P, {Property{"class", "x"}}, "p"});
+            REQUIRE(html.get_by_id("a") == body.get_by_id("a"));
+            REQUIRE(html.get_by_id("a") != nullptr);
+            REQUIRE(html.get_by_class("x").size() == 1);
+            REQUIRE(body.get_by_class("x").size() == 1);
+
+            Section copy{html};
+            REQUIRE(copy.is_indexing());
+            REQUIRE(copy.get_by_id("a") != nullptr);
+            REQUIRE(copy.get_by_id("a") != html.get_by_id("a"));
+
+            Section moved{std::move(copy)};
+            REQUIRE(moved.get_by_class("x").size() == 1);
+
+            html.set_indexing(false);
+            REQUIRE(html.get_by_class("x").size() == 1);
+        };
+
+        const auto test_query = []() {
+            using namespace docpp::HTML;
+
+            const Section page{parse("<html><body>"
+                "<div id=\"main\" class=\"content wide\">"
+                    "<h1>Title</h1>"
+                    "<a href=\"/one\" class=\"link\">one</a>"
+                    "<p>text <a href=\"/two\" lang=\"en-US\">two</a></p>"
+                    "<a name=\"anchor\">three</a>"
+                    "<ul><li>1</li><li class=\"item last\">2</li></ul>"
+                    "<span></span>"
+                "</div>"
+                "<div class=\"content\"><a href=\"https://example.com/x.png\">four</a></div>"
+                "<a href=\"/five\">five</a>"
+            "</body></html>")};
+
+            const auto get_data = [](const std::vector<const Section::Node*>& nodes) {
+                std::vector<std::string> ret{};
+
+                for (const Section::Node* it : nodes) {
+                    ret.push_back(it->is_element() ? std::string{it->get_element().get_data()} : it->get_section().get_tag());
+                }
+
+                return ret;
+            };
+
+            for (const bool indexing : {false, true}) {
+                Section section{page};
+                section.set_indexing(indexing);
+
+                const Document document{section};
+
+                REQUIRE(get_data(section.query_selector_all("div.content > a[href]")) == std::vector<std::string>{"one", "four"});
+                REQUIRE(get_data(section.query_selector_all("div.content a[href]")) == std::vector<std::string>{"one", "two", "four"});
+                REQUIRE(get_data(section.query_selector_all("a")) == std::vector<std::string>{"one", "two", "three", "four", "five"});
+                REQUIRE(get_data(section.query_selector_all("#main a")) == std::vector<std::string>{"one", "two", "three"});
+                REQUIRE(get_data(section.query_selector_all("body > a, h1")) == std::vector<std::string>{"Title", "five"});
+                REQUIRE(get_data(section.query_selector_all("h1 + a")) == std::vector<std::string>{"one"});
+                REQUIRE(get_data(section.query_selector_all("h1 ~ a")) == std::vector<std::string>{"one", "three"});
+                REQUIRE(get_data(section.query_selector_all("li:first-child, li:last-child")) == std::vector<std::string>{"1", "2"});
+                REQUIRE(get_data(section.query_selector_all("li:only-child")).empty());
+                REQUIRE(get_data(section.query_selector_all(".content > :first-child")) == std::vector<std::string>{"Title", "four"});
+                REQUIRE(get_data(section.query_selector_all("span:empty")) == std::vector<std::string>{""});
+                REQUIRE(get_data(section.query_selector_all(".item.last")) == std::vector<std::string>{"2"});
+                REQUIRE(get_data(section.query_selector_all("li.item.first")).empty());
+                REQUIRE(get_data(section.query_selector_all("#nothing")).empty());
+                REQUIRE(get_data(section.query_selector_all("[lang|=en]")) == std::vector<std::string>{"two"});
+                REQUIRE(get_data(section.query_selector_all("a[href^=\"/\"]")) == std::vector<std::string>{"one", "two", "five"});
+                REQUIRE(get_data(section.query_selector_all("a[href$='.png']")) == std::vector<std::string>{"four"});
+                REQUIRE(get_data(section.query_selector_all("a[href*=example]")) == std::vector<std::string>{"four"});
+                REQUIRE(get_data(section.query_selector_all("[class~=wide] > ul > *")) == std::vector<std::string>{"1", "2"});
+                REQUIRE(get_data(section.query_selector_all("html div:first-child > ul")) == std::vector<std::string>{"ul"});
+                REQUIRE(get_data(section.query_selector_all("DIV.content > A[HREF]")) == std::vector<std::string>{"one", "four"});
+                REQUIRE(get_data(section.query_selector_all("Li.item, a[Name]")) == std::vector<std::string>{"three", "2"});
+                REQUIRE(get_data(section.query_selector_all("div.CONTENT, #MAIN, a[href$='.PNG']")).empty());
+
+                REQUIRE(section.query_selector("a[name]")->get_element().get_data() == "three");
+                REQUIRE(section.query_selector("#main")->get_section().get_properties().at(0).get_value() == "main");
+                REQUIRE(section.query_selector("table") == nullptr);
+
+                const Selector selector{"div.content > a[href]"};
+                REQUIRE(document.query_selector(selector)->get_element() == section.query_selector(selector)->get_element());
+                REQUIRE(document.query_selector_all(selector).size() == 2);
+                REQUIRE(document.query_selector("li.item")->get_element().get_data() == "2");
+                REQUIRE(document.query_selector_all("a").size() == 5);
+            }
+
+            for (const char* it : {"", "a,", ",a", "a >", "a[href", "a[=x]", "a:hover", "a:", "a[href=\"x]", ".", "a $ b"}) {
+                try {
+                    Selector{it};
+                    REQUIRE(false);
+                } catch (const docpp::invalid_argument&) {
+                }
+            }
+        };
+
+        const auto test_atoms = []() {
+            using namespace docpp::HTML;
+
+            REQUIRE(Atom{"div"} == Atom{Tag::Div});
+            REQUIRE(&Atom{"div"}.get() == &Atom{std::string{"div"}}.get());
+            REQUIRE(Atom{Tag::Abbr} == Atom{Tag::Abbreviation});
+            REQUIRE(Atom{"class"} == Atom{"class"});
+            REQUIRE(Atom{"data-atom-test"} == Atom{std::string{"data-atom"} + "-test"});
+            REQUIRE(Atom{"data-atom-test"} != Atom{"data-atom-other"});
+            REQUIRE(Atom{"data-atom-test"}.get() == "data-atom-test");
+            REQUIRE(Atom{""} == Atom{});
+            REQUIRE(Atom{}.empty());
+            REQUIRE(Atom{}.get().empty());
+            REQUIRE(Atom{Tag::Empty}.empty());
+
+            Atom atom{};
+            REQUIRE(Atom::find("div", atom));
+            REQUIRE(atom == Atom{Tag::Div});
+            REQUIRE(Atom::find("data-atom-test", atom));
+            REQUIRE(atom.get() == "data-atom-test");
+            REQUIRE(!Atom::find("data-never-interned", atom));
+
+            try {
+                Atom{static_cast<Tag>(-1)};
+                REQUIRE(false);
+            } catch (const docpp::invalid_argument&) {
+            }
+
+            Element first{Tag::Td, {Property{"class", "cell"}}, "1"};
+            Element second{"td", {Property{std::string{"cl"} + "ass", "cell"}}, "1"};
+
+            REQUIRE(first.get_tag_atom() == second.get_tag_atom());
+            REQUIRE(&first.get_tag() == &second.get_tag());
+            REQUIRE(&first.get_properties().at(0).get_key() == &second.get_properties().at(0).get_key());
+            REQUIRE(first == second);
+
+            second.set_tag("th");
+            REQUIRE(first != second);
+            REQUIRE(second.get_tag() == "th");
+            REQUIRE(second.get() == "<th class=\"cell\">1</th>");
+
+            Property property{"data-atom-test", "value"};
+            REQUIRE(property.get() == std::make_pair(std::string{"data-atom-test"}, std::string{"value"}));
+            property.set_key("id");
+            REQUIRE(property.get_key_atom() == Atom{"id"});
+            property.clear();
+            REQUIRE(property.empty());
+
+            Section section{Tag::Table, {}};
+            section.push_back(first);
+            section.push_back(Element{"custom-cell", {}, "2"});
+
+            REQUIRE(section.get_tag_atom() == Atom{"table"});
+            REQUIRE(section["td"].size() == 1);
+            REQUIRE(section[Tag::Td].size() == 1);
+            REQUIRE(section["custom-cell"].at("2").get_tag() == "custom-cell");
+            REQUIRE(section["data-never-interned"].empty());
+            REQUIRE(!Atom::find("data-never-interned", atom));
+            Properties properties{std::vector<Property>{Property{"id", "x"}, Property{"class", "cell"}}};
+            REQUIRE(properties.find(Property{"class", "other"}) == 1);
+
+            // once the table is full, atoms store their own string and compare by content
+            const Atom::size_type limit{Atom::get_limit()};
+            Atom::set_limit(0);
+
+            const Atom stored{"data-past-limit"};
+            REQUIRE(stored == Atom{"data-past-limit"});
+            REQUIRE(&stored.get() != &Atom{"data-past-limit"}.get());
+            REQUIRE(stored != Atom{"data-past-other"});
+            REQUIRE(stored != Atom{Tag::Div});
+            REQUIRE(stored != Atom{});
+            REQUIRE(stored.get_arena() == nullptr);
+            REQUIRE(&Atom{"data-atom-test"}.get() == &Atom{std::string{"data-atom-test"}}.get());
+            REQUIRE(Atom::find("data-past-limit", atom));
+            REQUIRE(atom == stored);
+
+            const std::string markup{"<x-card data-x=\"1\"><x-body><p>a</p><x-item data-y=\"2\">b</x-item></x-body></x-card>"};
+            REQUIRE(parse(markup).get() == markup);
+
+            Section copy{};
+
+            {
+                docpp::Arena arena{};
+                const Atom in_arena{"data-past-limit", &arena};
+
+                REQUIRE(in_arena.get_arena() == &arena);
+                REQUIRE(in_arena == stored);
+                REQUIRE(&Atom{"data-past-limit", &arena}.get() == &in_arena.get());
+                REQUIRE(Atom{in_arena, nullptr}.get_arena() == nullptr);
+                REQUIRE(Atom{stored, &arena}.get_arena() == &arena);
+
+                // the names of the parsed tree are freed with the arena, even below sections whose destructors are skipped
+                const Section parsed{parse(markup, arena)};
+                REQUIRE(parsed.get() == markup);
+                REQUIRE(parsed.get_by_tag("x-item").size() == 1);
+                REQUIRE(parsed.get_by_tag("x-item").at(0)->get_element().get_tag_atom().get_arena() == &arena);
+
+                copy = parsed;
+                REQUIRE(copy == parsed);
+            }
+
+            REQUIRE(copy.get() == markup);
+            REQUIRE(copy.get_by_tag("x-item").size() == 1);
+
+            Atom::set_limit(limit);
+            REQUIRE(Atom::get_limit() == limit);
+        };
+
+        const auto test_compact_elements = []() {
+            using namespace docpp::HTML;
+
+            static_assert(!std::is_convertible<std::string, Atom>::value, "interning must be explicit");
+            static_assert(sizeof(Element) <= sizeof(Atom) + sizeof(Properties) + sizeof(docpp::String) + 2 * sizeof(int), "Element must not be padded");
+
+            REQUIRE(Element{Tag::Br}.get_type() == Type::Non_Closed);
+            REQUIRE(Element{Tag::Img, Properties{}, std::string{}}.get_type() == Type::Non_Closed);
+            REQUIRE(Element{Tag::Empty, {}, "text"}.get_type() == Type::Text);
+            REQUIRE(Element{Tag::Br}.get() == "<br>");
+
+            Element element{Tag::Div, {}, "data"};
+            element.set_tag(Tag::Hr);
+            REQUIRE(element.get_tag() == "hr");
+            REQUIRE(element.get_type() == Type::Non_Closed);
+
+            for (const Tag it : {static_cast<Tag>(-1), static_cast<Tag>(100000)}) {
+                try {
+                    Element{it};
+                    REQUIRE(false);
+                } catch (const docpp::invalid_argument&) {
+                }
+
+                try {
+                    element.set_tag(it);
+                    REQUIRE(false);
+                } catch (const docpp::invalid_argument&) {
+                }
+            }
+
+            REQUIRE(element.get_tag() == "hr");
+
+            REQUIRE(Element{"my-widget", {}, "x"} == Element{std::string{"my-"} + "widget", {}, "x"});
+            REQUIRE(Element{"my-widget", {}, "x"} != Element{"my-gadget", {}, "x"});
+            REQUIRE(Element{Tag::P, {}, "x"} == Element{"p", {}, "x", Type::Non_Self_Closing});
+            REQUIRE(Element{Tag::P, {}, "x"} != Element{"p", {}, "x", Type::Self_Closing});
+            REQUIRE(Element{Tag::P, {}, "x"} != Element{Tag::P, {}, "y"});
+            REQUIRE(Element{Tag::P, {Property{"id", "a"}}, "x"} != Element{Tag::P, {Property{"id", "b"}}, "x"});
+        };
+
+        const auto the_test_to_end_all_tests = []() {
+            using namespace docpp::HTML;
+
+            Section base_section{docpp::HTML::Tag::Html, {}};
+
+            base_section.push_back(Element{docpp::HTML::Tag::H2, {}, "data"});
+            base_section.push_back(Element{docpp::HTML::Tag::H3, {}, "data"});
+            base_section.push_back(Element{docpp::HTML::Tag::H4, {}, "data"});
+            base_section.push_back(Element{docpp::HTML::Tag::H5, {}, "data"});
+
+            REQUIRE(base_section.get() == "<html><h2>data</h2><h3>data</h3><h4>data</h4><h5>data</h5></html>");
+
+            Section section{docpp::HTML::Tag::Html, {}};
+            Section section_plus_plus{docpp::HTML::Tag::Html, {}};
+
+            // just... why? because i can, that's why
+            for (std::size_t i = 0; i < 10; ++i) {
+                Section _section{docpp::HTML::Tag::Div, {}};
+
+                _section.push_back(Element{docpp::HTML::Tag::P, {}, "Data " + std::to_string(i)});
+
+                section_plus_plus += _section;
+                section_plus_plus += section_plus_plus;
+
+                REQUIRE(section_plus_plus.size() == (i + 1) * 2);
+            }
+        };
+
+        test_get_and_set();
+        test_copy_section();
+        test_operators();
+        test_constructors();
+        test_iterators();
+        test_find();
+        test_insert();
+        test_swap();
+        test_front_and_back();
+        test_size_empty_and_clear();
+        test_push_front_and_back();
+        test_string_get();
+        test_constructors();
+        test_handle_elements();
+        test_handle_sections();
+        test_mixed_children();
+        test_arena();
+        test_move();
+        test_views();
+        test_children();
+        test_caching();
+        test_threads();
+        test_deep();
+        test_minified();
+        test_diff();
+        test_indexes();
+        test_query();
+        test_atoms();
+        test_compact_elements();
+        the_test_to_end_all_tests();
+    }
+
+    void test_document() {
+        const auto test_get_and_set = []() {
+            using namespace docpp::HTML;
+
+            Document document;
+
+            document.set(Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H1, {}, "data1"},
+                    Element{docpp::HTML::Tag::H2, {}, "data2"},
+                    Element{docpp::HTML::Tag::H3, {}, "data3"},
+                    Element{docpp::HTML::Tag::H4, {}, "data4"},
+                    Element{docpp::HTML::Tag::H5, {}, "data5"},
+                    Element{docpp::HTML::Tag::H6, {}, "data6"}
+                }
+            });
+
+            REQUIRE(document.get() == "<!DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
+            REQUIRE(document.get<std::string>() == "<!DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
+            REQUIRE(document.get<std::string>(docpp::HTML::Formatting::None) == "<!DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
+            REQUIRE(document.get<std::string>(docpp::HTML::Formatting::Pretty) == "<!DOCTYPE html>\n<html>\n\t<h1>data1</h1>\n\t<h2>data2</h2>\n\t<h3>data3</h3>\n\t<h4>data4</h4>\n\t<h5>data5</h5>\n\t<h6>data6</h6>\n</html>");
+            REQUIRE(document.get<std::string>(docpp::HTML::Formatting::Newline) == "<!DOCTYPE html>\n<html>\n<h1>data1</h1>\n<h2>data2</h2>\n<h3>data3</h3>\n<h4>data4</h4>\n<h5>data5</h5>\n<h6>data6</h6>\n</html>");
+
+            REQUIRE(document.get_doctype() == "<!DOCTYPE html>");
+            REQUIRE(document.get_section() == Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H1, {}, "data1"},
+                    Element{docpp::HTML::Tag::H2, {}, "data2"},
+                    Element{docpp::HTML::Tag::H3, {}, "data3"},
+                    Element{docpp::HTML::Tag::H4, {}, "data4"},
+                    Element{docpp::HTML::Tag::H5, {}, "data5"},
+                    Element{docpp::HTML::Tag::H6, {}, "data6"}
+                }
+            });
+
+            REQUIRE(document.get_section().get() == "<html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
+
+            document.set_doctype("<!NEW_DOCTYPE html>");
+
+            REQUIRE(document.get_doctype() == "<!NEW_DOCTYPE html>");
+            REQUIRE(document.get() == "<!NEW_DOCTYPE html><html><h1>data1</h1><h2>data2</h2><h3>data3</h3><h4>data4</h4><h5>data5</h5><h6>data6</h6></html>");
+        };
+
+        const auto test_copy_document = []() {
+            using namespace docpp::HTML;
+
+            Document document;
+
+            document.set(Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H1, {}, "data1"},
+                    Element{docpp::HTML::Tag::H2, {}, "data2"},
+                    Element{docpp::HTML::Tag::H3, {}, "data3"},
+                    Element{docpp::HTML::Tag::H4, {}, "data4"},
+                    Element{docpp::HTML::Tag::H5, {}, "data5"},
+                    Element{docpp::HTML::Tag::H6, {}, "data6"}
+                }
+            });
+
+            Document new_document = document;
+
+            REQUIRE(document == new_document);
+            REQUIRE(document.empty() == false);
+
+            document.clear();
+
+            REQUIRE(document.empty() == true);
+
+            document = std::move(new_document);
+
+            REQUIRE(document.empty() == false);
+
+            Document assigned{};
+            assigned = document;
+
+            REQUIRE(assigned == document);
+            REQUIRE(assigned.get() == document.get());
+        };
+
+        const auto test_operators = []() {
+            using namespace docpp::HTML;
+
+            Document document1;
+            Document document2;
+
+            document1.set(Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H1, {}, "data1"},
+                    Element{docpp::HTML::Tag::H2, {}, "data2"},
+                    Element{docpp::HTML::Tag::H3, {}, "data3"},
+                    Element{docpp::HTML::Tag::H4, {}, "data4"},
+                    Element{docpp::HTML::Tag::H5, {}, "data5"},
+                    Element{docpp::HTML::Tag::H6, {}, "data6"}
+                }
+            });
+
+            document2.set(Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H1, {}, "data1"},
+                    Element{docpp::HTML::Tag::H2, {}, "data2"},
+                    Element{docpp::HTML::Tag::H3, {}, "data3"},
+                    Element{docpp::HTML::Tag::H4, {}, "data4"},
+                    Element{docpp::HTML::Tag::H5, {}, "data5"},
+                    Element{docpp::HTML::Tag::H6, {}, "data6"}
+                }
+            });
+
+            REQUIRE(document1 == document2);
+
+            document2.set(Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H6, {}, "data1"},
+                    Element{docpp::HTML::Tag::H5, {}, "data2"},
+                    Element{docpp::HTML::Tag::H4, {}, "data3"},
+                    Element{docpp::HTML::Tag::H3, {}, "data4"},
+                    Element{docpp::HTML::Tag::H2, {}, "data5"},
+                    Element{docpp::HTML::Tag::H1, {}, "data6"}
+                }
+            });
+
+            REQUIRE(document1 != document2);
+        };
+
+        const auto test_constructors = []() {
+            using namespace docpp::HTML;
+
+            Document document{};
+
+            REQUIRE(document.get_doctype() == "<!DOCTYPE html>");
+            REQUIRE(document.get_section().get_tag() == "");
+            REQUIRE(document.get_section().get_sections().empty());
+            REQUIRE(document.get_section().get_elements().empty());
+            REQUIRE(document.get_section().get_properties().empty());
+
+            Document document2(Section {
+                docpp::HTML::Tag::Html, {},
+                {
+                    Element{docpp::HTML::Tag::H1, {}, "data1"},
+                    Element{docpp::HTML::Tag::H2, {}, "data2"},
+                    Element{docpp::HTML::Tag::H3, {}, "data3"},
+                    Element{docpp::HTML::Tag::H4, {}, "data4"},
+                    Element{docpp::HTML::Tag::H5, {}, "data5"},
+                    Element{docpp::HTML::Tag::H6, {}, "data6"}
+                }
+            });
+
+            REQUIRE(document2.get_doctype() == "<!DOCTYPE html>");
+            REQUIRE(document2.get_section().get_tag() == "html");
+            REQUIRE(document2.get_section().get_sections().empty());
+            REQUIRE(document2.get_section().get_elements().size() == 6);
+            REQUIRE(document2.get_section().get_properties().empty());
+
+            Document document3(Section(docpp::HTML::Tag::Html, {}, {
+                Section(docpp::HTML::Tag::Head, {}, {
+                    Element(docpp::HTML::Tag::Title, {}, "Title")
+                }),
+                Section(docpp::HTML::Tag::Body, {}, {
+                    Element(docpp::HTML::Tag::H1, {}, "Hello, World!")
+                }),
+            }), "<!NEW_DOCTYPE html>");
+
+            REQUIRE(document3.get_doctype() == "<!NEW_DOCTYPE html>");
+            REQUIRE(document3.get_section().get_tag() == "html");
+            REQUIRE(document3.get_section().get_sections().size() == 2);
+            REQUIRE(document3.get_section().get_elements().empty());
+            REQUIRE(document3.get_section().get_properties().empty());
+        };
+
+        const auto test_write_to = []() {
+            using namespace docpp::HTML;
+
+            Section body{docpp::HTML::Tag::Body, {Property{"class", "main"}}};
+            Section div{docpp::HTML::Tag::Div, {}};
+
+            div.push_back(Element{docpp::HTML::Tag::P, {}, "paragraph"});
+            div.push_back(Element{docpp::HTML::Tag::Img, {Property{"src", "image.png"}}});
+            body.push_back(Element{docpp::HTML::Tag::H1, {}, "header"});
+            body.push_back(div);
+            body.push_back(Element{docpp::HTML::Tag::Empty, {}, "text"});
+
+            Document document{Section{docpp::HTML::Tag::Html, {}, std::vector<Section>{body}}};
+
+            for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Newline}) {
+                std::string str{};
+                docpp::StringSink string_sink{str};
+                document.write_to(string_sink, formatting);
+
+                REQUIRE(str == document.get(formatting));
+
+                std::ostringstream stream{};
+                docpp::StreamSink stream_sink{stream};
+                document.write_to(stream_sink, formatting, 1);
+
+                REQUIRE(stream.str() == document.get(formatting, 1));
+
+                std::string chunks{};
+                docpp::Sink::size_type calls{0};
+                {
+                    docpp::CallbackSink callback_sink{[&chunks, &calls](const char* data, docpp::Sink::size_type size) {
+                        REQUIRE(size <= 16);
+                        chunks.append(data, size);
+                        ++calls;
+                    }, 16};
+                    document.write_to(callback_sink, formatting);
+                }
+
+                REQUIRE(chunks == document.get(formatting));
+                REQUIRE(calls > 1);
+
+                std::string element{};
+                docpp::StringSink element_sink{element};
+                Element{docpp::HTML::Tag::H1, {}, "data"}.write_to(element_sink, formatting, 2);
+
+                REQUIRE(element == Element{docpp::HTML::Tag::H1, {}, "data"}.get(formatting, 2));
+
+                std::string section{};
+                docpp::StringSink section_sink{section};
+                body.write_to(section_sink, formatting);
+
+                REQUIRE(section == body.get(formatting));
+
+                std::string buffer{"prefix"};
+                document.get_into(buffer, formatting);
+                body.get_into(buffer, formatting, 1);
+                div.get_into(buffer, formatting);
+                Element{docpp::HTML::Tag::H1, {}, "data"}.get_into(buffer, formatting);
+
+                REQUIRE(buffer == "prefix" + document.get(formatting) + body.get(formatting, 1) + div.get(formatting) + Element{docpp::HTML::Tag::H1, {}, "data"}.get(formatting));
+
+                for (int tabc{0}; tabc < 3; tabc++) {
+                    REQUIRE(document.serialized_size(formatting, tabc) == document.get(formatting, tabc).size());
+                    REQUIRE(body.serialized_size(formatting, tabc) == body.get(formatting, tabc).size());
+                    REQUIRE(div.serialized_size(formatting, tabc) == div.get(formatting, tabc).size());
+                    REQUIRE(div.at(0).serialized_size(formatting, tabc) == div.at(0).get(formatting, tabc).size());
+                    REQUIRE(body.at(2).serialized_size(formatting, tabc) == body.at(2).get(formatting, tabc).size());
+                }
+            }
+
+            std::FILE* file{std::tmpfile()};
+            REQUIRE(file != nullptr);
+
+            docpp::FileSink file_sink{file};
+            document.write_to(file_sink, Formatting::Pretty);
+            file_sink.flush();
+
+            std::string contents(static_cast<std::size_t>(std::ftell(file)), '\0');
+            std::rewind(file);
+            REQUIRE(std::fread(&contents[0], 1, contents.size(), file) == contents.size());
+            std::fclose(file);
+
+            REQUIRE(contents == document.get(Formatting::Pretty));
+        };
+
+        test_get_and_set();
+        test_copy_document();
+        test_operators();
+        test_constructors();
+        const auto test_parse = []() {
+            using namespace docpp::HTML;
+
+            const std::string html{"<div class=\"a\"><p>Hello &amp; bye</p> <span id=\"x\">y</span><br><img src=\"x\"/></div>"};
+            const Section section{parse(html)};
+
+            REQUIRE(section.get() == html);
+            REQUIRE(section.size() == 1);
+
+            const Section& div{section.get_sections().at(0)};
+            REQUIRE(div.get_tag() == "div");
+            REQUIRE(div.get_properties().at(0).get_key() == "class");
+            REQUIRE(div.get_properties().at(0).get_value() == "a");
+
+            REQUIRE(parse("<script>if (a<b) {}</script><p>unclosed<b>bold").get() == "<script>if (a<b) {}</script><p>unclosed<b>bold</b></p>");
+            REQUIRE(parse("a <3 b</div> c <").get() == "a <3 b c <");
+            REQUIRE(parse("<input disabled value='say \"hi\"'><DIV>X</div>").get() == "<input disabled=\"disabled\" value=\"say &quot;hi&quot;\"><div>X</div>");
+            REQUIRE(parse("<p data-x=1 >t").get() == "<p data-x=\"1\">t</p>");
+            REQUIRE(parse("<!-- c --><ul><li>1</li></ul>").get() == "<!-- c --><ul><li>1</li></ul>");
+            REQUIRE(parse("<P CLASS=x Data-Y=1>t").get() == "<p class=\"x\" data-y=\"1\">t</p>");
+
+            REQUIRE(parse("<ul><li>a<li><p>b<li>c</ul>").get() == "<ul><li>a</li><li><p>b</p></li><li>c</li></ul>");
+            REQUIRE(parse("<dl><dt>a<dd>b<dt>c</dl>").get() == "<dl><dt>a</dt><dd>b</dd><dt>c</dt></dl>");
+            REQUIRE(parse("<table><tr><td>1<th>2<tr><td>1<th>2</table>").get() == "<table><tr><td>1</td><th>2</th></tr><tr><td>1</td><th>2</th></tr></table>");
+            REQUIRE(parse("<select><option>a<option>b</select>").get() == "<select><option>a</option><option>b</option></select>");
+            REQUIRE(parse("<p>a<div>b</div>").get() == "<p>a</p><div>b</div>");
+            REQUIRE(parse("<p>a<span>b</span>").get() == "<p>a<span>b</span></p>");
+
+            // minified output leaves out the closing tags of li, p, td, th and tr, which the parser implies again
+            Section page{Tag::Body, {}};
+            Section items{"ul", {}};
+            items.push_back(Element{Tag::Li, {}, "one"});
+            items.push_back(Element{Tag::Li, {}, "two"});
+            Section cells{Tag::Table, {}};
+            Section row{Tag::Tr, {}};
+            row.push_back(Element{Tag::Td, {}, "1"});
+            row.push_back(Element{Tag::Th, {}, "2"});
+            cells.push_back(row);
+            cells.push_back(row);
+            page.push_back(items);
+            page.push_back(Element{Tag::P, {}, "text"});
+            page.push_back(cells);
+            page.push_back(Element{Tag::P, {}, "end"});
+
+            REQUIRE(page.get(Formatting::Minified) == "<body><ul><li>one<li>two</ul><p>text<table><tr><td>1<th>2<tr><td>1<th>2</table><p>end</body>");
+            REQUIRE(parse(page.get(Formatting::Minified)).get() == page.get());
+
+            docpp::Arena arena{1024};
+            const Section arena_section{parse(html, arena)};
+            REQUIRE(arena_section.get() == html);
+            REQUIRE(arena_section.get_arena() == &arena);
+
+            const Document document{parse_document("<!DOCTYPE html>\n<html><body>x</body></html>")};
+            REQUIRE(document.get_doctype() == "<!DOCTYPE html>");
+            REQUIRE(document.get() == "<!DOCTYPE html>\n<html><body>x</body></html>");
+            REQUIRE(parse_document("<p>x</p>").get_doctype().empty());
+        };
+
+        const auto test_template = []() {
+            using namespace docpp::HTML;
+
+            Section body{Tag::Body, {}};
+            body.push_back(Element{Tag::H1, {}, "Hello " + placeholder("name")});
+            body.push_back(Element{Tag::A, {Property{"href", "/users/" + placeholder("id")}}, placeholder("name") + "'s profile {{name}} {{ not a slot }} \x1A \x1A"});
+
+            const Document document{body};
+
+            for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Newline}) {
+                const Template templ{document, formatting};
+
+                REQUIRE(templ.size() == 2);
+                REQUIRE(templ.get_slots().at(0) == "name");
+                REQUIRE(templ.find("id") == 1);
+                REQUIRE(templ.find("missing") == Template::npos);
+
+                Section expected_body{Tag::Body, {}};
+                expected_body.push_back(Element{Tag::H1, {}, "Hello Jane"});
+                expected_body.push_back(Element{Tag::A, {Property{"href", "/users/42"}}, "Jane's profile {{name}} {{ not a slot }} \x1A \x1A"});
+
+                const Document expected{expected_body};
+
+                const std::vector<std::string> values{"Jane", "42"};
+
+                REQUIRE(templ.get(values) == expected.get(formatting));
+                REQUIRE(templ.serialized_size(values) == expected.get(formatting).size());
+                REQUIRE(templ.get(std::unordered_map<std::string, std::string>{{"name", "Jane"}, {"id", "42"}}) == expected.get(formatting));
+
+                std::ostringstream stream{};
+                docpp::StreamSink sink{stream};
+                templ.write_to(sink, values);
+
+                REQUIRE(stream.str() == expected.get(formatting));
+            }
+
+            // minified output leaves out the quotes of plain values, but a placeholder may be filled in with text that needs them
+            Section card{Tag::Div, Properties{std::vector<Property>{Property{"class", placeholder("classes")}, Property{"id", "card"}}}};
+            card.push_back(Element{"img", {Property{"alt", placeholder("alt")}}, "", Type::Self_Closing});
+
+            const Template minified{card, Formatting::Minified};
+
+            REQUIRE(minified.get(std::vector<std::string>{"card wide", "a \"quoted\" > title"}) == "<div class=\"card wide\" id=card><img alt=\"a \"quoted\" > title\"/></div>");
+
+            const Template section_template{body, Formatting::Pretty, 1};
+            REQUIRE(section_template.get(std::vector<std::string>{placeholder("name"), placeholder("id")}) == body.get(Formatting::Pretty, 1));
+            const Section literal{Tag::Div, {}, std::vector<Element>{Element{Tag::P, {}, "{{name}}"}}};
+            REQUIRE(Template{literal}.empty());
+            REQUIRE(Template{literal}.get(std::vector<std::string>{}) == "<div><p>{{name}}</p></div>");
+            REQUIRE(Template{Section{Tag::P, {}}}.empty());
+            REQUIRE(Template{Section{Tag::P, {}}}.get(std::vector<std::string>{}) == "<p></p>");
+
+            bool thrown{false};
+            try {
+                section_template.get(std::vector<std::string>{"a"});
+            } catch (const docpp::invalid_argument&) {
+                thrown = true;
+            }
+            REQUIRE(thrown);
+
+            for (const char* name : {"", "a b", "a}}", "\x1A"}) {
+                thrown = false;
+                try {
+                    placeholder(name);
+                } catch (const docpp::invalid_argument&) {
+                    thrown = true;
+                }
+                REQUIRE(thrown);
+            }
+        };
+
+        const auto test_hash = []() {
+            using namespace docpp::HTML;
+
+            Section body{Tag::Body, {}};
+
+            for (int i{0}; i < 3; i++) {
+                Section product{Tag::Div, Properties{Property{"class", "product"}}};
+                Section details{Tag::Div, {}};
+
+                details.push_back(Element{Tag::P, {}, "Product " + std::to_string(i)});
+                product.push_back(Element{Tag::H2, {}, "Title"});
+                product.push_back(details);
+                body.push_back(product);
+            }
+
+            Document document{body};
+
+            for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Minified}) {
+                const std::string expected{document.get(formatting)};
+
+                docpp::Hash hash{};
+                REQUIRE(document.get(hash, formatting) == expected);
+                REQUIRE(hash == docpp::Hash{expected});
+                REQUIRE(document.get_hash(formatting) == hash);
+                REQUIRE(document.get_section().get_hash(formatting, 1) == docpp::Hash{document.get_section().get(formatting, 1)});
+            }
+
+            const docpp::Hash before{document.get_hash()};
+
+            // cached sections hand over the hashes of their cached output, which must add up to the hash of the bytes
+            document.get_section().set_caching(true);
+
+            Section* details{nullptr};
+
+            for (Section::Node& it : document.get_section().children()) {
+                it.get_section().set_caching(true);
+
+                for (Section::Node& child : it.get_section().children()) {
+                    if (child.is_section()) {
+                        child.get_section().set_caching(true);
+                        details = &child.get_section();
+                    }
+                }
+            }
+
+            REQUIRE(document.get_hash() == before);
+            REQUIRE(document.get_hash() == before);
+
+            std::string out{};
+            docpp::StringSink string_sink{out};
+            docpp::HashingSink sink{string_sink, true};
+
+            document.write_to(sink);
+            sink.flush();
+
+            REQUIRE(out == document.get());
+            REQUIRE(sink.get_hash() == before);
+
+            docpp::Sha256 digest{};
+            digest.update(out.data(), out.size());
+
+            REQUIRE(sink.get_sha256() == digest.get());
+
+            details->push_back(Element{Tag::P, {}, "New"});
+
+            REQUIRE(document.get_hash() != before);
+            REQUIRE(document.get_hash() == docpp::Hash{document.get()});
+        };
+
+        test_write_to();
+        test_parse();
+        test_template();
+        test_hash();
+    }
+
+    void test_html() {
+        test_tag();
+        test_property();
+        test_properties();
+        test_element();
+        test_section();
+        test_document();
+    }
+} // namespace HTML
+
+inline namespace CSS {
+    void test_property() {
+        const auto test_get_and_set = []() {
+            using namespace docpp::CSS;
+
+            Property property;
+
+            property.set("key", "value");
+
+            REQUIRE(property.get().first == "key");
+            REQUIRE(property.get().second == "value");
+            REQUIRE(property.get_key() == "key");
+            REQUIRE(property.get_value() == "value");
+
+            property.set_key("new_key");
+
+            REQUIRE(property.get().first == "new_key");
+            REQUIRE(property.get().second == "value");
+            REQUIRE(property.get_key() == "new_key");
+            REQUIRE(property.get_value() == "value");
+
+            property.set_value("new_value");
+
+            REQUIRE(property.get().first == "new_key");
+            REQUIRE(property.get().second == "new_value");
+            REQUIRE(property.get_key() == "new_key");
+            REQUIRE(property.get_value() == "new_value");
 
             REQUIRE(property.get_key<std::string>() == "new_key");
             REQUIRE(property.get_value<std::string>() == "new_value");
@@ -1669,6 +3370,17 @@ inline namespace CSS {
 
             REQUIRE(stylesheet.front().get_tag() == "my_element");
             REQUIRE(stylesheet.back().get_tag() == "my_element2");
+
+            Element element{"my_element3", {}};
+            element.emplace_back("key5", "value5");
+
+            stylesheet.push_back(std::move(element));
+            stylesheet.emplace_back("my_element4", std::vector<Property>{Property{"key6", "value6"}});
+
+            REQUIRE(stylesheet.size() == 4);
+            REQUIRE(stylesheet.at(2).get_properties().at(0).get().first == "key5");
+            REQUIRE(stylesheet.back().get_tag() == "my_element4");
+            REQUIRE(stylesheet.back().get_properties().at(0).get().second == "value6");
         };
 
         const auto test_swap = []() {
@@ -1830,6 +3542,144 @@ inline namespace CSS {
             }
         };
 
+        const auto test_write_to = []() {
+            using namespace docpp::CSS;
+
+            Stylesheet stylesheet{};
+
+            stylesheet.push_back(Element{"body", {{Property{"color", "black"}, Property{"margin", "0"}}}});
+            stylesheet.push_back(Element{"a:hover", {{Property{"color", "red"}}}});
+
+            for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Newline, Formatting::Minified}) {
+                std::ostringstream stream{};
+                docpp::StreamSink stream_sink{stream};
+                stylesheet.write_to(stream_sink, formatting, 1);
+
+                REQUIRE(stream.str() == stylesheet.get(formatting, 1));
+
+                std::string str{};
+                docpp::StringSink string_sink{str};
+                stylesheet.at(0).write_to(string_sink, formatting);
+
+                REQUIRE(str == stylesheet.at(0).get(formatting));
+
+                std::string buffer{"prefix"};
+                stylesheet.get_into(buffer, formatting);
+                stylesheet.at(1).get_into(buffer, formatting, 1);
+
+                REQUIRE(buffer == "prefix" + stylesheet.get(formatting) + stylesheet.at(1).get(formatting, 1));
+
+                for (int tabc{0}; tabc < 3; tabc++) {
+                    REQUIRE(stylesheet.serialized_size(formatting, tabc) == stylesheet.get(formatting, tabc).size());
+                    REQUIRE(stylesheet.at(0).serialized_size(formatting, tabc) == stylesheet.at(0).get(formatting, tabc).size());
+                }
+            }
+        };
+
+        const auto test_parse = []() {
+            using namespace docpp::CSS;
+
+            Stylesheet stylesheet{};
+
+            stylesheet.push_back(Element{"body", {{Property{"color", "black"}, Property{"margin", "0 auto"}}}});
+            stylesheet.push_back(Element{"a:hover, a[href=\"{;}\"]", {{Property{"content", "\"};\""}}}});
+
+            for (const Formatting formatting : {Formatting::None, Formatting::Pretty, Formatting::Newline}) {
+                REQUIRE(parse(stylesheet.get(formatting)) == stylesheet);
+            }
+
+            const Stylesheet parsed{parse("/* header */ h1 ,\n h2  >  p {\n  margin : 0 ; /* note */ font: 12px/1.5 \"A  B\" !important\n}")};
+
+            REQUIRE(parsed.size() == 1);
+            REQUIRE(parsed.at(0).get_tag() == "h1 , h2 > p");
+            REQUIRE(parsed.at(0).at(0).get_key() == "margin");
+            REQUIRE(parsed.at(0).at(0).get_value() == "0");
+            REQUIRE(parsed.at(0).at(1).get_value() == "12px/1.5 \"A  B\" !important");
+
+            const std::string at_rules{"@charset \"utf-8\"; @media (max-width: 10px) { a { b: \"}\" } } @font-face { src: url(data:a;b) } div{x:y}"};
+            const Stylesheet with_at_rules{parse(at_rules)};
+
+            REQUIRE(with_at_rules.size() == 4);
+            REQUIRE(with_at_rules.at(0).get_type() == Type::Verbatim);
+            REQUIRE(with_at_rules.at(1).get_tag() == "@media (max-width: 10px) { a { b: \"}\" } }");
+            REQUIRE(with_at_rules.at(2).get_type() == Type::Rule);
+            REQUIRE(with_at_rules.get() == "@charset \"utf-8\";@media (max-width: 10px) { a { b: \"}\" } }@font-face {src: url(data:a;b);}div {x: y;}");
+            REQUIRE(with_at_rules.get(Formatting::Minified) == "@charset \"utf-8\";@media (max-width: 10px) { a { b: \"}\" } }@font-face{src:url(data:a;b)}div{x:y}");
+            REQUIRE(with_at_rules.get(Formatting::Pretty, 1) == "\t@charset \"utf-8\";\n\t@media (max-width: 10px) { a { b: \"}\" } }\n\t@font-face {\n\t\tsrc: url(data:a;b);\n\t}\n\tdiv {\n\t\tx: y;\n\t}\n");
+            REQUIRE(parse(with_at_rules.get(Formatting::Newline)) == with_at_rules);
+            REQUIRE(parse("@import url(a.css) /* b */ screen;p{a:b}").get() == "@import url(a.css) /* b */ screen;p {a: b;}");
+            REQUIRE(parse("p{a:b} @supports (display: grid) { p { a: c }").get() == "p {a: b;}@supports (display: grid) { p { a: c }}");
+
+            Element verbatim{"@layer base;", {}, Type::Verbatim};
+            REQUIRE(verbatim.get(Formatting::Newline) == "@layer base;\n");
+            REQUIRE(verbatim.serialized_size(Formatting::Pretty, 2) == verbatim.get(Formatting::Pretty, 2).size());
+            REQUIRE(verbatim != Element{"@layer base;", {}, Type::Rule});
+            verbatim.clear();
+            REQUIRE(verbatim.get_type() == Type::Rule);
+            REQUIRE(parse("} p { bad; :empty; a: b; c: ").get() == "p {a: b;}");
+            REQUIRE(parse("").empty());
+        };
+
+        const auto test_minified = []() {
+            using namespace docpp::CSS;
+
+            const Element element{".nav  >  a ,  p", {{
+                Property{"margin", "0px  auto 0.5em -0.25px"},
+                Property{"color", "#AAbbcc"},
+                Property{"border-color", "#abcdef"},
+                Property{"width", "calc(0px + 10%)"},
+                Property{"background", "url(#aabbcc) , #112233 !important"},
+                Property{"flex", "0px"},
+                Property{"--gap", " 0px "},
+                Property{"font-family", "\"Open  Sans\",  serif"},
+                Property{"empty", ""},
+            }}};
+
+            REQUIRE(element.get(Formatting::Minified) == ".nav>a,p{margin:0 auto .5em -.25px;color:#Abc;border-color:#abcdef;width:calc(0px + 10%);background:url(#aabbcc),#123!important;flex:0px;--gap: 0px ;font-family:\"Open  Sans\",serif}");
+            REQUIRE(Element{"[title=\"a  b\"]  a:not( .q )", {{Property{"content", "\"x  y\""}}}}.get(Formatting::Minified) == "[title=\"a  b\"] a:not(.q){content:\"x  y\"}");
+            REQUIRE(Element{"p", {{Property{"color", ""}}}}.get(Formatting::Minified).empty());
+            REQUIRE(Element{"p", {{Property{"color", "red"}}}}.get(Formatting::Minified, 2) == "p{color:red}");
+        };
+
+        const auto test_optimize = []() {
+            using namespace docpp::CSS;
+
+            Stylesheet stylesheet{};
+
+            stylesheet.push_back(Element{"a:hover", {{Property{"color", "#ccccff"}, Property{"text-decoration", "underline"}}}});
+            stylesheet.push_back(Element{"a:hover", {{Property{"color", "#ccccff"}, Property{"text-decoration", "underline"}}}});
+            stylesheet.push_back(Element{".x", {{Property{"margin-top", "1px"}}}});
+            stylesheet.push_back(Element{"a:hover", {{Property{"margin", "0"}}}});
+            stylesheet.push_back(Element{"a:hover", {{Property{"color", "red"}}}});
+            stylesheet.push_back(Element{"p", {{Property{"display", "-webkit-box"}, Property{"display", "flex"}, Property{"width", "100px"}, Property{"width", "calc(100% - 1px)"}}}});
+            stylesheet.push_back(Element{"p", {{Property{"color", "red !important"}, Property{"color", "blue"}, Property{"top", "0"}, Property{"top", "1px"}}}});
+            stylesheet.push_back(Element{"@font-face", {{Property{"font-family", "a"}}}});
+            stylesheet.push_back(Element{"@font-face", {{Property{"font-family", "b"}}}});
+            stylesheet.push_back(Element{"div", {{Property{"color", ""}}}});
+
+            stylesheet.optimize();
+
+            REQUIRE(stylesheet.size() == 6);
+            REQUIRE(stylesheet.get(Formatting::Minified) == "a:hover{color:#ccf;text-decoration:underline}.x{margin-top:1px}a:hover{margin:0;color:red}"
+                "p{display:-webkit-box;display:flex;width:100px;width:calc(100% - 1px);color:red!important;top:1px}@font-face{font-family:a}@font-face{font-family:b}");
+
+            Stylesheet selectors{};
+
+            selectors.push_back(Element{".a > .b", {{Property{"color", "red"}}}});
+            selectors.push_back(Element{".a>.b", {{Property{"margin", "0"}}}});
+            selectors.optimize();
+
+            REQUIRE(selectors.size() == 1);
+            REQUIRE(selectors.at(0).get_tag() == ".a > .b");
+            REQUIRE(selectors.at(0).size() == 2);
+
+            // a rule is never moved across a verbatim rule, which may set the same properties
+            Stylesheet barrier{parse("a{color:red}@media print{a{color:blue}}a{margin:0}")};
+            barrier.optimize();
+
+            REQUIRE(barrier.get(Formatting::Minified) == "a{color:red}@media print{a{color:blue}}a{margin:0}");
+        };
+
         test_get_and_set();
         test_copy_section();
         test_operators();
@@ -1839,6 +3689,10 @@ inline namespace CSS {
         test_size_empty_and_clear();
         test_insert();
         test_iterators();
+        test_write_to();
+        test_parse();
+        test_minified();
+        test_optimize();
     }
 
     void test_css() {
@@ -1887,6 +3741,66 @@ inline namespace General {
         REQUIRE(docpp::CSS::Stylesheet::npos == -1);
     }
 
+    void test_hash() {
+        const std::string text{"The quick brown fox jumps over the lazy dog, again and again."};
+
+        docpp::Hash whole{text};
+        docpp::Hash pieces{};
+        docpp::Hash combined{};
+
+        for (std::size_t i{0}; i < text.size(); i += 7) {
+            const std::size_t size{std::min<std::size_t>(7, text.size() - i)};
+
+            pieces.update(text.data() + i, size);
+            combined.append(docpp::Hash{text.data() + i, size});
+        }
+
+        REQUIRE(whole.size() == text.size());
+        REQUIRE(pieces == whole);
+        REQUIRE(combined == whole);
+        REQUIRE(whole.get_64() == combined.get_64());
+        REQUIRE(whole.get_string().size() == 32);
+        REQUIRE(whole.get_etag() == "\"" + whole.get_string() + "\"");
+        REQUIRE(whole != docpp::Hash{text.substr(1)});
+        REQUIRE(docpp::Hash{std::string(1, '\0')} != docpp::Hash{});
+        REQUIRE(docpp::Hash{} == docpp::Hash{std::string{}});
+
+        docpp::Sha256 empty{};
+        docpp::Sha256 abc{};
+        docpp::Sha256 million{};
+        const std::string a(1000, 'a');
+
+        abc.update("abc", 3);
+
+        for (int i{0}; i < 1000; i++) {
+            million.update(a.data(), a.size());
+        }
+
+        REQUIRE(empty.get() == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        REQUIRE(abc.get() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        REQUIRE(million.get() == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+        std::string out{};
+        docpp::StringSink string_sink{out};
+        docpp::HashingSink sink{string_sink, true};
+        docpp::HashingSink plain{};
+
+        sink.write(text.data(), 10);
+        sink.write(text.data() + 10, text.size() - 10, docpp::Hash{text.substr(10)});
+        plain.write(text);
+        sink.flush();
+
+        REQUIRE(out == text);
+        REQUIRE(sink.get_hash() == whole);
+        REQUIRE(plain.get_hash() == whole);
+        REQUIRE(plain.get_sha256().empty());
+
+        docpp::Sha256 digest{};
+        digest.update(text.data(), text.size());
+
+        REQUIRE(sink.get_sha256() == digest.get());
+    }
+
     void test_version() {
         std::tuple<int, int, int> version = docpp::version();
 
@@ -1903,6 +3817,7 @@ SCENARIO("Test general", "[GENERAL]") {
     General::test_exceptions();
     General::test_npos_values();
     General::test_version();
+    General::test_hash();
 }
 
 /**